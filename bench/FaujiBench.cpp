@@ -0,0 +1,588 @@
+#include "Fauji.hpp"
+#include "SoundPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Headless micro benchmarks of the game's hot paths, reported as JSON so that runs of different
+// commits can be compared. Every scenario is seeded, so two runs do exactly the same work.
+
+struct BenchConfig {
+    double fMinSeconds = 0.5; // timed work per scenario
+    uint64_t nSeed = 1;
+    std::string filter;       // only scenarios whose name contains this
+};
+
+struct BenchResult {
+    std::string name;
+    std::string params;
+    long long nOps = 0;
+    long long nItemsPerOp = 1; // objects, pixels, ... handled by one op
+    double fNsPerOp = 0.0;
+    double fMinNsPerOp = 0.0;  // of the fastest batch, the least noisy number
+};
+
+class FaujiBench {
+private:
+    BenchConfig config;
+    std::vector<BenchResult> vecResults;
+
+    // Runs op in batches of nBatch until at least fMinSeconds were timed. setup runs untimed before every
+    // batch, so a scenario that changes the world (carving the terrain for example) can put it back.
+    void measure(const std::string &name, const std::string &params, long long nItemsPerOp, int nBatch,
+                 const std::function<void()> &setup, const std::function<void()> &op) {
+        if (name.find(config.filter) == std::string::npos) return;
+        std::cerr << name << " " << params << std::endl;
+        // one untimed batch to warm up caches and let the allocator settle
+        setup();
+        for (int i = 0; i < nBatch; i++) op();
+
+        BenchResult result;
+        result.name = name;
+        result.params = params;
+        result.nItemsPerOp = nItemsPerOp;
+        double fTotalNs = 0.0;
+        result.fMinNsPerOp = INFINITY;
+        while (fTotalNs < config.fMinSeconds * 1e9) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < nBatch; i++) op();
+            double fBatchNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            fTotalNs += fBatchNs;
+            result.nOps += nBatch;
+            result.fMinNsPerOp = std::min(result.fMinNsPerOp, fBatchNs / nBatch);
+        }
+        result.fNsPerOp = fTotalNs / result.nOps;
+        vecResults.push_back(result);
+    }
+
+    // a headless game with a generated map, without units
+    static void initGame(Fauji &game, uint64_t nSeed, int nMapWidth, int nMapHeight) {
+        game.setMapSize(nMapWidth, nMapHeight);
+        game.setSeed(nSeed);
+        game.onInit();
+        game.createMap();
+    }
+
+    void benchIntegrate(int nObjects) {
+        Fauji game(true);
+        initGame(game, config.nSeed, 1024, 512);
+        Random rng(config.nSeed);
+        for (int i = 0; i < nObjects; i++) {
+            auto debris = std::make_unique<cDebris>(rng.nextFloat() * game.nMapWidth, rng.nextFloat() * game.nMapHeight / 2, rng);
+            debris->nBounceBeforeDeath = -1; // keep the object count constant
+            game.listObjects.push_back(std::move(debris));
+        }
+        std::vector<cDebris> vecStart;
+        for (auto &p: game.listObjects) vecStart.push_back(*static_cast<cDebris *>(p.get()));
+
+        measure("physics/integrate", "objects=" + std::to_string(nObjects), nObjects * 10LL, 10,
+                [&]() {
+                    // every batch starts from the same falling objects, settled ones would be cheaper
+                    size_t i = 0;
+                    for (auto &p: game.listObjects) *static_cast<cDebris *>(p.get()) = vecStart[i++];
+                },
+                [&]() { game.updatePhysics(1.0f / 60.0f); });
+    }
+
+    // bAllSoil turns the land of the map into soil, the map as it was before there were materials
+    void benchBoom(int nRadius, bool bAllSoil) {
+        Fauji game(true);
+        initGame(game, config.nSeed, 1024, 512);
+        std::vector<unsigned char> vecMap(game.map, game.map + game.nMapWidth * game.nMapHeight);
+        if (bAllSoil) {
+            for (unsigned char &nMaterial: vecMap) nMaterial = nMaterial == MATERIAL_SKY ? MATERIAL_SKY : MATERIAL_SOIL;
+        }
+        Random rng(config.nSeed);
+        measure("terrain/boom", "radius=" + std::to_string(nRadius) + (bAllSoil ? ",map=soil" : ",map=layered"), 1, 32,
+                [&]() {
+                    std::copy(vecMap.begin(), vecMap.end(), game.map);
+                    game.listObjects.clear();
+                    rng.setSeed(config.nSeed);
+                },
+                [&]() {
+                    float x = rng.nextFloat() * game.nMapWidth;
+                    float y = game.nMapHeight * (0.5f + 0.5f * rng.nextFloat());
+                    game.BOOM(x, y, static_cast<float>(nRadius));
+                });
+    }
+
+    void benchCreateMap(int nMapWidth, int nMapHeight) {
+        Fauji game(true);
+        initGame(game, config.nSeed, nMapWidth, nMapHeight);
+        measure("terrain/create_map", "size=" + std::to_string(nMapWidth) + "x" + std::to_string(nMapHeight),
+                static_cast<long long>(nMapWidth) * nMapHeight, 1,
+                [&]() { game.setSeed(config.nSeed); },
+                [&]() { game.createMap(); });
+    }
+
+    // The run-length coded terrain of a map with nCraters craters blown into it, or of noise for nCraters < 0,
+    // next to copying the raw map. That it comes back exactly is checked by fauji-tests.
+    void benchTerrainRle(int nCraters) {
+        Fauji game(true);
+        initGame(game, config.nSeed, 1024, 512);
+        Random rng(config.nSeed);
+        for (int i = 0; i < nCraters; i++) {
+            game.BOOM(rng.nextFloat() * game.nMapWidth, game.nMapHeight * (0.3f + 0.7f * rng.nextFloat()),
+                      10.0f + 50.0f * rng.nextFloat());
+        }
+        game.listObjects.clear();
+        int nWidth = game.nMapWidth, nHeight = game.nMapHeight;
+        long long nPixels = static_cast<long long>(nWidth) * nHeight;
+        std::vector<unsigned char> vecMap(game.map, game.map + nPixels);
+        if (nCraters < 0) {
+            for (auto &pixel: vecMap) pixel = static_cast<unsigned char>(rng.nextInt(3));
+        }
+        cTerrainRle terrain;
+        terrain.encode(vecMap.data(), nWidth, nHeight);
+        std::string params = (nCraters < 0 ? std::string("map=noise") : "craters=" + std::to_string(nCraters)) +
+                             ",bytes=" + std::to_string(terrain.getData().size()) + ",raw=" + std::to_string(nPixels);
+        measure("terrain/rle_encode", params, nPixels, 4,
+                []() {},
+                [&]() { terrain.encode(vecMap.data(), nWidth, nHeight); });
+        std::vector<unsigned char> vecDecoded(vecMap.size());
+        measure("terrain/rle_decode", params, nPixels, 4,
+                []() {},
+                [&]() { terrain.decode(vecDecoded.data()); });
+        std::vector<unsigned char> vecColumn(nHeight);
+        measure("terrain/rle_column", params, nHeight, 256,
+                []() {},
+                [&]() { terrain.decodeColumn(rng.nextInt(nWidth), vecColumn.data()); });
+        measure("terrain/raw_copy", params, nPixels, 4,
+                []() {},
+                [&]() { std::copy(vecMap.begin(), vecMap.end(), vecDecoded.begin()); });
+    }
+
+    // The terrain settling after nCraters craters of nRadius blown in at once, the way the nuke's land, or for
+    // nCraters 0 after one crater of nRadius undercutting the highest hill. Timed from the craters until
+    // everything came to rest, an item is a tick. That it comes to rest at all is checked by fauji-tests.
+    void benchTerrainSettle(int nCraters, int nRadius) {
+        Fauji game(true);
+        initGame(game, config.nSeed, 1024, 512);
+        int nWidth = game.nMapWidth, nHeight = game.nMapHeight;
+        Random rng(config.nSeed);
+        for (int i = 0; i < nCraters; i++) {
+            carveCrater(game.map, nWidth, nHeight, rng.nextInt(nWidth), rng.nextInt(nHeight), nRadius);
+        }
+        int nHillX = 0, nHillY = 0;
+        if (nCraters == 0) {
+            int x = static_cast<int>(std::min_element(game.vecColumnTop.begin(), game.vecColumnTop.end()) -
+                                     game.vecColumnTop.begin());
+            nHillX = x + nRadius;
+            nHillY = game.vecColumnTop[x] + nRadius;
+            carveCrater(game.map, nWidth, nHeight, nHillX, nHillY, nRadius);
+        }
+        std::vector<unsigned char> vecCarved(game.map, game.map + nWidth * nHeight);
+        int nReach = getCraterReach(nRadius);
+        rng.setSeed(config.nSeed);
+        auto activate = [&]() {
+            std::copy(vecCarved.begin(), vecCarved.end(), game.map);
+            game.markTerrainChanged(0, 0, nWidth, nHeight);
+            game.terrainSettler.reset(nWidth, nHeight);
+            for (int i = 0; i < nCraters; i++) {
+                int x = rng.nextInt(nWidth), y = rng.nextInt(nHeight);
+                game.terrainSettler.activate(x - nReach, y - nReach, 2 * nReach + 1, 2 * nReach + 1);
+            }
+            rng.setSeed(config.nSeed);
+            if (nCraters == 0) {
+                game.terrainSettler.activate(nHillX - nReach, nHillY - nReach, 2 * nReach + 1, 2 * nReach + 1);
+            }
+        };
+        uint32_t nTick = 0;
+        auto settle = [&]() {
+            while (!game.terrainSettler.isIdle()) {
+                game.terrainSettler.tick(game.map, ++nTick,
+                                         [&](int x, int y, int w, int h) { game.markTerrainChanged(x, y, w, h); });
+            }
+        };
+        activate();
+        int nTicks = 0, nPeakChunks = 0;
+        while (!game.terrainSettler.isIdle()) {
+            nPeakChunks = std::max(nPeakChunks, game.terrainSettler.getActiveChunkCount());
+            game.terrainSettler.tick(game.map, ++nTick, [](int, int, int, int) {});
+            nTicks++;
+        }
+        std::string params = (nCraters == 0 ? std::string("hillside") : "craters=" + std::to_string(nCraters)) +
+                             ",radius=" + std::to_string(nRadius) + ",ticks=" + std::to_string(nTicks) +
+                             ",peak_chunks=" + std::to_string(nPeakChunks);
+        measure("terrain/settle", params, nTicks, 1,
+                [&]() {
+                    activate();
+                    nTick = 0;
+                },
+                settle);
+    }
+
+    void benchPerlinNoise(int nCount) {
+        Fauji game(true);
+        Random rng(config.nSeed);
+        std::vector<float> vecSeed(nCount), vecOutput(nCount);
+        for (auto &f: vecSeed) f = rng.nextFloat();
+        measure("terrain/perlin_noise_1d", "count=" + std::to_string(nCount), nCount, 16,
+                []() {},
+                [&]() { game.perlinNoise1D(nCount, vecSeed.data(), 8, 2.0f, vecOutput.data()); });
+    }
+
+    void benchWireFrame(int nObjects) {
+        Fauji game(true);
+        if (!game.constructSoftwareConsole(800, 450)) return;
+        Random rng(config.nSeed);
+        std::vector<ObjectSnapshot> vecMissiles(nObjects);
+        for (auto &missile: vecMissiles) {
+            cMissile(rng.nextFloat() * 800.0f, rng.nextFloat() * 450.0f, rng.nextFloat() * 20.0f - 10.0f,
+                     rng.nextFloat() * 20.0f - 10.0f).takeSnapshot(missile);
+        }
+        measure("render/wireframe_model", "objects=" + std::to_string(nObjects), nObjects, 4,
+                []() {},
+                [&]() {
+                    for (auto &missile: vecMissiles) cMissile::draw(&game, missile, 0.0f, 0.0f);
+                    game.getFrameArena().reset();
+                });
+    }
+
+    void benchDrawLandscape(int nWidth, int nHeight) {
+        Fauji game(true);
+        initGame(game, config.nSeed, 1024, 512);
+        if (!game.constructSoftwareConsole(nWidth, nHeight)) return;
+        game.onPublishSnapshot();
+        game.renderSnapshots.update();
+        measure("render/landscape", "size=" + std::to_string(nWidth) + "x" + std::to_string(nHeight),
+                static_cast<long long>(nWidth) * nHeight, 1,
+                []() {},
+                [&]() { game.drawLandscape(game.renderSnapshots.readBuffer()); });
+    }
+
+    // Copying what is drawn out of the simulation, with a crater carved before every snapshot (it is the
+    // changed part of the terrain that gets copied)
+    void benchPublishSnapshot(int nObjects) {
+        Fauji game(true);
+        initGame(game, config.nSeed, 1024, 512);
+        Random rng(config.nSeed);
+        for (int i = 0; i < nObjects; i++) {
+            game.listObjects.push_back(std::make_unique<cDebris>(rng.nextFloat() * game.nMapWidth,
+                                                                 rng.nextFloat() * game.nMapHeight, rng));
+        }
+        measure("sim/publish_snapshot", "objects=" + std::to_string(nObjects), 1, 16,
+                []() {},
+                [&]() {
+                    game.markTerrainChanged(rng.nextInt(game.nMapWidth - 60), rng.nextInt(game.nMapHeight - 60),
+                                            60, 60);
+                    game.onPublishSnapshot();
+                    game.renderSnapshots.update();
+                });
+    }
+
+    // A shot of nWeapon dropped onto the map, stepped until everything it released has gone off, on a
+    // fresh copy of the map every time
+    void benchProjectiles(WEAPON nWeapon) {
+        Fauji game(true);
+        initGame(game, config.nSeed, 1024, 512);
+        std::vector<unsigned char> vecMap(game.map, game.map + game.nMapWidth * game.nMapHeight);
+        measure("sim/projectiles", std::string("weapon=") + getWeaponInfo(nWeapon).name, 1, 1,
+                [&]() {
+                    std::copy(vecMap.begin(), vecMap.end(), game.map);
+                    game.listObjects.clear();
+                    game.projectiles.clear();
+                },
+                [&]() {
+                    game.projectiles.spawn(nWeapon, game.nMapWidth / 2.0f, 0.0f, 0.0f, 0.5f);
+                    for (int i = 0; i < 10000 && game.projectiles.size() > 0; i++) {
+                        game.updatePhysics(1.0f / 60.0f);
+                    }
+                });
+    }
+
+    // Saving the whole simulation with nObjects pieces of debris about and a crater's worth of terrain marked
+    // changed before every save, and restoring two states a tick and a crater apart in turns
+    void benchSimulationState(int nObjects) {
+        Fauji game(true);
+        initGame(game, config.nSeed, 1024, 512);
+        Random rng(config.nSeed);
+        for (int i = 0; i < nObjects; i++) {
+            game.listObjects.push_back(std::make_unique<cDebris>(rng.nextFloat() * game.nMapWidth,
+                                                                 rng.nextFloat() * game.nMapHeight / 2, rng));
+        }
+        SimulationState state;
+        measure("sim/save_state", "objects=" + std::to_string(nObjects), nObjects, 16,
+                []() {},
+                [&]() {
+                    game.markTerrainChanged(rng.nextInt(game.nMapWidth - 60), rng.nextInt(game.nMapHeight - 60),
+                                            60, 60);
+                    game.saveState(state);
+                });
+
+        SimulationState vecStates[2];
+        game.saveState(vecStates[0]);
+        game.BOOM(game.nMapWidth / 2.0f, game.nMapHeight / 2.0f, 30.0f);
+        game.updatePhysics(1.0f / 60.0f);
+        game.saveState(vecStates[1]);
+        int nNext = 0;
+        measure("sim/restore_state", "objects=" + std::to_string(nObjects), nObjects, 16,
+                []() {},
+                [&]() {
+                    game.restoreState(vecStates[nNext]);
+                    nNext ^= 1;
+                });
+    }
+
+    // A whole seeded AI-vs-AI match from the start to the end, the way fauji-sweep plays them
+    void benchMatch(int nTeams, int nTeamSize) {
+        measure("sim/match", "teams=" + std::to_string(nTeams) + "x" + std::to_string(nTeamSize), 1, 1,
+                []() {},
+                [&]() {
+                    Fauji game(true);
+                    game.setFixedTimestep(1.0f / 60.0f);
+                    game.setSeed(config.nSeed);
+                    game.setAllTeamsAI(true);
+                    game.setDeterministicAI(true);
+                    game.setAIThreadCount(1);
+                    game.setMaxTicks(36000);
+                    game.setTeams(nTeams, nTeamSize);
+                    if (!game.startSimulation()) return;
+                    while (game.stepSimulation()) {}
+                });
+    }
+
+    // Seeking to random ticks of a spectator stream of a whole match, and playing it tick by tick
+    void benchSpectator(int nTeams, int nTeamSize) {
+        std::stringstream stream;
+        cSpectatorWriter writer(stream);
+        Fauji game(true);
+        game.setFixedTimestep(1.0f / 60.0f);
+        game.setSeed(config.nSeed);
+        game.setAllTeamsAI(true);
+        game.setDeterministicAI(true);
+        game.setAIThreadCount(1);
+        game.setMaxTicks(36000);
+        game.setTeams(nTeams, nTeamSize);
+        game.setSpectatorWriter(&writer);
+        if (!game.startSimulation()) return;
+        while (game.stepSimulation()) {}
+        cSpectatorReader reader;
+        if (!reader.load(stream, "bench")) return;
+        uint32_t nTicks = reader.getLastTick() - reader.getFirstTick() + 1;
+        std::string params = "teams=" + std::to_string(nTeams) + "x" + std::to_string(nTeamSize) + ",ticks=" +
+                             std::to_string(nTicks) + ",bytes=" + std::to_string(reader.getByteCount());
+        Random rng(config.nSeed);
+        measure("spectator/seek", params, 1, 16,
+                []() {},
+                [&]() {
+                    reader.seek(reader.getFirstTick() + rng.nextInt(static_cast<int>(nTicks)));
+                });
+        RenderSnapshot snapshot;
+        measure("spectator/play", params, 1, 256,
+                []() {},
+                [&]() {
+                    uint32_t nNext = reader.getTick() + 1;
+                    reader.seek(nNext > reader.getLastTick() ? reader.getFirstTick() : nNext);
+                    reader.fillSnapshot(snapshot, 800, 450);
+                });
+    }
+
+    // A WAV of nMilliseconds of fading noise, what an explosion sounds like near enough for timing the mixer
+    static std::vector<uint8_t> makeNoiseWav(int nMilliseconds, Random &rng) {
+        const int nRate = 22050;
+        int nSamples = nRate * nMilliseconds / 1000;
+        std::vector<uint8_t> vecWav;
+        auto put = [&vecWav](uint32_t nValue, int nBytes) {
+            for (int i = 0; i < nBytes; i++) vecWav.push_back(static_cast<uint8_t>(nValue >> (8 * i)));
+        };
+        vecWav.insert(vecWav.end(), {'R', 'I', 'F', 'F'});
+        put(36 + nSamples * 2, 4);
+        vecWav.insert(vecWav.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+        put(16, 4);
+        put(1, 2);         // PCM
+        put(1, 2);         // mono
+        put(nRate, 4);
+        put(nRate * 2, 4); // bytes per second
+        put(2, 2);         // bytes per frame
+        put(16, 2);        // bits per sample
+        vecWav.insert(vecWav.end(), {'d', 'a', 't', 'a'});
+        put(nSamples * 2, 4);
+        for (int i = 0; i < nSamples; i++) {
+            float fSample = (rng.nextFloat() * 2.0f - 1.0f) * (1.0f - static_cast<float>(i) / nSamples);
+            put(static_cast<uint16_t>(static_cast<int16_t>(fSample * 20000.0f)), 2);
+        }
+        return vecWav;
+    }
+
+    // nEvents explosions in a frame through the sound pool, on SDL's dummy audio driver. What a frame costs
+    // should hardly depend on nEvents, the pool starts a few voices whatever it is.
+    void benchSoundPool(int nEvents) {
+        if (std::string("audio/sound_pool").find(config.filter) == std::string::npos) return;
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+        if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0 || Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+            std::cout << "No dummy audio device: " << Mix_GetError() << std::endl;
+            return;
+        }
+        Random rng(config.nSeed);
+        std::vector<uint8_t> vecWav = makeNoiseWav(500, rng);
+        Mix_Chunk *chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(vecWav.data(), static_cast<int>(vecWav.size())), 1);
+        SoundPool pool;
+        int nExplosion = -1;
+        if (chunk != nullptr && pool.open()) {
+            nExplosion = pool.addSound(std::make_shared<Sound>(chunk), 3, 4);
+        } else if (chunk != nullptr) {
+            Mix_FreeChunk(chunk);
+        }
+        if (nExplosion >= 0) {
+            auto frame = [&]() {
+                for (int i = 0; i < nEvents; i++) pool.play(nExplosion, 0.2f + 0.8f * rng.nextFloat(), rng.nextFloat() * 2.0f - 1.0f);
+                pool.flush();
+            };
+            frame();
+            std::string params = "events=" + std::to_string(nEvents) + ",voices=" +
+                                 std::to_string(pool.getStats().nVoices);
+            measure("audio/sound_pool", params, nEvents, 64,
+                    []() {},
+                    frame);
+        }
+        pool.close();
+        Mix_CloseAudio();
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+
+    // The men's sprites (every other one dead, so a tomb) through the sprite batch, or each with its own
+    // SDL_RenderCopyEx from separate textures the way they were drawn before there was an atlas
+    void benchSprites(int nObjects, bool bBatched) {
+        Fauji game(true);
+        if (!game.constructSoftwareConsole(800, 450)) return;
+        std::vector<std::pair<std::string, ImageHandle>> vecImages;
+        for (auto &sheet: {std::make_pair("man.png", SDL_Point{256, 205}),
+                           std::make_pair("tomb-removebg.png", SDL_Point{360, 360})}) {
+            auto pixels = std::make_shared<std::vector<unsigned char>>(size_t(sheet.second.x) * sheet.second.y * 4,
+                                                                       0xC0);
+            auto image = std::make_shared<Image>();
+            image->pixels = pixels->data();
+            image->nWidth = sheet.second.x;
+            image->nHeight = sheet.second.y;
+            image->nPitch = sheet.second.x * 4;
+            image->data = pixels;
+            vecImages.emplace_back(sheet.first, image);
+        }
+        auto atlas = std::make_shared<TextureAtlas>();
+        if (!atlas->build(vecImages)) return;
+        cMan::findSprites(*atlas);
+        game.getSpriteBatch().setAtlas(atlas);
+        LTexture vecTextures[2];
+        for (int i = 0; i < 2; i++) {
+            const Image &image = *vecImages[i].second;
+            vecTextures[i].loadTextureFromPixels(image.pixels, image.nWidth, image.nHeight, image.nPitch);
+        }
+
+        Random rng(config.nSeed);
+        std::vector<std::unique_ptr<cMan>> vecMen;
+        for (int i = 0; i < nObjects; i++) {
+            vecMen.push_back(std::make_unique<cMan>(rng.nextFloat() * 800.0f, rng.nextFloat() * 450.0f));
+            vecMen.back()->bDead = i % 2 == 1;
+        }
+        measure("render/sprites", "objects=" + std::to_string(nObjects) + ",batched=" + std::to_string(bBatched),
+                nObjects, 4,
+                []() {},
+                [&]() {
+                    SpriteBatch &batch = game.getSpriteBatch();
+                    for (auto &man: vecMen) {
+                        float fSize = man->radius * 2;
+                        SDL_Rect sheetClip = cMan::spriteClips[0];
+                        SDL_Rect *clip = man->bDead ? nullptr : &sheetClip;
+                        if (bBatched) {
+                            batch.draw(man->bDead ? cMan::nTombRegion : cMan::nSpriteRegion, clip,
+                                       man->px - man->radius, man->py - man->radius, fSize, fSize);
+                        } else {
+                            vecTextures[man->bDead ? 1 : 0].drawTexture(man->px - man->radius, man->py - man->radius,
+                                                                        fSize, fSize, clip);
+                        }
+                    }
+                    batch.flush();
+                });
+    }
+
+public:
+    explicit FaujiBench(const BenchConfig &config) : config(config) {}
+
+    void run() {
+        for (int n: {1000, 10000, 100000}) benchIntegrate(n);
+        for (int r: {10, 30, 60}) {
+            benchBoom(r, true);
+            benchBoom(r, false);
+        }
+        for (int w: {512, 1024, 2048, 4096}) benchCreateMap(w, w / 2);
+        for (int n: {0, 50, -1}) benchTerrainRle(n);
+        benchTerrainSettle(1, 20);
+        benchTerrainSettle(100, 20);
+        benchTerrainSettle(0, 80);
+        for (int n: {256, 1024, 4096, 16384}) benchPerlinNoise(n);
+        for (int n: {100, 1000, 10000}) benchWireFrame(n);
+        benchDrawLandscape(800, 450);
+        for (int n: {100, 1000, 10000}) benchPublishSnapshot(n);
+        for (WEAPON nWeapon: {WEAPON_MISSILE, WEAPON_CLUSTER_BOMB, WEAPON_GRENADE, WEAPON_AIRSTRIKE}) {
+            benchProjectiles(nWeapon);
+        }
+        for (int n: {100, 1000, 10000}) benchSimulationState(n);
+        benchMatch(2, 2);
+        benchSpectator(2, 2);
+        for (int n: {1, 10, 100, 1000}) benchSoundPool(n);
+        for (int n: {100, 1000, 10000}) {
+            benchSprites(n, false);
+            benchSprites(n, true);
+        }
+    }
+
+    std::string toJson() const {
+        std::ostringstream out;
+        out << "{\n  \"seed\": " << config.nSeed << ",\n  \"benchmarks\": [";
+        for (size_t i = 0; i < vecResults.size(); i++) {
+            const BenchResult &r = vecResults[i];
+            char numbers[256];
+            snprintf(numbers, sizeof(numbers),
+                     "\"ops\": %lld, \"items_per_op\": %lld, \"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, "
+                     "\"ops_per_sec\": %.1f, \"ns_per_item\": %.3f",
+                     r.nOps, r.nItemsPerOp, r.fNsPerOp, r.fMinNsPerOp, 1e9 / r.fNsPerOp, r.fNsPerOp / r.nItemsPerOp);
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\", \"params\": \"" << r.params
+                << "\", " << numbers << "}";
+        }
+        out << "\n  ]\n}\n";
+        return out.str();
+    }
+};
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    std::string outPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            config.filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            config.fMinSeconds = std::stod(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.nSeed = std::stoull(argv[++i]);
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else {
+            std::cout << "usage: fauji-bench [--filter name] [--min-time seconds] [--seed n] [--out results.json]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    FaujiBench bench(config);
+    bench.run();
+    if (outPath.empty()) {
+        std::cout << bench.toJson();
+        return 0;
+    }
+    std::ofstream file(outPath, std::ios::trunc);
+    file << bench.toJson();
+    if (!file) {
+        std::cout << "Unable to write " << outPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include "MatchServer.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Plays seeded AI-vs-AI matches for every point of a grid over the GameTuning constants, across all cores,
+// and writes the stats of every match as CSV and/or JSON. A summary per grid point goes to stdout.
+//
+//   fauji-sweep --seeds 200 --grid gravity=1.5,2,2.5 --grid ai-plan-until=5.5,6.5 --csv sweep.csv
+//
+// The AI plans every shot with a fixed number of simulated shots (--ai-shot-budget, 0 for a full search),
+// so the results depend on the seeds and the grid only, never on the machine.
+
+struct SweepAxis {
+    std::string name;
+    std::vector<float> vecValues;
+};
+
+struct SweepConfig {
+    int nSeeds = 100;          // matches per grid point, seeded nFirstSeed on
+    uint64_t nFirstSeed = 1;
+    int nWorkers = 0;
+    int nMatchesPerWorker = 4;
+    MatchSetup setup;          // with the tuning every grid point starts from
+    std::vector<SweepAxis> vecAxes;
+    std::string csvPath;
+    std::string jsonPath;
+};
+
+namespace {
+    // name=value, or name=a,b,c for a grid axis
+    bool parseAssignment(const std::string &text, SweepAxis &axis) {
+        size_t nEquals = text.find('=');
+        if (nEquals == std::string::npos || nEquals + 1 >= text.size()) {
+            std::cout << "Expected name=value, got " << text << std::endl;
+            return false;
+        }
+        axis.name = text.substr(0, nEquals);
+        std::stringstream values(text.substr(nEquals + 1));
+        std::string value;
+        while (std::getline(values, value, ',')) {
+            axis.vecValues.push_back(std::stof(value));
+        }
+        GameTuning tuning;
+        if (!tuning.set(axis.name, 0.0f)) {
+            int nNames;
+            const char *const *names = GameTuning::getNames(nNames);
+            std::cout << "Unknown constant " << axis.name << ", known are:";
+            for (int i = 0; i < nNames; i++) std::cout << " " << names[i];
+            std::cout << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // the values of every axis at grid point nPoint, the last axis changes fastest
+    std::vector<float> getPointValues(const std::vector<SweepAxis> &vecAxes, int nPoint) {
+        std::vector<float> vecValues(vecAxes.size());
+        for (int a = static_cast<int>(vecAxes.size()) - 1; a >= 0; a--) {
+            int nCount = static_cast<int>(vecAxes[a].vecValues.size());
+            vecValues[a] = vecAxes[a].vecValues[nPoint % nCount];
+            nPoint /= nCount;
+        }
+        return vecValues;
+    }
+
+    float getHitRate(const MatchStats &stats) {
+        return stats.nShots > 0 ? static_cast<float>(stats.nShotsHit) / stats.nShots : 0.0f;
+    }
+
+    double getTicksPerSecond(const MatchResult &result) {
+        return result.fSeconds > 0.0 ? result.nTicks / result.fSeconds : 0.0;
+    }
+}
+
+class cSweep {
+public:
+    explicit cSweep(const SweepConfig &config) : config(config) {}
+
+    bool run() {
+        nPoints = 1;
+        for (auto &axis: config.vecAxes) nPoints *= static_cast<int>(axis.vecValues.size());
+        std::vector<MatchSetup> vecSetups;
+        for (int p = 0; p < nPoints; p++) {
+            std::vector<float> vecValues = getPointValues(config.vecAxes, p);
+            MatchSetup setup = config.setup;
+            for (size_t a = 0; a < config.vecAxes.size(); a++) {
+                setup.tuning.set(config.vecAxes[a].name, vecValues[a]);
+            }
+            for (int s = 0; s < config.nSeeds; s++) {
+                setup.nSeed = config.nFirstSeed + s;
+                vecSetups.push_back(setup);
+            }
+        }
+        std::cerr << vecSetups.size() << " matches, " << nPoints << " grid points" << std::endl;
+        cMatchServer server(config.nWorkers, config.nMatchesPerWorker);
+        if (!server.run(vecSetups)) {
+            return false;
+        }
+        vecResults = server.getResults();
+        printSummary(server.getWallSeconds(), server.getWorkerCount());
+        return (config.csvPath.empty() || write(config.csvPath, toCsv())) &&
+               (config.jsonPath.empty() || write(config.jsonPath, toJson()));
+    }
+
+private:
+    SweepConfig config;
+    int nPoints = 1;
+    std::vector<MatchResult> vecResults; // nSeeds per grid point, in grid order
+
+    void printSummary(double fWallSeconds, int nWorkers) const {
+        printf("%zu matches in %.2f s on %d workers, %.1f matches/s\n", vecResults.size(), fWallSeconds, nWorkers,
+               vecResults.size() / fWallSeconds);
+        for (int p = 0; p < nPoints; p++) {
+            std::vector<float> vecValues = getPointValues(config.vecAxes, p);
+            double fTurns = 0.0, fHitRate = 0.0, fGameSeconds = 0.0, fWallMs = 0.0;
+            int nUndecided = 0;
+            for (int s = 0; s < config.nSeeds; s++) {
+                const MatchResult &result = vecResults[p * config.nSeeds + s];
+                fTurns += result.stats.nTurns;
+                fHitRate += getHitRate(result.stats);
+                fGameSeconds += result.nTicks / 60.0;
+                fWallMs += result.fSeconds * 1000.0;
+                nUndecided += result.stats.nWinningTeam < 0;
+            }
+            std::string point;
+            for (size_t a = 0; a < config.vecAxes.size(); a++) {
+                char value[64];
+                snprintf(value, sizeof(value), "%s=%g ", config.vecAxes[a].name.c_str(), vecValues[a]);
+                point += value;
+            }
+            double n = config.nSeeds;
+            printf("%sturns %.1f  hit rate %.2f  match %.0f s  undecided %d  %.1f ms per match\n", point.c_str(),
+                   fTurns / n, fHitRate / n, fGameSeconds / n, nUndecided, fWallMs / n);
+        }
+    }
+
+    std::string toCsv() const {
+        std::ostringstream out;
+        out << "point";
+        for (auto &axis: config.vecAxes) out << "," << axis.name;
+        out << ",seed,ticks,game_seconds,turns,shots,hits,hit_rate,enemy_damage,friendly_damage,winner,wall_ms,"
+               "ticks_per_sec\n";
+        for (size_t m = 0; m < vecResults.size(); m++) {
+            const MatchResult &result = vecResults[m];
+            const MatchStats &stats = result.stats;
+            int nPoint = static_cast<int>(m) / config.nSeeds;
+            out << nPoint;
+            for (float fValue: getPointValues(config.vecAxes, nPoint)) out << "," << fValue;
+            char numbers[256];
+            snprintf(numbers, sizeof(numbers), ",%llu,%u,%.2f,%u,%u,%u,%.3f,%.3f,%.3f,%d,%.3f,%.0f\n",
+                     static_cast<unsigned long long>(config.nFirstSeed + m % config.nSeeds), result.nTicks,
+                     result.nTicks / 60.0, stats.nTurns, stats.nShots, stats.nShotsHit, getHitRate(stats),
+                     stats.fEnemyDamage, stats.fFriendlyDamage, stats.nWinningTeam, result.fSeconds * 1000.0,
+                     getTicksPerSecond(result));
+            out << numbers;
+        }
+        return out.str();
+    }
+
+    std::string toJson() const {
+        std::ostringstream out;
+        out << "{\n  \"seeds\": " << config.nSeeds << ",\n  \"matches\": [";
+        for (size_t m = 0; m < vecResults.size(); m++) {
+            const MatchResult &result = vecResults[m];
+            const MatchStats &stats = result.stats;
+            int nPoint = static_cast<int>(m) / config.nSeeds;
+            std::vector<float> vecValues = getPointValues(config.vecAxes, nPoint);
+            out << (m == 0 ? "\n" : ",\n") << "    {\"point\": " << nPoint << ", \"params\": {";
+            for (size_t a = 0; a < config.vecAxes.size(); a++) {
+                out << (a == 0 ? "" : ", ") << "\"" << config.vecAxes[a].name << "\": " << vecValues[a];
+            }
+            char numbers[384];
+            snprintf(numbers, sizeof(numbers),
+                     "}, \"seed\": %llu, \"ticks\": %u, \"game_seconds\": %.2f, \"turns\": %u, \"shots\": %u, "
+                     "\"hits\": %u, \"hit_rate\": %.3f, \"enemy_damage\": %.3f, \"friendly_damage\": %.3f, "
+                     "\"winner\": %d, \"wall_ms\": %.3f, \"ticks_per_sec\": %.0f}",
+                     static_cast<unsigned long long>(config.nFirstSeed + m % config.nSeeds), result.nTicks,
+                     result.nTicks / 60.0, stats.nTurns, stats.nShots, stats.nShotsHit, getHitRate(stats),
+                     stats.fEnemyDamage, stats.fFriendlyDamage, stats.nWinningTeam, result.fSeconds * 1000.0,
+                     getTicksPerSecond(result));
+            out << numbers;
+        }
+        out << "\n  ]\n}\n";
+        return out.str();
+    }
+
+    static bool write(const std::string &path, const std::string &text) {
+        std::ofstream file(path, std::ios::trunc);
+        file << text;
+        if (!file) {
+            std::cout << "Unable to write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+int main(int argc, char *argv[]) {
+    SweepConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        SweepAxis axis;
+        if (arg == "--seeds" && i + 1 < argc) {
+            config.nSeeds = std::stoi(argv[++i]);
+        } else if (arg == "--first-seed" && i + 1 < argc) {
+            config.nFirstSeed = std::stoull(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            config.nWorkers = std::stoi(argv[++i]);
+        } else if (arg == "--per-worker" && i + 1 < argc) {
+            config.nMatchesPerWorker = std::stoi(argv[++i]);
+        } else if (arg == "--teams" && i + 1 < argc) {
+            config.setup.nTeams = std::stoi(argv[++i]);
+        } else if (arg == "--team-size" && i + 1 < argc) {
+            config.setup.nTeamSize = std::stoi(argv[++i]);
+        } else if (arg == "--max-ticks" && i + 1 < argc) {
+            config.setup.nMaxTicks = std::stoi(argv[++i]);
+        } else if (arg == "--ai-shot-budget" && i + 1 < argc) {
+            config.setup.nAIShotBudget = std::stoi(argv[++i]);
+        } else if (arg == "--set" && i + 1 < argc) {
+            if (!parseAssignment(argv[++i], axis) || axis.vecValues.size() != 1) return 1;
+            config.setup.tuning.set(axis.name, axis.vecValues[0]);
+        } else if (arg == "--grid" && i + 1 < argc) {
+            if (!parseAssignment(argv[++i], axis)) return 1;
+            config.vecAxes.push_back(axis);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            config.csvPath = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            config.jsonPath = argv[++i];
+        } else {
+            std::cout << "usage: fauji-sweep [--seeds n] [--first-seed n] [--workers n] [--per-worker n]\n"
+                         "                   [--teams n] [--team-size n] [--max-ticks n] [--ai-shot-budget n]\n"
+                         "                   [--set name=value]... [--grid name=v1,v2,...]... [--csv file] [--json file]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (config.nSeeds < 1) {
+        std::cout << "A sweep plays at least one seed per grid point" << std::endl;
+        return 1;
+    }
+    cSweep sweep(config);
+    return sweep.run() ? 0 : 1;
+}
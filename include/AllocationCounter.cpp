@@ -0,0 +1,57 @@
+#include "AllocationCounter.hpp"
+#include <SDL.h>
+#include <atomic>
+
+namespace {
+    thread_local uint64_t nThreadAllocations = 0;
+    thread_local uint64_t nThreadBytes = 0;
+    std::atomic<uint64_t> nTotalAllocations{0};
+
+    SDL_malloc_func sdlMalloc = nullptr;
+    SDL_calloc_func sdlCalloc = nullptr;
+    SDL_realloc_func sdlRealloc = nullptr;
+    SDL_free_func sdlFree = nullptr;
+
+    void *countedMalloc(size_t size) {
+        AllocationCounter::count(size);
+        return sdlMalloc(size);
+    }
+
+    void *countedCalloc(size_t nmemb, size_t size) {
+        AllocationCounter::count(nmemb * size);
+        return sdlCalloc(nmemb, size);
+    }
+
+    void *countedRealloc(void *mem, size_t size) {
+        AllocationCounter::count(size);
+        return sdlRealloc(mem, size);
+    }
+
+    void countedFree(void *mem) {
+        sdlFree(mem);
+    }
+}
+
+void AllocationCounter::countSDLAllocations() {
+    if (sdlMalloc != nullptr) return;
+    SDL_GetMemoryFunctions(&sdlMalloc, &sdlCalloc, &sdlRealloc, &sdlFree);
+    SDL_SetMemoryFunctions(countedMalloc, countedCalloc, countedRealloc, countedFree);
+}
+
+uint64_t AllocationCounter::getThreadAllocationCount() {
+    return nThreadAllocations;
+}
+
+uint64_t AllocationCounter::getThreadAllocatedBytes() {
+    return nThreadBytes;
+}
+
+uint64_t AllocationCounter::getTotalAllocationCount() {
+    return nTotalAllocations.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::count(size_t nBytes) {
+    nThreadAllocations++;
+    nThreadBytes += nBytes;
+    nTotalAllocations.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Counts heap allocations. Linking the allocation-hooks object (AllocationHooks.cpp) into an executable
+// replaces the global operator new and delete with versions that count every call before handing it to
+// malloc; without it operator new isn't counted. countSDLAllocations() does the same for the memory SDL and
+// its libraries allocate through SDL_malloc. Counting is a thread local increment, cheap enough to always
+// be on.
+class AllocationCounter {
+public:
+    AllocationCounter() = delete;
+
+    // Routes SDL_malloc and friends through the counters, call before SDL allocates anything
+    static void countSDLAllocations();
+
+    // allocations made by the calling thread since it started
+    static uint64_t getThreadAllocationCount();
+
+    static uint64_t getThreadAllocatedBytes();
+
+    // allocations made by every thread
+    static uint64_t getTotalAllocationCount();
+
+    // counts an allocation that didn't go through operator new or SDL_malloc
+    static void count(size_t nBytes);
+};
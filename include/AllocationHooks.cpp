@@ -0,0 +1,78 @@
+#include "AllocationCounter.hpp"
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete with versions that count every call before handing it to
+// malloc. Not part of the engine library: replacing them is a decision for the whole program, so only the
+// executables that report allocations (--alloc-stats) link this in, see the allocation-hooks target.
+
+namespace {
+    void *allocate(size_t size) {
+        AllocationCounter::count(size);
+        // malloc(0) may return nullptr, operator new may not
+        void *p = std::malloc(size != 0 ? size : 1);
+        if (p == nullptr) throw std::bad_alloc();
+        return p;
+    }
+
+    void *allocateAligned(size_t size, std::align_val_t alignment) {
+        AllocationCounter::count(size);
+        size_t nAlignment = static_cast<size_t>(alignment);
+        // aligned_alloc wants the size to be a multiple of the alignment
+        void *p = std::aligned_alloc(nAlignment, (size + nAlignment - 1) / nAlignment * nAlignment);
+        if (p == nullptr) throw std::bad_alloc();
+        return p;
+    }
+}
+
+void *operator new(size_t size) {
+    return allocate(size);
+}
+
+void *operator new[](size_t size) {
+    return allocate(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+    return allocateAligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { std::free(p); }
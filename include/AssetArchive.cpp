@@ -0,0 +1,200 @@
+#include "AssetArchive.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char MAGIC[4] = {'F', 'P', 'A', 'K'};
+
+    struct ArchiveHeader {
+        char magic[4];
+        uint32_t nVersion;
+        uint32_t nEntryCount;
+        uint32_t nReserved;
+    };
+
+    size_t alignData(size_t nOffset) {
+        return (nOffset + AssetArchive::DATA_ALIGNMENT - 1) / AssetArchive::DATA_ALIGNMENT *
+               AssetArchive::DATA_ALIGNMENT;
+    }
+}
+
+AssetArchive::~AssetArchive() {
+    close();
+}
+
+bool AssetArchive::open(const std::string &path) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        ::close(fd);
+        std::cout << "Unable to read asset archive " << path << std::endl;
+        return false;
+    }
+    void *mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid without the descriptor
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cout << "Unable to map asset archive " << path << std::endl;
+        return false;
+    }
+    mData = static_cast<const unsigned char *>(mapping);
+    mSize = static_cast<size_t>(fileStat.st_size);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    mBuffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    mData = mBuffer.data();
+    mSize = mBuffer.size();
+#endif
+
+    ArchiveHeader header{};
+    if (mSize < sizeof(header)) {
+        std::cout << "Asset archive " << path << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+    memcpy(&header, mData, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.nVersion != VERSION) {
+        std::cout << "Asset archive " << path << " has an unknown format, rebuild it with fauji-pack" << std::endl;
+        close();
+        return false;
+    }
+    if (header.nEntryCount > (mSize - sizeof(header)) / sizeof(AssetEntry)) {
+        std::cout << "Asset archive " << path << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+    mEntries = reinterpret_cast<const AssetEntry *>(mData + sizeof(header));
+    mEntryCount = header.nEntryCount;
+    for (uint32_t i = 0; i < mEntryCount; i++) {
+        const AssetEntry &entry = mEntries[i];
+        bool bInside = entry.nOffset <= mSize && entry.nSize <= mSize - entry.nOffset;
+        bool bTerminated = memchr(entry.name, 0, sizeof(entry.name)) != nullptr;
+        bool bImageFits = entry.nType != ASSET_IMAGE_RGBA32 ||
+                          (entry.nPitch >= entry.nWidth * 4 && uint64_t(entry.nPitch) * entry.nHeight <= entry.nSize);
+        if (!bInside || !bTerminated || !bImageFits) {
+            std::cout << "Asset archive " << path << " is damaged" << std::endl;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AssetArchive::close() {
+#ifndef _WIN32
+    if (mData != nullptr) {
+        munmap(const_cast<unsigned char *>(mData), mSize);
+    }
+#endif
+    mBuffer.clear();
+    mData = nullptr;
+    mSize = 0;
+    mEntries = nullptr;
+    mEntryCount = 0;
+}
+
+bool AssetArchive::isOpen() const {
+    return mData != nullptr;
+}
+
+const AssetEntry *AssetArchive::find(const std::string &name) const {
+    // a handful of entries, looked up once each at startup
+    for (uint32_t i = 0; i < mEntryCount; i++) {
+        if (name == mEntries[i].name) {
+            return &mEntries[i];
+        }
+    }
+    return nullptr;
+}
+
+const unsigned char *AssetArchive::getData(const AssetEntry &entry) const {
+    return mData + entry.nOffset;
+}
+
+uint32_t AssetArchive::getEntryCount() const {
+    return mEntryCount;
+}
+
+bool AssetArchiveWriter::addImage(const std::string &name, uint32_t nWidth, uint32_t nHeight,
+                                  const unsigned char *pixels, uint32_t nPitch) {
+    std::vector<unsigned char> data(size_t(nWidth) * 4 * nHeight);
+    for (uint32_t y = 0; y < nHeight; y++) {
+        memcpy(data.data() + size_t(y) * nWidth * 4, pixels + size_t(y) * nPitch, size_t(nWidth) * 4);
+    }
+    if (!addBlob(name, std::move(data))) {
+        return false;
+    }
+    AssetEntry &entry = vecEntries.back();
+    entry.nType = ASSET_IMAGE_RGBA32;
+    entry.nWidth = nWidth;
+    entry.nHeight = nHeight;
+    entry.nPitch = nWidth * 4;
+    return true;
+}
+
+bool AssetArchiveWriter::addBlob(const std::string &name, std::vector<unsigned char> data) {
+    AssetEntry entry{};
+    if (name.empty() || name.size() >= sizeof(entry.name)) {
+        std::cout << "Asset name '" << name << "' must have 1 to " << sizeof(entry.name) - 1 << " characters"
+                  << std::endl;
+        return false;
+    }
+    for (auto &other: vecEntries) {
+        if (name == other.name) {
+            std::cout << "Asset " << name << " is added twice" << std::endl;
+            return false;
+        }
+    }
+    memcpy(entry.name, name.c_str(), name.size());
+    entry.nType = ASSET_BLOB;
+    entry.nSize = data.size();
+    vecEntries.push_back(entry);
+    vecData.push_back(std::move(data));
+    return true;
+}
+
+bool AssetArchiveWriter::write(const std::string &path) const {
+    ArchiveHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.nVersion = AssetArchive::VERSION;
+    header.nEntryCount = static_cast<uint32_t>(vecEntries.size());
+
+    std::vector<AssetEntry> vecTable = vecEntries;
+    size_t nOffset = alignData(sizeof(header) + sizeof(AssetEntry) * vecTable.size());
+    for (auto &entry: vecTable) {
+        entry.nOffset = nOffset;
+        nOffset = alignData(nOffset + entry.nSize);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "Unable to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(vecTable.data()), sizeof(AssetEntry) * vecTable.size());
+    size_t nWritten = sizeof(header) + sizeof(AssetEntry) * vecTable.size();
+    const char padding[AssetArchive::DATA_ALIGNMENT] = {};
+    for (size_t i = 0; i < vecTable.size(); i++) {
+        file.write(padding, static_cast<std::streamsize>(vecTable[i].nOffset - nWritten));
+        file.write(reinterpret_cast<const char *>(vecData[i].data()), static_cast<std::streamsize>(vecData[i].size()));
+        nWritten = vecTable[i].nOffset + vecData[i].size();
+    }
+    return static_cast<bool>(file);
+}
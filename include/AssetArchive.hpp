@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The game's assets packed into one file by fauji-pack at build time.
+// Layout (host byte order): "FPAK", u32 version, u32 entry count, u32 reserved, the AssetEntry table and
+// then the data of every entry, each starting at a multiple of DATA_ALIGNMENT. Images are stored decoded,
+// as RGBA32 pixels with the colour key already turned into transparency, so loading one is a texture upload.
+// The archive is memory mapped, entries and data are used straight from the mapping and stay valid until
+// close(), fonts and music opened from it must be closed first.
+
+enum ASSET_TYPE : uint32_t {
+    ASSET_BLOB = 0,         // the file as it was, fonts and music
+    ASSET_IMAGE_RGBA32 = 1, // nWidth * nHeight pixels, nPitch bytes per row
+};
+
+struct AssetEntry {
+    char name[48];          // file name without directories, zero terminated
+    uint32_t nType;
+    uint32_t nWidth;
+    uint32_t nHeight;
+    uint32_t nPitch;
+    uint64_t nOffset;       // from the start of the archive
+    uint64_t nSize;
+};
+
+class AssetArchive {
+private:
+    const unsigned char *mData = nullptr;
+    size_t mSize = 0;
+    const AssetEntry *mEntries = nullptr;
+    uint32_t mEntryCount = 0;
+    std::vector<unsigned char> mBuffer; // the archive's content where it can't be mapped
+
+public:
+    static const uint32_t VERSION = 1;
+    static const size_t DATA_ALIGNMENT = 64;
+
+    AssetArchive() = default;
+
+    AssetArchive(const AssetArchive &) = delete;
+    AssetArchive &operator=(const AssetArchive &) = delete;
+
+    ~AssetArchive();
+
+    // Maps the archive at path, returns false (with a message) if it is missing or damaged
+    bool open(const std::string &path);
+
+    void close();
+
+    bool isOpen() const;
+
+    // nullptr if the archive has no entry with this name
+    const AssetEntry *find(const std::string &name) const;
+
+    const unsigned char *getData(const AssetEntry &entry) const;
+
+    uint32_t getEntryCount() const;
+};
+
+// Builds an archive, used by fauji-pack
+class AssetArchiveWriter {
+private:
+    std::vector<AssetEntry> vecEntries;
+    std::vector<std::vector<unsigned char>> vecData;
+
+public:
+    bool addImage(const std::string &name, uint32_t nWidth, uint32_t nHeight, const unsigned char *pixels,
+                  uint32_t nPitch);
+
+    bool addBlob(const std::string &name, std::vector<unsigned char> data);
+
+    bool write(const std::string &path) const;
+};
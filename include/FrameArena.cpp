@@ -0,0 +1,55 @@
+#include "FrameArena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t nSize) {
+    addBlock(nSize);
+}
+
+void FrameArena::addBlock(size_t nMinSize) {
+    Block block;
+    block.nSize = std::max(nMinSize, mBlocks.empty() ? size_t(0) : mBlocks.back().nSize * 2);
+    block.data = std::make_unique<unsigned char[]>(block.nSize);
+    mCapacity += block.nSize;
+    mBlocks.push_back(std::move(block));
+    mUsed = 0;
+}
+
+void *FrameArena::allocate(size_t nBytes, size_t nAlignment) {
+    Block &block = mBlocks.back();
+    uintptr_t nBase = reinterpret_cast<uintptr_t>(block.data.get());
+    size_t nOffset = ((nBase + mUsed + nAlignment - 1) & ~(nAlignment - 1)) - nBase;
+    if (nOffset + nBytes > block.nSize) {
+        // make_unique<unsigned char[]> is aligned for max_align_t, the new block starts aligned
+        addBlock(nBytes + nAlignment);
+        return allocate(nBytes, nAlignment);
+    }
+    mUsed = nOffset + nBytes;
+    mFrameBytes += nBytes;
+    return block.data.get() + nOffset;
+}
+
+void FrameArena::reset() {
+    mPeakBytes = std::max(mPeakBytes, mFrameBytes);
+    if (mBlocks.size() > 1) {
+        // the frame didn't fit, from now on one block holds all of it
+        size_t nSize = mCapacity;
+        mBlocks.clear();
+        mCapacity = 0;
+        addBlock(nSize);
+    }
+    mUsed = 0;
+    mFrameBytes = 0;
+}
+
+size_t FrameArena::getFrameBytes() const {
+    return mFrameBytes;
+}
+
+size_t FrameArena::getPeakBytes() const {
+    return mPeakBytes;
+}
+
+size_t FrameArena::getCapacity() const {
+    return mCapacity;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for memory that only lives until the end of the frame.
+// allocate() moves a pointer forward, deallocate() does nothing and reset() (called by the engine after the
+// frame is presented) makes the whole arena available again. A frame that needs more than the arena holds
+// gets extra blocks from the heap, reset() then replaces all blocks by one big enough for that frame, so
+// after the first few frames the arena stops allocating altogether. Only to be used from one thread.
+class FrameArena {
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t nSize = 0;
+    };
+
+    std::vector<Block> mBlocks;
+    size_t mUsed = 0;     // in the last block
+    size_t mCapacity = 0; // of all blocks together
+    size_t mFrameBytes = 0;
+    size_t mPeakBytes = 0;
+
+    void addBlock(size_t nMinSize);
+
+public:
+    static const size_t DEFAULT_SIZE = 256 * 1024;
+
+    explicit FrameArena(size_t nSize = DEFAULT_SIZE);
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void *allocate(size_t nBytes, size_t nAlignment = alignof(std::max_align_t));
+
+    // everything allocated since the last reset is gone
+    void reset();
+
+    // bytes handed out since the last reset
+    size_t getFrameBytes() const;
+
+    // the most any frame has used so far
+    size_t getPeakBytes() const;
+
+    size_t getCapacity() const;
+};
+
+// Lets standard containers allocate from a FrameArena. Freeing is a no-op, so a container that grows
+// leaves its old buffer behind until the arena is reset; reserve() up front where the size is known.
+template<class T>
+class ArenaAllocator {
+private:
+    FrameArena *mArena;
+
+    template<class U> friend class ArenaAllocator;
+
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(FrameArena &arena) : mArena(&arena) {}
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : mArena(other.mArena) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(mArena->allocate(n * sizeof(T), alignof(T))); }
+
+    void deallocate(T *, size_t) {}
+
+    template<class U>
+    bool operator==(const ArenaAllocator<U> &other) const { return mArena == other.mArena; }
+
+    template<class U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return mArena != other.mArena; }
+};
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
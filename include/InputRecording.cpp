@@ -0,0 +1,280 @@
+#include "InputRecording.hpp"
+#include <cstring>
+
+namespace {
+    const char REPLAY_MAGIC[4] = {'F', 'R', 'P', 'L'}; // no terminating NUL, a file starts with these 4 bytes
+    static_assert(sizeof(REPLAY_MAGIC) == 4, "the replay header has 4 magic bytes");
+    const uint8_t REPLAY_VERSION = 1;
+
+    enum RecordTag : uint8_t {
+        REC_END = 0,
+        REC_IDLE = 1,
+        REC_TICK = 2
+    };
+
+    const int EVENT_TYPES[] = {SDL_KEYDOWN, SDL_KEYUP, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONUP, SDL_MOUSEMOTION};
+    const int NUM_EVENT_TYPES = sizeof(EVENT_TYPES) / sizeof(EVENT_TYPES[0]);
+
+    void putU8(std::vector<uint8_t> &out, uint8_t v) { out.push_back(v); }
+
+    void putVarint(std::vector<uint8_t> &out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    void putZigzag(std::vector<uint8_t> &out, int64_t v) {
+        putVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    }
+
+    void putU64(std::vector<uint8_t> &out, uint64_t v) {
+        for (int i = 0; i < 8; i++) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    void putF32(std::vector<uint8_t> &out, float f) {
+        uint32_t v;
+        std::memcpy(&v, &f, sizeof(v));
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    // Reads from a byte buffer, every getter returns false instead of reading past the end
+    struct ByteReader {
+        const std::vector<uint8_t> &data;
+        size_t &pos;
+
+        bool u8(uint8_t &v) {
+            if (pos >= data.size()) return false;
+            v = data[pos++];
+            return true;
+        }
+
+        bool varint(uint64_t &v) {
+            v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t b;
+                if (!u8(b)) return false;
+                v |= static_cast<uint64_t>(b & 0x7F) << shift;
+                if ((b & 0x80) == 0) return true;
+            }
+            return false;
+        }
+
+        bool zigzag(int64_t &v) {
+            uint64_t u;
+            if (!varint(u)) return false;
+            v = static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+            return true;
+        }
+
+        bool u64(uint64_t &v) {
+            if (pos + 8 > data.size()) return false;
+            v = 0;
+            for (int i = 0; i < 8; i++) v |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+            return true;
+        }
+
+        bool f32(float &f) {
+            if (pos + 4 > data.size()) return false;
+            uint32_t v = 0;
+            for (int i = 0; i < 4; i++) v |= static_cast<uint32_t>(data[pos++]) << (8 * i);
+            std::memcpy(&f, &v, sizeof(f));
+            return true;
+        }
+    };
+}
+
+InputRecorder::~InputRecorder() {
+    close();
+}
+
+bool InputRecorder::open(const std::string &path, uint64_t seed, float fTickTime) {
+    close();
+    mFile.open(path, std::ios::binary | std::ios::trunc);
+    if (!mFile) {
+        std::cout << "Unable to open replay file " << path << " for writing" << std::endl;
+        return false;
+    }
+    mTickTime = fTickTime;
+    mIdleTicks = 0;
+    mBuffer.clear();
+    // a byte at a time, a range insert into the buffer just cleared trips gcc's -Warray-bounds
+    for (char c: REPLAY_MAGIC) putU8(mBuffer, static_cast<uint8_t>(c));
+    putU8(mBuffer, REPLAY_VERSION);
+    putU64(mBuffer, seed);
+    putF32(mBuffer, fTickTime);
+    flushBuffer();
+    return true;
+}
+
+bool InputRecorder::isOpen() const {
+    return mFile.is_open();
+}
+
+void InputRecorder::addEvents(const std::vector<InputEvent> &vecEvents) {
+    mTickEvents.insert(mTickEvents.end(), vecEvents.begin(), vecEvents.end());
+}
+
+void InputRecorder::addGameData(const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    mTickBlobs.emplace_back(bytes, bytes + size);
+}
+
+void InputRecorder::endTick(float fTickTime) {
+    if (!isOpen()) return;
+    if (mTickEvents.empty() && mTickBlobs.empty() && fTickTime == mTickTime) {
+        mIdleTicks++;
+        return;
+    }
+    flushIdle();
+    putU8(mBuffer, REC_TICK);
+    putF32(mBuffer, fTickTime);
+    putVarint(mBuffer, mTickEvents.size());
+    for (auto &event: mTickEvents) {
+        int nType = 0;
+        while (nType < NUM_EVENT_TYPES && EVENT_TYPES[nType] != event.eventType) nType++;
+        putU8(mBuffer, static_cast<uint8_t>(nType | (event.bRepeat ? 0x8 : 0)));
+        putVarint(mBuffer, static_cast<uint32_t>(event.buttonCode));
+        putVarint(mBuffer, static_cast<uint32_t>(event.scancode));
+        putZigzag(mBuffer, event.mousePosX);
+        putZigzag(mBuffer, event.mousePosY);
+    }
+    putVarint(mBuffer, mTickBlobs.size());
+    for (auto &blob: mTickBlobs) {
+        putVarint(mBuffer, blob.size());
+        mBuffer.insert(mBuffer.end(), blob.begin(), blob.end());
+    }
+    mTickEvents.clear();
+    mTickBlobs.clear();
+    if (mBuffer.size() > 4096) {
+        flushBuffer();
+    }
+}
+
+void InputRecorder::flushIdle() {
+    if (mIdleTicks > 0) {
+        putU8(mBuffer, REC_IDLE);
+        putVarint(mBuffer, mIdleTicks);
+        mIdleTicks = 0;
+    }
+}
+
+void InputRecorder::flushBuffer() {
+    mFile.write(reinterpret_cast<const char *>(mBuffer.data()), static_cast<std::streamsize>(mBuffer.size()));
+    mBuffer.clear();
+}
+
+void InputRecorder::close() {
+    if (!isOpen()) return;
+    flushIdle();
+    putU8(mBuffer, REC_END);
+    flushBuffer();
+    mFile.close();
+}
+
+bool InputReplayer::open(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Unable to open replay file " << path << std::endl;
+        return false;
+    }
+    mData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    mPos = 0;
+    mIdleTicks = 0;
+    mEnded = true;
+
+    ByteReader reader = {mData, mPos};
+    uint8_t version = 0;
+    if (mData.size() < 4 || std::memcmp(mData.data(), REPLAY_MAGIC, 4) != 0) {
+        std::cout << path << " is not a replay file" << std::endl;
+        return false;
+    }
+    mPos = 4;
+    if (!reader.u8(version) || version != REPLAY_VERSION || !reader.u64(mSeed) || !reader.f32(mTickTime)) {
+        std::cout << "Unsupported or truncated replay file " << path << std::endl;
+        return false;
+    }
+    mEnded = false;
+    return true;
+}
+
+bool InputReplayer::isOpen() const {
+    return !mEnded;
+}
+
+uint64_t InputReplayer::getSeed() const {
+    return mSeed;
+}
+
+float InputReplayer::getTickTime() const {
+    return mTickTime;
+}
+
+bool InputReplayer::nextTick(float &fTickTime, std::vector<InputEvent> &vecEvents,
+                             std::vector<std::vector<uint8_t>> &vecBlobs) {
+    vecEvents.clear();
+    vecBlobs.clear();
+    if (mEnded) return false;
+    if (mIdleTicks > 0) {
+        mIdleTicks--;
+        fTickTime = mTickTime;
+        return true;
+    }
+
+    ByteReader reader = {mData, mPos};
+    uint8_t tag;
+    if (!reader.u8(tag)) {
+        mEnded = true;
+        return false;
+    }
+    if (tag == REC_IDLE) {
+        if (!reader.varint(mIdleTicks) || mIdleTicks == 0) {
+            mEnded = true;
+            return false;
+        }
+        mIdleTicks--;
+        fTickTime = mTickTime;
+        return true;
+    }
+    if (tag != REC_TICK) {
+        mEnded = true;
+        return false;
+    }
+
+    uint64_t nEvents = 0;
+    uint64_t nBlobs = 0;
+    bool bOk = reader.f32(fTickTime) && reader.varint(nEvents);
+    for (uint64_t i = 0; bOk && i < nEvents; i++) {
+        uint8_t typeAndFlags;
+        uint64_t button, scancode;
+        int64_t x, y;
+        bOk = reader.u8(typeAndFlags) && reader.varint(button) && reader.varint(scancode) &&
+              reader.zigzag(x) && reader.zigzag(y) && (typeAndFlags & 0x7) < NUM_EVENT_TYPES;
+        if (bOk) {
+            InputEvent event;
+            event.eventType = EVENT_TYPES[typeAndFlags & 0x7];
+            event.bRepeat = (typeAndFlags & 0x8) != 0;
+            event.buttonCode = static_cast<int>(static_cast<uint32_t>(button));
+            event.scancode = static_cast<int>(scancode);
+            event.mousePosX = static_cast<int>(x);
+            event.mousePosY = static_cast<int>(y);
+            vecEvents.push_back(event);
+        }
+    }
+    bOk = bOk && reader.varint(nBlobs);
+    for (uint64_t i = 0; bOk && i < nBlobs; i++) {
+        uint64_t nSize;
+        bOk = reader.varint(nSize) && mPos + nSize <= mData.size();
+        if (bOk) {
+            vecBlobs.emplace_back(mData.begin() + mPos, mData.begin() + mPos + nSize);
+            mPos += nSize;
+        }
+    }
+    if (!bOk) {
+        std::cout << "Replay file is truncated" << std::endl;
+        mEnded = true;
+        return false;
+    }
+    return true;
+}
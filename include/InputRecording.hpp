@@ -0,0 +1,72 @@
+#pragma once
+
+#include "SimpleGameEngine.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Replay file layout, all numbers little endian:
+//   header:  "FRPL" | u8 version | u64 rng seed | f32 default tick time
+//   records: u8 tag followed by
+//     REC_IDLE  varint n                       n ticks at the default tick time without input or game data
+//     REC_TICK  f32 tick time | varint nEvents | events | varint nBlobs | (varint size | bytes) per blob
+//     REC_END
+//   event:   u8 (type index | repeat << 3) | varint button code | varint scancode | zigzag varint x | zigzag varint y
+// Most ticks of a match have no input at all and collapse into a single REC_IDLE record.
+
+// Writes the inputs of every simulation tick to a replay file
+class InputRecorder {
+private:
+    std::ofstream mFile;
+    float mTickTime = 0.0f;
+    uint64_t mIdleTicks = 0;
+    std::vector<InputEvent> mTickEvents;
+    std::vector<std::vector<uint8_t>> mTickBlobs;
+    std::vector<uint8_t> mBuffer;
+
+    void flushIdle();
+
+    void flushBuffer();
+
+public:
+    ~InputRecorder();
+
+    bool open(const std::string &path, uint64_t seed, float fTickTime);
+
+    bool isOpen() const;
+
+    // events that are about to be dispatched in the current tick
+    void addEvents(const std::vector<InputEvent> &vecEvents);
+
+    // opaque game data (for example a decision the AI made on another thread) that the game
+    // needs to get back at exactly this tick when replaying
+    void addGameData(const void *data, size_t size);
+
+    void endTick(float fTickTime);
+
+    void close();
+};
+
+// Reads a replay file back, one tick at a time
+class InputReplayer {
+private:
+    std::vector<uint8_t> mData;
+    size_t mPos = 0;
+    uint64_t mSeed = 0;
+    float mTickTime = 0.0f;
+    uint64_t mIdleTicks = 0;
+    bool mEnded = true;
+
+public:
+    bool open(const std::string &path);
+
+    bool isOpen() const;
+
+    uint64_t getSeed() const;
+
+    float getTickTime() const;
+
+    // Fills in the next tick, returns false once the recording is over
+    bool nextTick(float &fTickTime, std::vector<InputEvent> &vecEvents, std::vector<std::vector<uint8_t>> &vecBlobs);
+};
@@ -0,0 +1,114 @@
+#include "ObjectPool.hpp"
+#include <atomic>
+#include <mutex>
+
+namespace {
+    struct FreeSlot {
+        FreeSlot *next;
+    };
+
+    const size_t NUM_SIZE_CLASSES = ObjectPool::MAX_SIZE / ObjectPool::GRANULARITY;
+
+    // The slots a thread has freed, only ever touched by that thread, so allocating and freeing take no
+    // lock. Trivially destructible on purpose: objects may still be released while static destructors run.
+    struct ThreadLists {
+        FreeSlot *freeLists[NUM_SIZE_CLASSES];
+        bool bOwned; // see ThreadListsOwner
+    };
+    thread_local ThreadLists threadLists = {};
+
+    // What threads that have ended left behind, taken up by a thread whose own list of that size ran dry
+    struct SharedLists {
+        std::mutex mtx;
+        FreeSlot *freeLists[NUM_SIZE_CLASSES] = {};
+    };
+
+    SharedLists &sharedLists() {
+        // never destroyed, threads may still end while static destructors run
+        static SharedLists *lists = new SharedLists();
+        return *lists;
+    }
+
+    std::atomic<size_t> nReservedBytes(0);
+
+    // Hands the ending thread's slots over to the shared lists
+    struct ThreadListsOwner {
+        ~ThreadListsOwner() {
+            SharedLists &shared = sharedLists();
+            std::lock_guard<std::mutex> lock(shared.mtx);
+            for (size_t nClass = 0; nClass < NUM_SIZE_CLASSES; nClass++) {
+                FreeSlot *&list = threadLists.freeLists[nClass];
+                while (list != nullptr) {
+                    FreeSlot *slot = list;
+                    list = slot->next;
+                    slot->next = shared.freeLists[nClass];
+                    shared.freeLists[nClass] = slot;
+                }
+            }
+        }
+    };
+    thread_local ThreadListsOwner threadListsOwner;
+
+    size_t sizeClassOf(size_t nBytes) {
+        return (nBytes + ObjectPool::GRANULARITY - 1) / ObjectPool::GRANULARITY - 1;
+    }
+
+    // Fills the calling thread's empty list of nClass, from the shared list if it has anything, from the heap
+    // otherwise
+    void refill(size_t nClass) {
+        if (!threadLists.bOwned) {
+            // constructs the owner, so the lists are handed over when the thread ends. Only once, it may
+            // already be gone again when a thread allocates during its last moments.
+            threadLists.bOwned = true;
+            static_cast<void>(&threadListsOwner);
+        }
+        FreeSlot *&list = threadLists.freeLists[nClass];
+        {
+            SharedLists &shared = sharedLists();
+            std::lock_guard<std::mutex> lock(shared.mtx);
+            if (shared.freeLists[nClass] != nullptr) {
+                list = shared.freeLists[nClass];
+                shared.freeLists[nClass] = nullptr;
+                return;
+            }
+        }
+        // carve a new chunk into slots, chunks are never given back
+        size_t nSlotSize = (nClass + 1) * ObjectPool::GRANULARITY;
+        auto *chunk = static_cast<unsigned char *>(::operator new(ObjectPool::CHUNK_BYTES));
+        nReservedBytes += ObjectPool::CHUNK_BYTES;
+        for (size_t nOffset = 0; nOffset + nSlotSize <= ObjectPool::CHUNK_BYTES; nOffset += nSlotSize) {
+            auto *slot = reinterpret_cast<FreeSlot *>(chunk + nOffset);
+            slot->next = list;
+            list = slot;
+        }
+    }
+}
+
+void *ObjectPool::allocate(size_t nBytes) {
+    if (nBytes == 0 || nBytes > MAX_SIZE) return ::operator new(nBytes);
+    size_t nClass = sizeClassOf(nBytes);
+    FreeSlot *&list = threadLists.freeLists[nClass];
+    if (list == nullptr) {
+        refill(nClass);
+    }
+    FreeSlot *slot = list;
+    list = slot->next;
+    return slot;
+}
+
+void ObjectPool::deallocate(void *p, size_t nBytes) {
+    if (p == nullptr) return;
+    if (nBytes == 0 || nBytes > MAX_SIZE) {
+        ::operator delete(p);
+        return;
+    }
+    // a slot freed by another thread than the one that allocated it simply changes hands
+    size_t nClass = sizeClassOf(nBytes);
+    auto *slot = static_cast<FreeSlot *>(p);
+    slot->next = threadLists.freeLists[nClass];
+    threadLists.freeLists[nClass] = slot;
+}
+
+size_t ObjectPool::getReservedBytes() {
+    return nReservedBytes.load();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+// Free lists of fixed size slots for objects that are created and destroyed all the time (missiles,
+// debris, the list nodes holding them). Sizes are rounded up to a multiple of GRANULARITY and every size
+// class has its own free list, fed with CHUNK_BYTES at a time. Memory goes back to the free list, never to
+// the heap, so once the pool has grown to the busiest moment of a match spawning allocates nothing.
+// Bigger requests go straight to operator new.
+// Every thread keeps free lists of its own, matches running side by side on different threads don't
+// contend for a lock. The slots of a thread that ends go to the next thread that runs out.
+class ObjectPool {
+public:
+    static const size_t GRANULARITY = 16;
+    static const size_t MAX_SIZE = 512;
+    static const size_t CHUNK_BYTES = 64 * 1024;
+
+    ObjectPool() = delete;
+
+    static void *allocate(size_t nBytes);
+
+    // nBytes has to be the size that was allocated
+    static void deallocate(void *p, size_t nBytes);
+
+    // bytes taken from the heap so far
+    static size_t getReservedBytes();
+};
+
+// For classes whose objects should come out of the ObjectPool. With a virtual destructor the size passed to
+// operator delete is the one of the derived class, so deriving from Pooled once covers a whole hierarchy.
+class Pooled {
+public:
+    static void *operator new(size_t nBytes) { return ObjectPool::allocate(nBytes); }
+
+    static void operator delete(void *p, size_t nBytes) { ObjectPool::deallocate(p, nBytes); }
+};
+
+// Allocator for node based containers (std::list, std::map), single nodes come out of the ObjectPool
+template<class T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+
+    template<class U>
+    PoolAllocator(const PoolAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        static_assert(alignof(T) <= ObjectPool::GRANULARITY, "the pool's slots are only 16 byte aligned");
+        if (n == 1) return static_cast<T *>(ObjectPool::allocate(sizeof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (n == 1) {
+            ObjectPool::deallocate(p, sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    template<class U>
+    bool operator==(const PoolAllocator<U> &) const { return true; }
+
+    template<class U>
+    bool operator!=(const PoolAllocator<U> &) const { return false; }
+};
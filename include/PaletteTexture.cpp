@@ -0,0 +1,69 @@
+#include "PaletteTexture.hpp"
+#include "Trace.hpp"
+#include <iostream>
+
+extern SDL_Renderer *gRenderer;
+
+PaletteTexture::PaletteTexture() {
+    // opaque black
+    for (Uint32 &nColor: mPalette) nColor = 0xFF000000u;
+}
+
+PaletteTexture::~PaletteTexture() {
+    free();
+}
+
+void PaletteTexture::setColor(uint8_t nIndex, Color color) {
+    mPalette[nIndex] = 0xFF000000u | static_cast<Uint32>(color.r & 0xFF) << 16 |
+                       static_cast<Uint32>(color.g & 0xFF) << 8 | static_cast<Uint32>(color.b & 0xFF);
+}
+
+bool PaletteTexture::update(const uint8_t *pIndices, int nWidth, int nHeight, int nPitch) {
+    TRACE_SCOPE("upload palette texture");
+    if (nWidth <= 0 || nHeight <= 0) {
+        free();
+        return true;
+    }
+    if (mTexture == nullptr || nWidth != mWidth || nHeight != mHeight) {
+        free();
+        mTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, nWidth,
+                                     nHeight);
+        if (mTexture == nullptr) {
+            std::cout << "Unable to create texture! SDL Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        mWidth = nWidth;
+        mHeight = nHeight;
+    }
+    void *pPixels;
+    int nTexturePitch;
+    if (SDL_LockTexture(mTexture, nullptr, &pPixels, &nTexturePitch) != 0) {
+        std::cout << "Unable to lock texture! SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    for (int y = 0; y < nHeight; y++) {
+        const uint8_t *src = pIndices + static_cast<size_t>(y) * nPitch;
+        Uint32 *dst = reinterpret_cast<Uint32 *>(static_cast<unsigned char *>(pPixels) +
+                                                  static_cast<size_t>(y) * nTexturePitch);
+        for (int x = 0; x < nWidth; x++) dst[x] = mPalette[src[x]];
+    }
+    SDL_UnlockTexture(mTexture);
+    return true;
+}
+
+bool PaletteTexture::draw(int x, int y) const {
+    if (mTexture == nullptr) {
+        return true;
+    }
+    const SDL_Rect dst = {x, y, mWidth, mHeight};
+    return SDL_RenderCopy(gRenderer, mTexture, nullptr, &dst) == 0;
+}
+
+void PaletteTexture::free() {
+    if (mTexture != nullptr) {
+        SDL_DestroyTexture(mTexture);
+        mTexture = nullptr;
+    }
+    mWidth = 0;
+    mHeight = 0;
+}
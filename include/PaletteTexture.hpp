@@ -0,0 +1,34 @@
+#pragma once
+
+#include "SimpleGameEngine.hpp"
+#include <cstdint>
+
+// A streaming texture drawn out of a bitmap of 8-bit indices through a palette of 256 colours, one lock and
+// one copy a frame rather than an SDL call a pixel. Indices the palette wasn't given a colour for are black.
+class PaletteTexture {
+public:
+    PaletteTexture();
+
+    ~PaletteTexture();
+
+    PaletteTexture(const PaletteTexture &) = delete;
+
+    PaletteTexture &operator=(const PaletteTexture &) = delete;
+
+    void setColor(uint8_t nIndex, Color color);
+
+    // The texture becomes the nWidth x nHeight indices at pIndices, rows nPitch bytes apart. It is made anew
+    // when the size changes.
+    bool update(const uint8_t *pIndices, int nWidth, int nHeight, int nPitch);
+
+    // at (x, y) on the screen, at the size it was last updated to
+    bool draw(int x, int y) const;
+
+    void free();
+
+private:
+    SDL_Texture *mTexture = nullptr;
+    int mWidth = 0;
+    int mHeight = 0;
+    Uint32 mPalette[256];
+};
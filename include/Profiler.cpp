@@ -0,0 +1,173 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct Phase {
+        std::string name;
+        float fFrameMs = 0.0f;                       // time spent in the current frame
+        float fWindow[Profiler::WINDOW_FRAMES] = {}; // per-frame totals of the last frames
+    };
+
+    struct ProfilerState {
+        std::mutex mtx; // the simulation thread adds its time while the render thread ends frames
+        std::vector<Phase> vecPhases;
+        int nFrames = 0; // frames ended so far
+        std::string csvPath;
+        // nHistoryFrames rows of MAX_PHASES times not written yet, only kept if csvPath is set
+        std::vector<float> vecHistory;
+        int nHistoryFrames = 0;
+        std::ofstream csvFile;         // opened when the first chunk is written
+        int nCsvColumns = 0;           // phases in the file's header
+        int nCsvFramesWritten = 0;
+        bool bCsvFailed = false;
+    };
+
+    // Phases get registered from static initialisers of other translation units, so the state has to
+    // be constructed on first use
+    ProfilerState &state() {
+        static ProfilerState profilerState;
+        return profilerState;
+    }
+
+    std::atomic<bool> bProfilerEnabled(true);
+
+    // Writes the frames kept in the history to the CSV, the header first if it is the first chunk. Called with
+    // the lock held.
+    bool flushCsv(ProfilerState &s) {
+        if (s.bCsvFailed) return false;
+        if (!s.csvFile.is_open()) {
+            s.csvFile.open(s.csvPath, std::ios::trunc);
+            if (!s.csvFile) {
+                std::cout << "Unable to open " << s.csvPath << " for writing the frame profile" << std::endl;
+                s.bCsvFailed = true;
+                return false;
+            }
+            s.nCsvColumns = static_cast<int>(s.vecPhases.size());
+            s.csvFile << "frame_number";
+            for (int i = 0; i < s.nCsvColumns; i++) s.csvFile << "," << s.vecPhases[i].name;
+            s.csvFile << "\n";
+        }
+        for (int nFrame = 0; nFrame < s.nHistoryFrames; nFrame++) {
+            const float *row = s.vecHistory.data() + static_cast<size_t>(nFrame) * Profiler::MAX_PHASES;
+            s.csvFile << s.nCsvFramesWritten++;
+            for (int i = 0; i < s.nCsvColumns; i++) s.csvFile << "," << row[i];
+            s.csvFile << "\n";
+        }
+        s.nHistoryFrames = 0;
+        if (!s.csvFile) {
+            std::cout << "Unable to write the frame profile to " << s.csvPath << std::endl;
+            s.bCsvFailed = true;
+        }
+        return !s.bCsvFailed;
+    }
+
+    float percentile(std::vector<float> &vecSorted, float fFraction) {
+        if (vecSorted.empty()) return 0.0f;
+        size_t nIndex = static_cast<size_t>(fFraction * (vecSorted.size() - 1) + 0.5f);
+        return vecSorted[nIndex];
+    }
+}
+
+int Profiler::registerPhase(const char *name) {
+    std::lock_guard<std::mutex> lock(state().mtx);
+    std::vector<Phase> &vecPhases = state().vecPhases;
+    for (int i = 0; i < static_cast<int>(vecPhases.size()); i++) {
+        if (vecPhases[i].name == name) return i;
+    }
+    if (vecPhases.size() == MAX_PHASES) {
+        std::cout << "Too many profiler phases, not timing " << name << std::endl;
+        return -1;
+    }
+    vecPhases.emplace_back();
+    vecPhases.back().name = name;
+    return static_cast<int>(vecPhases.size()) - 1;
+}
+
+void Profiler::addTime(int nPhase, std::chrono::steady_clock::duration duration) {
+    if (nPhase < 0 || !bProfilerEnabled.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(state().mtx);
+    state().vecPhases[nPhase].fFrameMs += std::chrono::duration<float, std::milli>(duration).count();
+}
+
+void Profiler::setEnabled(bool bEnabled) {
+    bProfilerEnabled = bEnabled;
+}
+
+void Profiler::endFrame() {
+    if (!bProfilerEnabled.load(std::memory_order_relaxed)) return;
+    ProfilerState &s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    int nSlot = s.nFrames % WINDOW_FRAMES;
+    // phases registered after this frame have no time in it
+    float *row = s.csvPath.empty() ? nullptr
+                                   : s.vecHistory.data() + static_cast<size_t>(s.nHistoryFrames) * MAX_PHASES;
+    for (size_t i = 0; i < s.vecPhases.size(); i++) {
+        Phase &phase = s.vecPhases[i];
+        phase.fWindow[nSlot] = phase.fFrameMs;
+        if (row != nullptr) row[i] = phase.fFrameMs;
+        phase.fFrameMs = 0.0f;
+    }
+    s.nFrames++;
+    if (row != nullptr && ++s.nHistoryFrames == CSV_CHUNK_FRAMES) {
+        flushCsv(s);
+    }
+}
+
+void Profiler::setCsvPath(const std::string &path) {
+    ProfilerState &s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    if (s.csvFile.is_open()) s.csvFile.close();
+    s.csvPath = path;
+    s.vecHistory.assign(path.empty() ? 0 : static_cast<size_t>(CSV_CHUNK_FRAMES) * MAX_PHASES, 0.0f);
+    s.nHistoryFrames = 0;
+    s.nCsvColumns = 0;
+    s.nCsvFramesWritten = 0;
+    s.bCsvFailed = false;
+}
+
+bool Profiler::writeCsv() {
+    ProfilerState &s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    if (s.csvPath.empty()) return true;
+    if (!flushCsv(s)) return false;
+    s.csvFile.flush();
+    return static_cast<bool>(s.csvFile);
+}
+
+void Profiler::getPercentiles(int nPhase, float &p50, float &p95, float &p99) {
+    ProfilerState &s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    int nSamples = std::min(s.nFrames, WINDOW_FRAMES);
+    const float *fWindow = s.vecPhases[nPhase].fWindow;
+    std::vector<float> vecSorted(fWindow, fWindow + nSamples);
+    std::sort(vecSorted.begin(), vecSorted.end());
+    p50 = percentile(vecSorted, 0.50f);
+    p95 = percentile(vecSorted, 0.95f);
+    p99 = percentile(vecSorted, 0.99f);
+}
+
+std::string Profiler::getReport() {
+    std::string report = "ms        p50    p95    p99";
+    char line[96];
+    for (int i = 0; i < getPhaseCount(); i++) {
+        float p50, p95, p99;
+        getPercentiles(i, p50, p95, p99);
+        snprintf(line, sizeof(line), "\n%-16s %6.2f %6.2f %6.2f", getPhaseName(i), p50, p95, p99);
+        report += line;
+    }
+    return report;
+}
+
+int Profiler::getPhaseCount() {
+    return static_cast<int>(state().vecPhases.size());
+}
+
+const char *Profiler::getPhaseName(int nPhase) {
+    return state().vecPhases[nPhase].name.c_str();
+}
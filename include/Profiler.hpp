@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// Frame profiler.
+// Code is timed with ProfileScope against a named phase, a phase may be entered any number of times per
+// frame and its times add up. endFrame() closes the frame: the totals go into a rolling window that the
+// percentiles are computed from and, if a CSV path is set, into a per-frame history. The history is written
+// to the CSV CSV_CHUNK_FRAMES frames at a time and writeCsv() writes the rest, so however long a session
+// runs the profile holds no more than a chunk of it.
+// Times from several threads add up under a lock, a process running many matches at once turns it off.
+class Profiler {
+public:
+    static const int MAX_PHASES = 32;
+    static const int WINDOW_FRAMES = 240; // the percentiles cover the last 4 seconds at 60 fps
+    static const int CSV_CHUNK_FRAMES = 1024;
+
+    Profiler() = delete; // all frames share one profile
+
+    // Returns the id of the phase with this name, registering it if it is new
+    static int registerPhase(const char *name);
+
+    static void addTime(int nPhase, std::chrono::steady_clock::duration duration);
+
+    // On by default. While off addTime and endFrame return straight away without taking the lock.
+    static void setEnabled(bool bEnabled);
+
+    static void endFrame();
+
+    // Write the time of every phase in every frame to path from now on. The columns are the phases registered
+    // when the first chunk goes out, a phase registered later is left out of the file.
+    static void setCsvPath(const std::string &path);
+
+    // writes the frames not written yet, false if the file could not be written
+    static bool writeCsv();
+
+    // in milliseconds, over the rolling window
+    static void getPercentiles(int nPhase, float &p50, float &p95, float &p99);
+
+    // one line per phase with its percentiles, for the overlay
+    static std::string getReport();
+
+    static int getPhaseCount();
+
+    static const char *getPhaseName(int nPhase);
+};
+
+// Adds the time between construction and destruction to a phase
+class ProfileScope {
+private:
+    int mPhase;
+    std::chrono::steady_clock::time_point mStart;
+
+public:
+    explicit ProfileScope(int nPhase) : mPhase(nPhase), mStart(std::chrono::steady_clock::now()) {}
+
+    ~ProfileScope() { Profiler::addTime(mPhase, std::chrono::steady_clock::now() - mStart); }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+// Small seedable random number generator (xorshift64*).
+// Unlike rand() every instance has its own state, so a match seeded with the same value always
+// makes the same choices, no matter what else runs in the process.
+class Random {
+private:
+    uint64_t mState = 1;
+
+public:
+    explicit Random(uint64_t seed = 1) { setSeed(seed); }
+
+    void setSeed(uint64_t seed) {
+        // splitmix64, so that small consecutive seeds still start from well mixed states
+        uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        mState = z ^ (z >> 31);
+        if (mState == 0) mState = 1; // xorshift gets stuck on 0
+    }
+
+    uint32_t next() {
+        uint64_t x = mState;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        mState = x;
+        return static_cast<uint32_t>((x * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+
+    // uniform in [0, 1)
+    float nextFloat() { return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f); }
+
+    // uniform in [0, n)
+    int nextInt(int n) { return n <= 0 ? 0 : static_cast<int>(next() % static_cast<uint32_t>(n)); }
+
+    uint64_t getState() const { return mState; }
+
+    void setState(uint64_t state) { mState = state == 0 ? 1 : state; }
+};
@@ -0,0 +1,447 @@
+#include "ResourceCache.hpp"
+#include "AssetArchive.hpp"
+#include "Trace.hpp"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+    // What the loader thread produces: the file's bytes, or an image's decoded RGBA32 pixels
+    struct LoadedData {
+        std::shared_ptr<const void> owner; // keeps bytes alive, the archive or a vector
+        const unsigned char *bytes = nullptr;
+        size_t nSize = 0;
+        int nWidth = 0;
+        int nHeight = 0;
+        int nPitch = 0;
+    };
+
+    struct CacheEntry {
+        std::string id;
+        RESOURCE_TYPE type = RESOURCE_TEXTURE;
+        // guarded by the mutex while the loader may still have the entry
+        bool bQueued = false;
+        bool bLoading = false;
+        bool bLoaded = false; // data is ready, or empty if loading failed
+        LoadedData data;
+        // only touched by the render thread
+        TextureHandle texture;
+        FontHandle font;
+        MusicHandle music;
+        SoundHandle sound;
+        ImageHandle image;
+        size_t nBytes = 0;    // counted against the budget
+        uint64_t nLastUse = 0;
+    };
+
+    struct CacheState {
+        std::mutex mtx;
+        std::condition_variable cvWork;   // the queue has work or the loader has to stop
+        std::condition_variable cvLoaded; // an entry finished loading
+        std::map<std::string, std::unique_ptr<CacheEntry>> entries;
+        std::deque<CacheEntry *> queue;
+        std::thread loader;
+        bool bStopLoader = false;
+        std::shared_ptr<AssetArchive> archive;
+        std::string resourceDir = "../res/";
+        size_t nBudget = ResourceCache::DEFAULT_MEMORY_BUDGET;
+        size_t nUsage = 0;
+        uint64_t nUseCounter = 0;
+
+        ~CacheState() { stopLoader(); }
+
+        void stopLoader() {
+            if (!loader.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                bStopLoader = true;
+            }
+            cvWork.notify_all();
+            loader.join();
+            bStopLoader = false;
+        }
+    };
+
+    CacheState &state() {
+        static CacheState cacheState;
+        return cacheState;
+    }
+
+    std::string keyOf(RESOURCE_TYPE type, const std::string &id, int nPointSize) {
+        std::string key = std::to_string(type) + ":" + id;
+        if (type == RESOURCE_FONT) key += "@" + std::to_string(nPointSize);
+        return key;
+    }
+
+    // RGBA32 with the cyan colour key turned into transparency, as fauji-pack stores images
+    bool decodeImage(SDL_Surface *loadedSurface, const std::string &id, LoadedData &data) {
+        if (loadedSurface == nullptr) {
+            std::cout << "Unable to load image " << id << " SDL_image Error: " << IMG_GetError() << std::endl;
+            return false;
+        }
+        SDL_Surface *surface = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loadedSurface);
+        if (surface == nullptr) {
+            std::cout << "Unable to convert image " << id << " SDL Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        auto pixels = std::make_shared<std::vector<unsigned char>>(size_t(surface->w) * 4 * surface->h);
+        SDL_LockSurface(surface);
+        for (int y = 0; y < surface->h; y++) {
+            const auto *row = static_cast<const unsigned char *>(surface->pixels) + y * surface->pitch;
+            unsigned char *out = pixels->data() + size_t(y) * surface->w * 4;
+            for (int x = 0; x < surface->w * 4; x += 4) {
+                out[x] = row[x];
+                out[x + 1] = row[x + 1];
+                out[x + 2] = row[x + 2];
+                out[x + 3] = (row[x] == 0 && row[x + 1] == 0xFF && row[x + 2] == 0xFF) ? 0 : row[x + 3];
+            }
+        }
+        data.nWidth = surface->w;
+        data.nHeight = surface->h;
+        data.nPitch = surface->w * 4;
+        SDL_UnlockSurface(surface);
+        SDL_FreeSurface(surface);
+        data.bytes = pixels->data();
+        data.nSize = pixels->size();
+        data.owner = std::move(pixels);
+        return true;
+    }
+
+    // Everything that can be done away from the render thread. Fails with an empty result.
+    LoadedData loadData(RESOURCE_TYPE type, const std::string &id, const std::shared_ptr<AssetArchive> &archive,
+                        const std::string &resourceDir) {
+        TRACE_SCOPE("load asset");
+        LoadedData data;
+        const AssetEntry *entry = archive != nullptr ? archive->find(id) : nullptr;
+        if (entry != nullptr) {
+            const unsigned char *bytes = archive->getData(*entry);
+            bool bImage = type == RESOURCE_TEXTURE || type == RESOURCE_IMAGE;
+            if (bImage && entry->nType != ASSET_IMAGE_RGBA32) {
+                // packed as it was, decode it here
+                decodeImage(IMG_Load_RW(SDL_RWFromConstMem(bytes, static_cast<int>(entry->nSize)), 1), id, data);
+                return data;
+            }
+            // straight out of the mapping, which stays mapped while anything points into it
+            data.owner = std::shared_ptr<const void>(archive, bytes);
+            data.bytes = bytes;
+            data.nSize = entry->nSize;
+            data.nWidth = static_cast<int>(entry->nWidth);
+            data.nHeight = static_cast<int>(entry->nHeight);
+            data.nPitch = static_cast<int>(entry->nPitch);
+            return data;
+        }
+
+        std::string path = resourceDir + id;
+        if (type == RESOURCE_TEXTURE || type == RESOURCE_IMAGE) {
+            decodeImage(IMG_Load(path.c_str()), id, data);
+            return data;
+        }
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cout << "Unable to open " << path << std::endl;
+            return data;
+        }
+        auto bytes = std::make_shared<std::vector<unsigned char>>((std::istreambuf_iterator<char>(file)),
+                                                                  std::istreambuf_iterator<char>());
+        data.bytes = bytes->data();
+        data.nSize = bytes->size();
+        data.owner = std::move(bytes);
+        return data;
+    }
+
+    void loaderMain() {
+        TRACE_THREAD_NAME("resource loader");
+        CacheState &s = state();
+        std::unique_lock<std::mutex> lock(s.mtx);
+        while (true) {
+            s.cvWork.wait(lock, [&s]() { return s.bStopLoader || !s.queue.empty(); });
+            if (s.bStopLoader) {
+                return;
+            }
+            CacheEntry *entry = s.queue.front();
+            s.queue.pop_front();
+            entry->bLoading = true;
+            RESOURCE_TYPE type = entry->type;
+            std::string id = entry->id;
+            std::shared_ptr<AssetArchive> archive = s.archive;
+            std::string resourceDir = s.resourceDir;
+            lock.unlock();
+            LoadedData data = loadData(type, id, archive, resourceDir);
+            lock.lock();
+            entry->data = std::move(data);
+            entry->bLoaded = true;
+            entry->bLoading = false;
+            s.nUsage += entry->data.nSize;
+            entry->nBytes = entry->data.nSize;
+            s.cvLoaded.notify_all();
+        }
+    }
+
+    bool isHeld(const CacheEntry &entry) {
+        return entry.texture.use_count() > 1 || entry.font.use_count() > 1 || entry.music.use_count() > 1 ||
+               entry.sound.use_count() > 1 || entry.image.use_count() > 1;
+    }
+
+    // Drops the least recently used resources nobody holds until the cache fits its budget, called with
+    // the mutex held
+    void trim(CacheState &s) {
+        while (s.nUsage > s.nBudget) {
+            auto victim = s.entries.end();
+            for (auto it = s.entries.begin(); it != s.entries.end(); ++it) {
+                const CacheEntry &entry = *it->second;
+                if (!entry.bLoaded || isHeld(entry)) continue;
+                if (victim == s.entries.end() || entry.nLastUse < victim->second->nLastUse) {
+                    victim = it;
+                }
+            }
+            if (victim == s.entries.end()) {
+                // everything left is in use
+                return;
+            }
+            s.nUsage -= victim->second->nBytes;
+            s.entries.erase(victim);
+        }
+    }
+
+    CacheEntry &findOrCreate(CacheState &s, RESOURCE_TYPE type, const std::string &id, int nPointSize) {
+        std::unique_ptr<CacheEntry> &entry = s.entries[keyOf(type, id, nPointSize)];
+        if (entry == nullptr) {
+            entry = std::make_unique<CacheEntry>();
+            entry->id = id;
+            entry->type = type;
+        }
+        entry->nLastUse = ++s.nUseCounter;
+        return *entry;
+    }
+
+    // The entry with its data loaded, loads it right here unless the loader is already busy with it
+    CacheEntry &acquire(RESOURCE_TYPE type, const std::string &id, int nPointSize) {
+        CacheState &s = state();
+        std::unique_lock<std::mutex> lock(s.mtx);
+        CacheEntry &entry = findOrCreate(s, type, id, nPointSize);
+        if (entry.bLoaded) {
+            return entry;
+        }
+        if (entry.bLoading) {
+            s.cvLoaded.wait(lock, [&entry]() { return entry.bLoaded; });
+            return entry;
+        }
+        if (entry.bQueued) {
+            // still waiting in the queue, quicker to load it ourselves than to wait for everything before it
+            for (auto it = s.queue.begin(); it != s.queue.end(); ++it) {
+                if (*it == &entry) {
+                    s.queue.erase(it);
+                    break;
+                }
+            }
+        }
+        entry.bLoading = true;
+        std::shared_ptr<AssetArchive> archive = s.archive;
+        std::string resourceDir = s.resourceDir;
+        lock.unlock();
+        LoadedData data = loadData(type, id, archive, resourceDir);
+        lock.lock();
+        entry.data = std::move(data);
+        entry.bLoaded = true;
+        entry.bLoading = false;
+        entry.nBytes = entry.data.nSize;
+        s.nUsage += entry.nBytes;
+        return entry;
+    }
+
+    // Counts the entry as nBytes from now on
+    void recount(CacheEntry &entry, size_t nBytes) {
+        CacheState &s = state();
+        std::lock_guard<std::mutex> lock(s.mtx);
+        s.nUsage = s.nUsage - entry.nBytes + nBytes;
+        entry.nBytes = nBytes;
+        trim(s);
+    }
+}
+
+Font::Font(TTF_Font *font, std::shared_ptr<const void> data) : mFont(font), mData(std::move(data)) {}
+
+Font::~Font() {
+    TTF_CloseFont(mFont);
+}
+
+TTF_Font *Font::get() const {
+    return mFont;
+}
+
+Music::Music(Mix_Music *music, std::shared_ptr<const void> data) : mMusic(music), mData(std::move(data)) {}
+
+Music::~Music() {
+    Mix_FreeMusic(mMusic);
+}
+
+Mix_Music *Music::get() const {
+    return mMusic;
+}
+
+Sound::Sound(Mix_Chunk *chunk) : mChunk(chunk) {}
+
+Sound::~Sound() {
+    Mix_FreeChunk(mChunk);
+}
+
+Mix_Chunk *Sound::get() const {
+    return mChunk;
+}
+
+void ResourceCache::setAssetLocation(const std::string &archivePath, const std::string &resourceDir) {
+    auto archive = std::make_shared<AssetArchive>();
+    if (!archive->open(archivePath)) {
+        std::cout << "No asset archive, loading the assets from " << resourceDir << std::endl;
+        archive.reset();
+    }
+    CacheState &s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    s.archive = std::move(archive);
+    s.resourceDir = resourceDir;
+}
+
+void ResourceCache::preload(const std::string &id, RESOURCE_TYPE type) {
+    CacheState &s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.mtx);
+        // fonts are read at any size, their file is all there is to preload
+        CacheEntry &entry = findOrCreate(s, type, id, type == RESOURCE_FONT ? -1 : 0);
+        if (entry.bLoaded || entry.bLoading || entry.bQueued) {
+            return;
+        }
+        entry.bQueued = true;
+        s.queue.push_back(&entry);
+        if (!s.loader.joinable()) {
+            s.loader = std::thread(loaderMain);
+        }
+    }
+    s.cvWork.notify_one();
+}
+
+TextureHandle ResourceCache::getTexture(const std::string &id) {
+    CacheEntry &entry = acquire(RESOURCE_TEXTURE, id, 0);
+    TextureHandle texture = entry.texture;
+    if (texture == nullptr) {
+        texture = std::make_shared<LTexture>();
+        if (entry.data.bytes != nullptr) {
+            texture->loadTextureFromPixels(entry.data.bytes, entry.data.nWidth, entry.data.nHeight, entry.data.nPitch);
+        }
+        entry.texture = texture;
+        // the pixels are in the texture now, only the texture counts
+        entry.data = LoadedData();
+        recount(entry, size_t(texture->getWidth()) * texture->getHeight() * 4);
+    }
+    return texture;
+}
+
+FontHandle ResourceCache::getFont(const std::string &id, int nPointSize) {
+    // the file is one entry, shared by the fonts of every size
+    LoadedData file = acquire(RESOURCE_FONT, id, -1).data;
+    CacheEntry *entry;
+    {
+        CacheState &s = state();
+        std::lock_guard<std::mutex> lock(s.mtx);
+        entry = &findOrCreate(s, RESOURCE_FONT, id, nPointSize);
+        entry->bLoaded = true;
+    }
+    FontHandle font = entry->font;
+    if (font == nullptr) {
+        if (file.bytes == nullptr) {
+            return nullptr;
+        }
+        TTF_Font *ttfFont = TTF_OpenFontRW(SDL_RWFromConstMem(file.bytes, static_cast<int>(file.nSize)), 1, nPointSize);
+        if (ttfFont == nullptr) {
+            std::cout << "Failed to load font " << id << " SDL_ttf Error: " << TTF_GetError() << std::endl;
+            return nullptr;
+        }
+        font = std::make_shared<Font>(ttfFont, file.owner);
+        entry->font = font;
+    }
+    return font;
+}
+
+MusicHandle ResourceCache::getMusic(const std::string &id) {
+    CacheEntry &entry = acquire(RESOURCE_MUSIC, id, 0);
+    MusicHandle music = entry.music;
+    if (music == nullptr) {
+        if (entry.data.bytes == nullptr) {
+            return nullptr;
+        }
+        Mix_Music *mixMusic = Mix_LoadMUS_RW(SDL_RWFromConstMem(entry.data.bytes, static_cast<int>(entry.data.nSize)), 1);
+        if (mixMusic == nullptr) {
+            std::cout << "Failed to load music " << id << " SDL_mixer Error: " << Mix_GetError() << std::endl;
+            return nullptr;
+        }
+        music = std::make_shared<Music>(mixMusic, entry.data.owner);
+        entry.music = music;
+    }
+    return music;
+}
+
+SoundHandle ResourceCache::getSound(const std::string &id) {
+    CacheEntry &entry = acquire(RESOURCE_SOUND, id, 0);
+    SoundHandle sound = entry.sound;
+    if (sound == nullptr) {
+        if (entry.data.bytes == nullptr) {
+            return nullptr;
+        }
+        Mix_Chunk *chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(entry.data.bytes, static_cast<int>(entry.data.nSize)), 1);
+        if (chunk == nullptr) {
+            std::cout << "Failed to load sound " << id << " SDL_mixer Error: " << Mix_GetError() << std::endl;
+            return nullptr;
+        }
+        sound = std::make_shared<Sound>(chunk);
+        entry.sound = sound;
+        // the samples are SDL_mixer's now, only they count
+        entry.data = LoadedData();
+        recount(entry, chunk->alen);
+    }
+    return sound;
+}
+
+ImageHandle ResourceCache::getImage(const std::string &id) {
+    CacheEntry &entry = acquire(RESOURCE_IMAGE, id, 0);
+    ImageHandle image = entry.image;
+    if (image == nullptr) {
+        if (entry.data.bytes == nullptr) {
+            return nullptr;
+        }
+        auto newImage = std::make_shared<Image>();
+        newImage->pixels = entry.data.bytes;
+        newImage->nWidth = entry.data.nWidth;
+        newImage->nHeight = entry.data.nHeight;
+        newImage->nPitch = entry.data.nPitch;
+        newImage->data = entry.data.owner;
+        image = newImage;
+        entry.image = image;
+    }
+    return image;
+}
+
+void ResourceCache::setMemoryBudget(size_t nBytes) {
+    CacheState &s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    s.nBudget = nBytes;
+    trim(s);
+}
+
+size_t ResourceCache::getMemoryUsage() {
+    CacheState &s = state();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    return s.nUsage;
+}
+
+void ResourceCache::clear() {
+    CacheState &s = state();
+    s.stopLoader();
+    std::lock_guard<std::mutex> lock(s.mtx);
+    s.queue.clear();
+    s.entries.clear();
+    s.archive.reset();
+    s.nUsage = 0;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "SimpleGameEngine.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class AssetArchive;
+
+// A font opened from memory, keeps that memory (a mapped archive or the file's bytes) alive while it is open
+class Font {
+private:
+    TTF_Font *mFont;
+    std::shared_ptr<const void> mData;
+
+public:
+    Font(TTF_Font *font, std::shared_ptr<const void> data);
+
+    ~Font();
+
+    Font(const Font &) = delete;
+    Font &operator=(const Font &) = delete;
+
+    TTF_Font *get() const;
+};
+
+// Music opened from memory, like Font
+class Music {
+private:
+    Mix_Music *mMusic;
+    std::shared_ptr<const void> mData;
+
+public:
+    Music(Mix_Music *music, std::shared_ptr<const void> data);
+
+    ~Music();
+
+    Music(const Music &) = delete;
+    Music &operator=(const Music &) = delete;
+
+    Mix_Music *get() const;
+};
+
+// A sound effect decoded into SDL_mixer's format, which keeps no hold on the file's bytes
+class Sound {
+private:
+    Mix_Chunk *mChunk;
+
+public:
+    explicit Sound(Mix_Chunk *chunk);
+
+    ~Sound();
+
+    Sound(const Sound &) = delete;
+    Sound &operator=(const Sound &) = delete;
+
+    Mix_Chunk *get() const;
+};
+
+// Decoded RGBA32 pixels that weren't turned into a texture, what a TextureAtlas is built from
+struct Image {
+    const unsigned char *pixels = nullptr;
+    int nWidth = 0;
+    int nHeight = 0;
+    int nPitch = 0;
+    std::shared_ptr<const void> data; // keeps pixels alive
+};
+
+// A resource stays loaded as long as somebody holds a handle to it
+using TextureHandle = std::shared_ptr<LTexture>;
+using FontHandle = std::shared_ptr<Font>;
+using MusicHandle = std::shared_ptr<Music>;
+using SoundHandle = std::shared_ptr<Sound>;
+using ImageHandle = std::shared_ptr<const Image>;
+
+enum RESOURCE_TYPE {
+    RESOURCE_TEXTURE = 0,
+    RESOURCE_FONT,
+    RESOURCE_MUSIC,
+    RESOURCE_IMAGE,
+    RESOURCE_SOUND
+};
+
+// Loads every resource once, keyed by asset id (the asset's file name).
+// preload() queues the slow part (reading and decoding the file) on a background thread, the get functions
+// wait for it if it hasn't finished and then create the SDL object on the calling thread, which has to be
+// the one that renders. Resources nobody holds a handle to any more stay cached and are dropped least
+// recently used first once the cache grows beyond its memory budget.
+// Assets come from the asset archive if one is open, from the resource directory otherwise.
+class ResourceCache {
+public:
+    static const size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+    ResourceCache() = delete; // there is one set of assets
+
+    // Maps the archive at archivePath if it exists, loose files are looked for in resourceDir
+    static void setAssetLocation(const std::string &archivePath, const std::string &resourceDir);
+
+    static void preload(const std::string &id, RESOURCE_TYPE type);
+
+    // an empty texture if the asset can't be loaded, so that drawing it does nothing
+    static TextureHandle getTexture(const std::string &id);
+
+    // nullptr if the asset can't be loaded
+    static FontHandle getFont(const std::string &id, int nPointSize);
+
+    static MusicHandle getMusic(const std::string &id);
+
+    // nullptr if the asset can't be loaded or there is no audio device to decode it for
+    static SoundHandle getSound(const std::string &id);
+
+    // The pixels of an image, without creating a texture, nullptr if the asset can't be loaded
+    static ImageHandle getImage(const std::string &id);
+
+    // decoded pixels and file contents count, SDL's copies of them don't
+    static void setMemoryBudget(size_t nBytes);
+
+    static size_t getMemoryUsage();
+
+    // Drops every resource and stops the loader thread, before SDL shuts down. Handles that are still
+    // held stay usable as far as SDL allows.
+    static void clear();
+};
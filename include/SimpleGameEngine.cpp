@@ -1,14 +1,34 @@
 #include "SimpleGameEngine.hpp"
+#include "AllocationCounter.hpp"
+#include "InputRecording.hpp"
+#include "Profiler.hpp"
+#include "ResourceCache.hpp"
+#include "SoundPool.hpp"
+#include "SpriteBatch.hpp"
+#include "Trace.hpp"
+#include <algorithm>
 #include <cmath>
+#include <thread>
 
 const int FONT_SIZE = 18;
+const char *const FONT_NAME = "Roboto-Black.ttf";
+const int PROFILER_OVERLAY_REFRESH_FRAMES = 30; // re-rendering the overlay text every frame would show up in the profile
+
+namespace {
+    const int PHASE_FRAME = Profiler::registerPhase("frame");
+    const int PHASE_EVENTS = Profiler::registerPhase("events");
+    const int PHASE_SIMULATION = Profiler::registerPhase("simulation");
+    const int PHASE_FRAME_UPDATE = Profiler::registerPhase("frame update");
+    const int PHASE_PRESENT = Profiler::registerPhase("present");
+}
 //const int FONT_WIDTH = 10;
 //const int FONT_HEIGHT = 18;
 
+// Only the engine that owns the window (or a software console) sets these, a headless engine never touches
+// them, so any number of headless engines can run side by side on other threads
 SDL_Renderer *gRenderer = nullptr;
+// the engine's font (GameEngine::mFont), text textures are rendered with it
 TTF_Font *gFont = NULL;
-//The music that will be played
-Mix_Music *gMusic = NULL;
 
 LTexture::LTexture() {
     mTexture = nullptr;
@@ -40,6 +60,10 @@ void LTexture::drawTexture(int x, int y, int w, int h, SDL_Rect *clip, double an
     SDL_RenderCopyEx(gRenderer, mTexture, clip, &renderQuad, angle, center, flip);
 }
 
+SDL_Texture *LTexture::getSDLTexture() const {
+    return mTexture;
+}
+
 void LTexture::free() {
     if (mTexture != nullptr) {
         SDL_DestroyTexture(mTexture);
@@ -79,6 +103,7 @@ bool LTexture::loadTextureFromText(const std::string &text, SDL_Color color) {
 }
 
 bool LTexture::loadTextureFromFile(std::string path) {
+    TRACE_SCOPE("load texture");
 
     //Get rid of preexisting texture
     free();
@@ -114,8 +139,35 @@ bool LTexture::loadTextureFromFile(std::string path) {
 
 }
 
+bool LTexture::loadTextureFromPixels(const unsigned char *pixels, int width, int height, int pitch) {
+    TRACE_SCOPE("upload texture");
+    free();
+    SDL_Texture *newTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, width,
+                                                height);
+    if (newTexture == nullptr) {
+        std::cout << "Unable to create texture! SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    if (SDL_UpdateTexture(newTexture, nullptr, pixels, pitch) != 0) {
+        std::cout << "Unable to upload texture! SDL Error: " << SDL_GetError() << std::endl;
+        SDL_DestroyTexture(newTexture);
+        return false;
+    }
+    SDL_SetTextureBlendMode(newTexture, SDL_BLENDMODE_BLEND);
+    mTexture = newTexture;
+    mWidth = width;
+    mHeight = height;
+    return true;
+}
 
-GameEngine::GameEngine() : mWindowWidth(80), mWindowHeight(40), gWindow(nullptr) {
+GameEngine::GameEngine(bool bHeadless) : mWindowWidth(80), mWindowHeight(40), gWindow(nullptr),
+                                         mHeadless(bHeadless), mSpriteBatch(new SpriteBatch()),
+                                         mSoundPool(new SoundPool()) {
+    if (mHeadless) {
+        // nothing is shown or played, the simulation doesn't need SDL
+        return;
+    }
+    AllocationCounter::countSDLAllocations();
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
         std::cout << "SDL initialization failed: " << SDL_GetError();
     }
@@ -135,8 +187,9 @@ GameEngine::GameEngine() : mWindowWidth(80), mWindowHeight(40), gWindow(nullptr)
     if( Mix_OpenAudio( 44100, MIX_DEFAULT_FORMAT, 2, 2048 ) < 0 )
     {
         std::cout <<"SDL_mixer could not initialize! SDL_mixer Error: %s\n" << Mix_GetError() << std::endl;
-
+        return;
     }
+    mSoundPool->open();
 }
 
 GameEngine::~GameEngine() {
@@ -166,6 +219,9 @@ bool GameEngine::constructConsole(int windowWidth = 80, int windowHeight = 40, c
         return false;
     }
     SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+    // the font is read while the game sets itself up
+    openAssets();
+    ResourceCache::preload(FONT_NAME, RESOURCE_FONT);
 
     mWindowWidth = windowWidth;
     mWindowHeight = windowHeight;
@@ -173,8 +229,41 @@ bool GameEngine::constructConsole(int windowWidth = 80, int windowHeight = 40, c
 
 }
 
+bool GameEngine::constructSoftwareConsole(int width, int height) {
+    mSoftwareSurface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (mSoftwareSurface == nullptr) {
+        std::cout << "Surface could not be created! SDL Error: " << SDL_GetError();
+        return false;
+    }
+    gRenderer = SDL_CreateSoftwareRenderer(mSoftwareSurface);
+    if (gRenderer == nullptr) {
+        std::cout << "Software renderer could not be created! SDL Error: " << SDL_GetError();
+        return false;
+    }
+    SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+
+    mWindowWidth = width;
+    mWindowHeight = height;
+    return true;
+}
+
+void GameEngine::openAssets() {
+    if (mAssetsOpen) {
+        return;
+    }
+    // found relative to the executable, not to the working directory
+    char *basePath = SDL_GetBasePath();
+    std::string baseDir = basePath != nullptr ? basePath : "";
+    SDL_free(basePath);
+    ResourceCache::setAssetLocation(baseDir + "fauji.pak", baseDir + "../res/");
+    mAssetsOpen = true;
+}
+
 bool GameEngine::createResources() {
-    gFont = TTF_OpenFont("../res/Roboto-Black.ttf", FONT_SIZE);
+    openAssets();
+    TRACE_SCOPE("load font");
+    mFont = ResourceCache::getFont(FONT_NAME, FONT_SIZE);
+    gFont = mFont != nullptr ? mFont->get() : nullptr;
     if (gFont == nullptr) {
         std::cout << "Failed to load font! SDL_ttf Error: " << TTF_GetError();
         return false;
@@ -183,9 +272,10 @@ bool GameEngine::createResources() {
 }
 
 
-bool GameEngine::loadMusic(const char *path) {
-    gMusic = Mix_LoadMUS( path);
-    if (gMusic == NULL) {
+bool GameEngine::loadMusic(const char *name) {
+    TRACE_SCOPE("load music");
+    mMusic = ResourceCache::getMusic(name);
+    if (mMusic == nullptr) {
         std::cout << "Failed to load beat music! SDL_mixer Error: %s\n" << Mix_GetError() << std::endl;
         return false;
     }
@@ -229,9 +319,26 @@ bool GameEngine::fillRect(int x, int y, int w, int h, Color color) {
 }
 
 void GameEngine::close_sdl() {
-    //Free the music
-    Mix_FreeMusic( gMusic );
-    gMusic = NULL;
+    // the atlas is a texture as well
+    mSpriteBatch->setAtlas(nullptr);
+    if (mSoftwareSurface != nullptr) {
+        SDL_DestroyRenderer(gRenderer);
+        SDL_FreeSurface(mSoftwareSurface);
+        gRenderer = nullptr;
+        mSoftwareSurface = nullptr;
+    }
+    if (mHeadless) {
+        return;
+    }
+    mProfilerOverlay.free();
+    //Free the music and the sound effects
+    mMusic.reset();
+    mSoundPool->close();
+    mFont.reset();
+    gFont = nullptr;
+    // every texture has to go before the renderer does
+    ResourceCache::clear();
+    mAssetsOpen = false;
     //Destroy window
     SDL_DestroyRenderer(gRenderer);
     SDL_DestroyWindow(gWindow);
@@ -250,68 +357,367 @@ void GameEngine::initScreen() {
 
 void GameEngine::startGameLoop() {
     bool quit = false;
-    if (!createResources()) {
-        std::cout << "error while loading resources" << std::endl;
-        close_sdl();
-        quit = true;
+    TRACE_THREAD_NAME("game");
+    if (!mHeadless) {
+        if (!createResources()) {
+            std::cout << "error while loading resources" << std::endl;
+            close_sdl();
+            quit = true;
+        }
+        initScreen();
     }
-    initScreen();
     if (!onInit()) {
         std::cout << "onInit function returned error" << std::endl;
         quit = true;
     }
     auto prevFrameTime = std::chrono::system_clock::now();
     auto currFrameTime = std::chrono::system_clock::now();
+    float fAccumulator = 0.0f;
+    std::thread simulationThread;
+    bool bThreaded = mSimulationThread && !mHeadless && mTickTime > 0.0f && !quit;
+    if (bThreaded) {
+        mStopSimulation = false;
+        mSimulationFinished = false;
+        simulationThread = std::thread(&GameEngine::runSimulationThread, this);
+    }
 
     while (!quit) {
+        TRACE_SCOPE("frame");
+        auto frameStart = std::chrono::steady_clock::now();
+        uint64_t nFrameAllocationsStart = AllocationCounter::getThreadAllocationCount();
+        auto endProfiledFrame = [this, frameStart, &nFrameAllocationsStart]() {
+            mFrameArena.reset();
+            uint64_t nAllocations = AllocationCounter::getThreadAllocationCount() - nFrameAllocationsStart;
+            AllocationStats &stats = mAllocationStats;
+            stats.nFrames++;
+            stats.nAllocations += nAllocations;
+            stats.nLastFrameAllocations = nAllocations;
+            stats.nMaxFrameAllocations = std::max(stats.nMaxFrameAllocations, nAllocations);
+            if (nAllocations > 0) {
+                stats.nFramesWithAllocations++;
+                stats.nLastAllocatingFrame = stats.nFrames;
+            }
+            TRACE_COUNTER("allocations", nAllocations);
+            Profiler::addTime(PHASE_FRAME, std::chrono::steady_clock::now() - frameStart);
+            Profiler::endFrame();
+        };
         // handle timing
         currFrameTime = std::chrono::system_clock::now();
         std::chrono::duration<float> elapsedTime = currFrameTime - prevFrameTime;
         prevFrameTime = currFrameTime;
         float frameElapsedTime = elapsedTime.count();
-        initScreen();
-        //handle input
-        SDL_Event e;
-        while (SDL_PollEvent(&e) != 0) {
-            //User requests quit
-            if (e.type == SDL_QUIT) {
-                quit = true;
-            } else if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP || e.type == SDL_MOUSEBUTTONDOWN ||
-                       e.type == SDL_MOUSEBUTTONUP || e.type == SDL_MOUSEMOTION) {
-                int mouseX, mouseY;
-                SDL_GetMouseState(&mouseX, &mouseY);
-                int buttonCode;
-                if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
-                    buttonCode = e.key.keysym.sym;
-                } else {
-                    buttonCode = e.button.button;
+
+        // work out how many simulation ticks this frame runs
+        int nTicks = 1;
+        if (!mHeadless) {
+            ProfileScope eventsScope(PHASE_EVENTS);
+            TRACE_SCOPE("poll events");
+            initScreen();
+            //handle input
+            SDL_Event e;
+            while (SDL_PollEvent(&e) != 0) {
+                //User requests quit
+                if (e.type == SDL_QUIT) {
+                    quit = true;
+                } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3 && e.key.repeat == 0) {
+                    // the profiler overlay belongs to the engine, the game never sees this key
+                    mShowProfiler = !mShowProfiler;
+                    mProfilerOverlayAge = PROFILER_OVERLAY_REFRESH_FRAMES;
+                } else if (mReplayer != nullptr) {
+                    // the replay provides all the input
+                    continue;
+                } else if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
+                    InputEvent event;
+                    event.eventType = e.type;
+                    event.buttonCode = e.key.keysym.sym;
+                    event.scancode = e.key.keysym.scancode;
+                    event.bRepeat = e.key.repeat != 0;
+                    SDL_GetMouseState(&event.mousePosX, &event.mousePosY);
+                    mInput.pushEvent(event);
+                } else if (e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_MOUSEBUTTONUP) {
+                    InputEvent event;
+                    event.eventType = e.type;
+                    event.buttonCode = e.button.button;
+                    event.mousePosX = e.button.x;
+                    event.mousePosY = e.button.y;
+                    mInput.pushEvent(event);
+                } else if (e.type == SDL_MOUSEMOTION) {
+                    InputEvent event;
+                    event.eventType = e.type;
+                    event.mousePosX = e.motion.x;
+                    event.mousePosY = e.motion.y;
+                    mInput.pushEvent(event);
+                }
+            }
+            if (bThreaded) {
+                // the simulation thread keeps its own time
+                nTicks = 0;
+                if (mSimulationFinished) {
+                    quit = true;
                 }
-                InputEventHandler::runCallbacks(e.type, buttonCode, mouseX, mouseY, frameElapsedTime);
-//                onKeyboardEvent(e.key.keysym.sym, frameElapsedTime);
+            } else if (mTickTime > 0.0f) {
+                // never catch up more than a quarter of a second, otherwise one long stall snowballs
+                fAccumulator += std::min(frameElapsedTime, 0.25f);
+                nTicks = static_cast<int>(fAccumulator / mTickTime);
+                fAccumulator -= nTicks * mTickTime;
             }
         }
-        if (!onFrameUpdate(frameElapsedTime)) {
-            quit = true;
+
+        {
+            ProfileScope simulationScope(PHASE_SIMULATION);
+            for (int i = 0; i < nTicks && !quit; i++) {
+                if (!isTickReady()) {
+                    // the ticks left over are run once the game is ready for them
+                    if (mHeadless) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    } else {
+                        fAccumulator = std::min(fAccumulator + (nTicks - i) * mTickTime, 0.25f);
+                    }
+                    nTicks = i;
+                    break;
+                }
+                if (!runSimulationTick(mTickTime > 0.0f ? mTickTime : frameElapsedTime)) {
+                    quit = true;
+                }
+            }
+            if (nTicks > 0 && !mHeadless) {
+                onPublishSnapshot();
+                mSoundPool->flush();
+            }
+        }
+        if (mHeadless || quit) {
+            endProfiledFrame();
+            continue;
+        }
+
+        {
+            ProfileScope frameUpdateScope(PHASE_FRAME_UPDATE);
+            TRACE_SCOPE("frame update");
+            mRenderStats = RenderStats();
+            if (!onFrameUpdate(frameElapsedTime)) {
+                quit = true;
+            }
+            mRenderStats.nSprites = static_cast<uint32_t>(mSpriteBatch->getSpriteCount());
+            mSpriteBatch->flush();
+        }
+        if (mShowProfiler) {
+            uint64_t nOverlayStart = AllocationCounter::getThreadAllocationCount();
+            drawProfilerOverlay();
+            nFrameAllocationsStart += AllocationCounter::getThreadAllocationCount() - nOverlayStart;
         }
 
         // 4. RENDER OUTPUT
 
-        if (!renderConsole()) {
-            std::cout << "error while loading texture" << std::endl;
-            quit = true;
+        {
+            ProfileScope presentScope(PHASE_PRESENT);
+            TRACE_SCOPE("present");
+            if (!renderConsole()) {
+                std::cout << "error while loading texture" << std::endl;
+                quit = true;
+            }
+        }
+        endProfiledFrame();
+    }
+    if (simulationThread.joinable()) {
+        mStopSimulation = true;
+        simulationThread.join();
+    }
+    if (mRecorder != nullptr) {
+        mRecorder->close();
+    }
+    Profiler::writeCsv();
+}
+
+void GameEngine::setProfilerOverlay(bool bShow) {
+    mShowProfiler = bShow;
+    mProfilerOverlayAge = PROFILER_OVERLAY_REFRESH_FRAMES;
+}
+
+void GameEngine::drawProfilerOverlay() {
+    if (++mProfilerOverlayAge >= PROFILER_OVERLAY_REFRESH_FRAMES) {
+        mProfilerOverlayAge = 0;
+        char allocations[160];
+        snprintf(allocations, sizeof(allocations),
+                 "\nallocations/frame %llu (max %llu)\nobjects %u drawn, %u culled, %u sprites",
+                 static_cast<unsigned long long>(mAllocationStats.nLastFrameAllocations),
+                 static_cast<unsigned long long>(mAllocationStats.nMaxFrameAllocations),
+                 mRenderStats.nObjectsDrawn, mRenderStats.nObjectsCulled, mRenderStats.nSprites);
+        mProfilerOverlay.loadTextureFromText(Profiler::getReport() + allocations, {0xFF, 0xFF, 0xFF});
+    }
+    fillRect(0, 0, mProfilerOverlay.getWidth() + 8, mProfilerOverlay.getHeight() + 8, {0x20, 0x20, 0x20});
+    mProfilerOverlay.drawTexture(4, 4);
+}
+
+bool GameEngine::runSimulationTick(float fTickTime) {
+    TRACE_SCOPE("simulation tick");
+    if (mReplayer != nullptr) {
+        if (!mReplayer->nextTick(fTickTime, mTickEvents, mReplayData)) {
+            std::cout << "Replay finished" << std::endl;
+            return false;
         }
+        mReplayDataPos = 0;
+    } else {
+        // taken in one go, so what is recorded is exactly what the tick sees
+        mInput.takeQueuedEvents(mTickEvents);
+    }
+    if (mRecorder != nullptr) {
+        mRecorder->addEvents(mTickEvents);
+    }
+    mInput.dispatchEvents(mTickEvents, fTickTime);
+    bool bContinue = onSimulationTick(fTickTime);
+    if (mRecorder != nullptr) {
+        mRecorder->endTick(fTickTime);
+    }
+    return bContinue;
+}
 
+void GameEngine::runSimulationThread() {
+    TRACE_THREAD_NAME("simulation");
+    auto prevTime = std::chrono::steady_clock::now();
+    float fAccumulator = 0.0f;
+    while (!mStopSimulation) {
+        auto currTime = std::chrono::steady_clock::now();
+        // never catch up more than a quarter of a second, like the single threaded loop
+        fAccumulator += std::min(std::chrono::duration<float>(currTime - prevTime).count(), 0.25f);
+        prevTime = currTime;
+        int nTicks = static_cast<int>(fAccumulator / mTickTime);
+        fAccumulator -= nTicks * mTickTime;
+        if (nTicks > 0) {
+            ProfileScope simulationScope(PHASE_SIMULATION);
+            int nTicksRun = 0;
+            for (; nTicksRun < nTicks; nTicksRun++) {
+                if (!isTickReady()) {
+                    fAccumulator = std::min(fAccumulator + (nTicks - nTicksRun) * mTickTime, 0.25f);
+                    break;
+                }
+                if (!runSimulationTick(mTickTime)) {
+                    mSimulationFinished = true;
+                    return;
+                }
+            }
+            if (nTicksRun > 0) {
+                onPublishSnapshot();
+                mSoundPool->flush();
+            }
+        }
+        // until the next tick is due
+        std::this_thread::sleep_until(currTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(mTickTime - fAccumulator)));
     }
 }
 
+bool GameEngine::startSimulation() {
+    if (!onInit()) {
+        std::cout << "onInit function returned error" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool GameEngine::stepSimulation() {
+    if (!isTickReady()) {
+        return true;
+    }
+    bool bContinue = runSimulationTick(mTickTime);
+    mFrameArena.reset();
+    return bContinue;
+}
+
+void GameEngine::setFixedTimestep(float fTickTime) {
+    mTickTime = fTickTime;
+}
+
+void GameEngine::setSimulationThread(bool bEnabled) {
+    mSimulationThread = bEnabled;
+}
+
+InputEventHandler &GameEngine::getInput() {
+    return mInput;
+}
+
+const InputEventHandler &GameEngine::getInput() const {
+    return mInput;
+}
+
+FrameArena &GameEngine::getFrameArena() {
+    return mFrameArena;
+}
+
+SpriteBatch &GameEngine::getSpriteBatch() {
+    return *mSpriteBatch;
+}
+
+SoundPool &GameEngine::getSoundPool() {
+    return *mSoundPool;
+}
+
+RenderStats &GameEngine::getRenderStats() {
+    return mRenderStats;
+}
+
+const AllocationStats &GameEngine::getAllocationStats() const {
+    return mAllocationStats;
+}
+
+bool GameEngine::isHeadless() const {
+    return mHeadless;
+}
+
+bool GameEngine::startRecording(const std::string &path, uint64_t seed) {
+    mRecorder = std::make_unique<InputRecorder>();
+    if (!mRecorder->open(path, seed, mTickTime)) {
+        mRecorder.reset();
+        return false;
+    }
+    return true;
+}
+
+bool GameEngine::startReplay(const std::string &path) {
+    mReplayer = std::make_unique<InputReplayer>();
+    if (!mReplayer->open(path)) {
+        mReplayer.reset();
+        return false;
+    }
+    // play it back at the rate it was recorded with
+    mTickTime = mReplayer->getTickTime();
+    return true;
+}
+
+bool GameEngine::isRecording() const {
+    return mRecorder != nullptr;
+}
+
+bool GameEngine::isReplaying() const {
+    return mReplayer != nullptr;
+}
+
+uint64_t GameEngine::getReplaySeed() const {
+    return mReplayer != nullptr ? mReplayer->getSeed() : 0;
+}
+
+void GameEngine::recordGameData(const void *data, size_t size) {
+    if (mRecorder != nullptr) {
+        mRecorder->addGameData(data, size);
+    }
+}
+
+bool GameEngine::takeReplayGameData(std::vector<uint8_t> &data) {
+    if (mReplayer == nullptr || mReplayDataPos >= mReplayData.size()) {
+        return false;
+    }
+    data = mReplayData[mReplayDataPos++];
+    return true;
+}
+
 // Draws a model on screen with the given rotation(r), translation(x, y) and scaling(s)
 void GameEngine::DrawWireFrameModel(const std::vector<std::pair<float, float>> &vecModelCoordinates, float x, float y,
                                     float r, float s, Color color) {
     // std::pair.first = x coordinate
     // std::pair.second = y coordinate
 
-    // Create translated model vector of coordinate pairs, we don't want to change the original one
-    std::vector<std::pair<float, float>> vecTransformedCoordinates;
+    // Create translated model vector of coordinate pairs, we don't want to change the original one.
+    // It is thrown away at the end of the function, the frame arena hands it out without touching the heap
+    ArenaVector<std::pair<float, float>> vecTransformedCoordinates{ArenaAllocator<std::pair<float, float>>(mFrameArena)};
     unsigned int verts = vecModelCoordinates.size();
     vecTransformedCoordinates.resize(verts);
 
@@ -358,36 +764,169 @@ bool GameEngine::playMusic() {
     if( Mix_PlayingMusic() == 0 )
     {
         //Play the music
-        Mix_PlayMusic( gMusic, -1 );
+        return mMusic != nullptr && Mix_PlayMusic( mMusic->get(), -1 ) == 0;
     }
+    return true;
 }
 
 bool GameEngine::stopMusic() {
     Mix_HaltMusic();
+    return true;
 }
 
-void InputEventHandler::addCallback(const std::string &cb_name, const KeyEventFuncPtr &fn) {
-    m_callbacks.emplace_back(cb_name, fn);
+int InputEventHandler::kindOf(int eventType) {
+    switch (eventType) {
+        case SDL_KEYDOWN:
+            return KIND_KEY_DOWN;
+        case SDL_KEYUP:
+            return KIND_KEY_UP;
+        case SDL_MOUSEBUTTONDOWN:
+            return KIND_MOUSE_DOWN;
+        case SDL_MOUSEBUTTONUP:
+            return KIND_MOUSE_UP;
+        case SDL_MOUSEMOTION:
+            return KIND_MOUSE_MOTION;
+        default:
+            return -1;
+    }
 }
 
-void InputEventHandler::reset() {
-    m_callbacks.clear();
+InputEventHandler::InputEventHandler() : m_keysHeld(SDL_NUM_SCANCODES, false),
+                                         m_keysPressed(SDL_NUM_SCANCODES, false) {}
+
+InputHandle InputEventHandler::subscribe(int eventType, const KeyEventFuncPtr &fn) {
+    int nKind = kindOf(eventType);
+    if (nKind < 0) {
+        std::cout << "Cannot subscribe to event type " << eventType << std::endl;
+        return INVALID_INPUT_HANDLE;
+    }
+    int nSlot;
+    if (!m_freeSlots.empty()) {
+        nSlot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        nSlot = static_cast<int>(m_slots.size());
+        m_slots.emplace_back();
+    }
+    Slot &slot = m_slots[nSlot];
+    slot.nKind = nKind;
+    // the table a callback runs from mustn't grow under it
+    slot.bPending = m_nDispatching > 0;
+    std::vector<Subscription> &table = slot.bPending ? m_pending[nKind] : m_dispatch[nKind];
+    slot.nIndex = static_cast<int>(table.size());
+    table.push_back({fn, nSlot});
+    return (slot.nGeneration << SLOT_BITS) | nSlot;
 }
 
-void InputEventHandler::runCallbacks(int eventType, int buttonCode, int mousePosX, int mousePosY, float secPerFrame) {
-    for (const auto &cbptr: m_callbacks) {
-        cbptr.second(eventType, buttonCode, mousePosX, mousePosY, secPerFrame);
+void InputEventHandler::unsubscribe(InputHandle handle) {
+    if (handle < 0) return;
+    int nSlot = handle & ((1 << SLOT_BITS) - 1);
+    int nGeneration = handle >> SLOT_BITS;
+    if (nSlot >= static_cast<int>(m_slots.size())) return;
+    Slot &slot = m_slots[nSlot];
+    if (slot.nIndex < 0 || slot.nGeneration != nGeneration) return; // already removed
+
+    if (m_nDispatching > 0) {
+        // its callback may be the one running, it is dropped after the event
+        std::vector<Subscription> &table = slot.bPending ? m_pending[slot.nKind] : m_dispatch[slot.nKind];
+        table[slot.nIndex].bRemoved = true;
+        m_bRemovedWhileDispatching = true;
+    } else {
+        // move the last subscriber into the hole
+        std::vector<Subscription> &table = m_dispatch[slot.nKind];
+        if (slot.nIndex != static_cast<int>(table.size()) - 1) {
+            table[slot.nIndex] = std::move(table.back());
+            m_slots[table[slot.nIndex].nSlot].nIndex = slot.nIndex;
+        }
+        table.pop_back();
     }
+
+    slot.nIndex = -1;
+    slot.bPending = false;
+    slot.nGeneration = (slot.nGeneration + 1) & 0x7FF; // keep the handle positive
+    m_freeSlots.push_back(nSlot);
 }
 
-void InputEventHandler::removeCallback(const std::string &cb_name) {
-    auto it = std::remove_if(m_callbacks.begin(), m_callbacks.end(),
-                             [&](const std::pair<std::string, KeyEventFuncPtr> &cbPair) -> bool {
-                                 return cbPair.first == cb_name;
-                             });
-    if (it != m_callbacks.end()) {
-        m_callbacks.erase(it);
+bool InputEventHandler::pushEvent(const InputEvent &event) {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    if (m_queueCount == EVENT_QUEUE_SIZE) {
+        m_droppedEvents++;
+        return false;
     }
+    m_queue[(m_queueHead + m_queueCount) % EVENT_QUEUE_SIZE] = event;
+    m_queueCount++;
+    return true;
 }
 
-std::vector<std::pair<std::string, KeyEventFuncPtr>> InputEventHandler::m_callbacks;
\ No newline at end of file
+void InputEventHandler::takeQueuedEvents(std::vector<InputEvent> &vecEvents) {
+    vecEvents.clear();
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    for (int i = 0; i < m_queueCount; i++) {
+        vecEvents.push_back(m_queue[(m_queueHead + i) % EVENT_QUEUE_SIZE]);
+    }
+    m_queueHead = 0;
+    m_queueCount = 0;
+}
+
+void InputEventHandler::dispatchEvents(const std::vector<InputEvent> &vecEvents, float secPerFrame) {
+    std::fill(m_keysPressed.begin(), m_keysPressed.end(), false);
+    for (const InputEvent &event: vecEvents) {
+        bool bIsKeyEvent = event.eventType == SDL_KEYDOWN || event.eventType == SDL_KEYUP;
+        if (bIsKeyEvent && event.scancode >= 0 && event.scancode < SDL_NUM_SCANCODES) {
+            bool bDown = event.eventType == SDL_KEYDOWN;
+            if (bDown && !event.bRepeat) {
+                m_keysPressed[event.scancode] = true;
+            }
+            m_keysHeld[event.scancode] = bDown;
+        }
+
+        int nKind = kindOf(event.eventType);
+        if (nKind < 0) continue;
+        // the table doesn't change while the callbacks run, see unsubscribe
+        std::vector<Subscription> &table = m_dispatch[nKind];
+        m_nDispatching++;
+        for (size_t i = 0; i < table.size(); i++) {
+            if (!table[i].bRemoved) table[i].fn(event, secPerFrame);
+        }
+        m_nDispatching--;
+        if (m_nDispatching == 0) applyChangesFromCallbacks();
+    }
+}
+
+void InputEventHandler::applyChangesFromCallbacks() {
+    for (int nKind = 0; nKind < NUM_EVENT_KINDS; nKind++) {
+        std::vector<Subscription> &table = m_dispatch[nKind];
+        if (m_bRemovedWhileDispatching) {
+            size_t nKept = 0;
+            for (size_t i = 0; i < table.size(); i++) {
+                if (table[i].bRemoved) continue;
+                if (nKept != i) table[nKept] = std::move(table[i]);
+                m_slots[table[nKept].nSlot].nIndex = static_cast<int>(nKept);
+                nKept++;
+            }
+            table.resize(nKept);
+        }
+        for (Subscription &subscription: m_pending[nKind]) {
+            if (subscription.bRemoved) continue;
+            Slot &slot = m_slots[subscription.nSlot];
+            slot.bPending = false;
+            slot.nIndex = static_cast<int>(table.size());
+            table.push_back(std::move(subscription));
+        }
+        m_pending[nKind].clear();
+    }
+    m_bRemovedWhileDispatching = false;
+}
+
+bool InputEventHandler::isKeyHeld(int scancode) const {
+    return scancode >= 0 && scancode < SDL_NUM_SCANCODES && m_keysHeld[scancode];
+}
+
+bool InputEventHandler::wasKeyPressed(int scancode) const {
+    return scancode >= 0 && scancode < SDL_NUM_SCANCODES && m_keysPressed[scancode];
+}
+
+int InputEventHandler::getDroppedEventCount() {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_droppedEvents;
+}
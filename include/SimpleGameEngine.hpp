@@ -4,11 +4,15 @@
 #include <SDL_ttf.h>
 #include <SDL_image.h>
 #include <SDL_mixer.h>
+#include "FrameArena.hpp"
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <thread>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <mutex>
 
 class LTexture {
 private:
@@ -24,6 +28,9 @@ public:
 
     bool loadTextureFromFile(std::string path);
 
+    // pixels are RGBA32, as the ResourceCache decodes them
+    bool loadTextureFromPixels(const unsigned char *pixels, int width, int height, int pitch);
+
     void drawTexture(int x, int y, int w = 0, int h = 0, SDL_Rect *clip = NULL,
                      double angle = 0.0, SDL_Point *center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE);
 
@@ -31,6 +38,9 @@ public:
 
     int getHeight() const;
 
+    // for drawing it in ways drawTexture doesn't, see SpriteBatch
+    SDL_Texture *getSDLTexture() const;
+
     void free();
 };
 
@@ -40,23 +50,139 @@ struct Color {
     int b;
 };
 
-using KeyEventFuncPtr = std::function<void(int, int, int, int, float)>;
+// A copy of the parts of an SDL input event the game cares about
+struct InputEvent {
+    int eventType = 0;   // SDL_KEYDOWN, SDL_KEYUP, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONUP or SDL_MOUSEMOTION
+    int buttonCode = 0;  // key code for keyboard events, mouse button for mouse button events
+    int scancode = 0;    // keyboard events only
+    int mousePosX = 0;
+    int mousePosY = 0;
+    bool bRepeat = false; // key down generated by the OS key repeat
+};
+
+using KeyEventFuncPtr = std::function<void(const InputEvent &, float)>;
+
+// Handle returned by InputEventHandler::subscribe, the low bits are a slot index and the high bits
+// a generation counter, so a stale handle can never remove somebody else's subscription
+using InputHandle = int;
+const InputHandle INVALID_INPUT_HANDLE = -1;
 
 class InputEventHandler {
 private:
-    static std::vector<std::pair<std::string, KeyEventFuncPtr>> m_callbacks;
+    enum EventKind {
+        KIND_KEY_DOWN = 0,
+        KIND_KEY_UP,
+        KIND_MOUSE_DOWN,
+        KIND_MOUSE_UP,
+        KIND_MOUSE_MOTION,
+        NUM_EVENT_KINDS
+    };
+    static const int EVENT_QUEUE_SIZE = 256;
+    static const int SLOT_BITS = 20;
+
+    struct Subscription {
+        KeyEventFuncPtr fn;
+        int nSlot;
+        bool bRemoved = false; // unsubscribed while an event was dispatched, dropped afterwards
+    };
+    struct Slot {
+        int nKind = 0;
+        int nIndex = -1;       // position in the dispatch table of nKind, -1 while the slot is free
+        bool bPending = false; // nIndex is a position in m_pending instead, subscribed during a dispatch
+        int nGeneration = 0;
+    };
+
+    // one dense dispatch table per event kind, so an event only visits its own subscribers
+    std::vector<Subscription> m_dispatch[NUM_EVENT_KINDS];
+    std::vector<Slot> m_slots;
+    std::vector<int> m_freeSlots;
+    // While a callback runs the tables stay as they are: subscribers it adds wait in m_pending and those it
+    // removes are only marked, both are taken care of once the event has been dispatched
+    int m_nDispatching = 0;
+    bool m_bRemovedWhileDispatching = false;
+    std::vector<Subscription> m_pending[NUM_EVENT_KINDS];
+
+    // events are copied in here while polling SDL and dispatched in one go per tick, the simulation may
+    // take them on another thread than the one polling
+    std::mutex m_queueMutex;
+    InputEvent m_queue[EVENT_QUEUE_SIZE];
+    int m_queueHead = 0;
+    int m_queueCount = 0;
+    int m_droppedEvents = 0;
+
+    // keyboard state as of the last dispatchEvents, built from the events themselves
+    std::vector<bool> m_keysHeld;
+    std::vector<bool> m_keysPressed;
+
+    static int kindOf(int eventType);
+
+    // drops the subscribers removed and adds those subscribed while an event was dispatched
+    void applyChangesFromCallbacks();
 
 public:
-    InputEventHandler() = delete; // The callback queue is shared, no point in creating instances
-    static void addCallback(const std::string &cb_name, const KeyEventFuncPtr &fn);
+    // Every engine has its own (see GameEngine::getInput), engines running side by side on different
+    // threads share neither subscribers nor key state
+    InputEventHandler();
+
+    InputEventHandler(const InputEventHandler &) = delete;
+    InputEventHandler &operator=(const InputEventHandler &) = delete;
+
+    // eventType is one of the SDL event types in InputEvent::eventType
+    InputHandle subscribe(int eventType, const KeyEventFuncPtr &fn);
+
+    // O(1), the last subscriber of the same event type takes the removed one's place. Called from a
+    // callback (for itself or another subscriber) the subscriber gets no more events and is removed after
+    // the event. A subscriber added from a callback gets the events after that one.
+    void unsubscribe(InputHandle handle);
 
-    static void removeCallback(const std::string &cb_name);
+    // returns false (and counts the event as dropped) if the queue is full, may be called from any thread
+    bool pushEvent(const InputEvent &event);
 
-    static void reset();
+    // moves the queued events into vecEvents
+    void takeQueuedEvents(std::vector<InputEvent> &vecEvents);
 
-    static void runCallbacks(int eventType, int buttonCode, int mousePosX, int mousePosY, float secPerFrame);
+    // updates the keyboard state and runs the subscribers of every event, in order
+    void dispatchEvents(const std::vector<InputEvent> &vecEvents, float secPerFrame);
+
+    // key is down at the end of this frame's events
+    bool isKeyHeld(int scancode) const;
+
+    // key went down during this frame (key repeat doesn't count)
+    bool wasKeyPressed(int scancode) const;
+
+    int getDroppedEventCount();
+};
+
+// Heap allocations made by the game thread per frame (SDL's own included), to check that a running game
+// doesn't allocate. The profiler overlay's text is not counted.
+struct AllocationStats {
+    uint64_t nFrames = 0;
+    uint64_t nFramesWithAllocations = 0;
+    uint64_t nAllocations = 0;
+    uint64_t nMaxFrameAllocations = 0;
+    uint64_t nLastFrameAllocations = 0;
+    uint64_t nLastAllocatingFrame = 0; // frame number, counting from 1, 0 if no frame allocated
+};
+
+// What the current frame draws, the game counts its objects in onFrameUpdate. Shown by the profiler overlay.
+struct RenderStats {
+    uint32_t nObjectsDrawn = 0;
+    uint32_t nObjectsCulled = 0; // outside the view, not submitted
+    uint32_t nSprites = 0;       // through the sprite batch
 };
 
+class InputRecorder;
+
+class Font;
+
+class SpriteBatch;
+
+class SoundPool;
+
+class Music;
+
+class InputReplayer;
+
 
 class GameEngine {
 protected:
@@ -66,12 +192,57 @@ protected:
 private:
     void initScreen();
 
+    bool runSimulationTick(float fTickTime);
+
+    // the loop of the simulation thread, see setSimulationThread
+    void runSimulationThread();
+
+    void drawProfilerOverlay();
+
+    void openAssets();
+
     SDL_Window *gWindow = nullptr;
+    SDL_Surface *mSoftwareSurface = nullptr;
+    bool mHeadless = false;
+    float mTickTime = 0.0f;
+    bool mSimulationThread = false;
+    std::atomic<bool> mStopSimulation{false};
+    std::atomic<bool> mSimulationFinished{false}; // onSimulationTick returned false on the simulation thread
+    std::unique_ptr<InputRecorder> mRecorder;
+    std::unique_ptr<InputReplayer> mReplayer;
+    std::vector<InputEvent> mTickEvents;
+    std::vector<std::vector<uint8_t>> mReplayData;
+    size_t mReplayDataPos = 0;
+    bool mShowProfiler = false;
+    int mProfilerOverlayAge = 0; // frames since the overlay text was rendered
+    LTexture mProfilerOverlay;
+    std::shared_ptr<Font> mFont;
+    std::shared_ptr<Music> mMusic;
+    bool mAssetsOpen = false;
+    FrameArena mFrameArena;
+    std::unique_ptr<SpriteBatch> mSpriteBatch;
+    std::unique_ptr<SoundPool> mSoundPool;
+    AllocationStats mAllocationStats;
+    RenderStats mRenderStats;
+    InputEventHandler mInput;
 public:
-    GameEngine();
+    // A headless engine opens no window and initialises no SDL subsystem, it only runs simulation ticks
+    // (as fast as it can) until onSimulationTick returns false or the replay being played ends
+    explicit GameEngine(bool bHeadless = false);
+
+    // Called with a fixed tick time if setFixedTimestep was used, once per frame with the frame time otherwise
+    virtual bool onSimulationTick(float fTickTime) { return true; }
 
     virtual bool onFrameUpdate(float fElapsedTime) = 0;
 
+    // Asked before every simulation tick, a tick that isn't ready is put off and the game stalls until it is.
+    // Lockstep multiplayer waits here for the other players' input.
+    virtual bool isTickReady() { return true; }
+
+    // Called after the simulation ticks of a frame, on the thread that ran them, to copy what onFrameUpdate
+    // draws into a snapshot (see TripleBuffer). Not called on a headless engine.
+    virtual void onPublishSnapshot() {}
+
     virtual bool onInit() = 0;
 
     virtual bool drawPoint(int x, int y, Color color = {0xFF, 0xFF, 0xFF});
@@ -84,13 +255,77 @@ public:
 
     bool constructConsole(int nCharsX, int nCharsY, const char *title);
 
+    // Draws into an off-screen surface with SDL's software renderer instead of a window, works on a
+    // headless engine too. Nothing is ever shown, it is meant for measuring the drawing code.
+    bool constructSoftwareConsole(int width, int height);
+
     bool createResources();
 
+    // Scratch memory that is valid until the end of the current frame
+    FrameArena &getFrameArena();
+
+    const AllocationStats &getAllocationStats() const;
+
+    // Reset before every onFrameUpdate
+    RenderStats &getRenderStats();
+
+    // Sprites drawn through it are drawn together after onFrameUpdate
+    SpriteBatch &getSpriteBatch();
+
+    // Sound effects played through it during the simulation ticks of a frame are started together after
+    // onPublishSnapshot. Closed on a headless engine.
+    SoundPool &getSoundPool();
+
     bool renderConsole();
 
+    // The input of this engine's simulation, the game loop pushes what SDL reports into it
+    InputEventHandler &getInput();
+
+    const InputEventHandler &getInput() const;
+
     void startGameLoop();
 
-    bool loadMusic(const char *path);
+    // For a host that runs the ticks of many headless engines itself instead of startGameLoop (see
+    // fauji-server): calls onInit, false if it failed
+    bool startSimulation();
+
+    // Runs one tick with the fixed timestep unless the game isn't ready for it, false once onSimulationTick
+    // returned false or the replay ended
+    bool stepSimulation();
+
+    // Runs onSimulationTick every fTickTime seconds, independent of the frame rate (0 turns it off)
+    void setFixedTimestep(float fTickTime);
+
+    // Runs the simulation ticks on a thread of their own, paced by their own clock, so that slow frames and
+    // waiting for VSYNC don't hold them up. Needs a fixed timestep. onFrameUpdate then runs while ticks do
+    // and may only draw what onPublishSnapshot handed over.
+    void setSimulationThread(bool bEnabled);
+
+    bool isHeadless() const;
+
+    // Shows the frame profiler's percentiles over the game, F3 toggles it as well
+    void setProfilerOverlay(bool bShow);
+
+    // Logs the rng seed and the input of every tick to path, call after setFixedTimestep
+    bool startRecording(const std::string &path, uint64_t seed);
+
+    // Feeds the input recorded in path back instead of the live input
+    bool startReplay(const std::string &path);
+
+    bool isRecording() const;
+
+    bool isReplaying() const;
+
+    uint64_t getReplaySeed() const;
+
+    // Stores game data with the current tick of the recording
+    void recordGameData(const void *data, size_t size);
+
+    // Hands out the game data recorded with the current tick, one blob per call
+    bool takeReplayGameData(std::vector<uint8_t> &data);
+
+    // name is the asset id of the music, see ResourceCache
+    bool loadMusic(const char *name);
 
     bool playMusic();
     bool stopMusic();
@@ -0,0 +1,129 @@
+#include "SoundPool.hpp"
+#include <algorithm>
+#include <cmath>
+
+bool SoundPool::open(int nChannels) {
+    close();
+    int nFrequency;
+    Uint16 nFormat;
+    int nOutputChannels;
+    if (Mix_QuerySpec(&nFrequency, &nFormat, &nOutputChannels) == 0) {
+        return false;
+    }
+    nChannels = std::max(1, nChannels);
+    Mix_AllocateChannels(nChannels);
+    vecChannels.assign(nChannels, Channel());
+    bOpen = true;
+    return true;
+}
+
+void SoundPool::close() {
+    if (bOpen) {
+        Mix_HaltChannel(-1);
+    }
+    bOpen = false;
+    vecSounds.clear();
+    vecPending.clear();
+    vecChannels.clear();
+}
+
+bool SoundPool::isOpen() const {
+    return bOpen;
+}
+
+int SoundPool::addSound(SoundHandle sound, int nPriority, int nMaxVoices) {
+    if (!bOpen || sound == nullptr) {
+        return -1;
+    }
+    SoundEntry entry;
+    entry.sound = std::move(sound);
+    entry.nPriority = nPriority;
+    entry.vecVoices.resize(std::max(1, nMaxVoices));
+    vecSounds.push_back(std::move(entry));
+    return static_cast<int>(vecSounds.size()) - 1;
+}
+
+void SoundPool::play(int nSound, float fVolume, float fPan) {
+    if (!bOpen || nSound < 0 || nSound >= static_cast<int>(vecSounds.size()) || !(fVolume > 0.0f)) {
+        return;
+    }
+    stats.nEvents++;
+    SoundEntry &entry = vecSounds[nSound];
+    fPan = std::max(-1.0f, std::min(fPan, 1.0f));
+    int nVoices = static_cast<int>(entry.vecVoices.size());
+    int nVoice = std::min(static_cast<int>((fPan + 1.0f) * 0.5f * nVoices), nVoices - 1);
+    Voice &voice = entry.vecVoices[nVoice];
+    voice.fEnergy += fVolume * fVolume;
+    voice.fVolumeSum += fVolume;
+    voice.fPanSum += fVolume * fPan;
+    if (!entry.bPending) {
+        entry.bPending = true;
+        vecPending.push_back(nSound);
+    }
+}
+
+void SoundPool::flush() {
+    if (vecPending.empty()) {
+        return;
+    }
+    nFlushes++;
+    for (int c = 0; c < static_cast<int>(vecChannels.size()); c++) {
+        vecChannels[c].bBusy = Mix_Playing(c) != 0;
+    }
+    std::sort(vecPending.begin(), vecPending.end(),
+              [this](int a, int b) { return vecSounds[a].nPriority > vecSounds[b].nPriority; });
+    for (int nSound: vecPending) {
+        SoundEntry &entry = vecSounds[nSound];
+        entry.bPending = false;
+        for (Voice &voice: entry.vecVoices) {
+            if (voice.fVolumeSum <= 0.0f) continue;
+            // events that sound together add up like noise does, by their energy
+            float fVolume = std::min(std::sqrt(voice.fEnergy), 1.0f);
+            float fPan = voice.fPanSum / voice.fVolumeSum;
+            voice = Voice();
+            int nChannel = takeChannel(entry.nPriority);
+            if (nChannel < 0) {
+                stats.nDropped++;
+                continue;
+            }
+            Mix_Volume(nChannel, static_cast<int>(std::lround(fVolume * MIX_MAX_VOLUME)));
+            Mix_SetPanning(nChannel, static_cast<Uint8>(std::lround(255.0f * std::min(1.0f, 1.0f - fPan))),
+                           static_cast<Uint8>(std::lround(255.0f * std::min(1.0f, 1.0f + fPan))));
+            if (Mix_PlayChannel(nChannel, entry.sound->get(), 0) < 0) {
+                stats.nDropped++;
+                continue;
+            }
+            Channel &channel = vecChannels[nChannel];
+            channel.nPriority = entry.nPriority;
+            channel.nStartedFlush = nFlushes;
+            channel.bBusy = true;
+            stats.nVoices++;
+        }
+    }
+    vecPending.clear();
+}
+
+const SoundStats &SoundPool::getStats() const {
+    return stats;
+}
+
+int SoundPool::takeChannel(int nPriority) {
+    int nVictim = -1;
+    for (int c = 0; c < static_cast<int>(vecChannels.size()); c++) {
+        const Channel &channel = vecChannels[c];
+        if (!channel.bBusy) {
+            return c;
+        }
+        // what this flush started stays
+        if (channel.nPriority > nPriority || channel.nStartedFlush == nFlushes) continue;
+        const Channel *victim = nVictim < 0 ? nullptr : &vecChannels[nVictim];
+        if (victim == nullptr || channel.nPriority < victim->nPriority ||
+            (channel.nPriority == victim->nPriority && channel.nStartedFlush < victim->nStartedFlush)) {
+            nVictim = c;
+        }
+    }
+    if (nVictim >= 0) {
+        stats.nStolen++;
+    }
+    return nVictim;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ResourceCache.hpp"
+#include <cstdint>
+#include <vector>
+
+struct SoundStats {
+    uint64_t nEvents = 0;  // plays asked for
+    uint64_t nVoices = 0;  // voices started for them
+    uint64_t nStolen = 0;  // of those, voices that cut one of the same or a lower priority short
+    uint64_t nDropped = 0; // voices that found no channel they could have
+};
+
+// Sound effects on a fixed budget of SDL_mixer channels. play() only notes an event down, flush() (which the
+// engine calls after the simulation ticks of a frame) merges the events of every sound into at most the
+// sound's nMaxVoices voices, by where they are in the stereo field, and starts those. A hundred bombs landing
+// in one frame are a few louder voices rather than a hundred Mix_PlayChannel calls, what a frame costs the
+// mixer doesn't grow with the number of events.
+//
+// A voice that finds every channel busy takes the one that plays the lowest priority, the oldest of those,
+// unless that is a higher priority than its own, and is dropped otherwise.
+// Without an audio device (on a headless engine, or when SDL couldn't open one) the pool stays closed and
+// plays nothing. With SDL's dummy audio driver it works as it does with a real device.
+class SoundPool {
+public:
+    static const int DEFAULT_CHANNELS = 16;
+
+    // Takes nChannels of SDL_mixer's channels, false if the audio device isn't open
+    bool open(int nChannels = DEFAULT_CHANNELS);
+
+    // Stops every voice and lets go of the sounds, before SDL shuts down
+    void close();
+
+    bool isOpen() const;
+
+    // The id a sound is played with, -1 if sound is nullptr or the pool isn't open
+    int addSound(SoundHandle sound, int nPriority, int nMaxVoices);
+
+    // Notes an event of sound nSound down for the next flush, fVolume from 0 to 1 and fPan from -1 (left) to
+    // 1 (right). Doesn't call SDL, the simulation thread may play as long as it is the one that flushes.
+    void play(int nSound, float fVolume, float fPan);
+
+    // Starts the voices of the events noted since the last flush, higher priorities first
+    void flush();
+
+    const SoundStats &getStats() const;
+
+private:
+    // the events merged into one voice
+    struct Voice {
+        float fEnergy = 0.0f;    // the sum of the squared volumes
+        float fVolumeSum = 0.0f;
+        float fPanSum = 0.0f;    // weighted by volume
+    };
+    struct SoundEntry {
+        SoundHandle sound;
+        int nPriority;
+        std::vector<Voice> vecVoices; // nMaxVoices of them, each taking a stretch of the stereo field
+        bool bPending = false;        // events were noted since the last flush
+    };
+    struct Channel {
+        int nPriority = 0;
+        uint64_t nStartedFlush = 0;
+        bool bBusy = false;
+    };
+
+    bool bOpen = false;
+    std::vector<SoundEntry> vecSounds;
+    std::vector<int> vecPending; // sounds with events noted since the last flush
+    std::vector<Channel> vecChannels;
+    uint64_t nFlushes = 0;
+    SoundStats stats;
+
+    // the channel a voice of nPriority gets, -1 for none
+    int takeChannel(int nPriority);
+};
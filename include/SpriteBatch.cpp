@@ -0,0 +1,93 @@
+#include "SpriteBatch.hpp"
+#include "Trace.hpp"
+#include <cmath>
+#include <utility>
+
+extern SDL_Renderer *gRenderer;
+
+void SpriteBatch::setAtlas(std::shared_ptr<const TextureAtlas> atlas) {
+    mAtlas = std::move(atlas);
+    vecVertices.clear();
+    nSprites = 0;
+}
+
+const TextureAtlas *SpriteBatch::getAtlas() const {
+    return mAtlas.get();
+}
+
+void SpriteBatch::draw(int nRegion, const SDL_Rect *clip, float x, float y, float w, float h, double angle,
+                       SDL_RendererFlip flip) {
+    if (mAtlas == nullptr || nRegion < 0) {
+        return;
+    }
+    const LTexture &texture = mAtlas->getTexture();
+    if (texture.getWidth() == 0 || texture.getHeight() == 0) {
+        return;
+    }
+    SDL_Rect source = mAtlas->getRegion(nRegion);
+    if (clip != nullptr) {
+        source = {source.x + clip->x, source.y + clip->y, clip->w, clip->h};
+    }
+    float fInvWidth = 1.0f / static_cast<float>(texture.getWidth());
+    float fInvHeight = 1.0f / static_cast<float>(texture.getHeight());
+    float u0 = source.x * fInvWidth;
+    float u1 = (source.x + source.w) * fInvWidth;
+    float v0 = source.y * fInvHeight;
+    float v1 = (source.y + source.h) * fInvHeight;
+    if (flip & SDL_FLIP_HORIZONTAL) std::swap(u0, u1);
+    if (flip & SDL_FLIP_VERTICAL) std::swap(v0, v1);
+
+    // corners relative to the centre, clockwise from the top left
+    float fHalfW = w * 0.5f;
+    float fHalfH = h * 0.5f;
+    float cx = x + fHalfW;
+    float cy = y + fHalfH;
+    const float corners[4][2] = {{-fHalfW, -fHalfH}, {fHalfW, -fHalfH}, {fHalfW, fHalfH}, {-fHalfW, fHalfH}};
+    const float texCoords[4][2] = {{u0, v0}, {u1, v0}, {u1, v1}, {u0, v1}};
+    float fCos = 1.0f;
+    float fSin = 0.0f;
+    if (angle != 0.0) {
+        double fRadians = angle * M_PI / 180.0;
+        fCos = static_cast<float>(std::cos(fRadians));
+        fSin = static_cast<float>(std::sin(fRadians));
+    }
+    size_t nFirstVertex = vecVertices.size();
+    vecVertices.resize(nFirstVertex + 4);
+    SDL_Vertex *vertices = &vecVertices[nFirstVertex];
+    for (int i = 0; i < 4; i++) {
+        vertices[i].position.x = cx + corners[i][0] * fCos - corners[i][1] * fSin;
+        vertices[i].position.y = cy + corners[i][0] * fSin + corners[i][1] * fCos;
+        vertices[i].color = {0xFF, 0xFF, 0xFF, 0xFF};
+        vertices[i].tex_coord.x = texCoords[i][0];
+        vertices[i].tex_coord.y = texCoords[i][1];
+    }
+    nSprites++;
+    // every quad is indexed the same way, the indices only ever grow
+    if (vecIndices.size() < nSprites * 6) {
+        int nFirst = static_cast<int>(nSprites - 1) * 4;
+        for (int index: {0, 1, 2, 0, 2, 3}) {
+            vecIndices.push_back(nFirst + index);
+        }
+    }
+}
+
+size_t SpriteBatch::getSpriteCount() const {
+    return nSprites;
+}
+
+bool SpriteBatch::flush() {
+    if (nSprites == 0) {
+        return true;
+    }
+    TRACE_SCOPE("draw sprites");
+    int nResult = SDL_RenderGeometry(gRenderer, mAtlas->getTexture().getSDLTexture(), vecVertices.data(),
+                                     static_cast<int>(vecVertices.size()), vecIndices.data(),
+                                     static_cast<int>(nSprites * 6));
+    vecVertices.clear();
+    nSprites = 0;
+    if (nResult != 0) {
+        std::cout << "Unable to draw sprites! SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "TextureAtlas.hpp"
+#include <memory>
+#include <vector>
+
+// Collects sprites drawn from one TextureAtlas and hands them to the renderer as one SDL_RenderGeometry
+// call, instead of one SDL_RenderCopyEx (and possibly a texture switch) per sprite. The engine flushes
+// its batch after onFrameUpdate, so queued sprites end up on top of what was drawn directly.
+class SpriteBatch {
+private:
+    std::shared_ptr<const TextureAtlas> mAtlas;
+    std::vector<SDL_Vertex> vecVertices; // kept between frames, a frame's sprites don't allocate
+    std::vector<int> vecIndices;
+    size_t nSprites = 0;
+
+public:
+    // Sprites queued for the previous atlas are dropped
+    void setAtlas(std::shared_ptr<const TextureAtlas> atlas);
+
+    const TextureAtlas *getAtlas() const;
+
+    // Queues the atlas region nRegion, or the clip of it (relative to the region) if there is one, drawn
+    // like LTexture::drawTexture: angle in degrees clockwise around the centre of the destination
+    void draw(int nRegion, const SDL_Rect *clip, float x, float y, float w, float h, double angle = 0.0,
+              SDL_RendererFlip flip = SDL_FLIP_NONE);
+
+    size_t getSpriteCount() const;
+
+    // Draws everything queued since the last flush
+    bool flush();
+};
@@ -0,0 +1,123 @@
+#include "TextureAtlas.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstring>
+
+extern SDL_Renderer *gRenderer;
+
+namespace {
+    const int DEFAULT_MAX_SIZE = 4096; // if the renderer doesn't say
+
+    // Shelf packing: rows of images, tallest first. Fills in the rects (without padding) and returns the
+    // height used, or -1 if an image is wider than nWidth.
+    int packShelves(const std::vector<std::pair<std::string, ImageHandle>> &vecImages,
+                    const std::vector<size_t> &vecOrder, int nWidth, std::vector<SDL_Rect> &vecRects) {
+        const int pad = TextureAtlas::PADDING;
+        int x = 0;
+        int y = 0;
+        int nShelfHeight = 0;
+        for (size_t i: vecOrder) {
+            const Image &image = *vecImages[i].second;
+            int w = image.nWidth + 2 * pad;
+            int h = image.nHeight + 2 * pad;
+            if (w > nWidth) {
+                return -1;
+            }
+            if (x + w > nWidth) {
+                y += nShelfHeight;
+                x = 0;
+                nShelfHeight = 0;
+            }
+            vecRects[i] = {x + pad, y + pad, image.nWidth, image.nHeight};
+            x += w;
+            nShelfHeight = std::max(nShelfHeight, h);
+        }
+        return y + nShelfHeight;
+    }
+}
+
+bool TextureAtlas::build(const std::vector<std::string> &vecIds) {
+    std::vector<std::pair<std::string, ImageHandle>> vecImages;
+    for (auto &id: vecIds) {
+        ImageHandle image = ResourceCache::getImage(id);
+        if (image == nullptr) {
+            std::cout << "Unable to add " << id << " to the texture atlas" << std::endl;
+            return false;
+        }
+        vecImages.emplace_back(id, std::move(image));
+    }
+    return build(vecImages);
+}
+
+bool TextureAtlas::build(const std::vector<std::pair<std::string, ImageHandle>> &vecImages) {
+    TRACE_SCOPE("build texture atlas");
+    int nMaxSize = DEFAULT_MAX_SIZE;
+    SDL_RendererInfo info{};
+    if (SDL_GetRendererInfo(gRenderer, &info) == 0 && info.max_texture_width > 0) {
+        nMaxSize = std::min(info.max_texture_width, info.max_texture_height);
+    }
+
+    std::vector<size_t> vecOrder(vecImages.size());
+    size_t nArea = 0;
+    for (size_t i = 0; i < vecImages.size(); i++) {
+        vecOrder[i] = i;
+        const Image &image = *vecImages[i].second;
+        nArea += size_t(image.nWidth + 2 * PADDING) * (image.nHeight + 2 * PADDING);
+    }
+    std::stable_sort(vecOrder.begin(), vecOrder.end(), [&vecImages](size_t a, size_t b) {
+        return vecImages[a].second->nHeight > vecImages[b].second->nHeight;
+    });
+
+    // the narrowest power of two that is about square, wider until the shelves fit
+    int nWidth = 1;
+    while (nWidth < nMaxSize && size_t(nWidth) * nWidth < nArea) {
+        nWidth *= 2;
+    }
+    std::vector<SDL_Rect> vecRects(vecImages.size());
+    int nHeight = packShelves(vecImages, vecOrder, nWidth, vecRects);
+    while ((nHeight < 0 || nHeight > nMaxSize) && nWidth < nMaxSize) {
+        nWidth *= 2;
+        nHeight = packShelves(vecImages, vecOrder, nWidth, vecRects);
+    }
+    if (nHeight < 0 || nHeight > nMaxSize) {
+        std::cout << "The images don't fit into a " << nMaxSize << "x" << nMaxSize << " texture atlas" << std::endl;
+        return false;
+    }
+    nHeight = std::max(nHeight, 1);
+
+    // padding stays transparent
+    std::vector<unsigned char> pixels(size_t(nWidth) * 4 * nHeight, 0);
+    for (size_t i = 0; i < vecImages.size(); i++) {
+        const Image &image = *vecImages[i].second;
+        const SDL_Rect &rect = vecRects[i];
+        for (int y = 0; y < image.nHeight; y++) {
+            memcpy(pixels.data() + (size_t(rect.y + y) * nWidth + rect.x) * 4,
+                   image.pixels + size_t(y) * image.nPitch, size_t(image.nWidth) * 4);
+        }
+    }
+    if (!mTexture.loadTextureFromPixels(pixels.data(), nWidth, nHeight, nWidth * 4)) {
+        return false;
+    }
+    vecRegions.clear();
+    for (size_t i = 0; i < vecImages.size(); i++) {
+        vecRegions.push_back({vecImages[i].first, vecRects[i]});
+    }
+    return true;
+}
+
+int TextureAtlas::find(const std::string &id) const {
+    for (size_t i = 0; i < vecRegions.size(); i++) {
+        if (vecRegions[i].id == id) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+const SDL_Rect &TextureAtlas::getRegion(int nRegion) const {
+    return vecRegions[nRegion].rect;
+}
+
+const LTexture &TextureAtlas::getTexture() const {
+    return mTexture;
+}
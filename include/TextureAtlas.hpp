@@ -0,0 +1,42 @@
+#pragma once
+
+#include "SimpleGameEngine.hpp"
+#include "ResourceCache.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+struct AtlasRegion {
+    std::string id;
+    SDL_Rect rect; // where the image is in the atlas
+};
+
+// Several images packed into one texture, so that everything drawn from them can go to the renderer
+// in one call (see SpriteBatch). Sprite sheets are packed whole, their clips stay relative to the sheet.
+class TextureAtlas {
+private:
+    LTexture mTexture;
+    std::vector<AtlasRegion> vecRegions;
+
+public:
+    // transparent pixels around every image, keeps neighbours from bleeding into each other when scaled
+    static const int PADDING = 1;
+
+    TextureAtlas() = default;
+
+    TextureAtlas(const TextureAtlas &) = delete;
+    TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+    // Packs the images with these asset ids, returns false (with a message) if one can't be loaded or they
+    // don't fit into the largest texture the renderer supports
+    bool build(const std::vector<std::string> &vecIds);
+
+    bool build(const std::vector<std::pair<std::string, ImageHandle>> &vecImages);
+
+    // index of the image's region, -1 if the atlas doesn't have it
+    int find(const std::string &id) const;
+
+    const SDL_Rect &getRegion(int nRegion) const;
+
+    const LTexture &getTexture() const;
+};
@@ -0,0 +1,156 @@
+#include "Trace.hpp"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct TraceEvent {
+        const char *name;
+        uint64_t nTimestampNs;
+        uint64_t nDurationNs; // complete events only
+        double fValue;        // counters only
+        char phase;           // 'X' complete, 'B' begin, 'E' end, 'C' counter
+    };
+
+    // Written by exactly one thread at a time, nWritten is only published after the event is complete
+    struct TraceRing {
+        TraceEvent events[Trace::RING_EVENTS];
+        std::atomic<uint64_t> nWritten{0};
+        const char *threadName = nullptr;
+        int nId = 0;
+    };
+
+    struct TraceState {
+        std::mutex mtxRings; // only taken when a thread records its first event or exits, and by writeJson
+        std::vector<std::unique_ptr<TraceRing>> vecRings;
+        std::vector<TraceRing *> vecFreeRings;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    };
+
+    TraceState &state() {
+        static TraceState traceState;
+        return traceState;
+    }
+
+    // Short lived threads (the shot solver starts its workers per call) hand their ring back when they
+    // exit, the next new thread continues in it. The number of rings stays at the peak thread count.
+    struct ThreadRing {
+        TraceRing *ring = nullptr;
+
+        ~ThreadRing() {
+            if (ring == nullptr) return;
+            std::lock_guard<std::mutex> lock(state().mtxRings);
+            state().vecFreeRings.push_back(ring);
+        }
+    };
+
+    thread_local ThreadRing threadRing;
+
+    TraceRing &ring() {
+        if (threadRing.ring == nullptr) {
+            TraceState &s = state();
+            std::lock_guard<std::mutex> lock(s.mtxRings);
+            if (!s.vecFreeRings.empty()) {
+                threadRing.ring = s.vecFreeRings.back();
+                s.vecFreeRings.pop_back();
+            } else {
+                s.vecRings.push_back(std::make_unique<TraceRing>());
+                threadRing.ring = s.vecRings.back().get();
+                threadRing.ring->nId = static_cast<int>(s.vecRings.size());
+            }
+        }
+        return *threadRing.ring;
+    }
+
+    void record(char phase, const char *name, uint64_t nTimestampNs, uint64_t nDurationNs, double fValue) {
+        TraceRing &r = ring();
+        uint64_t n = r.nWritten.load(std::memory_order_relaxed);
+        TraceEvent &event = r.events[n % Trace::RING_EVENTS];
+        event.name = name;
+        event.nTimestampNs = nTimestampNs;
+        event.nDurationNs = nDurationNs;
+        event.fValue = fValue;
+        event.phase = phase;
+        r.nWritten.store(n + 1, std::memory_order_release);
+    }
+
+    void writeString(std::ofstream &file, const char *text) {
+        file << '"';
+        for (const char *c = text; *c != 0; c++) {
+            if (*c == '"' || *c == '\\') file << '\\';
+            file << *c;
+        }
+        file << '"';
+    }
+}
+
+void Trace::setThreadName(const char *name) {
+    ring().threadName = name;
+}
+
+void Trace::complete(const char *name, uint64_t nStartNs, uint64_t nEndNs) {
+    record('X', name, nStartNs, nEndNs - nStartNs, 0.0);
+}
+
+void Trace::begin(const char *name) {
+    record('B', name, now(), 0, 0.0);
+}
+
+void Trace::end(const char *name) {
+    record('E', name, now(), 0, 0.0);
+}
+
+void Trace::counter(const char *name, double fValue) {
+    record('C', name, now(), 0, fValue);
+}
+
+uint64_t Trace::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - state().start).count());
+}
+
+bool Trace::writeJson(const std::string &path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cout << "Unable to open " << path << " for writing the trace" << std::endl;
+        return false;
+    }
+    TraceState &s = state();
+    std::lock_guard<std::mutex> lock(s.mtxRings);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool bFirst = true;
+    auto separator = [&]() {
+        if (!bFirst) file << ",\n";
+        bFirst = false;
+    };
+    for (auto &r: s.vecRings) {
+        separator();
+        file << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << r->nId << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+        writeString(file, r->threadName != nullptr ? r->threadName : ("thread " + std::to_string(r->nId)).c_str());
+        file << "}}";
+
+        uint64_t nWritten = r->nWritten.load(std::memory_order_acquire);
+        uint64_t nFirst = nWritten > RING_EVENTS ? nWritten - RING_EVENTS : 0;
+        for (uint64_t n = nFirst; n < nWritten; n++) {
+            const TraceEvent &event = r->events[n % RING_EVENTS];
+            separator();
+            file << "{\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << r->nId << ",\"name\":";
+            writeString(file, event.name);
+            // microseconds with nanosecond precision
+            file << ",\"ts\":" << event.nTimestampNs / 1000 << "." << event.nTimestampNs % 1000 / 100
+                 << event.nTimestampNs % 100 / 10 << event.nTimestampNs % 10;
+            if (event.phase == 'X') {
+                file << ",\"dur\":" << event.nDurationNs / 1000 << "." << event.nDurationNs % 1000 / 100
+                     << event.nDurationNs % 100 / 10 << event.nDurationNs % 10;
+            } else if (event.phase == 'C') {
+                file << ",\"args\":{\"value\":" << event.fValue << "}";
+            }
+            file << "}";
+        }
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
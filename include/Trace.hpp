@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Trace events in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+// Every thread records into its own fixed size ring buffer, so apart from a thread's very first event
+// recording never takes a lock and never allocates; once a ring is full the oldest events are overwritten. writeJson() merges all rings into
+// one file and should be called once the traced threads are idle, for example when the game exits.
+//
+// The TRACE_ macros only record anything if the build defines FAUJI_TRACE (cmake -DFAUJI_TRACE=ON),
+// otherwise they expand to nothing and their arguments are not even evaluated.
+class Trace {
+public:
+    static const int RING_EVENTS = 1 << 16; // per thread
+
+    Trace() = delete;
+
+    // name shows up as the thread's track in the trace viewer, it must outlive the trace
+    static void setThreadName(const char *name);
+
+    // name must be a string literal (or otherwise live until writeJson)
+    static void complete(const char *name, uint64_t nStartNs, uint64_t nEndNs);
+
+    static void begin(const char *name);
+
+    static void end(const char *name);
+
+    static void counter(const char *name, double fValue);
+
+    static uint64_t now();
+
+    static bool writeJson(const std::string &path);
+};
+
+// Records a complete event for its own lifetime
+class TraceScope {
+private:
+    const char *mName;
+    uint64_t mStart;
+
+public:
+    explicit TraceScope(const char *name) : mName(name), mStart(Trace::now()) {}
+
+    ~TraceScope() { Trace::complete(mName, mStart, Trace::now()); }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+};
+
+#ifdef FAUJI_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_BEGIN(name) Trace::begin(name)
+#define TRACE_END(name) Trace::end(name)
+#define TRACE_COUNTER(name, value) Trace::counter(name, static_cast<double>(value))
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_BEGIN(name) do {} while (0)
+#define TRACE_END(name) do {} while (0)
+#define TRACE_COUNTER(name, value) do {} while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+#endif
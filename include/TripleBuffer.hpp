@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer mailbox that always holds the latest value.
+// The writer fills writeBuffer() and calls publish(), the reader calls update() and then looks at
+// readBuffer(). Neither side ever waits for the other: the writer can publish as often as it likes
+// and the reader simply skips values it was too slow to see.
+template<typename T>
+class TripleBuffer {
+private:
+    static const uint8_t FRESH_BIT = 0x4;
+    static const uint8_t INDEX_MASK = 0x3;
+
+    T mBuffers[3];
+    // index of the buffer in the middle, plus FRESH_BIT if the writer published it since the reader last looked
+    std::atomic<uint8_t> mMiddle;
+    uint8_t mBack;  // only touched by the writer
+    uint8_t mFront; // only touched by the reader
+
+public:
+    TripleBuffer() : mMiddle(2), mBack(1), mFront(0) {}
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // writer side
+    T &writeBuffer() { return mBuffers[mBack]; }
+
+    void publish() {
+        mBack = mMiddle.exchange(mBack | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // reader side, returns true if a newer value than the one in readBuffer() was picked up
+    bool update() {
+        if ((mMiddle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+            return false;
+        }
+        mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    T &readBuffer() { return mBuffers[mFront]; }
+
+    const T &readBuffer() const { return mBuffers[mFront]; }
+};
@@ -0,0 +1,133 @@
+#include "UdpSocket.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    sockaddr_in toSockAddr(const UdpAddress &address) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(address.nHost);
+        addr.sin_port = htons(address.nPort);
+        return addr;
+    }
+}
+
+bool UdpAddress::parse(const std::string &text, UdpAddress &address) {
+    size_t nColon = text.rfind(':');
+    if (nColon == std::string::npos || nColon + 1 >= text.size()) {
+        std::cout << "Expected host:port, got " << text << std::endl;
+        return false;
+    }
+    std::string host = text.substr(0, nColon);
+    int nPort = atoi(text.c_str() + nColon + 1);
+    if (nPort <= 0 || nPort > 65535) {
+        std::cout << "Invalid port in " << text << std::endl;
+        return false;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *result = nullptr;
+    int nError = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+    if (nError != 0 || result == nullptr) {
+        std::cout << "Unable to resolve " << host << ": " << gai_strerror(nError) << std::endl;
+        return false;
+    }
+    address.nHost = ntohl(reinterpret_cast<sockaddr_in *>(result->ai_addr)->sin_addr.s_addr);
+    address.nPort = static_cast<uint16_t>(nPort);
+    freeaddrinfo(result);
+    return true;
+}
+
+std::string UdpAddress::toString() const {
+    return std::to_string(nHost >> 24) + "." + std::to_string((nHost >> 16) & 0xFF) + "." +
+           std::to_string((nHost >> 8) & 0xFF) + "." + std::to_string(nHost & 0xFF) + ":" + std::to_string(nPort);
+}
+
+UdpSocket::~UdpSocket() {
+    close();
+}
+
+bool UdpSocket::open(uint16_t nPort) {
+    close();
+    mSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (mSocket < 0) {
+        std::cout << "Unable to create a UDP socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(nPort);
+    if (bind(mSocket, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        std::cout << "Unable to bind UDP port " << nPort << ": " << strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    int nFlags = fcntl(mSocket, F_GETFL, 0);
+    if (nFlags < 0 || fcntl(mSocket, F_SETFL, nFlags | O_NONBLOCK) != 0) {
+        std::cout << "Unable to make the UDP socket non-blocking: " << strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UdpSocket::close() {
+    if (mSocket >= 0) {
+        ::close(mSocket);
+        mSocket = -1;
+    }
+}
+
+bool UdpSocket::isOpen() const {
+    return mSocket >= 0;
+}
+
+bool UdpSocket::sendTo(const UdpAddress &address, const void *data, size_t nBytes) {
+    if (mSocket < 0) return false;
+    sockaddr_in addr = toSockAddr(address);
+    ssize_t nSent = sendto(mSocket, data, nBytes, 0, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    if (nSent < 0) {
+        // a full send buffer or a peer that isn't there yet, it is UDP, the datagram is simply lost
+        return false;
+    }
+    mBytesSent += nBytes + HEADER_BYTES;
+    mDatagramsSent++;
+    return true;
+}
+
+int UdpSocket::receive(void *buffer, size_t nCapacity, UdpAddress &from) {
+    if (mSocket < 0) return -1;
+    sockaddr_in addr{};
+    socklen_t nAddrLen = sizeof(addr);
+    ssize_t nReceived = recvfrom(mSocket, buffer, nCapacity, 0, reinterpret_cast<sockaddr *>(&addr), &nAddrLen);
+    if (nReceived < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED) return 0;
+        return -1;
+    }
+    from.nHost = ntohl(addr.sin_addr.s_addr);
+    from.nPort = ntohs(addr.sin_port);
+    mBytesReceived += nReceived + HEADER_BYTES;
+    return static_cast<int>(nReceived);
+}
+
+uint64_t UdpSocket::getBytesSent() const {
+    return mBytesSent;
+}
+
+uint64_t UdpSocket::getBytesReceived() const {
+    return mBytesReceived;
+}
+
+uint64_t UdpSocket::getDatagramsSent() const {
+    return mDatagramsSent;
+}
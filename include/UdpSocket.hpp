@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// An IPv4 address and port, in host byte order
+struct UdpAddress {
+    uint32_t nHost = 0;
+    uint16_t nPort = 0;
+
+    // "host:port", the host may be a name, it is resolved once here
+    static bool parse(const std::string &text, UdpAddress &address);
+
+    std::string toString() const;
+
+    bool operator==(const UdpAddress &other) const { return nHost == other.nHost && nPort == other.nPort; }
+};
+
+// A non-blocking UDP socket. Nothing is ever retried or ordered, whoever uses it has to cope with
+// datagrams that get lost, duplicated or arrive out of order.
+class UdpSocket {
+private:
+    int mSocket = -1;
+    uint64_t mBytesSent = 0;
+    uint64_t mBytesReceived = 0;
+    uint64_t mDatagramsSent = 0;
+
+public:
+    // what IPv4 and UDP add to every datagram on the wire
+    static const size_t HEADER_BYTES = 28;
+
+    UdpSocket() = default;
+
+    UdpSocket(const UdpSocket &) = delete;
+
+    UdpSocket &operator=(const UdpSocket &) = delete;
+
+    ~UdpSocket();
+
+    // Binds to nPort on every interface
+    bool open(uint16_t nPort);
+
+    void close();
+
+    bool isOpen() const;
+
+    bool sendTo(const UdpAddress &address, const void *data, size_t nBytes);
+
+    // Size of the datagram that was waiting, 0 if there was none and -1 on errors. Datagrams longer than
+    // nCapacity are cut off.
+    int receive(void *buffer, size_t nCapacity, UdpAddress &from);
+
+    // Payload plus HEADER_BYTES for every datagram
+    uint64_t getBytesSent() const;
+
+    uint64_t getBytesReceived() const;
+
+    uint64_t getDatagramsSent() const;
+};
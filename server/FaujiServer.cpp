@@ -0,0 +1,72 @@
+#include "MatchServer.hpp"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Dedicated headless server: plays many independent matches at once (see cMatchServer) and reports how
+// many it gets through and how long their ticks take.
+
+int main(int argc, char *argv[]) {
+    int nMatches = 64;
+    int nWorkers = 0;
+    int nMatchesPerWorker = 4;
+    uint64_t nSeed = 1;
+    MatchSetup setup;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--matches" && i + 1 < argc) {
+            nMatches = std::stoi(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            nWorkers = std::stoi(argv[++i]);
+        } else if (arg == "--per-worker" && i + 1 < argc) {
+            nMatchesPerWorker = std::stoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            nSeed = std::stoull(argv[++i]);
+        } else if (arg == "--teams" && i + 1 < argc) {
+            setup.nTeams = std::stoi(argv[++i]);
+        } else if (arg == "--team-size" && i + 1 < argc) {
+            setup.nTeamSize = std::stoi(argv[++i]);
+        } else if (arg == "--max-ticks" && i + 1 < argc) {
+            setup.nMaxTicks = std::stoi(argv[++i]);
+        } else {
+            std::cout << "usage: fauji-server [--matches n] [--workers n] [--per-worker n] [--seed n]\n"
+                         "                    [--teams n] [--team-size n] [--max-ticks n]" << std::endl;
+            return 1;
+        }
+    }
+    if (nMatches < 1 || nMatchesPerWorker < 1) {
+        std::cout << "A server plays at least one match, at least one at a time" << std::endl;
+        return 1;
+    }
+    // match m plays the server seed plus m
+    std::vector<MatchSetup> vecSetups(nMatches, setup);
+    for (int m = 0; m < nMatches; m++) {
+        vecSetups[m].nSeed = nSeed + m;
+    }
+    cMatchServer server(nWorkers, nMatchesPerWorker);
+    if (!server.run(vecSetups)) {
+        return 1;
+    }
+
+    // the final states of all matches in match order, the same for any number of workers
+    cStateHasher hasher;
+    uint64_t nTicks = 0;
+    for (auto &result: server.getResults()) {
+        hasher.add(result.nFinalHash);
+        nTicks += result.nTicks;
+    }
+    double fSeconds = server.getWallSeconds();
+    float p50, p95, p99, fMax;
+    server.getTickLatency(p50, p95, p99, fMax);
+    printf("%d matches of %d teams of %d on %d workers, %d at a time each\n", nMatches, setup.nTeams,
+           setup.nTeamSize, server.getWorkerCount(), server.getMatchesPerWorker());
+    printf("%.2f s, %.2f matches/s, %.0f ticks/s (%llu ticks)\n", fSeconds, nMatches / fSeconds, nTicks / fSeconds,
+           static_cast<unsigned long long>(nTicks));
+    printf("tick latency us  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f\n", p50, p95, p99, fMax);
+    for (int w = 0; w < server.getWorkerCount(); w++) {
+        printf("worker %d: %d matches\n", w, server.getWorkerMatchCounts()[w]);
+    }
+    printf("final state hash %016llx\n", static_cast<unsigned long long>(hasher.get()));
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include "AIPlanner.hpp"
+#include "Trace.hpp"
+#include "Weapons.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace {
+    ShotParams makeShotParams(const AISnapshot &snapshot, float fStandX, float fStandY) {
+        // the AI only ever fires missiles
+        const WeaponInfo &missile = getWeaponInfo(WEAPON_MISSILE);
+        ShotParams params;
+        params.fMagFireVelocity = missile.fMagFireVelocity;
+        params.fMissileRadius = missile.fRadius;
+        params.fMissileFriction = missile.fFriction;
+        params.fBlastRadius = missile.fBlastRadius;
+        params.fOriginX = fStandX;
+        params.fOriginY = fStandY;
+        params.fStepTime = snapshot.fStepTime;
+        params.fGravity = snapshot.fGravity;
+        const AIUnit &target = snapshot.vecUnits[snapshot.nTarget];
+        const int nShooterTeam = snapshot.vecUnits[snapshot.nShooter].nTeam;
+        params.target = {target.px, target.py, target.fHealth};
+        for (int i = 0; i < static_cast<int>(snapshot.vecUnits.size()); i++) {
+            const AIUnit &u = snapshot.vecUnits[i];
+            if (i == snapshot.nTarget) continue;
+            if (i == snapshot.nShooter) {
+                // the shooter takes its own blast wherever it ends up standing
+                params.vecFriends.push_back({fStandX, fStandY, u.fHealth});
+            } else if (u.fHealth <= 0.0f) {
+                continue; // the dead take no more damage
+            } else if (u.nTeam == nShooterTeam) {
+                params.vecFriends.push_back({u.px, u.py, u.fHealth});
+            } else {
+                params.vecEnemies.push_back({u.px, u.py, u.fHealth});
+            }
+        }
+        auto byX = [](const ShotBody &a, const ShotBody &b) { return a.px < b.px; };
+        std::sort(params.vecEnemies.begin(), params.vecEnemies.end(), byX);
+        std::sort(params.vecFriends.begin(), params.vecFriends.end(), byX);
+        return params;
+    }
+
+    float wrapAngle(float fAngle) {
+        while (fAngle > PHYSICS_PI) fAngle -= 2.0f * PHYSICS_PI;
+        while (fAngle <= -PHYSICS_PI) fAngle += 2.0f * PHYSICS_PI;
+        return fAngle;
+    }
+}
+
+cAIPlanner::cAIPlanner() : solver(), nLatestRequest(-1), bQuit(false) {}
+
+cAIPlanner::~cAIPlanner() {
+    bQuit = true;
+    cvIdle.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void cAIPlanner::submit(std::shared_ptr<const AISnapshot> snapshot) {
+    nLatestRequest = snapshot->nRequestId;
+    if (bDeterministic) {
+        plan(*snapshot);
+        return;
+    }
+    requests.writeBuffer() = std::move(snapshot);
+    requests.publish();
+    if (!worker.joinable()) {
+        // started with the first request, a deterministic planner never needs it
+        worker = std::thread(&cAIPlanner::run, this);
+    }
+    cvIdle.notify_one();
+}
+
+bool cAIPlanner::poll(AIPlan &plan) {
+    if (!plans.update()) {
+        return false;
+    }
+    plan = plans.readBuffer();
+    return true;
+}
+
+void cAIPlanner::setDeterministic(bool bDeterministic) {
+    this->bDeterministic = bDeterministic;
+}
+
+void cAIPlanner::setShotBudget(int nShots) {
+    nShotBudget = std::max(0, nShots);
+}
+
+void cAIPlanner::setThreadCount(int nThreads) {
+    solver.setThreadCount(nThreads);
+}
+
+void cAIPlanner::publish(const AIPlan &plan, const AISnapshot &snapshot) {
+    plans.writeBuffer() = plan;
+    plans.writeBuffer().fMoveTargetX += snapshot.nMapOffsetX;
+    plans.publish();
+}
+
+bool cAIPlanner::shouldStop(const AISnapshot &snapshot) const {
+    if (bQuit || nLatestRequest != snapshot.nRequestId) return true;
+    return !bDeterministic && std::chrono::steady_clock::now() >= snapshot.deadline;
+}
+
+void cAIPlanner::run() {
+    TRACE_THREAD_NAME("ai planner");
+    while (!bQuit) {
+        if (requests.update()) {
+            std::shared_ptr<const AISnapshot> snapshot = requests.readBuffer();
+            if (snapshot != nullptr) {
+                plan(*snapshot);
+            }
+            continue;
+        }
+        // nothing to do, sleep until the next submit (the timeout covers a notify that raced with us)
+        std::unique_lock<std::mutex> lock(mtxIdle);
+        cvIdle.wait_for(lock, std::chrono::milliseconds(5));
+    }
+}
+
+void cAIPlanner::plan(const AISnapshot &snapshot) {
+    TRACE_SCOPE("plan ai turn");
+    TerrainView terrain = {snapshot.map.data(), snapshot.nMapWidth, snapshot.nMapHeight};
+    std::vector<int> vecColumnTop;
+    buildColumnTops(terrain, vecColumnTop);
+    terrain.pColumnTop = vecColumnTop.data();
+
+    const AIUnit &shooter = snapshot.vecUnits[snapshot.nShooter];
+    const AIUnit &target = snapshot.vecUnits[snapshot.nTarget];
+
+    // where the shooter could fire from, it stays put unless the snapshot allows walking
+    std::vector<float> vecPositions = {shooter.px};
+    if (snapshot.bAllowMove) {
+        const int nStepsEachWay = 4;
+        for (int k = 1; k <= nStepsEachWay; k++) {
+            for (float fSign: {-1.0f, 1.0f}) {
+                float x = shooter.px + fSign * k * snapshot.fMaxMoveDistance / nStepsEachWay;
+                x = std::max(20.0f, std::min(x, snapshot.nMapWidth - 20.0f));
+                vecPositions.push_back(x);
+            }
+        }
+    }
+    auto standingY = [&](float x) {
+        if (x == shooter.px) return shooter.py;
+        return vecColumnTop[static_cast<int>(x)] - snapshot.fManRadius - 1.0f;
+    };
+
+    AIPlan best;
+    best.nRequestId = snapshot.nRequestId;
+    best.fMoveTargetX = shooter.px;
+    int nShots = 0;
+    const bool bShotBudget = bDeterministic && nShotBudget > 0;
+    auto shotsLeft = [&]() { return bShotBudget ? nShotBudget - nShots : INT_MAX; };
+
+    auto evaluate = [&](float fStandX, const std::vector<ShotCandidate> &vecCandidates, int nMaxShots) {
+        auto budget = snapshot.deadline - std::chrono::steady_clock::now();
+        if (bDeterministic) {
+            // long enough for any candidate list, the solver must not drop candidates on time
+            budget = std::chrono::hours(1);
+        } else if (budget <= std::chrono::steady_clock::duration::zero()) {
+            return ShotResult();
+        }
+        ShotParams params = makeShotParams(snapshot, fStandX, standingY(fStandX));
+        ShotResult result = solver.solve(terrain, params, vecCandidates, budget, std::min(nMaxShots, shotsLeft()));
+        nShots += solver.getLastEvaluatedCount();
+        return result;
+    };
+    auto consider = [&](float fStandX, const ShotResult &result) {
+        if (!result.bExploded) return;
+        // walking is not free and standing next to an ally invites splash damage next turn
+        float fScore = result.fScore - std::fabs(fStandX - shooter.px) * 0.0005f;
+        for (int i = 0; i < static_cast<int>(snapshot.vecUnits.size()); i++) {
+            const AIUnit &u = snapshot.vecUnits[i];
+            if (i != snapshot.nShooter && u.nTeam == shooter.nTeam && u.fHealth > 0.0f &&
+                std::fabs(u.px - fStandX) < 50.0f) {
+                fScore -= 0.05f;
+                break;
+            }
+        }
+        if (fScore > best.fScore) {
+            best.fMoveTargetX = fStandX;
+            best.fAngle = result.shot.fAngle;
+            best.fEnergy = result.shot.fEnergy;
+            best.fScore = fScore;
+            best.fTargetDamage = result.fTargetDamage;
+            best.fFriendlyDamage = result.fFriendlyDamage;
+            best.bHasShot = true;
+            best.nShotsSimulated = nShots;
+            publish(best, snapshot);
+        }
+    };
+
+    // Coarse pass over every position, the first plan is out after a handful of milliseconds.
+    // With a shot budget every position gets an equal share of half of it, the rest is for refining.
+    const int nCoarseAngles = 16;
+    const int nCoarseEnergies = 8;
+    const int nCoarseShots = bShotBudget ? std::max(1, nShotBudget / (2 * static_cast<int>(vecPositions.size())))
+                                         : INT_MAX;
+    for (float x: vecPositions) {
+        if (shouldStop(snapshot) || shotsLeft() <= 0) break;
+        bool bFacingRight = target.px > x;
+        consider(x, evaluate(x, cShotSolver::makeCandidateGrid(bFacingRight, nCoarseAngles, nCoarseEnergies),
+                             nCoarseShots));
+    }
+
+    // Refine around the best shot with a shrinking local grid until time runs out
+    float fAngleStep = (PHYSICS_PI / 2.0f + PHYSICS_PI / 8.0f) / nCoarseAngles;
+    float fEnergyStep = 0.8f / nCoarseEnergies;
+    while (best.bHasShot && !shouldStop(snapshot) && shotsLeft() > 0 && fAngleStep > 0.002f) {
+        std::vector<ShotCandidate> vecCandidates;
+        for (int a = -2; a <= 2; a++) {
+            for (int e = -2; e <= 2; e++) {
+                float fEnergy = std::max(0.05f, std::min(best.fEnergy + e * fEnergyStep * 0.5f, 1.0f));
+                vecCandidates.push_back({wrapAngle(best.fAngle + a * fAngleStep * 0.5f), fEnergy});
+            }
+        }
+        float x = best.fMoveTargetX;
+        consider(x, evaluate(x, vecCandidates, INT_MAX));
+        fAngleStep *= 0.5f;
+        fEnergyStep *= 0.5f;
+    }
+
+    if (nLatestRequest == snapshot.nRequestId) {
+        best.bFinal = true;
+        best.nShotsSimulated = nShots;
+        publish(best, snapshot);
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "ShotSolver.hpp"
+#include "TripleBuffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AIUnit {
+    float px = 0.0f;
+    float py = 0.0f;
+    float fHealth = 0.0f;
+    int nTeam = 0;
+};
+
+// Everything the planner is allowed to look at. It is a copy taken on the game thread and
+// never changes afterwards, so the planner can read it without any locking.
+struct AISnapshot {
+    int nRequestId = 0;
+    // On a wide map only the part around the shooter, every x in here is relative to nMapOffsetX
+    std::vector<unsigned char> map;
+    int nMapWidth = 0;
+    int nMapHeight = 0;
+    int nMapOffsetX = 0; // world x of the first column of map, plans are published in world coordinates
+    std::vector<AIUnit> vecUnits;
+    int nShooter = 0; // index into vecUnits
+    int nTarget = 0;  // index into vecUnits
+    float fManRadius = 16.0f;
+    float fStepTime = 1.0f / 60.0f; // physics sub-step the shots are simulated with
+    float fGravity = PHYSICS_GRAVITY;
+    bool bAllowMove = true;         // false if the shooter is where it is going to fire from
+    float fMaxMoveDistance = 160.0f;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+struct AIPlan {
+    int nRequestId = -1;
+    float fMoveTargetX = 0.0f;
+    float fAngle = 0.0f;
+    float fEnergy = 0.0f;
+    float fScore = -INFINITY;
+    float fTargetDamage = 0.0f;
+    float fFriendlyDamage = 0.0f;
+    bool bHasShot = false; // false if no simulated shot exploded at all
+    bool bFinal = false;   // the search has finished, later plans for this request won't come
+    int nShotsSimulated = 0;
+};
+
+// Plans the AI's turn on a background thread.
+// The game thread posts immutable snapshots with submit() and picks up plans with poll(), both are
+// lock-free, so the frame never waits for the planner. The planner runs an anytime search: it publishes
+// a coarse plan within a few milliseconds and keeps refining it until the snapshot's deadline.
+class cAIPlanner {
+public:
+    cAIPlanner();
+
+    ~cAIPlanner();
+
+    cAIPlanner(const cAIPlanner &) = delete;
+    cAIPlanner &operator=(const cAIPlanner &) = delete;
+
+    // Replaces whatever the planner is working on with this snapshot
+    void submit(std::shared_ptr<const AISnapshot> snapshot);
+
+    // Returns true and fills plan if a newer plan was published since the last call
+    bool poll(AIPlan &plan);
+
+    // In deterministic mode submit() plans on the calling thread and ignores the deadline, the search
+    // always runs to the end. The plan then only depends on the snapshot, never on timing or on how busy
+    // the machine is, which is what seeded matches without a replay need. Set it before the first submit().
+    void setDeterministic(bool bDeterministic);
+
+    // In deterministic mode stop every plan after this many simulated shots instead of running the search to
+    // the end, 0 for no limit. A fixed shot count keeps the plans reproducible, unlike a deadline.
+    void setShotBudget(int nShots);
+
+    // threads the shot solver spreads candidates over, 0 uses every hardware thread
+    void setThreadCount(int nThreads);
+
+private:
+    void run();
+
+    void plan(const AISnapshot &snapshot);
+
+    // true if the search should stop, either the deadline passed or a newer snapshot arrived
+    bool shouldStop(const AISnapshot &snapshot) const;
+
+    void publish(const AIPlan &plan, const AISnapshot &snapshot);
+
+    cShotSolver solver;
+    TripleBuffer<std::shared_ptr<const AISnapshot>> requests;
+    TripleBuffer<AIPlan> plans;
+    std::atomic<int> nLatestRequest;
+    std::atomic<bool> bQuit;
+    bool bDeterministic = false;
+    int nShotBudget = 0;
+    // only used to let the worker sleep while there is nothing to do, the game thread never takes it
+    std::mutex mtxIdle;
+    std::condition_variable cvIdle;
+    std::thread worker; // started by the first submit that doesn't plan on the calling thread
+};
@@ -0,0 +1,1605 @@
+#include "Fauji.hpp"
+#include "Profiler.hpp"
+#include "SoundPool.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+    const int PHASE_STATE_MACHINE = Profiler::registerPhase("state machine");
+    const int PHASE_AI = Profiler::registerPhase("ai");
+    const int PHASE_PHYSICS = Profiler::registerPhase("physics");
+    const int PHASE_BOOM = Profiler::registerPhase("boom");
+    const int PHASE_SETTLE_TERRAIN = Profiler::registerPhase("settle terrain");
+    const int PHASE_DRAW_TERRAIN = Profiler::registerPhase("draw terrain");
+    const int PHASE_DRAW_HUD = Profiler::registerPhase("draw hud");
+    const int PHASE_DRAW_OBJECTS = Profiler::registerPhase("draw objects");
+
+    // by SOUND_EFFECT. Explosions take channels from the rest, and however many go off in a frame they are
+    // heard as a few voices at most.
+    struct SoundEffectInfo {
+        const char *id;
+        int nPriority;
+        int nMaxVoices;
+    };
+    const SoundEffectInfo SOUND_EFFECTS_INFO[] = {{"explosion.wav", 3, 4},
+                                                  {"fire.wav",      2, 2},
+                                                  {"footstep.wav",  1, 1}};
+}
+
+const char *Fauji::getAIStateName(AI_STATE nState) {
+    static const char *AI_STATE_NAMES[] = {"AI assess environment", "AI move", "AI choose target",
+                                           "AI position for target", "AI aim", "AI fire"};
+    return AI_STATE_NAMES[nState];
+}
+
+Fauji::~Fauji() {
+    getInput().unsubscribe(nInputHandle);
+    delete[] map;
+}
+
+void Fauji::setMapSize(int nWidth, int nHeight) {
+    nMapWidth = nWidth;
+    nMapHeight = nHeight;
+}
+
+void Fauji::setSeed(uint64_t nSeed) {
+    rng.setSeed(nSeed);
+}
+
+void Fauji::setAllTeamsAI(bool bAllTeamsAI) {
+    this->bAllTeamsAI = bAllTeamsAI;
+}
+
+bool Fauji::setTeams(int nTeams, int nMembersPerTeam) {
+    if (nTeams < 2 || nTeams > MAX_TEAMS || nMembersPerTeam < 1 || nMembersPerTeam > MAX_MEMBERS_PER_TEAM) {
+        std::cout << "A battle needs 2 to " << MAX_TEAMS << " teams of 1 to " << MAX_MEMBERS_PER_TEAM << " men"
+                  << std::endl;
+        return false;
+    }
+    this->nTeams = nTeams;
+    this->nMembersPerTeam = nMembersPerTeam;
+    return true;
+}
+
+void Fauji::setDeterministicAI(bool bDeterministic) {
+    bDeterministicAI = bDeterministic;
+    aiPlanner.setDeterministic(bDeterministic);
+}
+
+void Fauji::setAIThreadCount(int nThreads) {
+    aiPlanner.setThreadCount(nThreads);
+}
+
+void Fauji::setAIShotBudget(int nShots) {
+    aiPlanner.setShotBudget(nShots);
+}
+
+void Fauji::setMaxTicks(int nMaxTicks) {
+    this->nMaxTicks = nMaxTicks;
+}
+
+void Fauji::setTuning(const GameTuning &tuning) {
+    this->tuning = tuning;
+}
+
+const MatchStats &Fauji::getMatchStats() const {
+    return matchStats;
+}
+
+void Fauji::setStateLog(cStateLog *pStateLog) {
+    this->pStateLog = pStateLog;
+}
+
+void Fauji::setRollbackCheck(int nTicks) {
+    nRollbackCheckTicks = nTicks > 0 ? static_cast<uint32_t>(nTicks) : 0;
+}
+
+template<typename Game, typename Visitor>
+void Fauji::visitSimulationValues(Game &game, Visitor &&visit) {
+    visit(game.nTick);
+    visit(game.rng);
+    visit(game.nGameState);
+    visit(game.nNextState);
+    visit(game.nAIState);
+    visit(game.nAINextState);
+    visit(game.nTeams);
+    visit(game.nMembersPerTeam);
+    visit(game.nCurrentTeam);
+    visit(game.nSelectedWeapon);
+    visit(game.fCameraPosX);
+    visit(game.fCameraPosY);
+    visit(game.fCameraPosXTarget);
+    visit(game.fCameraPosYTarget);
+    visit(game.fEnergyLevel);
+    visit(game.fOldEnergyLevel);
+    visit(game.fTimeSinceEnergyLevelSet);
+    visit(game.bFireWeapon);
+    visit(game.bShowCountDown);
+    visit(game.bShowNukeAnimation);
+    visit(game.planePosX);
+    visit(game.fTurnTime);
+    visit(game.bGameIsStable);
+    visit(game.bPlayerHasControl);
+    visit(game.bComputerHasControl);
+    visit(game.bPlayerActionComplete);
+    visit(game.bAI_AimLeft);
+    visit(game.bAI_AimRight);
+    visit(game.bAI_Energise);
+    visit(game.bAI_Walk);
+    visit(game.bAI_Jump);
+    visit(game.bAI_Flipped);
+    visit(game.fAITargetAngle);
+    visit(game.fAITargetEnergy);
+    visit(game.fAISafePosition);
+    visit(game.fAITargetX);
+    visit(game.fAITargetY);
+    visit(game.aiPlan);
+    visit(game.pendingAIPlan);
+    visit(game.bAIPlanPending);
+    visit(game.nAIRequestId);
+    visit(game.bAIShotRequested);
+    visit(game.fPhysicsStepTime);
+    visit(game.matchStats);
+    visit(game.bShotHit);
+}
+
+void Fauji::saveState(SimulationState &state) {
+    // a plan published since the last tick is part of the state, the planner forgets it once it is taken
+    AIPlan plan;
+    if (aiPlanner.poll(plan)) {
+        pendingAIPlan = plan;
+        bAIPlanPending = true;
+    }
+    state.vecValues.clear();
+    visitSimulationValues(*this, [&state](const auto &value) {
+        static_assert(std::is_trivially_copyable<std::decay_t<decltype(value)>>::value, "copied bytewise");
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+        state.vecValues.insert(state.vecValues.end(), bytes, bytes + sizeof(value));
+    });
+    state.nTick = nTick;
+    state.nMapWidth = nMapWidth;
+    state.nMapHeight = nMapHeight;
+    terrainChunks.save(map, nMapWidth, nMapHeight, state.vecTerrain);
+    terrainSettler.save(state.vecSettlingChunks);
+
+    state.vecObjectKinds.clear();
+    state.vecMen.clear();
+    state.vecDebris.clear();
+    state.nObjectUnderControl = state.nCameraTrackingObject = state.nAITargetMan = -1;
+    std::vector<std::pair<const cMan *, int>> vecManIndices; // sorted by address, for the teams below
+    int nPosition = 0;
+    for (auto &p: listObjects) {
+        OBJECT_KIND nKind = p->getKind();
+        state.vecObjectKinds.push_back(nKind);
+        if (nKind == OBJECT_MAN) {
+            vecManIndices.emplace_back(static_cast<const cMan *>(p.get()), static_cast<int>(state.vecMen.size()));
+            state.vecMen.push_back(*static_cast<const cMan *>(p.get()));
+        } else if (nKind == OBJECT_DEBRIS) {
+            state.vecDebris.push_back(*static_cast<const cDebris *>(p.get()));
+        }
+        if (p.get() == pObjectUnderControl) state.nObjectUnderControl = nPosition;
+        if (p.get() == pCameraTrackingObject) state.nCameraTrackingObject = nPosition;
+        if (p.get() == pAITargetMan) state.nAITargetMan = nPosition;
+        nPosition++;
+    }
+    projectiles.save(state.projectiles);
+    if (projectiles.getSlot(pCameraTrackingObject) >= 0) {
+        state.nCameraTrackingObject = -2 - projectiles.getSlot(pCameraTrackingObject);
+    }
+
+    std::sort(vecManIndices.begin(), vecManIndices.end());
+    state.vecTeams.clear();
+    state.vecTeamMembers.clear();
+    for (auto &team: vecTeams) {
+        state.vecTeams.push_back({team.nCurrentMember, team.nAliveMembers,
+                                  static_cast<int>(state.vecTeamMembers.size()),
+                                  static_cast<int>(team.vecMembers.size())});
+        for (cMan *pMan: team.vecMembers) {
+            auto it = std::lower_bound(vecManIndices.begin(), vecManIndices.end(),
+                                       std::make_pair(static_cast<const cMan *>(pMan), -1));
+            state.vecTeamMembers.push_back(it->second);
+        }
+    }
+    state.turnOrder = turnOrder;
+    state.gameOverMessage = gameOverMessage;
+}
+
+void Fauji::restoreState(const SimulationState &state) {
+    // whatever the planner came up with after the save belongs to a future that didn't happen
+    AIPlan plan;
+    while (aiPlanner.poll(plan)) {}
+    size_t nPos = 0;
+    visitSimulationValues(*this, [&state, &nPos](auto &value) {
+        memcpy(&value, state.vecValues.data() + nPos, sizeof(value));
+        nPos += sizeof(value);
+    });
+
+    if (state.nMapWidth != nMapWidth || state.nMapHeight != nMapHeight) {
+        nMapWidth = state.nMapWidth;
+        nMapHeight = state.nMapHeight;
+        delete[] map;
+        map = new unsigned char[nMapHeight * nMapWidth];
+        markTerrainChanged(0, 0, nMapWidth, nMapHeight);
+    }
+    terrainChunks.restore(map, nMapWidth, nMapHeight, state.vecTerrain,
+                          [this](int x, int y, int w, int h) { markTerrainChanged(x, y, w, h); });
+    terrainSettler.restore(nMapWidth, nMapHeight, state.vecSettlingChunks);
+
+    // The teams first, the men point at theirs. There is room for them since they were reserved.
+    vecTeams.resize(state.vecTeams.size());
+
+    // objects of the same kind are overwritten where they are, so pointers to them mostly stay the same
+    pObjectUnderControl = pCameraTrackingObject = nullptr;
+    pAITargetMan = nullptr;
+    std::vector<cMan *> vecMen;
+    vecMen.reserve(state.vecMen.size());
+    size_t nMan = 0, nDebris = 0;
+    auto it = listObjects.begin();
+    for (int nPosition = 0; nPosition < static_cast<int>(state.vecObjectKinds.size()); nPosition++, ++it) {
+        OBJECT_KIND nKind = static_cast<OBJECT_KIND>(state.vecObjectKinds[nPosition]);
+        if (it == listObjects.end()) {
+            it = listObjects.emplace(it);
+        } else if ((*it)->getKind() != nKind) {
+            it->reset();
+        }
+        if (nKind == OBJECT_MAN) {
+            const cMan &saved = state.vecMen[nMan++];
+            if (*it) {
+                *static_cast<cMan *>(it->get()) = saved;
+            } else {
+                *it = std::make_unique<cMan>(saved);
+            }
+            cMan *pMan = static_cast<cMan *>(it->get());
+            if (pMan->pTeam != nullptr) pMan->pTeam = &vecTeams[pMan->nTeam];
+            vecMen.push_back(pMan);
+        } else {
+            const cDebris &saved = state.vecDebris[nDebris++];
+            if (*it) {
+                *static_cast<cDebris *>(it->get()) = saved;
+            } else {
+                *it = std::make_unique<cDebris>(saved);
+            }
+        }
+        if (nPosition == state.nObjectUnderControl) pObjectUnderControl = it->get();
+        if (nPosition == state.nCameraTrackingObject) pCameraTrackingObject = it->get();
+        if (nPosition == state.nAITargetMan) pAITargetMan = static_cast<cMan *>(it->get());
+    }
+    listObjects.erase(it, listObjects.end());
+    projectiles.restore(state.projectiles);
+    if (state.nCameraTrackingObject <= -2) {
+        pCameraTrackingObject = projectiles.getSlotObject(-2 - state.nCameraTrackingObject);
+    }
+
+    for (size_t t = 0; t < state.vecTeams.size(); t++) {
+        const SimulationState::Team &saved = state.vecTeams[t];
+        cTeam &team = vecTeams[t];
+        team.nCurrentMember = saved.nCurrentMember;
+        team.nAliveMembers = saved.nAliveMembers;
+        team.nTeamSize = saved.nMembers;
+        team.vecMembers.resize(saved.nMembers);
+        for (int m = 0; m < saved.nMembers; m++) {
+            team.vecMembers[m] = vecMen[state.vecTeamMembers[saved.nFirstMember + m]];
+        }
+    }
+    turnOrder = state.turnOrder;
+    gameOverMessage = state.gameOverMessage;
+}
+
+bool Fauji::pollAIPlan(AIPlan &plan) {
+    if (aiPlanner.poll(plan)) {
+        bAIPlanPending = false;
+        return true;
+    }
+    if (bAIPlanPending) {
+        plan = pendingAIPlan;
+        bAIPlanPending = false;
+        return true;
+    }
+    return false;
+}
+
+void Fauji::setLockstep(cLockstep *pLockstep) {
+    this->pLockstep = pLockstep;
+}
+
+void Fauji::setSpectatorWriter(cSpectatorWriter *pWriter) {
+    pSpectatorWriter = pWriter;
+}
+
+void Fauji::setSpectatorPlayback(cSpectatorReader *pReader) {
+    pSpectatorReader = pReader;
+}
+
+uint32_t Fauji::getTick() const {
+    return nTick;
+}
+
+bool Fauji::isPlayersTeam(int nTeam) const {
+    if (bAllTeamsAI) return false;
+    return pLockstep != nullptr ? nTeam < pLockstep->getPlayerCount() : nTeam == 0;
+}
+
+bool Fauji::isMatchOver() const {
+    return bGameIsStable &&
+           (nGameState == GS_GAME_OVER2 || (nGameState == GS_GAME_OVER && isPlayersTeam(nCurrentTeam)));
+}
+
+void Fauji::captureTickState(TickRecord &record) const {
+    record.nTick = nTick;
+    record.hashMap(map, nMapWidth, nMapHeight);
+    record.nGameState = nGameState;
+    record.nAIState = nAIState;
+    record.nCurrentTeam = nCurrentTeam;
+    record.fTurnTime = fTurnTime;
+    record.nRngState = rng.getState();
+    record.vecTeamHealth.clear();
+    for (auto &team: vecTeams) {
+        float fHealth = 0.0f;
+        for (auto m: team.vecMembers) fHealth += m->fHealth;
+        record.vecTeamHealth.push_back(fHealth);
+    }
+    record.vecObjects.clear();
+    auto addObject = [&](const cPhysicsObject &p, uint8_t nType, float fHealth) {
+        ObjectState object;
+        object.nType = nType;
+        object.fHealth = fHealth;
+        object.bStable = p.bStable;
+        object.bDead = p.bDead;
+        object.nBounceBeforeDeath = p.nBounceBeforeDeath;
+        object.px = p.px;
+        object.py = p.py;
+        object.vx = p.vx;
+        object.vy = p.vy;
+        record.vecObjects.push_back(object);
+    };
+    for (auto &p: listObjects) {
+        if (auto pMan = dynamic_cast<const cMan *>(p.get())) {
+            addObject(*p, OBJ_MAN, pMan->fHealth);
+        } else if (dynamic_cast<const cDebris *>(p.get())) {
+            addObject(*p, OBJ_DEBRIS, 0.0f);
+        } else {
+            addObject(*p, OBJ_UNKNOWN, 0.0f);
+        }
+    }
+    for (size_t i = 0; i < projectiles.size(); i++) {
+        addObject(projectiles[i], OBJ_MISSILE, 0.0f);
+    }
+    record.finish();
+}
+
+void Fauji::walkManRight(cMan *pMan) {
+    pMan->vx = tuning.fWalkSpeed;
+    pMan->vy = -5.0f;
+    pMan->flipType = SDL_FLIP_HORIZONTAL;
+    pMan->fShootingAngle = PI / 2;
+    pMan->bStable = false;
+    playSound(SOUND_FOOTSTEP, pMan->px, 0.5f);
+}
+
+void Fauji::walkManLeft(cMan *pMan) {
+    pMan->vx = -tuning.fWalkSpeed;
+    pMan->vy = -5.0f;
+    pMan->flipType = SDL_FLIP_NONE;
+    pMan->fShootingAngle = PI / 2;
+    pMan->bStable = false;
+    playSound(SOUND_FOOTSTEP, pMan->px, 0.5f);
+}
+
+void Fauji::manJump(cMan *pMan) {
+    pMan->vx = 3.0f * (pMan->flipType == SDL_FLIP_NONE ? -1.0f : 1.0f);
+    pMan->vy = -tuning.fJumpSpeed;
+}
+
+void Fauji::aimLeft(cMan *pMan, float secPerFrame) {
+    pMan->fShootingAngle -= 1.0f * secPerFrame;
+    if (pMan->flipType != SDL_FLIP_NONE) {
+        if (pMan->fShootingAngle < -PI / 2) {
+            pMan->fShootingAngle = PI / 2;
+        }
+    } else {
+        if (pMan->fShootingAngle < -PI) {
+            pMan->fShootingAngle = PI;
+        } else if (pMan->fShootingAngle > 0 && pMan->fShootingAngle < PI / 2) {
+            pMan->fShootingAngle = -PI / 2;
+        }
+    }
+}
+
+void Fauji::aimRight(cMan *pMan, float secPerFrame) {
+    pMan->fShootingAngle += 1.0f * secPerFrame;
+    if (pMan->flipType != SDL_FLIP_NONE) {
+        if (pMan->fShootingAngle > PI / 2) {
+            pMan->fShootingAngle = -PI / 2;
+        }
+    } else {
+        if (pMan->fShootingAngle > PI) {
+            pMan->fShootingAngle = -PI;
+        } else if (pMan->fShootingAngle > -PI / 2 && pMan->fShootingAngle < 0) {
+            pMan->fShootingAngle = PI / 2;
+        }
+    }
+}
+
+void Fauji::energize(float secPerFrame) {
+    fEnergyLevel += tuning.fEnergyRate * secPerFrame;
+    if (fEnergyLevel > 1.0f) {
+        fEnergyLevel = 1.0f;
+    }
+}
+
+void Fauji::onUserInputEvent(const InputEvent &event, float secPerFrame) {
+    if (!bPlayerHasControl || pLockstep != nullptr) {
+        // a network match samples the keys in onSimulationTick, the tick they are played in comes later
+        return;
+    }
+    if (event.eventType == SDL_KEYDOWN && !event.bRepeat) {
+        if (event.buttonCode == SDLK_TAB) {
+            nSelectedWeapon = getNextSelectableWeapon(nSelectedWeapon);
+        }
+        if (pObjectUnderControl != nullptr) {
+            if (pObjectUnderControl->bStable) {
+                cMan *pMan = dynamic_cast<cMan *>(pObjectUnderControl);
+                if (event.buttonCode == SDLK_UP) {
+                    manJump(pMan);
+                }
+            }
+        }
+    }
+}
+
+void Fauji::applyHeldKeys(float fElapsedTime) {
+    applyPlayerInput(sampleLocalInput() & ~(INPUT_JUMP | INPUT_NEXT_WEAPON), fElapsedTime);
+}
+
+uint8_t Fauji::sampleLocalInput() const {
+    uint8_t nInput = 0;
+    if (getInput().isKeyHeld(SDL_SCANCODE_LEFT)) nInput |= INPUT_WALK_LEFT;
+    if (getInput().isKeyHeld(SDL_SCANCODE_RIGHT)) nInput |= INPUT_WALK_RIGHT;
+    if (getInput().wasKeyPressed(SDL_SCANCODE_UP)) nInput |= INPUT_JUMP;
+    if (getInput().isKeyHeld(SDL_SCANCODE_A)) nInput |= INPUT_AIM_LEFT;
+    if (getInput().isKeyHeld(SDL_SCANCODE_S)) nInput |= INPUT_AIM_RIGHT;
+    if (getInput().isKeyHeld(SDL_SCANCODE_SPACE)) nInput |= INPUT_ENERGISE;
+    if (getInput().wasKeyPressed(SDL_SCANCODE_TAB)) nInput |= INPUT_NEXT_WEAPON;
+    return nInput;
+}
+
+void Fauji::applyPlayerInput(uint8_t nInput, float fElapsedTime) {
+    if (!bPlayerHasControl || pObjectUnderControl == nullptr) {
+        return;
+    }
+    if (nInput & INPUT_NEXT_WEAPON) {
+        nSelectedWeapon = getNextSelectableWeapon(nSelectedWeapon);
+    }
+    if (!pObjectUnderControl->bStable) {
+        return;
+    }
+    cMan *pMan = dynamic_cast<cMan *>(pObjectUnderControl);
+    if (nInput & INPUT_JUMP) {
+        manJump(pMan);
+    }
+    if (nInput & INPUT_WALK_RIGHT) {
+        walkManRight(pMan);
+    } else if (nInput & INPUT_WALK_LEFT) {
+        walkManLeft(pMan);
+    } else if (nInput & INPUT_AIM_LEFT) {
+        aimLeft(pMan, fElapsedTime);
+    } else if (nInput & INPUT_AIM_RIGHT) {
+        aimRight(pMan, fElapsedTime);
+    } else if (nInput & INPUT_ENERGISE) {
+        energize(fElapsedTime);
+    }
+}
+
+void Fauji::submitAIPlanRequest(cMan *origin, bool bAllowMove, float fPlanningTime) {
+    auto snapshot = std::make_shared<AISnapshot>();
+    snapshot->nRequestId = ++nAIRequestId;
+    // the plan for the last request was made for another spot or another man, nothing may act on it anymore
+    aiPlan = AIPlan();
+    if (isReplaying()) {
+        // the plans come out of the replay
+        return;
+    }
+    // a wide map is copied only around the shooter, nothing it fires reaches beyond that
+    int nLeft = 0;
+    int nWidth = nMapWidth;
+    if (nMapWidth > 2 * AI_VIEW_DISTANCE) {
+        nWidth = 2 * AI_VIEW_DISTANCE;
+        nLeft = std::max(0, std::min(static_cast<int>(origin->px) - AI_VIEW_DISTANCE, nMapWidth - nWidth));
+    }
+    snapshot->map.resize(nWidth * nMapHeight);
+    for (int y = 0; y < nMapHeight; y++) {
+        memcpy(snapshot->map.data() + y * nWidth, map + y * nMapWidth + nLeft, nWidth);
+    }
+    snapshot->nMapWidth = nWidth;
+    snapshot->nMapHeight = nMapHeight;
+    snapshot->nMapOffsetX = nLeft;
+    for (auto &team: vecTeams) {
+        for (auto m: team.vecMembers) {
+            if (m == origin) snapshot->nShooter = static_cast<int>(snapshot->vecUnits.size());
+            if (m == pAITargetMan) snapshot->nTarget = static_cast<int>(snapshot->vecUnits.size());
+            snapshot->vecUnits.push_back({m->px - nLeft, m->py, m->fHealth, m->nTeam});
+        }
+    }
+    snapshot->fManRadius = origin->radius;
+    snapshot->fStepTime = fPhysicsStepTime;
+    snapshot->fGravity = tuning.fGravity;
+    snapshot->bAllowMove = bAllowMove;
+    if (fPlanningTime < 0.05f) fPlanningTime = 0.05f;
+    snapshot->deadline = std::chrono::steady_clock::now() +
+                         std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<float>(fPlanningTime));
+    aiPlanner.submit(std::move(snapshot));
+}
+
+bool Fauji::onInit() {
+    // create map
+    map = new unsigned char[nMapHeight * nMapWidth];
+    // initialise it with 0
+    memset(map, 0, nMapWidth * nMapHeight * sizeof(unsigned char));
+    markTerrainChanged(0, 0, nMapWidth, nMapHeight);
+    //createMap();
+    auto onUserInputFn = [this](const InputEvent &event, float secPerFrame) {
+        onUserInputEvent(event, secPerFrame);
+    };
+    nInputHandle = getInput().subscribe(SDL_KEYDOWN, onUserInputFn);
+    nGameState = GS_RESET;
+    nNextState = GS_RESET;
+    nAIState = AI_ASSESS_ENVIRONMENT;
+    nAINextState = AI_ASSESS_ENVIRONMENT;
+    nTick = 0;
+    TRACE_BEGIN(getAIStateName(nAIState));
+    if (!isHeadless()) {
+        // the images are decoded in the background while the music loads
+        const std::vector<std::string> vecSprites = {"man.png", "tomb-removebg.png", "fighter-jet.png"};
+        for (auto &id: vecSprites) {
+            ResourceCache::preload(id, RESOURCE_IMAGE);
+        }
+        for (auto &effect: SOUND_EFFECTS_INFO) {
+            ResourceCache::preload(effect.id, RESOURCE_SOUND);
+        }
+        // music: Battle Of The Dragons by TommyMutiu from Pixabay
+        loadMusic("battle-of-the-dragons.mp3");
+        playMusic();
+        for (int i = 0; i < SOUND_EFFECTS; i++) {
+            const SoundEffectInfo &effect = SOUND_EFFECTS_INFO[i];
+            nSoundIds[i] = getSoundPool().addSound(ResourceCache::getSound(effect.id), effect.nPriority,
+                                                   effect.nMaxVoices);
+        }
+        spriteAtlas = std::make_shared<TextureAtlas>();
+        spriteAtlas->build(vecSprites);
+        cMan::findSprites(*spriteAtlas);
+        nPlaneRegion = spriteAtlas->find("fighter-jet.png");
+        getSpriteBatch().setAtlas(spriteAtlas);
+    }
+    return true;
+}
+
+bool Fauji::isTickReady() {
+    // a broken lockstep lets the tick run, onSimulationTick ends the match
+    return pLockstep == nullptr || pLockstep->isTickReady(nTick) || !pLockstep->isHealthy();
+}
+
+bool Fauji::onSimulationTick(float fElapsedTime) {
+    if (pSpectatorReader != nullptr) {
+        return playSpectatorTick();
+    }
+    if (pLockstep != nullptr && !pLockstep->isHealthy()) {
+        std::cout << pLockstep->getError() << std::endl;
+        return false;
+    }
+    auto stateMachineStart = std::chrono::steady_clock::now();
+    switch (nGameState) {
+        case GS_RESET: {
+            setupBattle();
+            nNextState = GS_GENERATE_TERRAIN;
+            bPlayerHasControl = false;
+        }
+            break;
+        case GS_GENERATE_TERRAIN: {
+            createMap();
+            nNextState = GS_GENERATING_TERRAIN;
+            bPlayerHasControl = false;
+        }
+            break;
+        case GS_GENERATING_TERRAIN: {
+            nNextState = GS_ALLOCATE_UNITS;
+            bPlayerHasControl = false;
+        }
+            break;
+        case GS_ALLOCATE_UNITS: {
+            bPlayerHasControl = false;
+            float fSpacePerTeam = (float) nMapWidth / (float) nTeams;
+            float fSpacePerMember = (float) fSpacePerTeam / ((float) nMembersPerTeam * 2.0f);
+
+            // create teams, the men keep pointers to theirs so the vector must not grow afterwards
+            vecTeams.reserve(nTeams);
+            for (int t = 0; t < nTeams; t++) {
+                vecTeams.emplace_back(cTeam());
+                float fTeamMiddle = ((fSpacePerTeam) / 2.0f) + (t * fSpacePerTeam);
+                for (int w = 0; w < nMembersPerTeam; w++) {
+                    float fManX =
+                            fTeamMiddle - ((fSpacePerMember * (float) nMembersPerTeam) / 2) + w * fSpacePerMember;;
+                    float fManY = 0.0f;
+
+                    // add members to teams
+                    cMan *man = new cMan(fManX, fManY);
+                    man->nTeam = t;
+                    listObjects.push_back(std::unique_ptr<cMan>(man));
+                    vecTeams[t].addMember(man);
+                }
+            }
+            turnOrder.reset(nTeams);
+            // Select players first man for control and camera tracking
+            pObjectUnderControl = vecTeams[0].vecMembers[vecTeams[0].nCurrentMember];
+            pCameraTrackingObject = pObjectUnderControl;
+            bShowCountDown = false;
+            nNextState = GS_ALLOCATING_UNITS;
+        }
+            break;
+
+        case GS_ALLOCATING_UNITS: {
+            bPlayerHasControl = false;
+            if (bGameIsStable) {
+                nNextState = GS_START_PLAY;
+                bPlayerActionComplete = false;
+            }
+        }
+            break;
+        case GS_START_PLAY: {
+            bShowCountDown = true;
+            // clamp the players so that they don't walk off map
+            for (auto &t: vecTeams) {
+                for (auto m: t.vecMembers) {
+                    if (m->px < 5) m->px = 5;
+                    if (m->px > nMapWidth - 5) m->px = nMapWidth - 5;
+                }
+            }
+            // if any player has gone off screen, bring him back
+            if (bPlayerActionComplete || fTurnTime <= 0.0f) {
+                nNextState = GS_CAMERA_MODE;
+            }
+        }
+            break;
+        case GS_CAMERA_MODE: {
+            bPlayerHasControl = false;
+            bPlayerActionComplete = false;
+            bComputerHasControl = false;
+            bShowCountDown = false;
+            fEnergyLevel = 0;
+            if (bGameIsStable) {
+                // get next team
+                int nOldTeam = nCurrentTeam;
+                nCurrentTeam = turnOrder.next(nCurrentTeam, vecTeams);
+
+                // lock control if AI team is playing
+                if (isPlayersTeam(nCurrentTeam)) {
+                    bPlayerHasControl = true;
+                    bComputerHasControl = false;
+                } else {
+                    bPlayerHasControl = false;
+                    bComputerHasControl = true;
+                }
+                nNextState = GS_START_PLAY;
+                pObjectUnderControl = vecTeams[nCurrentTeam].getNextMember();
+                pCameraTrackingObject = pObjectUnderControl;
+                fTurnTime = tuning.fTurnTime;
+                matchStats.nTurns++;
+
+                // if it is the same team, current team won
+                if (nCurrentTeam == nOldTeam) {
+                    nNextState = GS_GAME_OVER;
+                }
+            }
+        }
+            break;
+        case GS_GAME_OVER: {
+            matchStats.nWinningTeam = nCurrentTeam;
+            bComputerHasControl = false;
+            bPlayerHasControl = false;
+            bShowCountDown = false;
+            if (pLockstep != nullptr && isPlayersTeam(nCurrentTeam) && nCurrentTeam != pLockstep->getLocalPlayer()) {
+                gameOverMessage = "Player " + std::to_string(nCurrentTeam + 1) + " won the battle";
+            } else if (isPlayersTeam(nCurrentTeam)) {
+                gameOverMessage = "Good job soldier, you saved us a nuke bomb!";
+            }
+            else {
+                gameOverMessage = "The battle is lost. Executing Plan B (nuke) ...";
+
+                nNextState = GS_NUKE;
+            }
+        }
+        break;
+        case GS_NUKE: {
+            bComputerHasControl = false;
+            bPlayerHasControl = false;
+            bShowCountDown = false;
+            bShowNukeAnimation = true;
+            for (int i = 0; i < 100; i ++)
+            {
+                int nBombX = rng.nextInt(nMapWidth);
+                int nBombY = rng.nextInt(nMapHeight / 2);
+                projectiles.spawn(WEAPON_MISSILE, nBombX, nBombY, 0.0f, 0.5f);
+            }
+            vecTeams[nCurrentTeam].wipeOut();
+            nNextState = GS_GAME_OVER2;
+        }
+            break;
+        case GS_GAME_OVER2: {
+        }
+            break;
+    }
+    Profiler::addTime(PHASE_STATE_MACHINE, std::chrono::steady_clock::now() - stateMachineStart);
+
+    if (pLockstep != nullptr) {
+        // everybody plays what was pressed now nInputDelay ticks later, the keys of this tick were pressed
+        // by whoever owns the current team that long ago
+        pLockstep->setLocalInput(nTick + pLockstep->getInputDelay(), sampleLocalInput());
+        applyPlayerInput(pLockstep->getInput(nCurrentTeam, nTick), fElapsedTime);
+    } else {
+        applyHeldKeys(fElapsedTime);
+    }
+
+    if (bComputerHasControl) {
+        ProfileScope aiScope(PHASE_AI);
+        cMan *origin = nullptr;
+        // pick up whatever the planner has published since the last frame, never wait for it.
+        // The planner races the game, so when and what it delivers is part of the recording.
+        AIPlan plan;
+        if (isReplaying()) {
+            std::vector<uint8_t> vecData;
+            while (takeReplayGameData(vecData)) {
+                if (vecData.size() == sizeof(AIPlan)) {
+                    memcpy(&plan, vecData.data(), sizeof(AIPlan));
+                    aiPlan = plan;
+                }
+            }
+        } else if (pollAIPlan(plan) && plan.nRequestId == nAIRequestId) {
+            aiPlan = plan;
+            recordGameData(&plan, sizeof(plan));
+        }
+        switch (nAIState) {
+            case AI_ASSESS_ENVIRONMENT: {
+                // a new turn, forget the previous plan
+                origin = (cMan *) pObjectUnderControl;
+                aiPlan = AIPlan();
+                bAIShotRequested = false;
+                fAISafePosition = origin->px;
+                nAINextState = AI_CHOOSE_TARGET;
+            }
+                break;
+            case AI_CHOOSE_TARGET: {
+                bAI_Walk = false;
+                bAI_Jump = false;
+                origin = (cMan *) pObjectUnderControl;
+                nCurrentTeam = origin->nTeam;
+                int nTargetTeam = 0;
+                int i = 0;
+
+                for(i=0; i <= 5; i++){
+                    nTargetTeam = rng.nextInt(vecTeams.size());
+                    if(nTargetTeam != nCurrentTeam && vecTeams[nTargetTeam].isTeamStillAlive()){
+                        break;
+                    }
+                }
+                if(i > 5){
+                    nTargetTeam = turnOrder.next(nCurrentTeam, vecTeams);
+                    if(nTargetTeam == nCurrentTeam){
+                        nNextState = GS_GAME_OVER;
+                    }
+                }
+                // aim for the healthiest opponent
+                cMan *mostHealthy = vecTeams[nTargetTeam].vecMembers[0];
+                for (auto w: vecTeams[nTargetTeam].vecMembers) {
+                    if (w->fHealth > mostHealthy->fHealth) {
+                        mostHealthy = w;
+                    }
+                }
+                pAITargetMan = mostHealthy;
+                fAITargetX = pAITargetMan->px;
+                fAITargetY = pAITargetMan->py;
+                if (fAITargetX < origin->px) {
+                    bAI_Flipped = false;
+                } else {
+                    bAI_Flipped = true;
+                }
+                // hand the planning over to the background planner, it decides where to stand and
+                // how to shoot while we start walking with whatever it has come up with so far
+                submitAIPlanRequest(origin, true, fTurnTime - (tuning.fAIWalkUntil + 0.5f));
+                nAINextState = AI_MOVE;
+            }
+                break;
+
+            case AI_MOVE: {
+                origin = (cMan *) pObjectUnderControl;
+                if (aiPlan.bHasShot) {
+                    fAISafePosition = aiPlan.fMoveTargetX;
+                }
+                if (aiPlan.nRequestId != nAIRequestId && fTurnTime >= tuning.fAIWalkUntil) {
+                    // nothing from the planner yet, give it another frame
+                    nAINextState = AI_MOVE;
+                } else if (fTurnTime >= tuning.fAIWalkUntil && std::abs(fAISafePosition - origin->px) > 1.0f) {
+                    if (bGameIsStable) {
+                        // walk towards the target
+                        if (fAISafePosition < origin->px) {
+                            bAI_Flipped = false;
+                        } else {
+                            bAI_Flipped = true;
+                        }
+                        bAI_Walk = true;
+                        nAINextState = AI_MOVE;
+                    }
+                } else if (fTurnTime < tuning.fAIWalkUntil && fTurnTime >= tuning.fAIJumpUntil &&
+                           std::abs(fAISafePosition - origin->px) > 1.0f) {
+                    bAI_Walk = false;
+                    bAI_Jump = true;
+                }
+                else {
+                    bAI_Walk = false;
+                    bAI_Jump = false;
+                    nAINextState = AI_POSITION_FOR_TARGET;
+                }
+            }
+                break;
+
+            case AI_POSITION_FOR_TARGET: {
+                origin = (cMan *) pObjectUnderControl;
+                bAI_Walk = false;
+                bAI_Jump = false;
+                if (bGameIsStable) {
+                    if (!bAIShotRequested) {
+                        // we rarely end up exactly where the plan wanted us, so plan the shot from here
+                        bAI_Flipped = pAITargetMan->px >= origin->px;
+                        submitAIPlanRequest(origin, false, std::min(fTurnTime - tuning.fAIPlanUntil, 0.5f));
+                        bAIShotRequested = true;
+                    } else if (aiPlan.bFinal || fTurnTime <= tuning.fAIPlanUntil) {
+                        // past the deadline the best shot the planner found so far is taken, or the fallback
+                        if (aiPlan.bHasShot && aiPlan.fTargetDamage > 0.0f && aiPlan.fScore > 0.0f) {
+                            // target is in range
+                            fAITargetAngle = aiPlan.fAngle;
+                            fAITargetEnergy = aiPlan.fEnergy;
+                            nAINextState = AI_AIM;
+                        } else if (fTurnTime > tuning.fAIPlanUntil + 0.5f) {
+                            // walk towards the target, and plan again once we have landed
+                            if (pAITargetMan->px < origin->px) {
+                                bAI_Flipped = false;
+                            } else {
+                                bAI_Flipped = true;
+                            }
+                            bAI_Walk = true;
+                            bAIShotRequested = false;
+                            nAINextState = AI_POSITION_FOR_TARGET;
+                        } else if (fTurnTime > tuning.fAIPlanUntil - 0.5f) {
+                            // if still hasn't reached, maybe its stuck. Try jumping
+                            bAI_Jump = true;
+                            bAIShotRequested = false;
+                            nAINextState = AI_POSITION_FOR_TARGET;
+                        } else {
+                            // fire from wherever you are, getting as close as we can without hurting ourselves
+                            if (aiPlan.bHasShot && aiPlan.fFriendlyDamage <= 0.0f) {
+                                fAITargetAngle = aiPlan.fAngle;
+                                fAITargetEnergy = aiPlan.fEnergy;
+                            } else {
+                                fAITargetAngle = bAI_Flipped ? -(PI / 2.0f) + (PI / 4.0f) : -(PI / 2.0f) - (PI / 4.0f);
+                                fAITargetEnergy = tuning.fAIFallbackEnergy;
+                            }
+                            nAINextState = AI_AIM;
+                        }
+                    }
+                }
+            }
+                break;
+            case AI_AIM: {
+                origin = (cMan *)pObjectUnderControl;
+                bAI_Walk = false;
+                bAI_Jump = false;
+
+                if(origin->fShootingAngle < fAITargetAngle){
+                    bAI_AimRight = true;
+                } else {
+                    bAI_AimLeft = true;
+                }
+                if(std::abs(origin->fShootingAngle - fAITargetAngle) < 0.075f){
+                    bAI_AimLeft = false;
+                    bAI_AimRight = false;
+                    fEnergyLevel = 0.0f;
+                    nAINextState = AI_FIRE;
+                } else {
+                    nAINextState = AI_AIM;
+                }
+            }
+            break;
+            case AI_FIRE: {
+                origin = (cMan *)pObjectUnderControl;
+                bAI_Energise = true;
+                if(fEnergyLevel >= fAITargetEnergy){
+                    bAI_Energise = false;
+                    bComputerHasControl = false;
+                    nAINextState = AI_ASSESS_ENVIRONMENT;
+                }
+            }
+            break;
+        }
+        if (origin != nullptr && origin->bStable) {
+            origin->flipType = bAI_Flipped ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
+            if (bAI_Walk && bAI_Flipped) {
+                //TODO: if collision then jump otherwise walk
+                walkManRight(origin);
+            } else if (bAI_Walk && !bAI_Flipped) {
+                walkManLeft(origin);
+            } else if (bAI_Jump) {
+                manJump(origin);
+            } else if(bAI_AimLeft){
+                aimLeft(origin, fElapsedTime);
+            } else if(bAI_AimRight){
+                aimRight(origin, fElapsedTime);
+            } else if(bAI_Energise){
+                energize(fElapsedTime);
+            }
+        }
+
+    }
+
+    fTurnTime -= fElapsedTime;
+    updatePhysics(fElapsedTime);
+
+    if (pCameraTrackingObject != nullptr) {
+        fCameraPosXTarget = pCameraTrackingObject->px - mWindowWidth / 2;
+        // we interpolate the camera position slowly between current
+        // position and target position to give a smooth transition effect
+        fCameraPosX += (fCameraPosXTarget - fCameraPosX) * 5.0f * fElapsedTime;
+        // TODO: tracking y is causing bugs, fix it later
+//            fCameraPosY = pCameraTrackingObject->py - mWindowHeight/2;
+    }
+
+    if (fCameraPosX < 0) fCameraPosX = 0;
+    if (fCameraPosX >= nMapWidth - mWindowWidth) fCameraPosX = nMapWidth - mWindowWidth;
+    if (fCameraPosY < 0) fCameraPosY = 0;
+    if (fCameraPosY >= nMapHeight - mWindowHeight) fCameraPosY = nMapHeight - mWindowHeight;
+
+    if (pObjectUnderControl != nullptr) {
+        cMan *pMan = dynamic_cast<cMan *>(pObjectUnderControl);
+        // directions of shooting
+        float dx = std::cos(pMan->fShootingAngle);
+        float dy = std::sin(pMan->fShootingAngle);
+
+        // fire the weapon if the energy level is set to a specific value for 1 second
+        if (fEnergyLevel > 0.0f) {
+            if (fEnergyLevel != fOldEnergyLevel) {
+                fOldEnergyLevel = fEnergyLevel;
+                fTimeSinceEnergyLevelSet = 0;
+            } else {
+                fTimeSinceEnergyLevelSet += fElapsedTime;
+                if (fTimeSinceEnergyLevelSet > 1) {
+                    bFireWeapon = true;
+                }
+            }
+
+        } else {
+            fTimeSinceEnergyLevelSet = 0;
+        }
+
+        if (bFireWeapon) {
+            WEAPON nWeapon = isPlayersTeam(pMan->nTeam) ? nSelectedWeapon : WEAPON_MISSILE;
+            const float fMagFireVelocity = getWeaponInfo(nWeapon).fMagFireVelocity;
+            cMissile *missile = projectiles.spawn(nWeapon, pMan->px, pMan->py, fMagFireVelocity * fEnergyLevel * dx,
+                                                  fMagFireVelocity * fEnergyLevel * dy);
+            if (missile != nullptr) {
+                pCameraTrackingObject = missile;
+            }
+            playSound(SOUND_FIRE, pMan->px, 0.4f + 0.6f * fEnergyLevel);
+            bFireWeapon = false;
+            matchStats.nShots++;
+            bShotHit = false;
+            fEnergyLevel = 0.0f;
+            fTimeSinceEnergyLevelSet = 0;
+            bPlayerActionComplete = true;
+        }
+    }
+
+    if (bShowNukeAnimation) {
+        planePosX += 10;
+        if (planePosX > mWindowWidth - 10) {
+            bShowNukeAnimation = false;
+        }
+    }
+
+    // check for game stability, the next turn waits for the terrain to settle as well
+    bGameIsStable = terrainSettler.isIdle();
+    for (auto &p: listObjects) {
+        if (!p->bStable) {
+            bGameIsStable = false;
+            break;
+        }
+    }
+    for (size_t i = 0; bGameIsStable && i < projectiles.size(); i++) {
+        // a grenade lying still is still going to go off
+        bGameIsStable = projectiles[i].bStable && projectiles[i].fFuse <= 0.0f;
+    }
+//        if (bGameIsStable) {
+//            fillRect(4, 4, 10, 10, {0xFF, 0, 0});
+//        }
+#ifdef FAUJI_TRACE
+    if (nAINextState != nAIState) {
+        TRACE_END(getAIStateName(nAIState));
+        TRACE_BEGIN(getAIStateName(nAINextState));
+    }
+    int nMen = 0, nMissiles = static_cast<int>(projectiles.size()), nDebris = 0, nAwake = 0;
+    for (auto &p: listObjects) {
+        if (dynamic_cast<cMan *>(p.get())) nMen++;
+        else if (dynamic_cast<cDebris *>(p.get())) nDebris++;
+        if (!p->bStable) nAwake++;
+    }
+    for (size_t i = 0; i < projectiles.size(); i++) {
+        if (!projectiles[i].bStable) nAwake++;
+    }
+    TRACE_COUNTER("live cMan", nMen);
+    TRACE_COUNTER("live cMissile", nMissiles);
+    TRACE_COUNTER("live cDebris", nDebris);
+    TRACE_COUNTER("awake objects", nAwake);
+#endif
+    nGameState = nNextState;
+    nAIState = nAINextState;
+
+    nTick++;
+    // after everything else of the tick, where a spectator stream's viewer settles the craters of the tick as well
+    {
+        ProfileScope settleScope(PHASE_SETTLE_TERRAIN);
+        TRACE_SCOPE("settle terrain");
+        terrainSettler.tick(map, nTick, [this](int x, int y, int w, int h) { markTerrainChanged(x, y, w, h); });
+        TRACE_COUNTER("settling chunks", terrainSettler.getActiveChunkCount());
+    }
+    if (pStateLog != nullptr) {
+        pStateLog->vecTicks.emplace_back();
+        captureTickState(pStateLog->vecTicks.back());
+    }
+    if (pSpectatorWriter != nullptr) {
+        recordSpectatorTick();
+    }
+    if (nRollbackCheckTicks > 0) {
+        if (nTick % (2 * nRollbackCheckTicks) == 0) {
+            saveState(rollbackCheckState);
+            bRollbackCheckPending = true;
+        } else if (bRollbackCheckPending && nTick % (2 * nRollbackCheckTicks) == nRollbackCheckTicks) {
+            restoreState(rollbackCheckState);
+            bRollbackCheckPending = false;
+            if (pStateLog != nullptr) pStateLog->vecTicks.resize(nTick);
+        }
+    }
+    if (pLockstep != nullptr && pLockstep->wantsStateHash(nTick)) {
+        TickRecord record;
+        captureTickState(record);
+        pLockstep->addStateHash(nTick, record.nHash);
+    }
+    if (nMaxTicks > 0 && nTick >= static_cast<uint32_t>(nMaxTicks)) {
+        return false;
+    }
+    // nobody watches a headless match, stop as soon as it is decided
+    return !(isHeadless() && isMatchOver());
+}
+
+void Fauji::setupBattle() {
+    int32_t nAIFlags = (bAllTeamsAI ? AI_FLAG_ALL_TEAMS : 0) | (bDeterministicAI ? AI_FLAG_DETERMINISTIC : 0);
+    TeamSetup setup = {nTeams, nMembersPerTeam, nMapWidth, nAIFlags};
+    if (isReplaying()) {
+        // replays recorded before battles could be configured hold no setup, they were 2 on 2, and those
+        // recorded before the AI flags were kept had the player on team 0
+        std::vector<uint8_t> vecData;
+        setup = {2, 2, nMapWidth, 0};
+        while (takeReplayGameData(vecData)) {
+            if (vecData.size() == sizeof(TeamSetup) || vecData.size() == offsetof(TeamSetup, nAIFlags)) {
+                setup.nAIFlags = 0;
+                memcpy(&setup, vecData.data(), vecData.size());
+            }
+        }
+        if (!setTeams(setup.nTeams, setup.nMembersPerTeam)) {
+            setup = {2, 2, nMapWidth, setup.nAIFlags};
+            setTeams(2, 2);
+        }
+        // who played which team is the recording's to say, not the command line's
+        setAllTeamsAI((setup.nAIFlags & AI_FLAG_ALL_TEAMS) != 0);
+        setDeterministicAI((setup.nAIFlags & AI_FLAG_DETERMINISTIC) != 0);
+    } else {
+        setup.nMapWidth = std::max(nMapWidth, nTeams * nMembersPerTeam * MIN_UNIT_SPACING);
+        recordGameData(&setup, sizeof(setup));
+    }
+    if (setup.nMapWidth != nMapWidth) {
+        nMapWidth = setup.nMapWidth;
+        delete[] map;
+        map = new unsigned char[nMapHeight * nMapWidth];
+        memset(map, 0, nMapWidth * nMapHeight * sizeof(unsigned char));
+        markTerrainChanged(0, 0, nMapWidth, nMapHeight);
+    }
+}
+
+void Fauji::updatePhysics(float fElapsedTime) {
+    fPhysicsStepTime = fElapsedTime;
+    // with the column tops, whatever flies above the terrain isn't tested against it
+    const TerrainView terrain = {map, nMapWidth, nMapHeight, vecColumnTop.data()};
+    auto stepObject = [&](cPhysicsObject &obj) {
+        if (stepPhysicsBody(obj, terrain, fElapsedTime, tuning.fGravity)) {
+            int nResponse = obj.ObjDeadAction();
+            if (nResponse > 0) {
+                BOOM(obj.px, obj.py, nResponse);
+                pCameraTrackingObject = nullptr;
+            }
+        }
+    };
+    // do 10 physics iterations per frame, since drawing a frame is slower than updating physics
+    const int nSubSteps = 10;
+    for (int z = 0; z < nSubSteps; z++) {
+        ProfileScope physicsScope(PHASE_PHYSICS);
+        TRACE_SCOPE("physics step");
+
+        // update physics of physical objects
+        for (auto &obj: listObjects) {
+            stepObject(*obj);
+        }
+
+        // then the projectiles, which were fired after everything else. What they release is stepped
+        // right away, the debris of their explosions below.
+        auto itLast = listObjects.empty() ? listObjects.end() : std::prev(listObjects.end());
+        for (size_t i = 0; i < projectiles.size(); i++) {
+            cMissile &projectile = projectiles[i];
+            bool bGoesOff = stepPhysicsBody(projectile, terrain, fElapsedTime, tuning.fGravity);
+            if (!projectile.bDead && projectile.burnFuse(fElapsedTime / nSubSteps)) {
+                projectile.bDead = true;
+                bGoesOff = true;
+            }
+            if (bGoesOff) {
+                detonate(projectile);
+            }
+        }
+        for (auto it = itLast == listObjects.end() ? listObjects.begin() : std::next(itLast);
+             it != listObjects.end(); ++it) {
+            stepObject(**it);
+        }
+
+        // remove dead objects from list
+        // Note that this function just removes the object, doesn't deallocate memory.
+        // That's why we use unique_pointer, so that removing the pointer also frees the memory.
+        // make sure to pass references to unique pointer in argument, since its copy constructor
+        // is explicitly disabled (for obvious reasons).
+        listObjects.remove_if([](std::unique_ptr<cPhysicsObject> &o) { return o->bDead; });
+        projectiles.removeDead();
+    }
+}
+
+void Fauji::detonate(cMissile &projectile) {
+    const WeaponInfo &weapon = getWeaponInfo(projectile.nWeapon);
+    if (pCameraTrackingObject == &projectile) {
+        pCameraTrackingObject = nullptr;
+    }
+    int nResponse = projectile.ObjDeadAction();
+    if (nResponse > 0) {
+        BOOM(projectile.px, projectile.py, nResponse);
+        pCameraTrackingObject = nullptr;
+    }
+    for (int i = 0; i < weapon.nReleaseCount; i++) {
+        float fFraction = (i + 0.5f) / weapon.nReleaseCount;
+        if (weapon.fReleaseSpread > 0.0f) {
+            // an airstrike, missiles drop from the top of the map over the impact like the nuke's
+            float x = projectile.px + weapon.fReleaseSpread * (fFraction - 0.5f);
+            x = std::max(0.0f, std::min(x, nMapWidth - 1.0f));
+            projectiles.spawn(weapon.nReleases, x, 0.0f, 0.0f, 0.5f);
+        } else {
+            // bomblets burst upwards in a fan
+            float fAngle = -PI * fFraction;
+            projectiles.spawn(weapon.nReleases, projectile.px, projectile.py, weapon.fReleaseSpeed * std::cos(fAngle),
+                              weapon.fReleaseSpeed * std::sin(fAngle));
+        }
+    }
+}
+
+void Fauji::markTerrainChanged(int x, int y, int w, int h) {
+    if (vecTerrainChanges.size() == TERRAIN_CHANGE_HISTORY) {
+        // snapshots that old get a full copy
+        vecTerrainChanges.erase(vecTerrainChanges.begin(), vecTerrainChanges.begin() + TERRAIN_CHANGE_HISTORY / 2);
+    }
+    vecTerrainChanges.push_back({x, y, w, h});
+    nTerrainVersion++;
+    terrainChunks.markChanged(x, y, w, h);
+    updateColumnTops(x, y, w, h);
+}
+
+void Fauji::updateColumnTops(int x, int y, int w, int h) {
+    if (static_cast<int>(vecColumnTop.size()) != nMapWidth) {
+        vecColumnTop.assign(nMapWidth, 0);
+        x = 0;
+        y = 0;
+        w = nMapWidth;
+    }
+    int x0 = std::max(x, 0);
+    int x1 = std::min(x + w, nMapWidth);
+    int y0 = std::max(y, 0);
+    for (int column = x0; column < x1; column++) {
+        int &nTop = vecColumnTop[column];
+        // land above the change is where it was
+        if (nTop < y0) continue;
+        nTop = y0;
+        while (nTop < nMapHeight && map[nTop * nMapWidth + column] == 0) nTop++;
+    }
+}
+
+void Fauji::copyTerrain(RenderSnapshot &s) const {
+    uint32_t nMissing = nTerrainVersion - s.nTerrainVersion;
+    if (s.nMapWidth != nMapWidth || s.nMapHeight != nMapHeight || nMissing > vecTerrainChanges.size()) {
+        s.nMapWidth = nMapWidth;
+        s.nMapHeight = nMapHeight;
+        s.vecMap.assign(map, map + nMapWidth * nMapHeight);
+    } else {
+        for (size_t i = vecTerrainChanges.size() - nMissing; i < vecTerrainChanges.size(); i++) {
+            const TerrainRect &rect = vecTerrainChanges[i];
+            int x0 = std::max(rect.x, 0);
+            int x1 = std::min(rect.x + rect.w, nMapWidth);
+            int y0 = std::max(rect.y, 0);
+            int y1 = std::min(rect.y + rect.h, nMapHeight);
+            for (int y = y0; y < y1 && x0 < x1; y++) {
+                memcpy(s.vecMap.data() + y * nMapWidth + x0, map + y * nMapWidth + x0, x1 - x0);
+            }
+        }
+    }
+    s.nTerrainVersion = nTerrainVersion;
+}
+
+void Fauji::takeSnapshot(RenderSnapshot &s) const {
+    s.nTick = nTick;
+    s.fCameraPosX = fCameraPosX;
+    s.fCameraPosY = fCameraPosY;
+    s.vecObjects.resize(listObjects.size() + projectiles.size());
+    size_t nObject = 0;
+    for (auto &p: listObjects) {
+        p->takeSnapshot(s.vecObjects[nObject++]);
+    }
+    for (size_t i = 0; i < projectiles.size(); i++) {
+        projectiles[i].takeSnapshot(s.vecObjects[nObject++]);
+    }
+
+    cMan *pMan = dynamic_cast<cMan *>(pObjectUnderControl);
+    s.bHasControlledMan = pMan != nullptr;
+    if (pMan != nullptr) {
+        s.fManX = pMan->px;
+        s.fManY = pMan->py;
+        s.fShootingAngle = pMan->fShootingAngle;
+    }
+    s.fEnergyLevel = fEnergyLevel;
+    s.bShowCountDown = bShowCountDown;
+    s.fTurnTime = fTurnTime;
+    s.gameOverMessage = gameOverMessage;
+    s.bShowNukeAnimation = bShowNukeAnimation;
+    s.planePosX = planePosX;
+    s.bShowWeapon = bPlayerHasControl;
+    s.nSelectedWeapon = nSelectedWeapon;
+}
+
+void Fauji::recordSpectatorTick() {
+    // a viewer starting over from the map has nothing settling, it has to be taken when nothing is
+    if (pSpectatorWriter->wantsTerrainMap(nTick) && terrainSettler.isIdle()) {
+        pSpectatorWriter->setTerrainMap(map, nMapWidth, nMapHeight);
+    }
+    takeSnapshot(spectatorSnapshot);
+    // an object keeps its address for as long as it lives
+    vecSpectatorKeys.clear();
+    for (auto &p: listObjects) {
+        vecSpectatorKeys.push_back(reinterpret_cast<uintptr_t>(p.get()));
+    }
+    for (size_t i = 0; i < projectiles.size(); i++) {
+        vecSpectatorKeys.push_back(reinterpret_cast<uintptr_t>(&projectiles[i]));
+    }
+    if (!pSpectatorWriter->writeTick(spectatorSnapshot, vecSpectatorKeys, mWindowWidth, mWindowHeight)) {
+        std::cout << "Unable to write the spectator stream, it ends at tick " << nTick << std::endl;
+        pSpectatorWriter = nullptr;
+    }
+}
+
+bool Fauji::playSpectatorTick() {
+    const uint32_t SEEK_TICKS = 600; // ten seconds
+    const InputEventHandler &input = getInput();
+    uint32_t nTarget = pSpectatorReader->getTick();
+    if (input.wasKeyPressed(SDL_SCANCODE_SPACE)) {
+        bSpectatorPaused = !bSpectatorPaused;
+    }
+    if (input.wasKeyPressed(SDL_SCANCODE_LEFT)) {
+        nTarget = nTarget > SEEK_TICKS ? nTarget - SEEK_TICKS : 0;
+    } else if (input.wasKeyPressed(SDL_SCANCODE_RIGHT)) {
+        nTarget += SEEK_TICKS;
+    } else if (input.wasKeyPressed(SDL_SCANCODE_HOME)) {
+        nTarget = 0;
+    } else if (!bSpectatorPaused) {
+        nTarget++;
+    }
+    if (nTarget > pSpectatorReader->getLastTick()) {
+        // the end stays on screen, unless nobody is watching
+        if (isHeadless()) return false;
+        nTarget = pSpectatorReader->getLastTick();
+    }
+    if (!pSpectatorReader->seek(nTarget)) {
+        return false;
+    }
+    nTick = pSpectatorReader->getTick();
+    return true;
+}
+
+void Fauji::onPublishSnapshot() {
+    TRACE_SCOPE("publish snapshot");
+    RenderSnapshot &s = renderSnapshots.writeBuffer();
+    if (pSpectatorReader != nullptr) {
+        pSpectatorReader->fillSnapshot(s, mWindowWidth, mWindowHeight);
+    } else {
+        takeSnapshot(s);
+        copyTerrain(s);
+    }
+    renderSnapshots.publish();
+}
+
+void Fauji::drawLandscape(const RenderSnapshot &s) {
+    ProfileScope terrainScope(PHASE_DRAW_TERRAIN);
+    if (s.vecMap.empty()) {
+        return;
+    }
+    // the part of the map in view, a texel a pixel
+    int nCameraX = static_cast<int>(std::lround(s.fCameraPosX));
+    int nCameraY = static_cast<int>(std::lround(s.fCameraPosY));
+    int x0 = std::max(nCameraX, 0);
+    int y0 = std::max(nCameraY, 0);
+    int x1 = std::min(nCameraX + mWindowWidth, s.nMapWidth);
+    int y1 = std::min(nCameraY + mWindowHeight, s.nMapHeight);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    if (landscapeTexture.update(s.vecMap.data() + static_cast<size_t>(y0) * s.nMapWidth + x0, x1 - x0, y1 - y0,
+                                s.nMapWidth)) {
+        landscapeTexture.draw(x0 - nCameraX, y0 - nCameraY);
+    }
+}
+
+bool Fauji::isInView(const RenderSnapshot &s, float x, float y, float fExtent) const {
+    return x + fExtent >= s.fCameraPosX && x - fExtent < s.fCameraPosX + mWindowWidth &&
+           y + fExtent >= s.fCameraPosY && y - fExtent < s.fCameraPosY + mWindowHeight;
+}
+
+void Fauji::drawObject(const ObjectSnapshot &object, float fOffsetX, float fOffsetY) {
+    switch (object.nKind) {
+        case OBJECT_DEBRIS:
+            cDebris::draw(this, object, fOffsetX, fOffsetY);
+            break;
+        case OBJECT_MISSILE:
+            cMissile::draw(this, object, fOffsetX, fOffsetY);
+            break;
+        case OBJECT_MAN:
+            cMan::draw(this, object, fOffsetX, fOffsetY, nRenderFrame);
+            break;
+    }
+}
+
+bool Fauji::onFrameUpdate(float fElapsedTime) {
+    renderSnapshots.update();
+    const RenderSnapshot &s = renderSnapshots.readBuffer();
+    nRenderFrame++;
+    drawLandscape(s);
+
+    if (s.bHasControlledMan) {
+        ProfileScope hudScope(PHASE_DRAW_HUD);
+        // directions of shooting
+        float dx = std::cos(s.fShootingAngle);
+        float dy = std::sin(s.fShootingAngle);
+
+        const int aimLength = 30;
+        int cx = static_cast<int>(aimLength * dx + s.fManX - s.fCameraPosX);
+        int cy = static_cast<int>(aimLength * dy + s.fManY - s.fCameraPosY);
+        // draw missile aim
+        if (cx + 4 >= 0 && cx < mWindowWidth && cy + 4 >= 0 && cy < mWindowHeight) {
+            fillRect(cx, cy, 4, 4, {0xFF, 0, 0});
+        }
+
+        // draw timer
+        if (s.bShowCountDown) {
+            int nSeconds = static_cast<int>(s.fTurnTime);
+            if (nSeconds != nTimerTextureSeconds) {
+                char text[16];
+                snprintf(text, sizeof(text), "%d", nSeconds);
+                timerTexture.loadTextureFromText(text, {0, 0, 0});
+                nTimerTextureSeconds = nSeconds;
+            }
+            timerTexture.drawTexture(3, 6);
+        }
+        if(s.gameOverMessage.length() != 0){
+            if (s.gameOverMessage != gameOverTextureMessage) {
+                gameOverTexture.loadTextureFromText(s.gameOverMessage, {0, 0, 0});
+                gameOverTextureMessage = s.gameOverMessage;
+            }
+            gameOverTexture.drawTexture((mWindowWidth/2 - gameOverTexture.getWidth())/2, mWindowHeight/2 - 20);
+        }
+        if (s.bShowWeapon) {
+            if (s.nSelectedWeapon != nWeaponTextureWeapon) {
+                weaponTexture.loadTextureFromText(getWeaponInfo(static_cast<WEAPON>(s.nSelectedWeapon)).name,
+                                                  {0, 0, 0});
+                nWeaponTextureWeapon = s.nSelectedWeapon;
+            }
+            weaponTexture.drawTexture(mWindowWidth - weaponTexture.getWidth() - 6, 6);
+        }
+        if(s.bShowNukeAnimation){
+            if (nPlaneRegion >= 0) {
+                const SDL_Rect &plane = spriteAtlas->getRegion(nPlaneRegion);
+                getSpriteBatch().draw(nPlaneRegion, nullptr, s.planePosX, 40, plane.w / 4.0f, plane.h / 4.0f);
+            }
+        }
+        // draw energy bar
+        bool bEnergyBarInView = isInView(s, s.fManX + 6, s.fManY + 21.5f, 11);
+        for (int i = 0; bEnergyBarInView && i < 22 * s.fEnergyLevel; i++) {
+            drawPoint(s.fManX - 5 + i - s.fCameraPosX, s.fManY + 20 - s.fCameraPosY, {0xFF, 0, 0xFF});
+            drawPoint(s.fManX - 5 + i - s.fCameraPosX, s.fManY + 21 - s.fCameraPosY, {0xFF, 0, 0xFF});
+            drawPoint(s.fManX - 5 + i - s.fCameraPosX, s.fManY + 22 - s.fCameraPosY, {0xFF, 0, 0xFF});
+            drawPoint(s.fManX - 5 + i - s.fCameraPosX, s.fManY + 23 - s.fCameraPosY, {0xFF, 0, 0xFF});
+        }
+    }
+    // draw objects
+    ProfileScope objectsScope(PHASE_DRAW_OBJECTS);
+    RenderStats &stats = getRenderStats();
+    for (const ObjectSnapshot &object: s.vecObjects) {
+        if (!isInView(s, object.px, object.py, object.fDrawExtent)) {
+            stats.nObjectsCulled++;
+            continue;
+        }
+        drawObject(object, s.fCameraPosX, s.fCameraPosY);
+        stats.nObjectsDrawn++;
+    }
+    return true;
+}
+
+void Fauji::BOOM(float fWorldX, float fWorldY, float fRadius) {
+    ProfileScope boomScope(PHASE_BOOM);
+    TRACE_SCOPE("BOOM");
+    // Erase Terrain to form crater
+    int nCraterX = static_cast<int>(fWorldX);
+    int nCraterY = static_cast<int>(fWorldY);
+    int nCraterRadius = static_cast<int>(fRadius);
+#ifdef FAUJI_TRACE
+    nTerrainPixelsCarved += carveCrater<true>(map, nMapWidth, nMapHeight, nCraterX, nCraterY, nCraterRadius);
+    TRACE_COUNTER("terrain pixels carved", nTerrainPixelsCarved);
+#else
+    carveCrater(map, nMapWidth, nMapHeight, nCraterX, nCraterY, nCraterRadius);
+#endif
+    if (pSpectatorWriter != nullptr) {
+        pSpectatorWriter->addCrater(nCraterX, nCraterY, nCraterRadius);
+    }
+    // sand gives way further than the radius
+    int nReach = getCraterReach(nCraterRadius);
+    markTerrainChanged(nCraterX - nReach, nCraterY - nReach, 2 * nReach + 1, 2 * nReach + 1);
+    terrainSettler.activate(nCraterX - nReach, nCraterY - nReach, 2 * nReach + 1, 2 * nReach + 1);
+    playSound(SOUND_EXPLOSION, fWorldX, std::min(fRadius / 40.0f, 1.0f));
+    // impact nearby bodies
+    auto impact = [&](cPhysicsObject &p) {
+        float dx = (p.px - fWorldX);
+        float dy = (p.py - fWorldY);
+        float fDist = std::sqrt(dx * dx + dy * dy);
+        if (fDist < 0.001f) fDist = 0.001f;
+        if (fDist < fRadius) {
+            // now we have to apply force on the object, for which we change its velocity.
+            // the new velocity should be in the direction of the distance vector and inversely proportional to the distance
+            p.vx = (dx / fDist) * fRadius;
+            p.vy = (dy / fDist) * fRadius;
+            if (p.getKind() == OBJECT_MAN) {
+                countDamage(static_cast<cMan &>(p), ((fRadius - fDist) / fRadius) * 0.8f);
+            } else {
+                p.Damage(((fRadius - fDist) / fRadius) * 0.8f);
+            }
+            p.bStable = false;
+        }
+    };
+    for (auto &p: listObjects) {
+        impact(*p);
+    }
+    for (size_t i = 0; i < projectiles.size(); i++) {
+        impact(projectiles[i]);
+    }
+
+    for (int i = 0; i < static_cast<int>(fRadius); i++) {
+        listObjects.push_back(std::make_unique<cDebris>(fWorldX, fWorldY, rng));
+    }
+}
+
+void Fauji::countDamage(cMan &man, float fDamage) {
+    float fHealthBefore = man.fHealth;
+    man.Damage(fDamage);
+    // only what the turns do, not the nuke at the end
+    if (nGameState != GS_START_PLAY && nGameState != GS_CAMERA_MODE) return;
+    if (man.nTeam == nCurrentTeam) {
+        matchStats.fFriendlyDamage += fHealthBefore - man.fHealth;
+    } else {
+        matchStats.fEnemyDamage += fHealthBefore - man.fHealth;
+        if (!bShotHit && fHealthBefore > man.fHealth) {
+            bShotHit = true;
+            matchStats.nShotsHit++;
+        }
+    }
+}
+
+void Fauji::playSound(SOUND_EFFECT nSound, float fWorldX, float fVolume) {
+    // from 0 at the left edge of the screen to 1 at the right edge, quieter the further off the screen
+    float fScreenX = (fWorldX - fCameraPosX) / mWindowWidth;
+    float fOffScreen = std::max(-fScreenX, fScreenX - 1.0f);
+    if (fOffScreen > 0.0f) fVolume /= 1.0f + 2.0f * fOffScreen;
+    getSoundPool().play(nSoundIds[nSound], fVolume, 2.0f * fScreenX - 1.0f);
+}
+
+void Fauji::createMap() {
+    // used in 1D perlin noise
+    float *fSurface = new float[nMapWidth];
+    float *fRockDepth = new float[nMapWidth];
+    float *fNoiseSeed = new float[nMapWidth];
+
+    for (int i = 0; i < nMapWidth; i++) {
+        fNoiseSeed[i] = rng.nextFloat();
+    }
+    fNoiseSeed[0] = 0.5f; // Because we want the terrain to start and end at half the height of the screen
+    perlinNoise1D(nMapWidth, fNoiseSeed, 8, 2.0f, fSurface);
+    for (int i = 0; i < nMapWidth; i++) {
+        fNoiseSeed[i] = rng.nextFloat();
+    }
+    perlinNoise1D(nMapWidth, fNoiseSeed, 6, 2.0f, fRockDepth);
+    // Under the surface the land is in layers: sand where it lies in a valley, soil, rock from a depth that
+    // goes up and down, and a floor of bedrock no crater gets through
+    const int nBedrockTop = nMapHeight - std::max(4, nMapHeight / 64);
+    std::vector<int> vecSandEnd(nMapWidth);
+    std::vector<int> vecRockTop(nMapWidth);
+    for (int x = 0; x < nMapWidth; x++) {
+        int nSurface = static_cast<int>(fSurface[x] * nMapHeight);
+        int nSand = std::min(static_cast<int>((fSurface[x] - 0.55f) * nMapHeight), 24);
+        vecSandEnd[x] = nSurface + std::max(nSand, 0);
+        vecRockTop[x] = nSurface + 20 + static_cast<int>(fRockDepth[x] * 0.25f * nMapHeight);
+    }
+    for (int y = 0; y < nMapHeight; y++) {
+        for (int x = 0; x < nMapWidth; x++) {
+            // if the current pixel in map is greater than corresponding pixel in noise output
+            // it is land (y=0 is at top)
+            unsigned char nMaterial = MATERIAL_SKY;
+            if (y > fSurface[x] * nMapHeight) {
+                if (y >= nBedrockTop) {
+                    nMaterial = MATERIAL_BEDROCK;
+                } else if (y >= vecRockTop[x]) {
+                    nMaterial = MATERIAL_ROCK;
+                } else if (y <= vecSandEnd[x]) {
+                    nMaterial = MATERIAL_SAND;
+                } else {
+                    nMaterial = MATERIAL_SOIL;
+                }
+            }
+            map[y * nMapWidth + x] = nMaterial;
+        }
+    }
+    delete[] fNoiseSeed;
+    delete[] fRockDepth;
+    delete[] fSurface;
+    markTerrainChanged(0, 0, nMapWidth, nMapHeight);
+    terrainSettler.reset(nMapWidth, nMapHeight);
+    if (pSpectatorWriter != nullptr) {
+        pSpectatorWriter->setTerrainMap(map, nMapWidth, nMapHeight);
+    }
+
+}
+
+void Fauji::perlinNoise1D(int nCount, float *fSeed, int nOctaves, float fBias, float *fOutput) {
+    // Used 1D Perlin Noise
+    for (int x = 0; x < nCount; x++) {
+        float fNoise = 0.0f;
+        float fScaleAcc = 0.0f;
+        float fScale = 1.0f;
+
+        for (int o = 0; o < nOctaves; o++) {
+            int nPitch = nCount >> o;
+            int nSample1 = (x / nPitch) * nPitch;
+            int nSample2 = (nSample1 + nPitch) % nCount;
+            float fBlend = (float) (x - nSample1) / (float) nPitch;
+            float fSample = (1.0f - fBlend) * fSeed[nSample1] + fBlend * fSeed[nSample2];
+            fScaleAcc += fScale;
+            fNoise += fSample * fScale;
+            fScale = fScale / fBias;
+        }
+
+        // Scale to seed range
+        fOutput[x] = fNoise / fScaleAcc;
+    }
+}
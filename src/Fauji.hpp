@@ -0,0 +1,345 @@
+#pragma once
+
+#include "SimpleGameEngine.hpp"
+#include "AIPlanner.hpp"
+#include "GameObjects.hpp"
+#include "GameTuning.hpp"
+#include "Lockstep.hpp"
+#include "Materials.hpp"
+#include "PaletteTexture.hpp"
+#include "Random.hpp"
+#include "RenderSnapshot.hpp"
+#include "SimulationState.hpp"
+#include "SpectatorStream.hpp"
+#include "StateHash.hpp"
+#include "TerrainSettler.hpp"
+#include "TripleBuffer.hpp"
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+// What happened in a match, for balancing the game (see fauji-sweep)
+struct MatchStats {
+    uint32_t nTurns = 0;
+    uint32_t nShots = 0;
+    uint32_t nShotsHit = 0;       // shots that hurt an opponent of the team that fired them
+    float fEnemyDamage = 0.0f;    // health the team whose turn it was took off its opponents
+    float fFriendlyDamage = 0.0f; // and off itself
+    int nWinningTeam = -1;        // -1 until the match is decided
+};
+
+class Fauji : public GameEngine {
+private:
+    int nMapWidth = 1024;
+    int nMapHeight = 512;
+    unsigned char *map = nullptr;
+    float fCameraPosX = 0;
+    float fCameraPosY = 0;
+    float fCameraPosXTarget = 0;
+    float fCameraPosYTarget = 0;
+
+    float fMapScrollSpeed = 400.0f;
+    std::list<std::unique_ptr<cPhysicsObject>, PoolAllocator<std::unique_ptr<cPhysicsObject>>> listObjects;
+    static const int PROJECTILE_CAPACITY = 1024;
+    cProjectilePool projectiles{PROJECTILE_CAPACITY}; // everything fired, kept out of listObjects
+    WEAPON nSelectedWeapon = WEAPON_MISSILE; // what the player fires, the AI always fires missiles
+    cPhysicsObject *pObjectUnderControl = nullptr;
+    cPhysicsObject *pCameraTrackingObject = nullptr;
+    float fEnergyLevel = 0;
+    float fOldEnergyLevel = 0;
+    bool bFireWeapon = false;
+    bool bShowCountDown = false;
+    bool bShowNukeAnimation = false;
+    int planePosX = 0;
+    std::shared_ptr<TextureAtlas> spriteAtlas; // the men, their tombs and the plane
+    int nPlaneRegion = -1;
+    enum SOUND_EFFECT {
+        SOUND_EXPLOSION = 0,
+        SOUND_FIRE,
+        SOUND_FOOTSTEP,
+        SOUND_EFFECTS
+    };
+    int nSoundIds[SOUND_EFFECTS] = {-1, -1, -1}; // in the engine's SoundPool
+    float fTurnTime = 0.0f;
+    bool bGameIsStable = false;
+    bool bPlayerHasControl = false;
+    bool bComputerHasControl = false;
+    bool bPlayerActionComplete = false;
+    float fTimeSinceEnergyLevelSet = 0;
+    // Vector to store teams
+    std::vector<cTeam> vecTeams;
+    // Current team being controlled
+    int nCurrentTeam = 0;
+    cTurnOrder turnOrder;                // hands the turn on to the next team still alive
+    int nTeams = 2;
+    int nMembersPerTeam = 2;
+
+    // AI control flags
+    bool bAI_AimLeft = false;            // AI has pressed "AIM_LEFT" key
+    bool bAI_AimRight = false;            // AI has pressed "AIM_RIGHT" key
+    bool bAI_Energise = false;            // AI has pressed "FIRE" key
+    bool bAI_Walk = false;              // AI is walking, which can include jumping if necessary
+    bool bAI_Jump = false;
+    bool bAI_Flipped = false;           // AI is facing left
+
+    float fAITargetAngle = 0.0f;        // Angle AI should aim for
+    float fAITargetEnergy = 0.0f;        // Energy level AI should aim for
+    float fAISafePosition = 0.0f;        // X-Coordinate considered safe for AI to move to
+    cMan *pAITargetMan = nullptr;        // Pointer to worm AI has selected as target
+    float fAITargetX = 0.0f;            // Coordinates of target missile location
+    float fAITargetY = 0.0f;
+    cAIPlanner aiPlanner;               // Plans the AI's turn on a background thread
+    AIPlan aiPlan;                      // Latest plan for the current request
+    AIPlan pendingAIPlan;               // published by the planner, taken out of it by saveState
+    bool bAIPlanPending = false;
+    int nAIRequestId = 0;               // Id of the last snapshot handed to the planner
+    bool bAIShotRequested = false;      // A shot from the current position has been requested
+    float fPhysicsStepTime = 1.0f / 60.0f; // Duration of the last physics sub-step, the planner integrates with it
+    std::string gameOverMessage;
+    LTexture timerTexture;              // rendered again only when the number of seconds changes
+    int nTimerTextureSeconds = -1;
+    LTexture gameOverTexture;
+    LTexture weaponTexture;
+    int nWeaponTextureWeapon = -1;
+    std::string gameOverTextureMessage;
+    InputHandle nInputHandle = INVALID_INPUT_HANDLE;
+    Random rng;                         // Every random choice of the match comes from here
+    GameTuning tuning;
+    MatchStats matchStats;
+    bool bShotHit = false;              // the last shot fired has hurt an opponent
+    bool bAllTeamsAI = false;           // the AI plays team 0 as well
+    bool bDeterministicAI = false;      // see setDeterministicAI
+    uint32_t nTick = 0;                 // simulation ticks since the start of the match
+    int nMaxTicks = 0;                  // stop the simulation after this many ticks, 0 runs forever
+    cStateLog *pStateLog = nullptr;     // receives the state of every tick when set
+    cLockstep *pLockstep = nullptr;     // set in a network match, every player's input comes from it
+    cSpectatorWriter *pSpectatorWriter = nullptr; // receives what every tick looks like when set
+    cSpectatorReader *pSpectatorReader = nullptr; // when set a spectator stream is played instead of a match
+    bool bSpectatorPaused = false;
+    RenderSnapshot spectatorSnapshot;   // what the spectator stream gets of a tick
+    std::vector<uintptr_t> vecSpectatorKeys; // of the objects of spectatorSnapshot, their addresses
+#ifdef FAUJI_TRACE
+    int nTerrainPixelsCarved = 0;       // land pixels turned into sky, for the trace
+#endif
+    TripleBuffer<RenderSnapshot> renderSnapshots; // published after the ticks of a frame, drawn by onFrameUpdate
+    uint32_t nTerrainVersion = 0;       // counts the changes to the map
+    std::vector<TerrainRect> vecTerrainChanges; // the latest changes to the map, oldest first
+    uint32_t nRenderFrame = 0;          // frames drawn, for the animations
+    PaletteTexture landscapeTexture;    // the part of the map in view, coloured by material
+    static const size_t TERRAIN_CHANGE_HISTORY = 256;
+    cTerrainChunks terrainChunks;       // the map as saveState last saw it
+    std::vector<int> vecColumnTop;      // topmost land row of every column, see TerrainView::pColumnTop
+    cTerrainSettler terrainSettler;     // lets the land the craters undermined fall
+    uint32_t nRollbackCheckTicks = 0;   // see setRollbackCheck
+    bool bRollbackCheckPending = false;
+    SimulationState rollbackCheckState;
+    static const int AI_VIEW_DISTANCE = 2048; // further than any shot flies, the planner sees this far to each side
+    static const int MIN_UNIT_SPACING = 32; // map width a man needs, the map is widened to give everyone that
+
+    // what a match is played with besides the seed, recorded so that replays set up the same battle
+    struct TeamSetup {
+        int32_t nTeams;
+        int32_t nMembersPerTeam;
+        int32_t nMapWidth;
+        int32_t nAIFlags; // AI_FLAG_*, replays recorded before it was kept end before it
+    };
+    static const int32_t AI_FLAG_ALL_TEAMS = 1;     // see setAllTeamsAI
+    static const int32_t AI_FLAG_DETERMINISTIC = 2; // see setDeterministicAI
+    enum GAME_STATE {
+        GS_RESET = 0,
+        GS_GENERATE_TERRAIN = 1,
+        GS_GENERATING_TERRAIN,
+        GS_ALLOCATE_UNITS,
+        GS_ALLOCATING_UNITS,
+        GS_START_PLAY,
+        GS_CAMERA_MODE,
+        GS_GAME_OVER,
+        GS_NUKE,
+        GS_GAME_OVER2
+    } nGameState, nNextState;
+
+    enum AI_STATE {
+        AI_ASSESS_ENVIRONMENT = 0,
+        AI_MOVE,
+        AI_CHOOSE_TARGET,
+        AI_POSITION_FOR_TARGET,
+        AI_AIM,
+        AI_FIRE,
+    } nAIState, nAINextState;
+
+    static const char *getAIStateName(AI_STATE nState);
+
+    // the 10 physics sub-steps of a tick, including the explosions of whatever dies in them
+    void updatePhysics(float fElapsedTime);
+
+    // a projectile going off: its crater, and whatever it releases as laid down in its WeaponInfo
+    void detonate(cMissile &projectile);
+
+    // damages a man caught in a blast and counts it in matchStats
+    void countDamage(cMan &man, float fDamage);
+
+    // a sound effect of something happening at fWorldX, panned to where that is on the screen
+    void playSound(SOUND_EFFECT nSound, float fWorldX, float fVolume);
+
+    // Every plain value saveState copies, handed to visit one after the other in the same order every time
+    template<typename Game, typename Visitor>
+    static void visitSimulationValues(Game &game, Visitor &&visit);
+
+    // a new plan of the planner, or the one saveState took out of it
+    bool pollAIPlan(AIPlan &plan);
+
+    // records the team setup, or takes it out of the replay, and widens the map if the units don't fit
+    void setupBattle();
+
+    // Every change to the map has to be marked, render snapshots copy only what changed
+    void markTerrainChanged(int x, int y, int w, int h);
+
+    // finds the top of every column in the changed rectangle again
+    void updateColumnTops(int x, int y, int w, int h);
+
+    // brings the snapshot's copy of the map up to date
+    void copyTerrain(RenderSnapshot &s) const;
+
+    // everything of a render snapshot but the map
+    void takeSnapshot(RenderSnapshot &s) const;
+
+    void recordSpectatorTick();
+
+    // a tick of the spectator stream instead of the simulation, with the keys seeking through it
+    bool playSpectatorTick();
+
+    // the part of the map under the camera
+    void drawLandscape(const RenderSnapshot &s);
+
+    // whether a square of half side fExtent around the world position (x, y) overlaps the camera's view
+    bool isInView(const RenderSnapshot &s, float x, float y, float fExtent) const;
+
+    void drawObject(const ObjectSnapshot &object, float fOffsetX, float fOffsetY);
+
+    // measure and check the parts above in isolation
+    friend class FaujiBench;
+    friend class FaujiTests;
+
+public:
+    explicit Fauji(bool bHeadless = false) : GameEngine(bHeadless) {
+        for (int i = 0; i < 256; i++) landscapeTexture.setColor(static_cast<uint8_t>(i), getMaterialInfo(i).color);
+    }
+
+    ~Fauji();
+
+    // before onInit, the map is allocated there
+    void setMapSize(int nWidth, int nHeight);
+
+    void setSeed(uint64_t nSeed);
+
+    void setAllTeamsAI(bool bAllTeamsAI);
+
+    static const int MAX_TEAMS = 64;
+    static const int MAX_MEMBERS_PER_TEAM = 32;
+
+    // before onInit, between 2 and MAX_TEAMS teams of 1 to MAX_MEMBERS_PER_TEAM men
+    bool setTeams(int nTeams, int nMembersPerTeam);
+
+    // Plans the AI's turns synchronously and without deadlines, so a seeded match without a replay
+    // plays out the same on every run
+    void setDeterministicAI(bool bDeterministic);
+
+    void setAIThreadCount(int nThreads);
+
+    // simulated shots a deterministic AI may spend on one plan, 0 searches to the end, see cAIPlanner
+    void setAIShotBudget(int nShots);
+
+    void setMaxTicks(int nMaxTicks);
+
+    // before onInit
+    void setTuning(const GameTuning &tuning);
+
+    const MatchStats &getMatchStats() const;
+
+    void setStateLog(cStateLog *pStateLog);
+
+    // before onInit, player p of the lockstep plays team p and the other teams are the AI's
+    void setLockstep(cLockstep *pLockstep);
+
+    // before onInit, the stream gets every tick of the match (ticks undone by setRollbackCheck as well)
+    void setSpectatorWriter(cSpectatorWriter *pWriter);
+
+    // Before onInit, makes this a viewer of the stream: nothing is simulated, the ticks step through the stream
+    // and draw what it holds. Left and right seek ten seconds back and forth, space pauses, home starts over.
+    void setSpectatorPlayback(cSpectatorReader *pReader);
+
+    // a human plays nTeam, unless all teams are the AI's
+    bool isPlayersTeam(int nTeam) const;
+
+    uint32_t getTick() const;
+
+    // Copies everything the match continues from into state: the terrain, every object, the teams, the game
+    // and AI state machines, the timers and the rng. Not in it are the planner's unfinished work (its plans
+    // are only exact with setDeterministicAI), replays and recordings, and the engine's input state.
+    void saveState(SimulationState &state);
+
+    // Puts the match back to where it was when state was saved, the next tick continues from there
+    void restoreState(const SimulationState &state);
+
+    // For checking that restoreState is exact: every 2 * nTicks ticks the state is saved, restored nTicks
+    // later and the ticks in between are run again. The state log forgets the ticks that were undone.
+    void setRollbackCheck(int nTicks);
+
+    // true once the match is decided and nothing moves anymore
+    bool isMatchOver() const;
+
+    // Everything that decides how the match continues, the camera and other presentation state is left out
+    void captureTickState(TickRecord &record) const;
+
+    void walkManRight(cMan *pMan);
+
+    void walkManLeft(cMan *pMan);
+
+    void manJump(cMan *pMan);
+
+    void aimLeft(cMan *pMan, float secPerFrame);
+
+    void aimRight(cMan *pMan, float secPerFrame);
+
+    void energize(float secPerFrame);
+
+    // Discrete actions, once per key press
+    void onUserInputEvent(const InputEvent &event, float secPerFrame);
+
+    // Continuous actions, applied every frame for as long as the key is held, so walking,
+    // aiming and energising don't depend on the OS key repeat rate
+    void applyHeldKeys(float fElapsedTime);
+
+    // The keyboard of this tick as PLAYER_INPUT bits
+    uint8_t sampleLocalInput() const;
+
+    // What the man under control does with a player's input of one tick
+    void applyPlayerInput(uint8_t nInput, float fElapsedTime);
+
+    // Copies what the AI planner needs to know into an immutable snapshot and hands it over.
+    // fPlanningTime is how long (in seconds) the planner may keep refining the plan.
+    void submitAIPlanRequest(cMan *origin, bool bAllowMove, float fPlanningTime);
+
+    bool onInit() override;
+
+    // Advances the game by one fixed tick, everything that changes the game state happens here
+    bool onSimulationTick(float fElapsedTime) override;
+
+    // In a network match a tick has to wait for the input of every player
+    bool isTickReady() override;
+
+    // Copies the state that is drawn into the next render snapshot
+    void onPublishSnapshot() override;
+
+    // Draws the latest render snapshot, may run on another thread than the ticks
+    bool onFrameUpdate(float fElapsedTime) override;
+
+    // create an explosion of a certain radius at a certain position in the world
+    void BOOM(float fWorldX, float fWorldY, float fRadius);
+
+    void createMap();
+
+    // Taken from Perlin Noise Video https://youtu.be/6-0UaeJBumA
+    void perlinNoise1D(int nCount, float *fSeed, int nOctaves, float fBias, float *fOutput);
+};
@@ -0,0 +1,102 @@
+#include "GameObjects.hpp"
+
+std::vector<std::pair<float, float>> defineDebris() {
+    // A small unit rectangle
+    std::vector<std::pair<float, float>> vecModel;
+    vecModel.push_back({0.0f, 0.0f});
+    vecModel.push_back({1.0f, 0.0f});
+    vecModel.push_back({1.0f, 1.0f});
+    vecModel.push_back({0.0f, 1.0f});
+    return vecModel;
+}
+
+// out of line initialisation of static member
+std::vector<std::pair<float, float>> cDebris::vecModel = defineDebris();
+
+int cDebris::ObjDeadAction() {
+    return 0;
+}
+
+int cMissile::ObjDeadAction() {
+    return static_cast<int>(getWeaponInfo(nWeapon).fBlastRadius);
+}
+
+std::vector<std::pair<float, float>> DefineMissile() {
+    // Defines a rocket like shape
+    std::vector<std::pair<float, float>> vecModel;
+    vecModel.push_back({0.0f, 0.0f});
+    vecModel.push_back({1.0f, 1.0f});
+    vecModel.push_back({2.0f, 1.0f});
+    vecModel.push_back({2.5f, 0.0f});
+    vecModel.push_back({2.0f, -1.0f});
+    vecModel.push_back({1.0f, -1.0f});
+    vecModel.push_back({0.0f, 0.0f});
+    vecModel.push_back({-1.0f, -1.0f});
+    vecModel.push_back({-2.5f, -1.0f});
+    vecModel.push_back({-2.0f, 0.0f});
+    vecModel.push_back({-2.5f, 1.0f});
+    vecModel.push_back({-1.0f, 1.0f});
+
+    // Scale points to make shape unit sized
+    for (auto &v: vecModel) {
+        v.first /= 2.5f;
+        v.second /= 2.5f;
+    }
+    return vecModel;
+}
+
+std::vector<std::pair<float, float>> cMissile::vecModel = DefineMissile();
+
+int cMan::nSpriteRegion = -1;
+int cMan::nTombRegion = -1;
+const SDL_Rect cMan::spriteClips[4] = {{0, 0, 64, 205}, {64, 0, 64, 205}, {128, 0, 64, 205}, {192, 0, 64, 205}};
+
+bool cMan::Damage(float d) {
+    bool bWasAlive = fHealth > 0;
+    fHealth -= d;
+    if (fHealth <= 0) { // Worm has died, no longer playable
+        fHealth = 0.0f;
+        bIsPlayable = false;
+        if (bWasAlive && pTeam != nullptr) pTeam->nAliveMembers--;
+    }
+    return fHealth > 0;
+}
+
+void cMan::draw(GameEngine *engine, const ObjectSnapshot &s, float fOffsetX, float fOffsetY,
+                uint32_t nAnimationFrame) {
+    float px = s.px;
+    float py = s.py;
+    float radius = s.radius;
+    if (s.bIsPlayable) {
+        const SDL_Rect *currentClip = nullptr;
+        if (std::abs(s.vx) > 4 && std::abs(s.vx) < 6) {
+            currentClip = &spriteClips[(nAnimationFrame / 2) % 4];
+        } else {
+            currentClip = &spriteClips[0];
+        }
+        engine->getSpriteBatch().draw(nSpriteRegion, currentClip, px - fOffsetX - radius, py - fOffsetY - radius,
+                                      radius * 2, radius * 2, 0, s.flipType);
+        Color healthColor = {};
+        if (s.nTeam == 0) {
+            healthColor = {0, 0, 0xFF};
+        } else {
+            healthColor = {0xFF, 0, 0};
+        }
+
+        // draw health bar
+        for (int i = 0; i < 22 * s.fHealth; i++) {
+            engine->drawPoint(px - 5 + i - fOffsetX, py - 20 - fOffsetY, healthColor);
+            engine->drawPoint(px - 5 + i - fOffsetX, py - 21 - fOffsetY, healthColor);
+            engine->drawPoint(px - 5 + i - fOffsetX, py - 22 - fOffsetY, healthColor);
+            engine->drawPoint(px - 5 + i - fOffsetX, py - 23 - fOffsetY, healthColor);
+        }
+    } else {
+        engine->getSpriteBatch().draw(nTombRegion, nullptr, px - fOffsetX - radius, py - fOffsetY - radius,
+                                      radius * 2, radius * 2);
+    }
+
+}
+
+int cMan::ObjDeadAction() {
+    return 0;
+}
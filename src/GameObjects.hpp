@@ -0,0 +1,352 @@
+#pragma once
+
+#include "SimpleGameEngine.hpp"
+#include "ObjectPool.hpp"
+#include "Random.hpp"
+#include "RenderSnapshot.hpp"
+#include "SpriteBatch.hpp"
+#include "Weapons.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+const float PI = 3.14159f;
+
+class cTeam;
+
+// Objects come out of the ObjectPool, missiles and debris are spawned and removed all the time
+class cPhysicsObject : public Pooled {
+public:
+    float px = 0.0f;
+    float py = 0.0f;
+    float vx = 0.0f;
+    float vy = 0.0f;
+    float ax = 0.0f;
+    float ay = 0.0f;
+    float radius = 4.0f;
+    bool bStable = false;
+    float fFriction = 0.8f;
+    int nBounceBeforeDeath = -1;
+    bool bDead = false;
+
+    cPhysicsObject(float x = 0.0f, float y = 0.0f) : px(x), py(y) {}
+
+    virtual ~cPhysicsObject() = default;
+
+    // Copies what drawing needs, the derived classes draw the snapshot with their static draw()
+    virtual void takeSnapshot(ObjectSnapshot &s) const {
+        s.px = px;
+        s.py = py;
+        s.vx = vx;
+        s.vy = vy;
+        s.radius = radius;
+        s.fDrawExtent = getDrawExtent();
+    }
+
+    // Half the side of a square around (px, py) that holds everything draw() draws, for culling
+    virtual float getDrawExtent() const { return radius; }
+
+    virtual OBJECT_KIND getKind() const = 0;
+
+    virtual int ObjDeadAction() = 0;
+
+    virtual bool Damage(float d) = 0;
+};
+
+class cDebris : public cPhysicsObject {
+public:
+    cDebris(float x, float y, Random &rng) : cPhysicsObject(x, y) {
+        // Set velocity to random direction and size for "boom" effect
+        vx = 10.0f * cosf(rng.nextFloat() * 2.0f * PI);
+        vy = 10.0f * sinf(rng.nextFloat() * 2.0f * PI);
+        radius = 1.0f;
+        fFriction = 0.8f;
+        nBounceBeforeDeath = 5;
+    }
+
+    void takeSnapshot(ObjectSnapshot &s) const override {
+        cPhysicsObject::takeSnapshot(s);
+        s.nKind = OBJECT_DEBRIS;
+    }
+
+    OBJECT_KIND getKind() const override { return OBJECT_DEBRIS; }
+
+    static void draw(GameEngine *engine, const ObjectSnapshot &s, float fOffsetX, float fOffsetY) {
+        engine->DrawWireFrameModel(vecModel, s.px - fOffsetX, s.py - fOffsetY, std::atan2f(s.vy, s.vx), s.radius,
+                                   {0x00, 0x64, 0x00});
+    }
+
+    float getDrawExtent() const override {
+        return radius * 1.5f; // the unit square's diagonal
+    }
+
+    bool Damage(float d) override {
+        return true; // Cannot be damaged
+    }
+
+    int ObjDeadAction() override;
+
+private:
+    // we want vecModel to be shared among all instances, so make it static
+    // since it is static, it must be initialised out of line
+    static std::vector<std::pair<float, float>> vecModel;
+};
+
+class cMissile : public cPhysicsObject // A projectile weapon, set up from the weapon table
+{
+public:
+    WEAPON nWeapon = WEAPON_MISSILE;
+    float fFuse = 0.0f; // seconds left until it goes off, 0 if the weapon has no fuse
+
+    cMissile(float x = 0.0f, float y = 0.0f, float _vx = 0.0f, float _vy = 0.0f) : cPhysicsObject(x, y) {
+        arm(WEAPON_MISSILE, x, y, _vx, _vy);
+    }
+
+    // Makes this a fresh projectile of nWeapon, projectiles are reused
+    void arm(WEAPON nWeapon, float x, float y, float _vx, float _vy) {
+        const WeaponInfo &weapon = getWeaponInfo(nWeapon);
+        this->nWeapon = nWeapon;
+        px = x;
+        py = y;
+        vx = _vx;
+        vy = _vy;
+        ax = 0.0f;
+        ay = 0.0f;
+        radius = weapon.fRadius;
+        fFriction = weapon.fFriction;
+        nBounceBeforeDeath = weapon.nBounceBeforeDeath;
+        bStable = false;
+        bDead = false;
+        fFuse = weapon.fFuseTime;
+    }
+
+    // true once the fuse has burnt down, the projectile goes off wherever it is
+    bool burnFuse(float fElapsedTime) {
+        if (fFuse <= 0.0f) return false;
+        fFuse -= fElapsedTime;
+        return fFuse <= 0.0f;
+    }
+
+    void takeSnapshot(ObjectSnapshot &s) const override {
+        cPhysicsObject::takeSnapshot(s);
+        s.nKind = OBJECT_MISSILE;
+        s.nWeapon = nWeapon;
+    }
+
+    OBJECT_KIND getKind() const override { return OBJECT_MISSILE; }
+
+    static void draw(GameEngine *engine, const ObjectSnapshot &s, float fOffsetX, float fOffsetY) {
+        engine->DrawWireFrameModel(vecModel, s.px - fOffsetX, s.py - fOffsetY, atan2f(s.vy, s.vx), s.radius,
+                                   getWeaponInfo(static_cast<WEAPON>(s.nWeapon)).color);
+    }
+
+    float getDrawExtent() const override {
+        return radius * 1.1f; // the fins stick out a little
+    }
+
+    bool Damage(float d) override {
+        return true; // Cannot be damaged
+    }
+
+    int ObjDeadAction() override;
+
+
+private:
+    static std::vector<std::pair<float, float>> vecModel;
+};
+
+// Every projectile in flight lives in one of a fixed number of slots allocated up front, so a shot,
+// however many bomblets it turns into, neither allocates nor adds nodes to Fauji::listObjects.
+// Projectiles are kept in the order they were fired, the order they had when they were in listObjects.
+class cProjectilePool {
+private:
+    std::vector<cMissile> vecSlots;
+    std::vector<int> vecFree;   // slots not in use
+    std::vector<int> vecActive; // slots in use, oldest first
+
+public:
+    explicit cProjectilePool(int nCapacity) : vecSlots(nCapacity) {
+        vecFree.reserve(nCapacity);
+        vecActive.reserve(nCapacity);
+        for (int i = nCapacity - 1; i >= 0; i--) vecFree.push_back(i);
+    }
+
+    // nullptr if every slot is taken, the projectile is then never fired
+    cMissile *spawn(WEAPON nWeapon, float x, float y, float vx, float vy) {
+        if (vecFree.empty()) return nullptr;
+        int nSlot = vecFree.back();
+        vecFree.pop_back();
+        vecActive.push_back(nSlot);
+        vecSlots[nSlot].arm(nWeapon, x, y, vx, vy);
+        return &vecSlots[nSlot];
+    }
+
+    // Slots of dead projectiles go back to the free list, the others keep their order
+    void removeDead() {
+        size_t nKept = 0;
+        for (int nSlot: vecActive) {
+            if (vecSlots[nSlot].bDead) {
+                vecFree.push_back(nSlot);
+            } else {
+                vecActive[nKept++] = nSlot;
+            }
+        }
+        vecActive.resize(nKept);
+    }
+
+    void clear() {
+        for (int nSlot: vecActive) vecFree.push_back(nSlot);
+        vecActive.clear();
+    }
+
+    // projectiles in flight, spawning while walking over them with operator[] is fine
+    size_t size() const { return vecActive.size(); }
+
+    cMissile &operator[](size_t i) { return vecSlots[vecActive[i]]; }
+
+    const cMissile &operator[](size_t i) const { return vecSlots[vecActive[i]]; }
+
+    // slot of a projectile of this pool, -1 for any other object
+    int getSlot(const cPhysicsObject *p) const {
+        const cMissile *pMissile = static_cast<const cMissile *>(p);
+        if (vecSlots.empty() || pMissile < vecSlots.data() || pMissile >= vecSlots.data() + vecSlots.size()) return -1;
+        return static_cast<int>(pMissile - vecSlots.data());
+    }
+
+    cMissile *getSlotObject(int nSlot) { return &vecSlots[nSlot]; }
+
+    // The projectiles in flight and the slot lists, what Fauji's state snapshots keep of the pool
+    struct Saved {
+        std::vector<cMissile> vecInFlight; // in the order of vecActive
+        std::vector<int> vecFree;
+        std::vector<int> vecActive;
+    };
+
+    void save(Saved &saved) const {
+        saved.vecFree = vecFree;
+        saved.vecActive = vecActive;
+        saved.vecInFlight.clear();
+        for (int nSlot: vecActive) saved.vecInFlight.push_back(vecSlots[nSlot]);
+    }
+
+    // every projectile goes back into the slot it had, so pointers to them stay valid
+    void restore(const Saved &saved) {
+        vecFree = saved.vecFree;
+        vecActive = saved.vecActive;
+        for (size_t i = 0; i < vecActive.size(); i++) vecSlots[vecActive[i]] = saved.vecInFlight[i];
+    }
+};
+
+class cMan : public cPhysicsObject {
+public:
+    SDL_RendererFlip flipType = SDL_FLIP_NONE;
+    float fShootingAngle = 0.0f;
+    float fHealth = 1.0f;
+    bool bIsPlayable = true;
+    int nTeam = 0;
+    cTeam *pTeam = nullptr;   // told when this man dies
+    static int nSpriteRegion; // in the game's sprite atlas, shared across instances
+    static int nTombRegion;
+    static const SDL_Rect spriteClips[4]; // the walk animation in man.png
+
+    cMan(float x, float y) : cPhysicsObject(x, y) {
+        fFriction = 0.2f;
+        radius = 16.0f;
+        bDead = false;
+        nBounceBeforeDeath = -1;
+        fShootingAngle = flipType == SDL_FLIP_NONE ? -PI : PI;
+    }
+
+    // Finds the sprites shared by all men, only needed when they are going to be drawn
+    static void findSprites(const TextureAtlas &atlas) {
+        nSpriteRegion = atlas.find("man.png");
+        nTombRegion = atlas.find("tomb-removebg.png");
+    }
+
+    bool Damage(float d) override; // Reduce worm's health by said amount
+
+    int ObjDeadAction() override;
+
+    void takeSnapshot(ObjectSnapshot &s) const override {
+        cPhysicsObject::takeSnapshot(s);
+        s.nKind = OBJECT_MAN;
+        s.bIsPlayable = bIsPlayable;
+        s.fHealth = fHealth;
+        s.nTeam = nTeam;
+        s.flipType = flipType;
+    }
+
+    OBJECT_KIND getKind() const override { return OBJECT_MAN; }
+
+    // nAnimationFrame counts the frames drawn, walking men step through spriteClips with it
+    static void draw(GameEngine *engine, const ObjectSnapshot &s, float fOffsetX, float fOffsetY,
+                     uint32_t nAnimationFrame);
+
+    float getDrawExtent() const override {
+        return std::max(radius, 24.0f); // the health bar is above the sprite
+    }
+
+};
+
+class cTeam {
+public:
+    std::vector<cMan *> vecMembers;
+    int nCurrentMember = 0;
+    int nTeamSize = 0;
+    int nAliveMembers = 0; // members with health left, counted down by cMan::Damage
+
+    bool isTeamStillAlive() const {
+        return nAliveMembers > 0;
+    }
+
+    void addMember(cMan *pMan) {
+        pMan->pTeam = this;
+        vecMembers.push_back(pMan);
+        nTeamSize = static_cast<int>(vecMembers.size());
+        nAliveMembers += pMan->fHealth > 0;
+    }
+
+    // The nuke, the men are left standing where they are
+    void wipeOut() {
+        for (auto m: vecMembers) m->fHealth = 0.0f;
+        nAliveMembers = 0;
+    }
+
+    cMan *getNextMember() {
+        do {
+            nCurrentMember++;
+            if (nCurrentMember >= nTeamSize) nCurrentMember = 0;
+        } while (vecMembers[nCurrentMember]->fHealth <= 0);
+        return vecMembers[nCurrentMember];
+    }
+};
+
+// The teams still in the match, in turn order. A team that has been wiped out is unlinked the first
+// time a turn passes it, so handing the turn on never walks over eliminated teams more than once.
+class cTurnOrder {
+private:
+    std::vector<int> vecNext;
+    std::vector<int> vecPrev;
+
+public:
+    void reset(int nTeams) {
+        vecNext.resize(nTeams);
+        vecPrev.resize(nTeams);
+        for (int t = 0; t < nTeams; t++) {
+            vecNext[t] = (t + 1) % nTeams;
+            vecPrev[t] = (t + nTeams - 1) % nTeams;
+        }
+    }
+
+    // The first team after nTeam that is still alive, nTeam itself if no other team is
+    int next(int nTeam, const std::vector<cTeam> &vecTeams) {
+        int n = vecNext[nTeam];
+        while (n != nTeam && !vecTeams[n].isTeamStillAlive()) {
+            // an unlinked team keeps its links, a turn that starts on it still finds its way back
+            vecNext[vecPrev[n]] = vecNext[n];
+            vecPrev[vecNext[n]] = vecPrev[n];
+            n = vecNext[n];
+        }
+        return n;
+    }
+};
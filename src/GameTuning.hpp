@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Physics.hpp"
+#include <string>
+
+// The constants of the physics and of the AI's turn that are worth tuning, with the values the game ships
+// with. A match keeps the tuning it was started with, every player of a network match has to use the same.
+struct GameTuning {
+    float fGravity = PHYSICS_GRAVITY;
+    float fWalkSpeed = 5.0f;          // horizontal speed of a step
+    float fJumpSpeed = 15.0f;         // upwards speed of a jump
+    float fEnergyRate = 0.75f;        // energy gained per second of energising, 1 is a full shot
+    float fTurnTime = 15.0f;          // seconds a team has for its turn
+
+    // The AI's turn, in seconds of turn time left
+    float fAIWalkUntil = 10.0f;       // walks to where the planner wants it to shoot from until then
+    float fAIJumpUntil = 9.0f;        // and jumps if it still isn't there
+    float fAIPlanUntil = 6.5f;        // the shot has to be planned by then
+    float fAIFallbackEnergy = 0.75f;  // energy of the shot fired when the planner found nothing
+
+    // Sets the constant called name (as in getNames), false for an unknown name
+    bool set(const std::string &name, float fValue) {
+        float *pValue = find(name);
+        if (pValue == nullptr) return false;
+        *pValue = fValue;
+        return true;
+    }
+
+    static const char *const *getNames(int &nNames) {
+        static const char *const NAMES[] = {"gravity", "walk-speed", "jump-speed", "energy-rate", "turn-time",
+                                            "ai-walk-until", "ai-jump-until", "ai-plan-until", "ai-fallback-energy"};
+        nNames = sizeof(NAMES) / sizeof(NAMES[0]);
+        return NAMES;
+    }
+
+private:
+    float *find(const std::string &name) {
+        float *values[] = {&fGravity, &fWalkSpeed, &fJumpSpeed, &fEnergyRate, &fTurnTime, &fAIWalkUntil,
+                           &fAIJumpUntil, &fAIPlanUntil, &fAIFallbackEnergy};
+        int nNames;
+        const char *const *names = getNames(nNames);
+        for (int i = 0; i < nNames; i++) {
+            if (name == names[i]) return values[i];
+        }
+        return nullptr;
+    }
+};
@@ -0,0 +1,315 @@
+#include "Lockstep.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+
+namespace {
+    const uint8_t PACKET_VERSION = 1;
+    const uint8_t FLAG_HASH = 1;
+    const uint8_t FLAG_LEAVING = 2;
+    const size_t MAX_PACKET_BYTES = 1400;
+    // a run takes at most 3 bytes, so a datagram of them stays well below MAX_PACKET_BYTES
+    const size_t MAX_RUNS_PER_PACKET = 256;
+    // nobody answering before the match starts is more likely someone still starting their game
+    const auto JOIN_TIMEOUT = std::chrono::seconds(60);
+    const auto TIMEOUT = std::chrono::seconds(10);
+    const auto STOP_TIMEOUT = std::chrono::seconds(2);
+
+    void putVarint(std::vector<uint8_t> &out, uint32_t nValue) {
+        while (nValue >= 0x80) {
+            out.push_back(static_cast<uint8_t>(nValue | 0x80));
+            nValue >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(nValue));
+    }
+
+    void putU32(std::vector<uint8_t> &out, uint32_t nValue) {
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(nValue >> (8 * i)));
+    }
+
+    struct Reader {
+        const uint8_t *data;
+        size_t nSize;
+        size_t nPos = 0;
+        bool bOk = true;
+
+        uint8_t u8() {
+            if (nPos >= nSize) {
+                bOk = false;
+                return 0;
+            }
+            return data[nPos++];
+        }
+
+        uint32_t u32() {
+            uint32_t nValue = 0;
+            for (int i = 0; i < 4; i++) nValue |= static_cast<uint32_t>(u8()) << (8 * i);
+            return nValue;
+        }
+
+        uint32_t varint() {
+            uint32_t nValue = 0;
+            for (int nShift = 0; nShift < 35; nShift += 7) {
+                uint8_t nByte = u8();
+                nValue |= static_cast<uint32_t>(nByte & 0x7F) << nShift;
+                if ((nByte & 0x80) == 0) return nValue;
+            }
+            bOk = false;
+            return 0;
+        }
+    };
+}
+
+cLockstep::~cLockstep() {
+    socket.close();
+}
+
+bool cLockstep::start(const LockstepConfig &config) {
+    int nPlayers = static_cast<int>(config.vecPlayers.size());
+    if (nPlayers < 2 || nPlayers > MAX_PLAYERS) {
+        std::cout << "A lockstep match needs 2 to " << MAX_PLAYERS << " players" << std::endl;
+        return false;
+    }
+    if (config.nLocalPlayer < 0 || config.nLocalPlayer >= nPlayers) {
+        std::cout << "Player " << config.nLocalPlayer << " is not one of the " << nPlayers << " players" << std::endl;
+        return false;
+    }
+    if (config.nInputDelay < 1) {
+        std::cout << "The input delay has to be at least one tick" << std::endl;
+        return false;
+    }
+    vecPlayers.assign(nPlayers, Player());
+    for (int i = 0; i < nPlayers; i++) {
+        if (!UdpAddress::parse(config.vecPlayers[i], vecPlayers[i].address)) return false;
+    }
+    if (!socket.open(vecPlayers[config.nLocalPlayer].address.nPort)) return false;
+
+    nLocalPlayer = config.nLocalPlayer;
+    nInputDelay = config.nInputDelay;
+    nSessionId = config.nSessionId;
+    // nobody can have played anything in the first ticks yet
+    for (Player &player : vecPlayers) player.vecInputs.assign(nInputDelay, 0);
+    startTime = std::chrono::steady_clock::now();
+    error.clear();
+    return true;
+}
+
+void cLockstep::stop() {
+    if (!socket.isOpen()) return;
+    // whoever is a little behind may still be waiting for our last inputs
+    auto deadline = std::chrono::steady_clock::now() + STOP_TIMEOUT;
+    while (std::chrono::steady_clock::now() < deadline) {
+        receive();
+        send(false);
+        uint32_t nOurs = static_cast<uint32_t>(vecPlayers[nLocalPlayer].vecInputs.size());
+        bool bDelivered = true;
+        for (int i = 0; i < getPlayerCount(); i++) {
+            const Player &player = vecPlayers[i];
+            if (i != nLocalPlayer && !player.bLeft && player.nAcknowledged < nOurs) bDelivered = false;
+        }
+        if (bDelivered) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    send(true);
+    socket.close();
+}
+
+int cLockstep::getPlayerCount() const {
+    return static_cast<int>(vecPlayers.size());
+}
+
+int cLockstep::getLocalPlayer() const {
+    return nLocalPlayer;
+}
+
+int cLockstep::getInputDelay() const {
+    return nInputDelay;
+}
+
+void cLockstep::setLocalInput(uint32_t nTick, uint8_t nInput) {
+    std::vector<uint8_t> &vecInputs = vecPlayers[nLocalPlayer].vecInputs;
+    if (nTick != vecInputs.size()) return;
+    vecInputs.push_back(nInput);
+}
+
+bool cLockstep::isTickReady(uint32_t nTick) {
+    receive();
+    send(false);
+    if (!isHealthy()) return false;
+
+    auto now = std::chrono::steady_clock::now();
+    bool bReady = true;
+    for (int i = 0; i < getPlayerCount(); i++) {
+        const Player &player = vecPlayers[i];
+        if (player.vecInputs.size() > nTick) continue;
+        bReady = false;
+        if (player.bLeft) {
+            fail("Player " + std::to_string(i) + " left the match");
+        } else if (player.bHeard ? now - player.lastHeard > TIMEOUT : now - startTime > JOIN_TIMEOUT) {
+            fail("Player " + std::to_string(i) + " at " + player.address.toString() + " stopped answering");
+        }
+    }
+    if (!bReady && !bWaiting) {
+        waitStart = now;
+        bWaiting = true;
+    } else if (bReady && bWaiting) {
+        waited += now - waitStart;
+        bWaiting = false;
+    }
+    return bReady;
+}
+
+uint8_t cLockstep::getInput(int nPlayer, uint32_t nTick) const {
+    const std::vector<uint8_t> &vecInputs = vecPlayers[nPlayer].vecInputs;
+    return nTick < vecInputs.size() ? vecInputs[nTick] : 0;
+}
+
+bool cLockstep::wantsStateHash(uint32_t nTick) const {
+    return nTick % HASH_INTERVAL == 0;
+}
+
+void cLockstep::addStateHash(uint32_t nTick, uint64_t nHash) {
+    StateHash &hash = localHashes[(nTick / HASH_INTERVAL) % HASH_HISTORY];
+    hash.nTick = nTick;
+    hash.nHash = static_cast<uint32_t>(nHash ^ (nHash >> 32));
+    latestHash = hash;
+    for (int i = 0; i < getPlayerCount(); i++) {
+        if (i != nLocalPlayer) compareHashes(i, nTick);
+    }
+}
+
+bool cLockstep::isHealthy() const {
+    return error.empty();
+}
+
+const std::string &cLockstep::getError() const {
+    return error;
+}
+
+void cLockstep::printStats(uint32_t nTicks, float fTickTime, std::ostream &out) const {
+    int nOthers = getPlayerCount() - 1;
+    float fSeconds = static_cast<float>(nTicks) * fTickTime;
+    if (nOthers <= 0 || fSeconds <= 0.0f) return;
+    float fBytesPerSecond = static_cast<float>(socket.getBytesSent()) / static_cast<float>(nOthers) / fSeconds;
+    float fPacketsPerSecond = static_cast<float>(socket.getDatagramsSent()) / static_cast<float>(nOthers) / fSeconds;
+    float fWaited = std::chrono::duration<float>(waited).count();
+    out << std::fixed << std::setprecision(1)
+        << "Lockstep: " << nTicks << " ticks, " << fBytesPerSecond << " B/s and " << fPacketsPerSecond
+        << " datagrams/s to each player (UDP/IP headers included), input delay " << nInputDelay << " ticks, "
+        << fWaited << " s waited for other players" << std::endl;
+}
+
+void cLockstep::receive() {
+    uint8_t buffer[MAX_PACKET_BYTES];
+    UdpAddress from;
+    int nReceived;
+    while ((nReceived = socket.receive(buffer, sizeof(buffer), from)) > 0) {
+        Reader reader{buffer, static_cast<size_t>(nReceived)};
+        if (reader.u8() != 'F' || reader.u8() != 'L' || reader.u8() != PACKET_VERSION) continue;
+        if (reader.u32() != nSessionId) continue;
+        int nPlayer = reader.u8();
+        if (!reader.bOk || nPlayer >= getPlayerCount() || nPlayer == nLocalPlayer) continue;
+        uint32_t nAcknowledged = reader.varint();
+        uint32_t nFirst = reader.varint();
+        uint32_t nRuns = reader.varint();
+        if (!reader.bOk) continue;
+
+        Player &player = vecPlayers[nPlayer];
+        std::vector<uint8_t> &vecInputs = player.vecInputs;
+        uint32_t nTick = nFirst;
+        for (uint32_t i = 0; i < nRuns && reader.bOk; i++) {
+            uint32_t nLength = reader.varint();
+            uint8_t nInput = reader.u8();
+            if (!reader.bOk || nLength > MAX_TICKS_PER_PACKET) {
+                reader.bOk = false;
+                break;
+            }
+            // only what follows on what we have, older datagrams overlap and newer ones come again
+            for (uint32_t j = 0; j < nLength; j++, nTick++) {
+                if (nTick == vecInputs.size()) vecInputs.push_back(nInput);
+            }
+        }
+        uint8_t nFlags = reader.u8();
+        StateHash hash;
+        if (reader.bOk && (nFlags & FLAG_HASH)) {
+            hash.nTick = reader.varint();
+            hash.nHash = reader.u32();
+        }
+        if (!reader.bOk) continue;
+
+        player.nAcknowledged = std::max(player.nAcknowledged, nAcknowledged);
+        player.lastHeard = std::chrono::steady_clock::now();
+        player.bHeard = true;
+        if (nFlags & FLAG_LEAVING) player.bLeft = true;
+        if (nFlags & FLAG_HASH) {
+            player.hashes[(hash.nTick / HASH_INTERVAL) % HASH_HISTORY] = hash;
+            compareHashes(nPlayer, hash.nTick);
+        }
+    }
+}
+
+void cLockstep::send(bool bLeaving) {
+    for (int i = 0; i < getPlayerCount(); i++) {
+        if (i != nLocalPlayer) sendTo(vecPlayers[i], bLeaving);
+    }
+}
+
+void cLockstep::sendTo(Player &player, bool bLeaving) {
+    const std::vector<uint8_t> &vecOurs = vecPlayers[nLocalPlayer].vecInputs;
+    uint32_t nOurs = static_cast<uint32_t>(vecOurs.size());
+    auto now = std::chrono::steady_clock::now();
+    bool bNewInputs = nOurs >= player.nSent + SEND_EVERY_TICKS;
+    bool bResend = now - player.lastSend >= std::chrono::milliseconds(RESEND_INTERVAL_MS);
+    if (!bLeaving && !bNewInputs && !bResend) return;
+
+    // everything the other one hasn't acknowledged, the inputs of a tick rarely differ from the last one
+    uint32_t nFirst = std::min(player.nAcknowledged, nOurs);
+    uint32_t nLast = std::min(nOurs, nFirst + MAX_TICKS_PER_PACKET);
+    vecPacket.clear();
+    vecPacket.push_back('F');
+    vecPacket.push_back('L');
+    vecPacket.push_back(PACKET_VERSION);
+    putU32(vecPacket, nSessionId);
+    vecPacket.push_back(static_cast<uint8_t>(nLocalPlayer));
+    putVarint(vecPacket, static_cast<uint32_t>(player.vecInputs.size()));
+    putVarint(vecPacket, nFirst);
+
+    std::vector<std::pair<uint32_t, uint8_t>> vecRuns;
+    for (uint32_t nTick = nFirst; nTick < nLast; nTick++) {
+        if (!vecRuns.empty() && vecRuns.back().second == vecOurs[nTick]) {
+            vecRuns.back().first++;
+        } else if (vecRuns.size() < MAX_RUNS_PER_PACKET) {
+            vecRuns.emplace_back(1, vecOurs[nTick]);
+        } else {
+            // the rest goes with the next datagram
+            nLast = nTick;
+        }
+    }
+    putVarint(vecPacket, static_cast<uint32_t>(vecRuns.size()));
+    for (const auto &run : vecRuns) {
+        putVarint(vecPacket, run.first);
+        vecPacket.push_back(run.second);
+    }
+
+    uint8_t nFlags = (latestHash.nTick != UINT32_MAX ? FLAG_HASH : 0) | (bLeaving ? FLAG_LEAVING : 0);
+    vecPacket.push_back(nFlags);
+    if (nFlags & FLAG_HASH) {
+        putVarint(vecPacket, latestHash.nTick);
+        putU32(vecPacket, latestHash.nHash);
+    }
+
+    socket.sendTo(player.address, vecPacket.data(), vecPacket.size());
+    player.nSent = nLast;
+    player.lastSend = now;
+}
+
+void cLockstep::compareHashes(int nPlayer, uint32_t nTick) {
+    const StateHash &ours = localHashes[(nTick / HASH_INTERVAL) % HASH_HISTORY];
+    const StateHash &theirs = vecPlayers[nPlayer].hashes[(nTick / HASH_INTERVAL) % HASH_HISTORY];
+    if (ours.nTick != nTick || theirs.nTick != nTick || ours.nHash == theirs.nHash) return;
+    fail("Desync with player " + std::to_string(nPlayer) + " at tick " + std::to_string(nTick));
+}
+
+void cLockstep::fail(const std::string &message) {
+    if (error.empty()) error = message;
+}
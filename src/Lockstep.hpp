@@ -0,0 +1,130 @@
+#pragma once
+
+#include "UdpSocket.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// What a player does in one tick, the only thing lockstep players send each other
+enum PLAYER_INPUT : uint8_t {
+    INPUT_WALK_LEFT = 1 << 0,
+    INPUT_WALK_RIGHT = 1 << 1,
+    INPUT_JUMP = 1 << 2,        // pressed in this tick
+    INPUT_AIM_LEFT = 1 << 3,
+    INPUT_AIM_RIGHT = 1 << 4,
+    INPUT_ENERGISE = 1 << 5,    // firing follows from energising, see Fauji::onSimulationTick
+    INPUT_NEXT_WEAPON = 1 << 6  // pressed in this tick
+};
+
+struct LockstepConfig {
+    int nLocalPlayer = 0;
+    std::vector<std::string> vecPlayers; // host:port of every player in player order, the local port is bound
+    int nInputDelay = 8;                 // ticks between sampling an input and running it
+    uint32_t nSessionId = 0;             // seed and setup of the match, packets of another match are dropped
+};
+
+// Deterministic lockstep over UDP: every player runs the whole simulation and only the players' inputs go
+// over the network. The input sampled in tick t is run in tick t + nInputDelay by everybody, and a tick
+// waits until every player's input for it has arrived.
+//
+// Every player sends every other player a datagram per SEND_EVERY_TICKS ticks of input (and at least every
+// RESEND_INTERVAL_MS), holding all of its inputs the other one hasn't acknowledged yet. They are run-length
+// encoded, as inputs hardly ever change from one tick to the next. Lost datagrams are made up for by the
+// next one, there are no retransmissions of their own.
+//
+// Every HASH_INTERVAL ticks the game hands over the hash of its state (see TickRecord), the latest one rides
+// along with the inputs and the other players compare it with their own hash of that tick.
+//
+// Packet, little endian:
+//   "FL" | u8 version | u32 session | u8 player | varint acknowledged inputs of the receiver
+//        | varint first tick | varint nRuns | (varint length | u8 input) per run
+//        | u8 flags (1 = hash follows, 2 = leaving) | varint hash tick | u32 hash
+class cLockstep {
+public:
+    static const int MAX_PLAYERS = 8;
+    static const int HASH_INTERVAL = 30;
+    static const int SEND_EVERY_TICKS = 5;
+    static const int RESEND_INTERVAL_MS = 100;
+    static const int MAX_TICKS_PER_PACKET = 1024;
+
+    ~cLockstep();
+
+    bool start(const LockstepConfig &config);
+
+    // Waits until everybody has every input of ours (or a moment has passed) and says goodbye
+    void stop();
+
+    int getPlayerCount() const;
+
+    int getLocalPlayer() const;
+
+    int getInputDelay() const;
+
+    // Our input for tick nTick, ticks come in order
+    void setLocalInput(uint32_t nTick, uint8_t nInput);
+
+    // Sends and receives, true once every player's input for nTick has arrived
+    bool isTickReady(uint32_t nTick);
+
+    // only for ticks that are ready
+    uint8_t getInput(int nPlayer, uint32_t nTick) const;
+
+    bool wantsStateHash(uint32_t nTick) const;
+
+    // our state after nTick
+    void addStateHash(uint32_t nTick, uint64_t nHash);
+
+    // false once the states have diverged or a player left or stopped answering, getError() says which
+    bool isHealthy() const;
+
+    const std::string &getError() const;
+
+    // what was sent to each player, per second of a match played with nTickTime
+    void printStats(uint32_t nTicks, float fTickTime, std::ostream &out) const;
+
+private:
+    struct StateHash {
+        uint32_t nTick = UINT32_MAX;
+        uint32_t nHash = 0;
+    };
+
+    static const int HASH_HISTORY = 64;
+
+    struct Player {
+        UdpAddress address;
+        std::vector<uint8_t> vecInputs;   // everything received from this player, by tick
+        uint32_t nAcknowledged = 0;       // how many of our inputs this player has
+        uint32_t nSent = 0;               // how many of our inputs went out to this player last time
+        std::chrono::steady_clock::time_point lastSend;
+        std::chrono::steady_clock::time_point lastHeard;
+        bool bHeard = false;
+        bool bLeft = false;
+        StateHash hashes[HASH_HISTORY];   // the latest hashes received, by tick / HASH_INTERVAL
+    };
+
+    UdpSocket socket;
+    std::vector<Player> vecPlayers; // the local one's vecInputs are our own inputs
+    int nLocalPlayer = 0;
+    int nInputDelay = 0;
+    uint32_t nSessionId = 0;
+    StateHash localHashes[HASH_HISTORY];
+    StateHash latestHash;
+    std::string error;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point waitStart;
+    bool bWaiting = false;
+    std::chrono::steady_clock::duration waited{}; // the game stood still for the other players this long
+    std::vector<uint8_t> vecPacket;
+
+    void receive();
+
+    void send(bool bLeaving);
+
+    void sendTo(Player &player, bool bLeaving);
+
+    void compareHashes(int nPlayer, uint32_t nTick);
+
+    void fail(const std::string &message);
+};
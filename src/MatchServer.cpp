@@ -0,0 +1,156 @@
+#include "MatchServer.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace {
+    float percentile(std::vector<float> &vecValues, float fFraction) {
+        if (vecValues.empty()) return 0.0f;
+        size_t nIndex = static_cast<size_t>(fFraction * (vecValues.size() - 1) + 0.5f);
+        std::nth_element(vecValues.begin(), vecValues.begin() + static_cast<long>(nIndex), vecValues.end());
+        return vecValues[nIndex];
+    }
+}
+
+cMatchServer::cMatchServer(int nWorkers, int nMatchesPerWorker)
+        : nWorkers(nWorkers > 0 ? nWorkers : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
+          nMatchesPerWorker(std::max(1, nMatchesPerWorker)) {}
+
+bool cMatchServer::run(const std::vector<MatchSetup> &vecSetups) {
+    pSetups = &vecSetups;
+    vecResults.assign(vecSetups.size(), MatchResult());
+    vecWorkers.assign(nWorkers, Worker());
+    nNextMatch = 0;
+    bFailed = false;
+    // the profiler's lock would be shared by every match on every core, and nobody reads it here
+    Profiler::setEnabled(false);
+    std::vector<std::thread> vecThreads;
+    auto startTime = std::chrono::steady_clock::now();
+    for (int w = 0; w < nWorkers; w++) {
+        vecThreads.emplace_back(&cMatchServer::runWorker, this, w);
+    }
+    for (auto &t: vecThreads) {
+        t.join();
+    }
+    fWallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    Profiler::setEnabled(true);
+
+    vecTickMicroseconds.clear();
+    vecWorkerMatchCounts.clear();
+    for (auto &worker: vecWorkers) {
+        vecTickMicroseconds.insert(vecTickMicroseconds.end(), worker.vecTickMicroseconds.begin(),
+                                   worker.vecTickMicroseconds.end());
+        vecWorkerMatchCounts.push_back(worker.nMatchesPlayed);
+    }
+    vecWorkers.clear();
+    pSetups = nullptr;
+    return !bFailed;
+}
+
+const std::vector<MatchResult> &cMatchServer::getResults() const {
+    return vecResults;
+}
+
+int cMatchServer::getWorkerCount() const {
+    return nWorkers;
+}
+
+int cMatchServer::getMatchesPerWorker() const {
+    return nMatchesPerWorker;
+}
+
+const std::vector<int> &cMatchServer::getWorkerMatchCounts() const {
+    return vecWorkerMatchCounts;
+}
+
+double cMatchServer::getWallSeconds() const {
+    return fWallSeconds;
+}
+
+void cMatchServer::getTickLatency(float &p50, float &p95, float &p99, float &fMax) {
+    p50 = percentile(vecTickMicroseconds, 0.50f);
+    p95 = percentile(vecTickMicroseconds, 0.95f);
+    p99 = percentile(vecTickMicroseconds, 0.99f);
+    fMax = vecTickMicroseconds.empty() ? 0.0f : *std::max_element(vecTickMicroseconds.begin(),
+                                                                  vecTickMicroseconds.end());
+}
+
+bool cMatchServer::takeMatch(ActiveMatch &match) {
+    int nMatch = nNextMatch.fetch_add(1);
+    if (nMatch >= static_cast<int>(pSetups->size()) || bFailed) {
+        return false;
+    }
+    const MatchSetup &setup = (*pSetups)[nMatch];
+    // created on the worker thread, so its objects come out of that thread's pool
+    auto fauji = std::make_unique<Fauji>(true);
+    fauji->setFixedTimestep(1.0f / 60.0f);
+    fauji->setSeed(setup.nSeed);
+    fauji->setTuning(setup.tuning);
+    fauji->setAllTeamsAI(true);
+    // planned on the worker's own thread, the worker is the only thread of its core
+    fauji->setDeterministicAI(true);
+    fauji->setAIThreadCount(1);
+    fauji->setAIShotBudget(setup.nAIShotBudget);
+    fauji->setMaxTicks(setup.nMaxTicks);
+    if (!fauji->setTeams(setup.nTeams, setup.nTeamSize) || !fauji->startSimulation()) {
+        std::cout << "Unable to start match " << nMatch << std::endl;
+        bFailed = true;
+        return false;
+    }
+    match.nMatch = nMatch;
+    match.fauji = std::move(fauji);
+    match.time = {};
+    return true;
+}
+
+void cMatchServer::finishMatch(ActiveMatch &match) {
+    TickRecord record;
+    match.fauji->captureTickState(record);
+    MatchResult &result = vecResults[match.nMatch];
+    result.nTicks = match.fauji->getTick();
+    result.nFinalHash = record.nHash;
+    result.stats = match.fauji->getMatchStats();
+    result.fSeconds = std::chrono::duration<double>(match.time).count();
+    match.fauji.reset();
+}
+
+void cMatchServer::runWorker(int nWorker) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(nWorker % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+    Worker &worker = vecWorkers[nWorker];
+    std::vector<ActiveMatch> vecActive;
+    for (int i = 0; i < nMatchesPerWorker; i++) {
+        ActiveMatch match;
+        if (!takeMatch(match)) break;
+        vecActive.push_back(std::move(match));
+    }
+    worker.vecTickMicroseconds.reserve(static_cast<size_t>(nMatchesPerWorker) * 4096);
+    while (!vecActive.empty()) {
+        for (size_t i = 0; i < vecActive.size();) {
+            ActiveMatch &match = vecActive[i];
+            auto tickStart = std::chrono::steady_clock::now();
+            bool bContinue = match.fauji->stepSimulation();
+            auto tickTime = std::chrono::steady_clock::now() - tickStart;
+            match.time += tickTime;
+            worker.vecTickMicroseconds.push_back(std::chrono::duration<float, std::micro>(tickTime).count());
+            if (bContinue) {
+                i++;
+                continue;
+            }
+            finishMatch(match);
+            worker.nMatchesPlayed++;
+            if (!takeMatch(match)) {
+                vecActive.erase(vecActive.begin() + static_cast<long>(i));
+            }
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Fauji.hpp"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// One headless AI-vs-AI match to play
+struct MatchSetup {
+    uint64_t nSeed = 1;
+    int nTeams = 2;
+    int nTeamSize = 2;
+    int nMaxTicks = 36000; // ten minutes at 60 ticks per second, most matches are decided much sooner
+    int nAIShotBudget = 128; // simulated shots per AI plan, 0 lets the planner search to the end
+    GameTuning tuning;
+};
+
+struct MatchResult {
+    uint32_t nTicks = 0;
+    uint64_t nFinalHash = 0; // of the state the match ended in, see TickRecord
+    MatchStats stats;
+    double fSeconds = 0.0;   // spent running its ticks
+};
+
+// Plays many independent matches at once. Every match is a headless Fauji of its own with its own rng and
+// its own input queue (GameEngine::getInput, pushEvent may be called from any thread), so the matches share
+// nothing but the process.
+//
+// Scheduling is thread per core: every worker is pinned to a core and keeps up to nMatchesPerWorker matches
+// going, running one tick of each in turn. A worker whose match ended takes the next one nobody has started.
+// The time of every single tick is kept for the tick latency percentiles.
+class cMatchServer {
+public:
+    // nWorkers 0 for one per hardware thread
+    cMatchServer(int nWorkers, int nMatchesPerWorker);
+
+    // Plays every match, false if one of them could not be started
+    bool run(const std::vector<MatchSetup> &vecSetups);
+
+    // in the order of the setups
+    const std::vector<MatchResult> &getResults() const;
+
+    int getWorkerCount() const;
+
+    int getMatchesPerWorker() const;
+
+    // matches each worker played
+    const std::vector<int> &getWorkerMatchCounts() const;
+
+    double getWallSeconds() const;
+
+    // in microseconds, over every tick of every match
+    void getTickLatency(float &p50, float &p95, float &p99, float &fMax);
+
+private:
+    struct ActiveMatch {
+        int nMatch = 0;
+        std::unique_ptr<Fauji> fauji;
+        std::chrono::steady_clock::duration time{};
+    };
+
+    struct Worker {
+        std::vector<float> vecTickMicroseconds;
+        int nMatchesPlayed = 0;
+    };
+
+    int nWorkers;
+    int nMatchesPerWorker;
+    const std::vector<MatchSetup> *pSetups = nullptr;
+    std::vector<MatchResult> vecResults; // every match is written by one worker only
+    std::vector<Worker> vecWorkers;
+    std::vector<int> vecWorkerMatchCounts;
+    std::vector<float> vecTickMicroseconds;
+    std::atomic<int> nNextMatch{0};
+    std::atomic<bool> bFailed{false};
+    double fWallSeconds = 0.0;
+
+    void runWorker(int nWorker);
+
+    // false once there are no matches left to start
+    bool takeMatch(ActiveMatch &match);
+
+    void finishMatch(ActiveMatch &match);
+};
@@ -0,0 +1,17 @@
+#include "Materials.hpp"
+
+namespace {
+    // Tune the materials here. Soil is what all land was before there were materials, it changes nothing.
+    const MaterialInfo MATERIALS[MATERIAL_COUNT] = {
+            // name     hardness friction falls  slides color
+            {"Sky",     0.0f,    1.0f,    false, false, {0x00, 0xFF, 0xFF}},
+            {"Soil",    1.0f,    1.0f,    true,  true,  {0x00, 0x64, 0x00}},
+            {"Rock",    2.0f,    1.15f,   true,  false, {0x70, 0x70, 0x70}},
+            {"Bedrock", 0.0f,    1.2f,    false, false, {0x30, 0x30, 0x38}},
+            {"Sand",    0.6f,    0.5f,    true,  true,  {0xC2, 0xB2, 0x80}},
+    };
+}
+
+const MaterialInfo &getMaterialInfo(uint8_t nMaterial) {
+    return MATERIALS[nMaterial < MATERIAL_COUNT ? nMaterial : MATERIAL_SOIL];
+}
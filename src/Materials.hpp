@@ -0,0 +1,27 @@
+#pragma once
+
+#include "SimpleGameEngine.hpp"
+#include <cstdint>
+
+// What a pixel of the map is made of, the map holds one of these a pixel. Anything but sky is land.
+enum MATERIAL : uint8_t {
+    MATERIAL_SKY = 0,
+    MATERIAL_SOIL,
+    MATERIAL_ROCK,
+    MATERIAL_BEDROCK,
+    MATERIAL_SAND,
+    MATERIAL_COUNT
+};
+
+// How a material takes explosions, what bounces off it and how it settles, and what it looks like
+struct MaterialInfo {
+    const char *name;
+    float fHardness;  // a crater of radius r reaches r / fHardness into it, 0 for a material no crater touches
+    float fFriction;  // scales the friction of a body bouncing off it
+    bool bFalls;      // falls when there is sky under it (see cTerrainSettler)
+    bool bSlides;     // and slides down to the side when there isn't
+    Color color;
+};
+
+// values the map doesn't know are soil
+const MaterialInfo &getMaterialInfo(uint8_t nMaterial);
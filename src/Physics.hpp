@@ -0,0 +1,273 @@
+#pragma once
+
+#include "Materials.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Read-only view of the terrain bitmap (0 = sky, anything else = land).
+// Physics only ever reads the map through this, so the same integration code can run
+// against the live map or against a private copy on another thread.
+struct TerrainView {
+    const unsigned char *map = nullptr;
+    int nWidth = 0;
+    int nHeight = 0;
+    // Optional, topmost solid row of every column (nHeight if the column is empty).
+    // When present, bodies that are clearly above the terrain skip the collision test entirely.
+    const int *pColumnTop = nullptr;
+
+    // True if a circle at (x, y) with radius r can't touch any land, only answers when pColumnTop is set
+    bool isClearlyInSky(float x, float y, float r) const {
+        if (pColumnTop == nullptr) return false;
+        int x1 = static_cast<int>(x - r) - 1;
+        int x2 = static_cast<int>(x + r) + 1;
+        // clamped like the samples, a body off the side of the map is tested against the edge column
+        if (x1 < 0) x1 = 0;
+        if (x1 >= nWidth) x1 = nWidth - 1;
+        if (x2 >= nWidth) x2 = nWidth - 1;
+        if (x2 < 0) x2 = 0;
+        float fBottom = y + r + 1.0f;
+        for (int i = x1; i <= x2; i++) {
+            if (fBottom >= pColumnTop[i]) return false;
+        }
+        return true;
+    }
+
+    // x and y must already be clamped to the map
+    unsigned char at(float x, float y) const {
+        return map[static_cast<int>(std::round(y)) * nWidth + static_cast<int>(std::round(x))];
+    }
+};
+
+// Fills vecColumnTop with the topmost solid row of every column of the terrain, for TerrainView::pColumnTop
+inline void buildColumnTops(const TerrainView &terrain, std::vector<int> &vecColumnTop) {
+    vecColumnTop.assign(terrain.nWidth, terrain.nHeight);
+    // walk the rows top down, so every column is settled as soon as its first land pixel shows up
+    int nUnsettled = terrain.nWidth;
+    for (int y = 0; y < terrain.nHeight && nUnsettled > 0; y++) {
+        const unsigned char *row = terrain.map + y * terrain.nWidth;
+        for (int x = 0; x < terrain.nWidth; x++) {
+            if (row[x] != 0 && vecColumnTop[x] == terrain.nHeight) {
+                vecColumnTop[x] = y;
+                nUnsettled--;
+            }
+        }
+    }
+}
+
+const float PHYSICS_PI = 3.14159f;
+const float PHYSICS_GRAVITY = 2.0f;
+
+// Advances one body by a single physics sub-step: applies gravity and forces, tests the semicircle
+// in the direction of motion against the terrain and reflects the velocity off the contact normal.
+// Body is anything with the cPhysicsObject state fields (px, py, vx, vy, ax, ay, radius, bStable,
+// fFriction, nBounceBeforeDeath, bDead).
+// Returns true if the body ran out of bounces on this step, the caller decides what that means
+// (explode, despawn, score a shot, ...).
+template<typename Body>
+bool stepPhysicsBody(Body &obj, const TerrainView &terrain, float fElapsedTime, float fGravity = PHYSICS_GRAVITY) {
+    // apply gravity
+    obj.ay += fGravity;
+    // update velocity
+    obj.vx += obj.ax * fElapsedTime;
+    obj.vy += obj.ay * fElapsedTime;
+
+    // update positions
+    float fPotentialX = obj.px + obj.vx * fElapsedTime;
+    float fPotentialY = obj.py + obj.vy * fElapsedTime;
+
+    // reset forces after applying them
+    obj.ay = 0;
+    obj.ax = 0;
+    obj.bStable = false;
+
+    // Collision check with map
+    float fResponseX = 0;
+    float fResponseY = 0;
+    float fMaterialFriction = 0; // summed over the samples that hit land
+    int nContacts = 0;
+    bool bCollision = false;
+    // Bodies high up in the sky can't touch anything, don't bother sampling
+    if (!terrain.isClearlyInSky(fPotentialX, fPotentialY, obj.radius)) {
+        float fAngle = std::atan2(obj.vy, obj.vx);
+        // Iterate through the semicircle in direction of motion
+        for (float r = fAngle - PHYSICS_PI / 2.0f; r < fAngle + PHYSICS_PI / 2.0f; r += PHYSICS_PI / 8.0f) {
+            float fTestPosX = obj.radius * std::cos(r) + fPotentialX;
+            float fTestPosY = obj.radius * std::sin(r) + fPotentialY;
+            // clamp the boundaries
+            if (fTestPosX >= terrain.nWidth) fTestPosX = terrain.nWidth - 1;
+            if (fTestPosY >= terrain.nHeight) fTestPosY = terrain.nHeight - 1;
+            if (fTestPosX < 0) fTestPosX = 0;
+            if (fTestPosY < 0) fTestPosY = 0;
+
+            // check if map collides at test position
+            unsigned char nMaterial = terrain.at(fTestPosX, fTestPosY);
+            if (nMaterial != MATERIAL_SKY) {
+                // Accumulate the collision vectors to create a response vector
+                // the final response vector will be normal to the areas of contact
+                fResponseX += fPotentialX - fTestPosX;
+                fResponseY += fPotentialY - fTestPosY;
+                fMaterialFriction += getMaterialInfo(nMaterial).fFriction;
+                nContacts++;
+                bCollision = true;
+            }
+        }
+    }
+    float fMagVelocity = std::sqrt(obj.vx * obj.vx + obj.vy * obj.vy); // |d|
+    float fMagResponse = std::sqrt(fResponseX * fResponseX + fResponseY * fResponseY); // |n|
+
+    bool bDiedThisStep = false;
+    if (bCollision) {
+        obj.bStable = true;
+
+        // reflection equation, where d is the impact vector (velocity), and n is normal to the surface which is normalised (response vector)
+        // 𝑟=𝑑−2(𝑑⋅𝑛)𝑛
+        float fDdotN = obj.vx * (fResponseX / fMagResponse) + obj.vy * (fResponseY / fMagResponse);
+        // rock gives more of a bounce than soil, sand less, by what the body touches
+        float fFriction = obj.fFriction * (fMaterialFriction / nContacts);
+        obj.vx = fFriction * (obj.vx - 2.0f * fDdotN * fResponseX / fMagResponse);
+        obj.vy = fFriction * (obj.vy - 2.0f * fDdotN * fResponseY / fMagResponse);
+
+        if (obj.nBounceBeforeDeath > 0) {
+            (obj.nBounceBeforeDeath)--;
+            obj.bDead = obj.nBounceBeforeDeath == 0; // object is dead if no more bounces left
+            bDiedThisStep = obj.bDead;
+        }
+    } else {
+        // we let an object update its position only when it is not colliding
+        obj.px = fPotentialX;
+        obj.py = fPotentialY;
+    }
+    // Turn off movement when tiny
+    if (fMagVelocity < 0.4f) obj.bStable = true;
+    return bDiedThisStep;
+}
+
+// Damage BOOM() deals to a body whose centre is fDist away from an explosion of radius fRadius
+inline float explosionDamage(float fDist, float fRadius) {
+    if (fDist < 0.001f) fDist = 0.001f;
+    if (fDist >= fRadius) return 0.0f;
+    return ((fRadius - fDist) / fRadius) * 0.8f;
+}
+
+// How far a crater of radius r reaches into nMaterial, 0 for not at all
+inline int getCraterReach(int r, uint8_t nMaterial) {
+    float fHardness = getMaterialInfo(nMaterial).fHardness;
+    if (r <= 0 || fHardness <= 0.0f) return 0;
+    return static_cast<int>(static_cast<float>(r) / fHardness);
+}
+
+// The furthest a crater of radius r reaches into any material, what it carves is within that of its centre
+inline int getCraterReach(int r) {
+    int nReach = 0;
+    for (int m = MATERIAL_SKY + 1; m < MATERIAL_COUNT; m++) nReach = std::max(nReach, getCraterReach(r, m));
+    return nReach;
+}
+
+// Turns the land a crater of radius r around (xc, yc) reaches into sky: the disc of radius
+// getCraterReach(r, m) of every material m. The crater BOOM() blows (and a spectator stream replays).
+// Returns the land pixels that were carved if bCount, counting them costs a little, and 0 otherwise.
+template<bool bCount = false>
+inline int carveCrater(unsigned char *map, int nWidth, int nHeight, int xc, int yc, int r) {
+    static_assert(MATERIAL_SKY == 0 && MATERIAL_SOIL == 1, "a byte above 1 is land other than soil");
+    // Every row of the disc of a material spans [xc - half, xc + half), with the half widths of the scan-lines
+    // the midpoint circle algorithm (taken from wikipedia) draws for its reach. A row of vecHalf holds those of
+    // every material, then of the values that aren't a material (as soil), then the widest. The few radii the
+    // weapons have come one after another, the table of the last is kept.
+    const int SLOT_OTHER = MATERIAL_COUNT;
+    const int SLOT_WIDEST = MATERIAL_COUNT + 1;
+    const int nSlots = MATERIAL_COUNT + 2;
+    thread_local std::vector<int> vecHalf;
+    thread_local int nHalfRadius = 0;
+    thread_local int nMaxReach = 0;
+    if (nHalfRadius != r) {
+        nHalfRadius = r;
+        nMaxReach = getCraterReach(r);
+        vecHalf.assign((nMaxReach + 1) * nSlots, 0);
+        for (int m = MATERIAL_SKY + 1; m < MATERIAL_COUNT; m++) {
+            int nReach = getCraterReach(r, m);
+            int x = 0;
+            int y = nReach;
+            int p = 3 - 2 * nReach;
+            while (nReach > 0 && y >= x) {
+                int &nHalfY = vecHalf[y * nSlots + m];
+                int &nHalfX = vecHalf[x * nSlots + m];
+                nHalfY = std::max(nHalfY, x);
+                nHalfX = std::max(nHalfX, y);
+                if (p < 0) p += 4 * x++ + 6;
+                else p += 4 * (x++ - y--) + 10;
+            }
+        }
+        for (int dy = 0; dy <= nMaxReach; dy++) {
+            int *half = vecHalf.data() + dy * nSlots;
+            half[SLOT_OTHER] = half[MATERIAL_SOIL];
+            half[SLOT_WIDEST] = *std::max_element(half, half + SLOT_WIDEST);
+        }
+    }
+    if (nMaxReach <= 0) return 0;
+
+    // Most land is soil: a row of only sky and soil has just soil's span carved, 8 pixels at a time. The pixels
+    // of other materials go by their own spans one at a time.
+    const uint64_t OTHER_BITS = 0xFEFEFEFEFEFEFEFEULL;
+    int nCarved = 0;
+    const int *half = nullptr; // of the row
+    // whether any of the pixels from xFrom to xTo isn't sky or soil
+    auto hasOther = [&](const unsigned char *row, int xFrom, int xTo) {
+        uint64_t nWord;
+        uint64_t nAny = 0;
+        int nx = xFrom;
+        for (; nx + 8 <= xTo; nx += 8) {
+            memcpy(&nWord, row + nx, sizeof(nWord));
+            nAny |= nWord;
+        }
+        if (nx < xTo) {
+            // the pixels left over are looked at with the 8 that end with them, or start with them at the left edge
+            int nLoad = xTo >= 8 ? xTo - 8 : nx;
+            if (nLoad + 8 > nWidth) return true;
+            memcpy(&nWord, row + nLoad, sizeof(nWord));
+            nAny |= nWord;
+        }
+        return (nAny & OTHER_BITS) != 0;
+    };
+    auto carveSoil = [&](unsigned char *row, int xFrom, int xTo) {
+        uint64_t nWord;
+        int nx = xFrom;
+        for (; nx + 8 <= xTo; nx += 8) {
+            memcpy(&nWord, row + nx, sizeof(nWord));
+            // the soil pixels are the bytes of 1, the top byte of the product sums them up
+            if (bCount) nCarved += static_cast<int>((nWord * 0x0101010101010101ULL) >> 56);
+            memset(row + nx, MATERIAL_SKY, sizeof(nWord));
+        }
+        for (; nx < xTo; nx++) {
+            if (bCount) nCarved += row[nx];
+            row[nx] = MATERIAL_SKY;
+        }
+    };
+    auto carvePixels = [&](unsigned char *row, int xFrom, int xTo) {
+        for (int nx = xFrom; nx < xTo; nx++) {
+            unsigned char nMaterial = row[nx];
+            int nHalf = half[nMaterial < MATERIAL_COUNT ? nMaterial : SLOT_OTHER];
+            // sky has no span, it isn't counted
+            if (static_cast<unsigned>(nx - xc + nHalf) < static_cast<unsigned>(2 * nHalf)) {
+                row[nx] = MATERIAL_SKY;
+                if (bCount) nCarved++;
+            }
+        }
+    };
+    int y0 = std::max(yc - nMaxReach, 0);
+    int y1 = std::min(yc + nMaxReach, nHeight - 1);
+    for (int ny = y0; ny <= y1; ny++) {
+        half = vecHalf.data() + std::abs(ny - yc) * nSlots;
+        unsigned char *row = map + ny * nWidth;
+        int x0 = std::max(xc - half[SLOT_WIDEST], 0);
+        int x1 = std::min(xc + half[SLOT_WIDEST], nWidth);
+        if (hasOther(row, x0, x1)) {
+            carvePixels(row, x0, x1);
+        } else {
+            carveSoil(row, std::max(xc - half[MATERIAL_SOIL], x0), std::min(xc + half[MATERIAL_SOIL], x1));
+        }
+    }
+    return nCarved;
+}
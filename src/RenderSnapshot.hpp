@@ -0,0 +1,67 @@
+#pragma once
+
+#include <SDL.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum OBJECT_KIND {
+    OBJECT_DEBRIS = 0,
+    OBJECT_MISSILE,
+    OBJECT_MAN
+};
+
+// What drawing needs of one cPhysicsObject
+struct ObjectSnapshot {
+    OBJECT_KIND nKind = OBJECT_DEBRIS;
+    float px = 0.0f;
+    float py = 0.0f;
+    float vx = 0.0f;
+    float vy = 0.0f;
+    float radius = 0.0f;
+    float fDrawExtent = 0.0f; // see cPhysicsObject::getDrawExtent
+    int nWeapon = 0;          // missiles only, a WEAPON
+    // men only
+    bool bIsPlayable = true;
+    float fHealth = 0.0f;
+    int nTeam = 0;
+    SDL_RendererFlip flipType = SDL_FLIP_NONE;
+};
+
+// A part of the terrain that changed
+struct TerrainRect {
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+// Everything Fauji::onFrameUpdate draws, copied out of the simulation after its ticks and handed to the
+// renderer through a TripleBuffer, so that drawing never looks at state a tick is changing. The buffers are
+// reused, after the first few snapshots publishing one doesn't allocate.
+struct RenderSnapshot {
+    uint32_t nTick = 0;
+    float fCameraPosX = 0.0f;
+    float fCameraPosY = 0.0f;
+    std::vector<ObjectSnapshot> vecObjects;
+
+    // the HUD, only drawn while somebody is in control
+    bool bHasControlledMan = false;
+    float fManX = 0.0f;
+    float fManY = 0.0f;
+    float fShootingAngle = 0.0f;
+    float fEnergyLevel = 0.0f;
+    bool bShowCountDown = false;
+    float fTurnTime = 0.0f;
+    std::string gameOverMessage;
+    bool bShowNukeAnimation = false;
+    int planePosX = 0;
+    bool bShowWeapon = false; // the player's turn, the weapon the player fires next is shown
+    int nSelectedWeapon = 0;
+
+    // A copy of the map, only the rects that changed since this buffer was last written are copied again
+    int nMapWidth = 0;
+    int nMapHeight = 0;
+    std::vector<unsigned char> vecMap;
+    uint32_t nTerrainVersion = 0; // Fauji::nTerrainVersion when vecMap was brought up to date
+};
@@ -0,0 +1,200 @@
+#include "ShotSolver.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+    // The missile state, cMissile without the drawing and virtual dispatch
+    struct SimMissile {
+        float px = 0.0f;
+        float py = 0.0f;
+        float vx = 0.0f;
+        float vy = 0.0f;
+        float ax = 0.0f;
+        float ay = 0.0f;
+        float radius = 5.0f;
+        bool bStable = false;
+        float fFriction = 0.5f;
+        int nBounceBeforeDeath = 1;
+        bool bDead = false;
+    };
+
+    float damageAt(const ShotBody &body, float fX, float fY, float fRadius) {
+        if (body.fHealth <= 0.0f) return 0.0f;
+        float dx = body.px - fX;
+        float dy = body.py - fY;
+        float fDamage = explosionDamage(std::sqrt(dx * dx + dy * dy), fRadius);
+        // a unit can't lose more health than it has
+        return std::min(fDamage, body.fHealth);
+    }
+
+    // the damage a blast does to the bodies (sorted by px) that are close enough to feel it
+    float damageAt(const std::vector<ShotBody> &vecBodies, float fX, float fY, float fRadius) {
+        auto it = std::lower_bound(vecBodies.begin(), vecBodies.end(), fX - fRadius,
+                                   [](const ShotBody &body, float x) { return body.px < x; });
+        float fDamage = 0.0f;
+        for (; it != vecBodies.end() && it->px <= fX + fRadius; ++it) {
+            fDamage += damageAt(*it, fX, fY, fRadius);
+        }
+        return fDamage;
+    }
+
+    // Orders results by score, equal scores are broken by the shot itself so the pick
+    // doesn't depend on which worker thread happened to evaluate it
+    bool isBetter(const ShotResult &a, const ShotResult &b) {
+        if (a.fScore != b.fScore) return a.fScore > b.fScore;
+        if (a.shot.fAngle != b.shot.fAngle) return a.shot.fAngle < b.shot.fAngle;
+        return a.shot.fEnergy < b.shot.fEnergy;
+    }
+}
+
+cShotSolver::cShotSolver(int nThreads) {
+    setThreadCount(nThreads);
+}
+
+void cShotSolver::setThreadCount(int nThreads) {
+    this->nThreads = nThreads;
+    if (this->nThreads <= 0) {
+        this->nThreads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    if (this->nThreads <= 0) {
+        this->nThreads = 1;
+    }
+}
+
+int cShotSolver::getThreadCount() const { return nThreads; }
+
+int cShotSolver::getLastEvaluatedCount() const { return nLastEvaluated; }
+
+std::vector<ShotCandidate> cShotSolver::makeCandidateGrid(bool bFacingRight, int nAngles, int nEnergies,
+                                                          float fMinEnergy, float fMaxEnergy) {
+    std::vector<ShotCandidate> vecCandidates;
+    vecCandidates.reserve(nAngles * nEnergies);
+    // from almost straight up to slightly downwards, in the right facing half plane (y grows downwards)
+    const float fMinAngle = -PHYSICS_PI / 2.0f + 0.05f;
+    const float fMaxAngle = PHYSICS_PI / 8.0f;
+    for (int a = 0; a < nAngles; a++) {
+        float fAngle = fMinAngle + (fMaxAngle - fMinAngle) * (nAngles > 1 ? (float) a / (float) (nAngles - 1) : 0.5f);
+        if (!bFacingRight) {
+            // mirror around the vertical axis and bring it back into (-PI, PI]
+            fAngle = PHYSICS_PI - fAngle;
+            if (fAngle > PHYSICS_PI) fAngle -= 2.0f * PHYSICS_PI;
+        }
+        for (int e = 0; e < nEnergies; e++) {
+            float fEnergy = fMinEnergy +
+                            (fMaxEnergy - fMinEnergy) * (nEnergies > 1 ? (float) e / (float) (nEnergies - 1) : 1.0f);
+            vecCandidates.push_back({fAngle, fEnergy});
+        }
+    }
+    return vecCandidates;
+}
+
+ShotResult cShotSolver::simulateShot(const TerrainView &terrain, const ShotParams &params, const ShotCandidate &shot) {
+    SimMissile missile;
+    missile.px = params.fOriginX;
+    missile.py = params.fOriginY;
+    missile.vx = params.fMagFireVelocity * shot.fEnergy * std::cos(shot.fAngle);
+    missile.vy = params.fMagFireVelocity * shot.fEnergy * std::sin(shot.fAngle);
+    missile.radius = params.fMissileRadius;
+    missile.fFriction = params.fMissileFriction;
+
+    ShotResult result;
+    result.shot = shot;
+    for (int i = 0; i < params.nMaxSteps; i++) {
+        if (stepPhysicsBody(missile, terrain, params.fStepTime, params.fGravity)) {
+            result.bExploded = true;
+            break;
+        }
+    }
+    result.fImpactX = missile.px;
+    result.fImpactY = missile.py;
+    if (!result.bExploded) {
+        return result; // fScore stays at -INFINITY
+    }
+
+    result.fTargetDamage = damageAt(params.target, missile.px, missile.py, params.fBlastRadius);
+    float fEnemyDamage = damageAt(params.vecEnemies, missile.px, missile.py, params.fBlastRadius);
+    result.fFriendlyDamage = damageAt(params.vecFriends, missile.px, missile.py, params.fBlastRadius);
+
+    // distance to the target breaks ties between shots that miss, so the AI at least lands close
+    float dx = missile.px - params.target.px;
+    float dy = missile.py - params.target.py;
+    float fMissDistance = std::sqrt(dx * dx + dy * dy);
+    result.fScore = result.fTargetDamage + params.fEnemyWeight * fEnemyDamage -
+                    params.fFriendlyFireWeight * result.fFriendlyDamage - fMissDistance * 0.0001f;
+    return result;
+}
+
+ShotResult cShotSolver::solve(const TerrainView &terrain, const ShotParams &params,
+                              const std::vector<ShotCandidate> &vecCandidates,
+                              std::chrono::steady_clock::duration budget, int nMaxShots) {
+    const int nCandidates = static_cast<int>(vecCandidates.size());
+    const int nToEvaluate = std::min(nCandidates, nMaxShots);
+    nLastEvaluated = 0;
+    if (nToEvaluate <= 0) {
+        return {};
+    }
+    auto deadline = std::chrono::steady_clock::now() + budget;
+
+    // missiles spend most of their flight high above the ground, let them skip the collision samples there
+    TerrainView skyTerrain = terrain;
+    if (skyTerrain.pColumnTop == nullptr) {
+        buildColumnTops(terrain, vecColumnTop);
+        skyTerrain.pColumnTop = vecColumnTop.data();
+    }
+
+    // Visit the candidates with a stride that is coprime to their count, so if the deadline or nMaxShots cuts the
+    // search short, the evaluated shots are still spread over the whole grid instead of covering only the first angles
+    int nStride = std::max(1, static_cast<int>(nCandidates * 0.618f));
+    auto gcd = [](int a, int b) {
+        while (b != 0) {
+            int t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    };
+    while (gcd(nStride, nCandidates) != 1) nStride++;
+
+    std::atomic<int> nNext(0);
+    std::atomic<int> nEvaluated(0);
+    int nWorkers = std::min(nThreads, nToEvaluate);
+    std::vector<ShotResult> vecBest(nWorkers);
+
+    auto worker = [&](int w) {
+        if (w > 0) TRACE_THREAD_NAME("shot solver");
+        TRACE_SCOPE("solve shots");
+        ShotResult best;
+        while (std::chrono::steady_clock::now() < deadline) {
+            int k = nNext.fetch_add(1, std::memory_order_relaxed);
+            if (k >= nToEvaluate) break;
+            const ShotCandidate &shot = vecCandidates[(static_cast<long long>(k) * nStride) % nCandidates];
+            ShotResult result = simulateShot(skyTerrain, params, shot);
+            nEvaluated.fetch_add(1, std::memory_order_relaxed);
+            if (isBetter(result, best)) {
+                best = result;
+            }
+        }
+        vecBest[w] = best;
+    };
+
+    std::vector<std::thread> vecThreads;
+    for (int w = 1; w < nWorkers; w++) {
+        vecThreads.emplace_back(worker, w);
+    }
+    // the calling thread does its share of the work too
+    worker(0);
+    for (auto &t: vecThreads) {
+        t.join();
+    }
+
+    nLastEvaluated = nEvaluated.load();
+    ShotResult best;
+    for (auto &r: vecBest) {
+        if (isBetter(r, best)) {
+            best = r;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Physics.hpp"
+#include <chrono>
+#include <climits>
+#include <vector>
+
+// A unit the solver has to care about when scoring an explosion
+struct ShotBody {
+    float px = 0.0f;
+    float py = 0.0f;
+    float fHealth = 0.0f;
+};
+
+struct ShotCandidate {
+    float fAngle = 0.0f;  // shooting angle, same convention as cMan::fShootingAngle
+    float fEnergy = 0.0f; // energy level in [0, 1], same as Fauji::fEnergyLevel
+};
+
+struct ShotResult {
+    ShotCandidate shot;
+    float fScore = -INFINITY;
+    float fTargetDamage = 0.0f;
+    float fFriendlyDamage = 0.0f;
+    float fImpactX = 0.0f;
+    float fImpactY = 0.0f;
+    bool bExploded = false; // false if the missile was still flying when the step limit ran out
+};
+
+// Everything needed to simulate a missile, mirrors what Fauji does when it fires one
+struct ShotParams {
+    float fOriginX = 0.0f;
+    float fOriginY = 0.0f;
+    float fMagFireVelocity = 40.0f;
+    float fMissileRadius = 5.0f;
+    float fMissileFriction = 0.5f;
+    float fBlastRadius = 30.0f;
+    float fStepTime = 1.0f / 60.0f; // duration of one physics sub-step
+    float fGravity = PHYSICS_GRAVITY;
+    int nMaxSteps = 2000;
+
+    ShotBody target;
+    // Both sorted by px, a blast only looks at the bodies within fBlastRadius of it
+    std::vector<ShotBody> vecEnemies; // other opponents, hitting them is a bonus
+    std::vector<ShotBody> vecFriends; // own team including the shooter
+
+    float fEnemyWeight = 0.5f;
+    float fFriendlyFireWeight = 1.5f;
+};
+
+// Runs many candidate shots through the game's missile physics against a terrain snapshot
+// and picks the one with the best expected outcome.
+// Candidates are spread over worker threads, every worker stops picking up new candidates once
+// the deadline has passed, so the solver always returns within the budget (plus one shot).
+// nMaxShots caps the candidates evaluated independently of the clock, the capped search still
+// covers the whole grid and always evaluates the same candidates.
+class cShotSolver {
+public:
+    explicit cShotSolver(int nThreads = 0);
+
+    // Grid of angles over the half plane the shooter is facing, crossed with energy levels
+    static std::vector<ShotCandidate> makeCandidateGrid(bool bFacingRight, int nAngles, int nEnergies,
+                                                        float fMinEnergy = 0.2f, float fMaxEnergy = 1.0f);
+
+    // Simulates a single shot, usable without the thread pool
+    static ShotResult simulateShot(const TerrainView &terrain, const ShotParams &params, const ShotCandidate &shot);
+
+    ShotResult solve(const TerrainView &terrain, const ShotParams &params,
+                     const std::vector<ShotCandidate> &vecCandidates,
+                     std::chrono::steady_clock::duration budget, int nMaxShots = INT_MAX);
+
+    // 0 uses every hardware thread. The best shot doesn't depend on the thread count as long as
+    // the budget is large enough to evaluate every candidate.
+    void setThreadCount(int nThreads);
+
+    int getThreadCount() const;
+
+    // number of candidates evaluated by the last call to solve
+    int getLastEvaluatedCount() const;
+
+private:
+    int nThreads;
+    int nLastEvaluated = 0;
+    std::vector<int> vecColumnTop;
+};
@@ -0,0 +1,47 @@
+#include "SimulationState.hpp"
+
+void cTerrainChunks::markChanged(int x, int y, int w, int h) {
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + w, nMapWidth);
+    int y1 = std::min(y + h, nMapHeight);
+    if (x0 >= x1 || y0 >= y1) return;
+    for (int cy = y0 / CHUNK_SIZE; cy <= (y1 - 1) / CHUNK_SIZE; cy++) {
+        for (int cx = x0 / CHUNK_SIZE; cx <= (x1 - 1) / CHUNK_SIZE; cx++) {
+            vecDirty[cy * nChunksX + cx] = 1;
+        }
+    }
+}
+
+void cTerrainChunks::save(const unsigned char *map, int nWidth, int nHeight, std::vector<Chunk> &vecChunks) {
+    resize(nWidth, nHeight);
+    for (int c = 0; c < static_cast<int>(vecCurrent.size()); c++) {
+        if (!vecDirty[c] && vecCurrent[c] != nullptr) continue;
+        int x, y, w, h;
+        getChunkRect(c, x, y, w, h);
+        auto chunk = std::make_shared<std::vector<unsigned char>>(w * h);
+        for (int row = 0; row < h; row++) {
+            std::copy(map + (y + row) * nMapWidth + x, map + (y + row) * nMapWidth + x + w, chunk->data() + row * w);
+        }
+        vecCurrent[c] = std::move(chunk);
+        vecDirty[c] = 0;
+    }
+    vecChunks = vecCurrent;
+}
+
+void cTerrainChunks::resize(int nWidth, int nHeight) {
+    if (nWidth == nMapWidth && nHeight == nMapHeight) return;
+    nMapWidth = nWidth;
+    nMapHeight = nHeight;
+    nChunksX = (nWidth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    nChunksY = (nHeight + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    vecCurrent.assign(nChunksX * nChunksY, nullptr);
+    vecDirty.assign(nChunksX * nChunksY, 1);
+}
+
+void cTerrainChunks::getChunkRect(int nChunk, int &x, int &y, int &w, int &h) const {
+    x = (nChunk % nChunksX) * CHUNK_SIZE;
+    y = (nChunk / nChunksX) * CHUNK_SIZE;
+    w = std::min(CHUNK_SIZE, nMapWidth - x);
+    h = std::min(CHUNK_SIZE, nMapHeight - y);
+}
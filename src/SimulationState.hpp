@@ -0,0 +1,85 @@
+#pragma once
+
+#include "AIPlanner.hpp"
+#include "GameObjects.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The map in chunks of CHUNK_SIZE x CHUNK_SIZE pixels, copied on write. Saving copies only the chunks that
+// changed since the last save and shares the others with the states saved before, restoring writes back only
+// the chunks that differ from what the map holds. Every change to the map has to go through markChanged.
+class cTerrainChunks {
+public:
+    static const int CHUNK_SIZE = 64;
+
+    using Chunk = std::shared_ptr<const std::vector<unsigned char>>;
+
+    void markChanged(int x, int y, int w, int h);
+
+    // a map of another size starts over with every chunk changed
+    void save(const unsigned char *map, int nWidth, int nHeight, std::vector<Chunk> &vecChunks);
+
+    // Calls changed(x, y, w, h) for every chunk written back, before it is known to be clean again
+    template<typename Changed>
+    void restore(unsigned char *map, int nWidth, int nHeight, const std::vector<Chunk> &vecChunks,
+                 Changed &&changed) {
+        resize(nWidth, nHeight);
+        for (int c = 0; c < static_cast<int>(vecChunks.size()); c++) {
+            if (!vecDirty[c] && vecCurrent[c] == vecChunks[c]) continue;
+            int x, y, w, h;
+            getChunkRect(c, x, y, w, h);
+            const unsigned char *pChunk = vecChunks[c]->data();
+            for (int row = 0; row < h; row++) {
+                std::copy(pChunk + row * w, pChunk + (row + 1) * w, map + (y + row) * nMapWidth + x);
+            }
+            changed(x, y, w, h);
+            vecCurrent[c] = vecChunks[c];
+            vecDirty[c] = 0;
+        }
+    }
+
+private:
+    int nMapWidth = 0;
+    int nMapHeight = 0;
+    int nChunksX = 0;
+    int nChunksY = 0;
+    std::vector<Chunk> vecCurrent;  // what the map holds where it isn't dirty, shared with the saved states
+    std::vector<uint8_t> vecDirty;  // changed since it was last saved or restored
+
+    void resize(int nWidth, int nHeight);
+
+    void getChunkRect(int nChunk, int &x, int &y, int &w, int &h) const;
+};
+
+// Everything a match continues from, taken by Fauji::saveState and put back by Fauji::restoreState. Meant to
+// be kept and reused (a ring of them for rollback, say), the vectors then keep their memory between saves.
+struct SimulationState {
+    uint32_t nTick = 0;
+    int nMapWidth = 0;
+    int nMapHeight = 0;
+    std::vector<cTerrainChunks::Chunk> vecTerrain;
+    std::vector<uint32_t> vecSettlingChunks; // see cTerrainSettler::save
+    std::vector<uint8_t> vecValues;       // Fauji's plain values, see Fauji::visitSimulationValues
+    std::vector<uint8_t> vecObjectKinds;  // an OBJECT_KIND for every entry of Fauji::listObjects
+    std::vector<cMan> vecMen;             // the men and the debris of listObjects, in list order
+    std::vector<cDebris> vecDebris;
+    cProjectilePool::Saved projectiles;
+
+    struct Team {
+        int nCurrentMember;
+        int nAliveMembers;
+        int nFirstMember; // into vecTeamMembers
+        int nMembers;
+    };
+    std::vector<Team> vecTeams;
+    std::vector<int> vecTeamMembers;      // indices into vecMen
+    cTurnOrder turnOrder;
+    std::string gameOverMessage;
+
+    // the objects Fauji points at: -1 for none, a position in listObjects, or -2 - slot for a projectile
+    int nObjectUnderControl = -1;
+    int nCameraTrackingObject = -1;
+    int nAITargetMan = -1;
+};
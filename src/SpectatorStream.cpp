@@ -0,0 +1,711 @@
+#include "SpectatorStream.hpp"
+#include "Physics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    const char SPECTATOR_MAGIC[4] = {'F', 'S', 'P', 'C'};
+    const uint8_t SPECTATOR_VERSION = 4; // 1 had no TERRAIN_MAP, in 2 the terrain didn't settle, in 3 all land was soil
+
+    enum RECORD_TYPE : uint8_t {
+        RECORD_KEYFRAME = 1, // coded against nothing, decoding can start here
+        RECORD_DELTA         // coded against the tick before
+    };
+
+    enum TERRAIN_OP : uint8_t {
+        TERRAIN_SURFACE = 0, // land from a column top down, only streams before version 4 have it
+        TERRAIN_CRATER,
+        TERRAIN_MAP // the bytes of a cTerrainRle, after their count
+    };
+
+    // What the HUD of a RenderSnapshot is kept as, one quantized value each
+    enum HUD_FIELD {
+        HUD_CAMERA_X = 0, // of the centre of the view
+        HUD_CAMERA_Y,
+        HUD_MAN_X,
+        HUD_MAN_Y,
+        HUD_SHOOTING_ANGLE,
+        HUD_ENERGY,
+        HUD_TURN_TIME,
+        HUD_PLANE_X,
+        HUD_WEAPON,
+        HUD_FLAGS,
+        HUD_FIELDS
+    };
+    const uint32_t HUD_GAME_OVER_MESSAGE = 1u << HUD_FIELDS; // in the mask of changed fields
+
+    enum HUD_FLAG {
+        HUD_FLAG_CONTROLLED_MAN = 1,
+        HUD_FLAG_COUNT_DOWN = 2,
+        HUD_FLAG_NUKE = 4,
+        HUD_FLAG_WEAPON = 8
+    };
+
+    enum SPECTATOR_FLAG {
+        SPECTATOR_FLAG_FLIPPED = 1,
+        SPECTATOR_FLAG_PLAYABLE = 2,
+        SPECTATOR_FLAG_WALKING = 4 // men only, the walk animation runs
+    };
+
+    // which fields of an object differ from what the tick before predicted
+    enum OBJECT_FIELD {
+        OBJECT_FIELD_X = 1,
+        OBJECT_FIELD_Y = 2,
+        OBJECT_FIELD_DIRECTION = 4,
+        OBJECT_FIELD_HEALTH = 8,
+        OBJECT_FIELD_FLAGS = 16,
+        OBJECT_FIELDS_ALL = 31
+    };
+    // An object is coded as a varint holding whether it is new, the fields coded and how many objects of the
+    // tick before are gone in front of it: (nSkipped << OBJECT_OP_SKIP_SHIFT) | (nFields << 1) | bNew
+    const int OBJECT_OP_SKIP_SHIFT = 6;
+
+    const float POSITION_SCALE = 8.0f;
+    const float HEALTH_SCALE = 1000.0f;
+    const float ANGLE_SCALE = 1000.0f;
+    const float ENERGY_SCALE = 1000.0f;
+    const float TURN_TIME_SCALE = 100.0f;
+    const int DIRECTION_STEPS = 64;
+
+    int32_t quantize(float f, float fScale) {
+        if (!std::isfinite(f)) return 0;
+        double v = std::max(-1e9, std::min(static_cast<double>(f) * fScale, 1e9));
+        return static_cast<int32_t>(std::lround(v));
+    }
+
+    // The bytes of a record, integers as LEB128 varints, signed ones zigzagged first
+    class cByteWriter {
+    public:
+        explicit cByteWriter(std::vector<uint8_t> &vecBytes) : vecBytes(vecBytes) {}
+
+        void putByte(uint8_t nByte) { vecBytes.push_back(nByte); }
+
+        void putVarint(uint64_t n) {
+            while (n >= 0x80) {
+                vecBytes.push_back(static_cast<uint8_t>(n | 0x80));
+                n >>= 7;
+            }
+            vecBytes.push_back(static_cast<uint8_t>(n));
+        }
+
+        void putSigned(int64_t n) { putVarint((static_cast<uint64_t>(n) << 1) ^ static_cast<uint64_t>(n >> 63)); }
+
+        void putFloat(float f) {
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            for (int i = 0; i < 4; i++) vecBytes.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+
+    private:
+        std::vector<uint8_t> &vecBytes;
+    };
+
+    // Reads what cByteWriter wrote, a read past the end gives zeros and turns bOk off
+    class cByteReader {
+    public:
+        cByteReader(const uint8_t *p, size_t nSize) : pStart(p), p(p), pEnd(p + nSize) {}
+
+        bool bOk = true;
+
+        // bytes read so far
+        size_t getOffset() const { return static_cast<size_t>(p - pStart); }
+
+        uint8_t getByte() {
+            if (p == pEnd) {
+                bOk = false;
+                return 0;
+            }
+            return *p++;
+        }
+
+        uint64_t getVarint() {
+            uint64_t n = 0;
+            for (int nShift = 0; nShift < 64; nShift += 7) {
+                uint8_t nByte = getByte();
+                n |= static_cast<uint64_t>(nByte & 0x7F) << nShift;
+                if (!(nByte & 0x80)) return n;
+            }
+            bOk = false;
+            return n;
+        }
+
+        int64_t getSigned() {
+            uint64_t n = getVarint();
+            return static_cast<int64_t>(n >> 1) ^ -static_cast<int64_t>(n & 1);
+        }
+
+        void skip(size_t nBytes) {
+            if (nBytes > static_cast<size_t>(pEnd - p)) {
+                bOk = false;
+                nBytes = static_cast<size_t>(pEnd - p);
+            }
+            p += nBytes;
+        }
+
+        float getFloat() {
+            uint32_t bits = 0;
+            for (int i = 0; i < 4; i++) bits |= static_cast<uint32_t>(getByte()) << (8 * i);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+
+    private:
+        const uint8_t *pStart;
+        const uint8_t *p;
+        const uint8_t *pEnd;
+    };
+
+    SpectatorObject quantizeObject(const ObjectSnapshot &s) {
+        SpectatorObject q;
+        q.nKind = static_cast<uint8_t>(s.nKind);
+        q.radius = s.radius;
+        q.fDrawExtent = s.fDrawExtent;
+        q.x = quantize(s.px, POSITION_SCALE);
+        q.y = quantize(s.py, POSITION_SCALE);
+        if (s.nKind == OBJECT_MAN) {
+            q.nTeam = s.nTeam;
+            q.nHealth = quantize(s.fHealth, HEALTH_SCALE);
+            q.nFlags = (s.flipType != SDL_FLIP_NONE ? SPECTATOR_FLAG_FLIPPED : 0) |
+                       (s.bIsPlayable ? SPECTATOR_FLAG_PLAYABLE : 0) |
+                       // what cMan::draw steps through the walk animation for
+                       (std::abs(s.vx) > 4 && std::abs(s.vx) < 6 ? SPECTATOR_FLAG_WALKING : 0);
+        } else {
+            q.nWeapon = s.nWeapon;
+            float fTurn = std::atan2(s.vy, s.vx) / (2.0f * PHYSICS_PI);
+            q.nDirection = static_cast<int32_t>(std::lround(fTurn * DIRECTION_STEPS)) & (DIRECTION_STEPS - 1);
+        }
+        return q;
+    }
+
+    bool isSameObject(const SpectatorObject &a, const SpectatorObject &b) {
+        return a.nKind == b.nKind && a.nWeapon == b.nWeapon && a.nTeam == b.nTeam && a.radius == b.radius &&
+               a.fDrawExtent == b.fDrawExtent;
+    }
+
+    // Where an object is expected to be a tick later: as far on as it moved in the tick before, which is exact
+    // for a body flying freely and for one lying still
+    SpectatorObject predict(const SpectatorObject &previous) {
+        SpectatorObject predicted = previous;
+        predicted.x += previous.dx;
+        predicted.y += previous.dy;
+        return predicted;
+    }
+
+    uint8_t getChangedFields(const SpectatorObject &q, const SpectatorObject &predicted) {
+        return (q.x != predicted.x ? OBJECT_FIELD_X : 0) | (q.y != predicted.y ? OBJECT_FIELD_Y : 0) |
+               (q.nDirection != predicted.nDirection ? OBJECT_FIELD_DIRECTION : 0) |
+               (q.nHealth != predicted.nHealth ? OBJECT_FIELD_HEALTH : 0) |
+               (q.nFlags != predicted.nFlags ? OBJECT_FIELD_FLAGS : 0);
+    }
+
+    void putObjectFields(cByteWriter &writer, const SpectatorObject &q, const SpectatorObject &predicted,
+                         uint8_t nFields) {
+        if (nFields & OBJECT_FIELD_X) writer.putSigned(static_cast<int64_t>(q.x) - predicted.x);
+        if (nFields & OBJECT_FIELD_Y) writer.putSigned(static_cast<int64_t>(q.y) - predicted.y);
+        if (nFields & OBJECT_FIELD_DIRECTION) writer.putSigned(static_cast<int64_t>(q.nDirection) - predicted.nDirection);
+        if (nFields & OBJECT_FIELD_HEALTH) writer.putSigned(static_cast<int64_t>(q.nHealth) - predicted.nHealth);
+        if (nFields & OBJECT_FIELD_FLAGS) writer.putByte(q.nFlags);
+    }
+
+    // q holds the prediction
+    void getObjectFields(cByteReader &reader, SpectatorObject &q, uint8_t nFields) {
+        if (nFields & OBJECT_FIELD_X) q.x += static_cast<int32_t>(reader.getSigned());
+        if (nFields & OBJECT_FIELD_Y) q.y += static_cast<int32_t>(reader.getSigned());
+        if (nFields & OBJECT_FIELD_DIRECTION) q.nDirection += static_cast<int32_t>(reader.getSigned());
+        if (nFields & OBJECT_FIELD_HEALTH) q.nHealth += static_cast<int32_t>(reader.getSigned());
+        if (nFields & OBJECT_FIELD_FLAGS) q.nFlags = reader.getByte();
+    }
+
+    // the camera of a view of nViewSize centred on nCentre, clamped like Fauji clamps its own
+    float getCameraPos(int32_t nCentre, int nViewSize, int nMapSize) {
+        float fPos = nCentre / POSITION_SCALE - nViewSize / 2;
+        if (fPos < 0) fPos = 0;
+        if (fPos >= nMapSize - nViewSize) fPos = static_cast<float>(nMapSize - nViewSize);
+        return fPos;
+    }
+}
+
+cSpectatorWriter::cSpectatorWriter(std::ostream &out, int nKeyframeInterval)
+        : out(out), nKeyframeInterval(std::max(1, nKeyframeInterval)), vecHud(HUD_FIELDS, 0),
+          vecCurrentHud(HUD_FIELDS, 0) {}
+
+void cSpectatorWriter::addCrater(int x, int y, int r) {
+    cByteWriter writer(vecTerrainOps);
+    writer.putByte(TERRAIN_CRATER);
+    writer.putSigned(x);
+    writer.putSigned(y);
+    writer.putVarint(static_cast<uint32_t>(std::max(r, 0)));
+    nTerrainOps++;
+    bCratersSinceMap = true;
+}
+
+bool cSpectatorWriter::wantsTerrainMap(uint32_t nTick) const {
+    // the first tick written is a keyframe
+    if (!bCratersSinceMap || (bHeaderWritten && (nTick - nFirstTick) % nKeyframeInterval != 0)) return false;
+    return !bHeaderWritten ||
+           nTick - nTerrainMapTick >= static_cast<uint32_t>(nKeyframeInterval) * TERRAIN_MAP_KEYFRAMES;
+}
+
+void cSpectatorWriter::setTerrainMap(const unsigned char *map, int nWidth, int nHeight) {
+    terrainRle.encode(map, nWidth, nHeight);
+    const std::vector<uint8_t> &vecBytes = terrainRle.getData();
+    cByteWriter writer(vecTerrainOps);
+    writer.putByte(TERRAIN_MAP);
+    writer.putVarint(vecBytes.size());
+    vecTerrainOps.insert(vecTerrainOps.end(), vecBytes.begin(), vecBytes.end());
+    nTerrainOps++;
+    bTerrainMapPending = true;
+    bCratersSinceMap = false;
+}
+
+void cSpectatorWriter::writeHeader() {
+    out.write(SPECTATOR_MAGIC, 4);
+    out.put(static_cast<char>(SPECTATOR_VERSION));
+    std::vector<uint8_t> vecHeader;
+    cByteWriter(vecHeader).putVarint(nKeyframeInterval);
+    out.write(reinterpret_cast<const char *>(vecHeader.data()), static_cast<std::streamsize>(vecHeader.size()));
+    nBytesWritten += 5 + vecHeader.size();
+    bHeaderWritten = true;
+}
+
+bool cSpectatorWriter::writeTick(const RenderSnapshot &s, const std::vector<uintptr_t> &vecKeys, int nViewWidth,
+                                 int nViewHeight) {
+    if (!bHeaderWritten) {
+        writeHeader();
+        nFirstTick = s.nTick;
+    }
+    bool bKeyframe = (s.nTick - nFirstTick) % nKeyframeInterval == 0;
+    if (bKeyframe) {
+        // coded against nothing at all
+        std::fill(vecHud.begin(), vecHud.end(), 0);
+        gameOverMessage.clear();
+        vecPrevious.clear();
+        vecPreviousKeys.clear();
+    }
+
+    vecRecord.clear();
+    cByteWriter writer(vecRecord);
+    writer.putVarint(s.nTick);
+    writer.putVarint(nTerrainOps);
+    vecRecord.insert(vecRecord.end(), vecTerrainOps.begin(), vecTerrainOps.end());
+    vecTerrainOps.clear();
+    nTerrainOps = 0;
+    if (bTerrainMapPending) {
+        nTerrainMapTick = s.nTick;
+        bTerrainMapPending = false;
+    }
+
+    // the HUD, only the fields that changed
+    int32_t *hud = vecCurrentHud.data();
+    hud[HUD_CAMERA_X] = quantize(s.fCameraPosX + nViewWidth / 2, POSITION_SCALE);
+    hud[HUD_CAMERA_Y] = quantize(s.fCameraPosY + nViewHeight / 2, POSITION_SCALE);
+    hud[HUD_MAN_X] = s.bHasControlledMan ? quantize(s.fManX, POSITION_SCALE) : 0;
+    hud[HUD_MAN_Y] = s.bHasControlledMan ? quantize(s.fManY, POSITION_SCALE) : 0;
+    hud[HUD_SHOOTING_ANGLE] = s.bHasControlledMan ? quantize(s.fShootingAngle, ANGLE_SCALE) : 0;
+    hud[HUD_ENERGY] = quantize(s.fEnergyLevel, ENERGY_SCALE);
+    hud[HUD_TURN_TIME] = quantize(s.fTurnTime, TURN_TIME_SCALE);
+    hud[HUD_PLANE_X] = s.planePosX;
+    hud[HUD_WEAPON] = s.nSelectedWeapon;
+    hud[HUD_FLAGS] = (s.bHasControlledMan ? HUD_FLAG_CONTROLLED_MAN : 0) | (s.bShowCountDown ? HUD_FLAG_COUNT_DOWN : 0) |
+                     (s.bShowNukeAnimation ? HUD_FLAG_NUKE : 0) | (s.bShowWeapon ? HUD_FLAG_WEAPON : 0);
+    uint32_t nHudMask = s.gameOverMessage != gameOverMessage ? HUD_GAME_OVER_MESSAGE : 0;
+    for (int f = 0; f < HUD_FIELDS; f++) {
+        if (hud[f] != vecHud[f]) nHudMask |= 1u << f;
+    }
+    writer.putVarint(nHudMask);
+    for (int f = 0; f < HUD_FIELDS; f++) {
+        if (nHudMask & (1u << f)) writer.putSigned(static_cast<int64_t>(hud[f]) - vecHud[f]);
+    }
+    if (nHudMask & HUD_GAME_OVER_MESSAGE) {
+        writer.putVarint(s.gameOverMessage.size());
+        vecRecord.insert(vecRecord.end(), s.gameOverMessage.begin(), s.gameOverMessage.end());
+        gameOverMessage = s.gameOverMessage;
+    }
+    std::swap(vecHud, vecCurrentHud);
+
+    // The objects in order. Those that lived through the tick keep their order, so every one of them is coded
+    // as the number of objects of the tick before that are gone in front of it and the fields that differ from
+    // its prediction. New ones are coded in full.
+    mapPreviousIndex.clear();
+    for (size_t i = 0; i < vecPreviousKeys.size(); i++) mapPreviousIndex[vecPreviousKeys[i]] = i;
+    writer.putVarint(s.vecObjects.size());
+    vecCurrent.resize(s.vecObjects.size());
+    size_t nNextPrevious = 0;
+    for (size_t i = 0; i < s.vecObjects.size(); i++) {
+        SpectatorObject &q = vecCurrent[i];
+        q = quantizeObject(s.vecObjects[i]);
+        auto it = mapPreviousIndex.find(vecKeys[i]);
+        if (it != mapPreviousIndex.end() && it->second >= nNextPrevious && isSameObject(q, vecPrevious[it->second])) {
+            const SpectatorObject &previous = vecPrevious[it->second];
+            const SpectatorObject predicted = predict(previous);
+            uint8_t nFields = getChangedFields(q, predicted);
+            writer.putVarint(((it->second - nNextPrevious) << OBJECT_OP_SKIP_SHIFT) | (nFields << 1));
+            putObjectFields(writer, q, predicted, nFields);
+            q.dx = q.x - previous.x;
+            q.dy = q.y - previous.y;
+            nNextPrevious = it->second + 1;
+        } else {
+            writer.putVarint(1);
+            writer.putByte(q.nKind);
+            writer.putVarint(static_cast<uint32_t>(q.nWeapon));
+            writer.putVarint(static_cast<uint32_t>(q.nTeam));
+            writer.putFloat(q.radius);
+            writer.putFloat(q.fDrawExtent);
+            putObjectFields(writer, q, SpectatorObject(), OBJECT_FIELDS_ALL);
+        }
+    }
+    std::swap(vecPrevious, vecCurrent);
+    vecPreviousKeys.assign(vecKeys.begin(), vecKeys.end());
+
+    vecPrefix.clear();
+    vecPrefix.push_back(bKeyframe ? RECORD_KEYFRAME : RECORD_DELTA);
+    cByteWriter(vecPrefix).putVarint(vecRecord.size());
+    out.write(reinterpret_cast<const char *>(vecPrefix.data()), static_cast<std::streamsize>(vecPrefix.size()));
+    out.write(reinterpret_cast<const char *>(vecRecord.data()), static_cast<std::streamsize>(vecRecord.size()));
+    nBytesWritten += vecPrefix.size() + vecRecord.size();
+    if (bKeyframe) {
+        // whoever is reading along gets everything up to here
+        out.flush();
+    }
+    return static_cast<bool>(out);
+}
+
+uint64_t cSpectatorWriter::getBytesWritten() const {
+    return nBytesWritten;
+}
+
+bool cSpectatorReader::load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Unable to open spectator stream " << path << std::endl;
+        return false;
+    }
+    return load(file, path);
+}
+
+bool cSpectatorReader::load(std::istream &in, const std::string &name) {
+    this->name = name;
+    vecData.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    vecTicks.clear();
+    vecKeyframes.clear();
+    vecTerrainOps.clear();
+    vecSurfaces.clear();
+    vecMaps.clear();
+    bDecoded = false;
+    nMapWidth = 0;
+    nMapHeight = 0;
+    vecMap.clear();
+    bTerrainBuilt = false;
+    nTerrainVersion++;
+    bSettles = false;
+    bMaterials = false;
+
+    if (vecData.size() < 5 || memcmp(vecData.data(), SPECTATOR_MAGIC, 4) != 0 || vecData[4] < 1 ||
+        vecData[4] > SPECTATOR_VERSION) {
+        std::cout << name << " is not a supported spectator stream" << std::endl;
+        return false;
+    }
+    bSettles = vecData[4] >= 3;
+    bMaterials = vecData[4] >= 4;
+    cByteReader header(vecData.data() + 5, vecData.size() - 5);
+    header.getVarint(); // the keyframe interval, the keyframes are found as they are
+    size_t nOffset = 5 + header.getOffset();
+
+    // Indexes the records and collects the terrain ops. A record cut short is one still being written, the
+    // stream ends before it.
+    while (nOffset < vecData.size()) {
+        cByteReader prefix(vecData.data() + nOffset, vecData.size() - nOffset);
+        uint8_t nType = prefix.getByte();
+        uint64_t nSize = prefix.getVarint();
+        if (!prefix.bOk || nSize > vecData.size() - nOffset - prefix.getOffset()) break;
+        size_t nPayload = nOffset + prefix.getOffset();
+        cByteReader reader(vecData.data() + nPayload, nSize);
+        uint32_t nRecordTick = static_cast<uint32_t>(reader.getVarint());
+        if (vecTicks.empty()) {
+            if (nType != RECORD_KEYFRAME) {
+                std::cout << name << " does not start with a keyframe" << std::endl;
+                return false;
+            }
+            nFirstTick = nRecordTick;
+        }
+        if ((nType != RECORD_KEYFRAME && nType != RECORD_DELTA) || nRecordTick != nFirstTick + vecTicks.size()) {
+            std::cout << name << " is broken at tick " << nRecordTick << ", it is read up to there" << std::endl;
+            break;
+        }
+        uint64_t nOps = reader.getVarint();
+        for (uint64_t i = 0; i < nOps && reader.bOk; i++) {
+            TerrainOp op = {nRecordTick, -1, -1, 0, 0, 0};
+            uint8_t nOp = reader.getByte();
+            if (nOp == TERRAIN_SURFACE) {
+                Surface surface;
+                surface.nWidth = static_cast<int>(reader.getVarint());
+                surface.nHeight = static_cast<int>(reader.getVarint());
+                surface.vecColumnTop.resize(surface.nWidth);
+                int nTop = 0;
+                for (int x = 0; x < surface.nWidth && reader.bOk; x++) {
+                    nTop += static_cast<int>(reader.getSigned());
+                    surface.vecColumnTop[x] = nTop;
+                }
+                op.nSurface = static_cast<int>(vecSurfaces.size());
+                vecSurfaces.push_back(std::move(surface));
+            } else if (nOp == TERRAIN_CRATER) {
+                op.x = static_cast<int>(reader.getSigned());
+                op.y = static_cast<int>(reader.getSigned());
+                op.r = static_cast<int>(reader.getVarint());
+            } else if (nOp == TERRAIN_MAP) {
+                uint64_t nBytes = reader.getVarint();
+                cTerrainRle terrain;
+                if (nBytes > nSize - reader.getOffset() ||
+                    !terrain.load(vecData.data() + nPayload + reader.getOffset(), static_cast<size_t>(nBytes))) {
+                    reader.bOk = false;
+                    break;
+                }
+                reader.skip(static_cast<size_t>(nBytes));
+                op.nMap = static_cast<int>(vecMaps.size());
+                vecMaps.push_back(std::move(terrain));
+            } else {
+                reader.bOk = false;
+            }
+            vecTerrainOps.push_back(op);
+        }
+        if (!reader.bOk) {
+            std::cout << name << " is broken at tick " << nRecordTick << ", it is read up to there" << std::endl;
+            break;
+        }
+        vecTicks.push_back({nPayload, static_cast<size_t>(nSize), nType == RECORD_KEYFRAME});
+        if (nType == RECORD_KEYFRAME) vecKeyframes.push_back(nRecordTick);
+        nOffset = nPayload + nSize;
+    }
+    if (vecTicks.empty()) {
+        std::cout << "Spectator stream " << name << " holds no tick" << std::endl;
+        return false;
+    }
+    return seek(nFirstTick);
+}
+
+uint32_t cSpectatorReader::getFirstTick() const {
+    return nFirstTick;
+}
+
+uint32_t cSpectatorReader::getLastTick() const {
+    return nFirstTick + static_cast<uint32_t>(vecTicks.size()) - 1;
+}
+
+uint32_t cSpectatorReader::getTick() const {
+    return nTick;
+}
+
+int cSpectatorReader::getKeyframeCount() const {
+    return static_cast<int>(vecKeyframes.size());
+}
+
+size_t cSpectatorReader::getByteCount() const {
+    return vecData.size();
+}
+
+bool cSpectatorReader::seek(uint32_t nTarget) {
+    if (vecTicks.empty()) return false;
+    nTarget = std::max(getFirstTick(), std::min(nTarget, getLastTick()));
+    uint32_t nKeyframe = *(std::upper_bound(vecKeyframes.begin(), vecKeyframes.end(), nTarget) - 1);
+    uint32_t nFrom = nKeyframe;
+    if (bDecoded && nTick >= nKeyframe && nTick <= nTarget) {
+        nFrom = nTick + 1;
+    }
+    for (uint32_t t = nFrom; t <= nTarget; t++) {
+        if (!decodeTick(t)) {
+            bDecoded = false;
+            return false;
+        }
+    }
+    updateTerrain(nTarget);
+    return true;
+}
+
+bool cSpectatorReader::decodeTick(uint32_t nDecodeTick) {
+    const TickIndex &index = vecTicks[nDecodeTick - nFirstTick];
+    if (index.bKeyframe) {
+        vecHud.assign(HUD_FIELDS, 0);
+        gameOverMessage.clear();
+        vecObjects.clear();
+    }
+    cByteReader reader(vecData.data() + index.nOffset, index.nSize);
+    reader.getVarint();
+    // the terrain ops were taken out by load
+    uint64_t nOps = reader.getVarint();
+    for (uint64_t i = 0; i < nOps; i++) {
+        uint8_t nOp = reader.getByte();
+        if (nOp == TERRAIN_SURFACE) {
+            int nWidth = static_cast<int>(reader.getVarint());
+            reader.getVarint();
+            for (int x = 0; x < nWidth; x++) reader.getVarint();
+        } else if (nOp == TERRAIN_CRATER) {
+            reader.getVarint();
+            reader.getVarint();
+            reader.getVarint();
+        } else {
+            reader.skip(static_cast<size_t>(reader.getVarint()));
+        }
+    }
+
+    uint32_t nHudMask = static_cast<uint32_t>(reader.getVarint());
+    for (int f = 0; f < HUD_FIELDS; f++) {
+        if (nHudMask & (1u << f)) vecHud[f] += static_cast<int32_t>(reader.getSigned());
+    }
+    if (nHudMask & HUD_GAME_OVER_MESSAGE) {
+        size_t nLength = static_cast<size_t>(reader.getVarint());
+        gameOverMessage.clear();
+        for (size_t i = 0; i < nLength && reader.bOk; i++) gameOverMessage += static_cast<char>(reader.getByte());
+    }
+
+    std::swap(vecPrevious, vecObjects);
+    size_t nObjects = static_cast<size_t>(reader.getVarint());
+    vecObjects.clear();
+    size_t nNextPrevious = 0;
+    for (size_t i = 0; i < nObjects && reader.bOk; i++) {
+        uint64_t nOp = reader.getVarint();
+        if (nOp & 1) {
+            SpectatorObject q;
+            q.nKind = reader.getByte();
+            q.nWeapon = static_cast<int32_t>(reader.getVarint());
+            q.nTeam = static_cast<int32_t>(reader.getVarint());
+            q.radius = reader.getFloat();
+            q.fDrawExtent = reader.getFloat();
+            getObjectFields(reader, q, OBJECT_FIELDS_ALL);
+            vecObjects.push_back(q);
+        } else {
+            nNextPrevious += static_cast<size_t>(nOp >> OBJECT_OP_SKIP_SHIFT);
+            if (nNextPrevious >= vecPrevious.size()) {
+                reader.bOk = false;
+                break;
+            }
+            const SpectatorObject &previous = vecPrevious[nNextPrevious++];
+            SpectatorObject q = predict(previous);
+            getObjectFields(reader, q, static_cast<uint8_t>((nOp >> 1) & OBJECT_FIELDS_ALL));
+            q.dx = q.x - previous.x;
+            q.dy = q.y - previous.y;
+            vecObjects.push_back(q);
+        }
+    }
+    if (!reader.bOk) {
+        std::cout << "Spectator stream " << name << " is broken at tick " << nDecodeTick << std::endl;
+        return false;
+    }
+    nTick = nDecodeTick;
+    bDecoded = true;
+    return true;
+}
+
+void cSpectatorReader::updateTerrain(uint32_t nTarget) {
+    uint32_t nFrom = nTerrainTick + 1;
+    if (!bTerrainBuilt || nTarget < nTerrainTick) {
+        // over again from the last whole terrain by the target, there is no terrain before the first
+        nNextTerrainOp = 0;
+        for (size_t i = 0; i < vecTerrainOps.size() && vecTerrainOps[i].nTick <= nTarget; i++) {
+            if (vecTerrainOps[i].nSurface >= 0 || vecTerrainOps[i].nMap >= 0) nNextTerrainOp = i;
+        }
+        nMapWidth = 0;
+        nMapHeight = 0;
+        vecMap.clear();
+        terrainSettler.reset(0, 0);
+        nTerrainVersion++;
+        bTerrainBuilt = true;
+        nFrom = 0;
+    }
+    // tick by tick while the terrain settles, the way the match did: the terrain ops of the tick, then a tick of
+    // settling. Straight on to the next op while nothing settles.
+    for (uint32_t t = nFrom; t <= nTarget; t++) {
+        if (terrainSettler.isIdle()) {
+            if (nNextTerrainOp == vecTerrainOps.size() || vecTerrainOps[nNextTerrainOp].nTick > nTarget) break;
+            t = std::max(t, vecTerrainOps[nNextTerrainOp].nTick);
+        }
+        while (nNextTerrainOp < vecTerrainOps.size() && vecTerrainOps[nNextTerrainOp].nTick <= t) {
+            applyTerrainOp(vecTerrainOps[nNextTerrainOp++]);
+        }
+        bool bChanged = false;
+        terrainSettler.tick(vecMap.data(), t, [&bChanged](int, int, int, int) { bChanged = true; });
+        if (bChanged) nTerrainVersion++;
+    }
+    nTerrainTick = nTarget;
+}
+
+void cSpectatorReader::applyTerrainOp(const TerrainOp &op) {
+    if (op.nSurface >= 0) {
+        const Surface &surface = vecSurfaces[op.nSurface];
+        nMapWidth = surface.nWidth;
+        nMapHeight = surface.nHeight;
+        vecMap.resize(static_cast<size_t>(nMapWidth) * nMapHeight);
+        terrainSettler.reset(nMapWidth, nMapHeight);
+        for (int y = 0; y < nMapHeight; y++) {
+            unsigned char *row = vecMap.data() + static_cast<size_t>(y) * nMapWidth;
+            for (int x = 0; x < nMapWidth; x++) row[x] = y >= surface.vecColumnTop[x];
+        }
+    } else if (op.nMap >= 0) {
+        const cTerrainRle &terrain = vecMaps[op.nMap];
+        nMapWidth = terrain.getWidth();
+        nMapHeight = terrain.getHeight();
+        vecMap.resize(static_cast<size_t>(nMapWidth) * nMapHeight);
+        terrainSettler.reset(nMapWidth, nMapHeight);
+        if (!terrain.decode(vecMap.data())) {
+            // load only takes whole maps, but sky is still better than half of one
+            std::fill(vecMap.begin(), vecMap.end(), 0);
+        }
+    } else if (!vecMap.empty()) {
+        carveCrater(vecMap.data(), nMapWidth, nMapHeight, op.x, op.y, op.r);
+        // all land was soil, the match woke only the crater's own rectangle
+        int nReach = bMaterials ? getCraterReach(op.r) : op.r;
+        if (bSettles) terrainSettler.activate(op.x - nReach, op.y - nReach, 2 * nReach + 1, 2 * nReach + 1);
+    }
+    nTerrainVersion++;
+}
+
+void cSpectatorReader::fillSnapshot(RenderSnapshot &s, int nViewWidth, int nViewHeight) const {
+    s.nTick = nTick;
+    s.fCameraPosX = getCameraPos(vecHud[HUD_CAMERA_X], nViewWidth, nMapWidth);
+    s.fCameraPosY = getCameraPos(vecHud[HUD_CAMERA_Y], nViewHeight, nMapHeight);
+    s.vecObjects.resize(vecObjects.size());
+    for (size_t i = 0; i < vecObjects.size(); i++) {
+        const SpectatorObject &q = vecObjects[i];
+        ObjectSnapshot &o = s.vecObjects[i];
+        o.nKind = static_cast<OBJECT_KIND>(q.nKind);
+        o.px = q.x / POSITION_SCALE;
+        o.py = q.y / POSITION_SCALE;
+        if (o.nKind == OBJECT_MAN) {
+            o.vx = q.nFlags & SPECTATOR_FLAG_WALKING ? 5.0f : 0.0f;
+            o.vy = 0.0f;
+        } else {
+            float fAngle = 2.0f * PHYSICS_PI * (q.nDirection & (DIRECTION_STEPS - 1)) / DIRECTION_STEPS;
+            o.vx = std::cos(fAngle);
+            o.vy = std::sin(fAngle);
+        }
+        o.radius = q.radius;
+        o.fDrawExtent = q.fDrawExtent;
+        o.nWeapon = q.nWeapon;
+        o.bIsPlayable = (q.nFlags & SPECTATOR_FLAG_PLAYABLE) != 0;
+        o.fHealth = q.nHealth / HEALTH_SCALE;
+        o.nTeam = q.nTeam;
+        o.flipType = q.nFlags & SPECTATOR_FLAG_FLIPPED ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
+    }
+    int32_t nFlags = vecHud[HUD_FLAGS];
+    s.bHasControlledMan = (nFlags & HUD_FLAG_CONTROLLED_MAN) != 0;
+    s.fManX = vecHud[HUD_MAN_X] / POSITION_SCALE;
+    s.fManY = vecHud[HUD_MAN_Y] / POSITION_SCALE;
+    s.fShootingAngle = vecHud[HUD_SHOOTING_ANGLE] / ANGLE_SCALE;
+    s.fEnergyLevel = vecHud[HUD_ENERGY] / ENERGY_SCALE;
+    s.bShowCountDown = (nFlags & HUD_FLAG_COUNT_DOWN) != 0;
+    s.fTurnTime = vecHud[HUD_TURN_TIME] / TURN_TIME_SCALE;
+    s.gameOverMessage = gameOverMessage;
+    s.bShowNukeAnimation = (nFlags & HUD_FLAG_NUKE) != 0;
+    s.planePosX = vecHud[HUD_PLANE_X];
+    s.bShowWeapon = (nFlags & HUD_FLAG_WEAPON) != 0;
+    s.nSelectedWeapon = vecHud[HUD_WEAPON];
+    if (s.nMapWidth != nMapWidth || s.nMapHeight != nMapHeight || s.nTerrainVersion != nTerrainVersion) {
+        s.nMapWidth = nMapWidth;
+        s.nMapHeight = nMapHeight;
+        s.vecMap.assign(vecMap.begin(), vecMap.end());
+        s.nTerrainVersion = nTerrainVersion;
+    }
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "RenderSnapshot.hpp"
+#include "TerrainRle.hpp"
+#include "TerrainSettler.hpp"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Spectator streams (.fspc) hold what a match looked like, tick by tick, so that it can be watched, broadcast
+// and scrubbed through without running the simulation again. Every tick is one record: the terrain operations
+// of the tick, the HUD and the objects, quantized (positions to 1/8 pixel, directions to 64 steps, health to
+// thousandths) and, between keyframes, coded as the difference to what the tick before predicts. The terrain is
+// stored as the map createMap made, run-length coded (see cTerrainRle), and the craters BOOM blew into it, and
+// now and then, in a keyframe, as the whole map again, so that seeking has only the craters since to carve. The
+// viewer lets the craters settle (see cTerrainSettler) the way the match did, whole maps are only taken while
+// nothing settles.
+//
+// The file is a header followed by the records, written as the match runs and flushed at every keyframe, so it
+// can be read while it is still being written.
+
+// Quantized state of one drawn object, as the stream holds it
+struct SpectatorObject {
+    uint8_t nKind = OBJECT_DEBRIS;
+    uint8_t nFlags = 0;       // SPECTATOR_FLAG_...
+    int32_t nWeapon = 0;
+    int32_t nTeam = 0;
+    float radius = 0.0f;
+    float fDrawExtent = 0.0f;
+    int32_t x = 0;            // 1/8 pixels
+    int32_t y = 0;
+    int32_t nDirection = 0;   // of the velocity, 0 to 63 for a full turn, not kept for men
+    int32_t nHealth = 0;      // thousandths, men only
+    int32_t dx = 0;           // how far it moved in the tick before, not stored but predicted from
+    int32_t dy = 0;
+};
+
+class cSpectatorWriter {
+public:
+    static const int DEFAULT_KEYFRAME_INTERVAL = 120;
+    static const int TERRAIN_MAP_KEYFRAMES = 4; // keyframes at least from one whole map to the next
+
+    // The stream goes to out, which has to outlive the writer. A keyframe is written every nKeyframeInterval
+    // ticks, seeking decodes at most that many ticks.
+    explicit cSpectatorWriter(std::ostream &out, int nKeyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+    // A crater carved with carveCrater, goes into the next tick written
+    void addCrater(int x, int y, int r);
+
+    // Whether the tick nTick, written next, wants the whole map handed to setTerrainMap: it is a keyframe
+    // a while after the last whole map, and craters changed the terrain since
+    bool wantsTerrainMap(uint32_t nTick) const;
+
+    // The whole terrain made new, or as it is after the craters added so far. Goes into the next tick written.
+    void setTerrainMap(const unsigned char *map, int nWidth, int nHeight);
+
+    // Writes the tick s was taken at, vecKeys holding a key for every object of s that stays the same for as
+    // long as the object lives (its address, say). The camera is kept as the centre of a view of nViewWidth x
+    // nViewHeight, so that a viewer with another window size can centre on the same spot.
+    // false once writing failed.
+    bool writeTick(const RenderSnapshot &s, const std::vector<uintptr_t> &vecKeys, int nViewWidth, int nViewHeight);
+
+    uint64_t getBytesWritten() const;
+
+private:
+    std::ostream &out;
+    int nKeyframeInterval;
+    bool bHeaderWritten = false;
+    uint32_t nFirstTick = 0;
+    uint64_t nBytesWritten = 0;
+    std::vector<uint8_t> vecTerrainOps; // encoded, with nTerrainOps of them
+    int nTerrainOps = 0;
+    uint32_t nTerrainMapTick = 0;       // of the last whole terrain written, a surface or a map
+    bool bTerrainMapPending = false;    // a whole terrain is among the terrain ops
+    bool bCratersSinceMap = false;
+    cTerrainRle terrainRle;
+    std::vector<uint8_t> vecRecord;
+    std::vector<uint8_t> vecPrefix;     // the record's type and size
+    // the tick written last, what the next one is coded against
+    std::vector<int32_t> vecHud;
+    std::string gameOverMessage;
+    std::vector<uintptr_t> vecPreviousKeys;
+    std::vector<SpectatorObject> vecPrevious;
+    std::unordered_map<uintptr_t, size_t> mapPreviousIndex; // key to position in vecPrevious
+    std::vector<SpectatorObject> vecCurrent;
+    std::vector<int32_t> vecCurrentHud;
+
+    void writeHeader();
+};
+
+class cSpectatorReader {
+public:
+    bool load(const std::string &path);
+
+    // name is only for the messages
+    bool load(std::istream &in, const std::string &name);
+
+    uint32_t getFirstTick() const;
+
+    uint32_t getLastTick() const;
+
+    // the tick decoded last
+    uint32_t getTick() const;
+
+    int getKeyframeCount() const;
+
+    size_t getByteCount() const;
+
+    // Decodes the tick nTick (clamped to the stream), going on from the tick decoded last if that is on the way
+    // and from the keyframe before nTick otherwise. The terrain is rebuilt from the last surface before nTick
+    // when going back.
+    bool seek(uint32_t nTick);
+
+    // Copies the decoded tick into s, with the camera centred for a view of nViewWidth x nViewHeight. The map
+    // is only copied when it changed since it was last copied into s.
+    void fillSnapshot(RenderSnapshot &s, int nViewWidth, int nViewHeight) const;
+
+private:
+    struct TickIndex {
+        size_t nOffset;  // of the record's payload in vecData
+        size_t nSize;
+        bool bKeyframe;
+    };
+    struct TerrainOp {
+        uint32_t nTick;
+        int nSurface; // into vecSurfaces, -1 for anything else
+        int nMap;     // into vecMaps, -1 for anything else
+        int x;
+        int y;
+        int r;
+    };
+    struct Surface {
+        int nWidth;
+        int nHeight;
+        std::vector<int> vecColumnTop;
+    };
+
+    std::string name;
+    std::vector<uint8_t> vecData;
+    uint32_t nFirstTick = 0;
+    std::vector<TickIndex> vecTicks;   // every tick from nFirstTick on
+    std::vector<uint32_t> vecKeyframes; // ticks of the keyframes, ascending
+    std::vector<TerrainOp> vecTerrainOps;
+    std::vector<Surface> vecSurfaces;
+    std::vector<cTerrainRle> vecMaps;
+    bool bSettles = false;              // streams before version 3 were written before the terrain settled
+    bool bMaterials = false;            // and before version 4 before there was land other than soil
+
+    // the decoded tick
+    bool bDecoded = false;
+    uint32_t nTick = 0;
+    std::vector<int32_t> vecHud;
+    std::string gameOverMessage;
+    std::vector<SpectatorObject> vecObjects;
+    std::vector<SpectatorObject> vecPrevious;
+
+    // the terrain as of nTerrainTick, with the terrain ops before nNextTerrainOp applied since the last whole one
+    bool bTerrainBuilt = false;
+    int nMapWidth = 0;
+    int nMapHeight = 0;
+    std::vector<unsigned char> vecMap;
+    uint32_t nTerrainTick = 0;
+    size_t nNextTerrainOp = 0;
+    uint32_t nTerrainVersion = 0;
+    cTerrainSettler terrainSettler;
+
+    bool decodeTick(uint32_t nTick);
+
+    void updateTerrain(uint32_t nTick);
+
+    void applyTerrainOp(const TerrainOp &op);
+};
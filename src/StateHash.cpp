@@ -0,0 +1,240 @@
+#include "StateHash.hpp"
+#include <fstream>
+
+namespace {
+    const char STATE_LOG_MAGIC[4] = {'F', 'S', 'T', 'L'};
+    const uint8_t STATE_LOG_VERSION = 1;
+
+    // State logs are compared between builds on the same machine, so plain host byte order is fine
+    template<typename T>
+    void put(std::ofstream &file, const T &value) {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool get(std::ifstream &file, T &value) {
+        return static_cast<bool>(file.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+    const char *objectTypeName(uint8_t nType) {
+        switch (nType) {
+            case OBJ_MAN:
+                return "man";
+            case OBJ_MISSILE:
+                return "missile";
+            case OBJ_DEBRIS:
+                return "debris";
+            default:
+                return "object";
+        }
+    }
+
+    void printFloat(std::ostream &out, float f) {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        out << f << " (0x" << std::hex << bits << std::dec << ")";
+    }
+
+    // prints one differing field, returns true if it did differ
+    template<typename T>
+    bool diffField(std::ostream &out, const std::string &name, const T &a, const T &b) {
+        if (memcmp(&a, &b, sizeof(T)) == 0) return false;
+        out << "    " << name << ": " << a << " vs " << b << std::endl;
+        return true;
+    }
+
+    bool diffField(std::ostream &out, const std::string &name, const float &a, const float &b) {
+        if (memcmp(&a, &b, sizeof(float)) == 0) return false;
+        out << "    " << name << ": ";
+        printFloat(out, a);
+        out << " vs ";
+        printFloat(out, b);
+        out << std::endl;
+        return true;
+    }
+}
+
+void TickRecord::hashMap(const unsigned char *map, int nWidth, int nHeight) {
+    cStateHasher whole;
+    for (int band = 0; band < MAP_BANDS; band++) {
+        int y0 = nHeight * band / MAP_BANDS;
+        int y1 = nHeight * (band + 1) / MAP_BANDS;
+        cStateHasher hasher;
+        hasher.add(map + static_cast<size_t>(y0) * nWidth, static_cast<size_t>(y1 - y0) * nWidth);
+        nMapBandHash[band] = hasher.get();
+        whole.add(nMapBandHash[band]);
+    }
+    nMapHash = whole.get();
+}
+
+void TickRecord::finish() {
+    cStateHasher hasher;
+    hasher.add(nMapHash);
+    hasher.add(nGameState);
+    hasher.add(nAIState);
+    hasher.add(nCurrentTeam);
+    hasher.add(fTurnTime);
+    hasher.add(nRngState);
+    for (float fHealth: vecTeamHealth) hasher.add(fHealth);
+    for (auto &object: vecObjects) {
+        hasher.add(object.nType);
+        hasher.add(object.bStable);
+        hasher.add(object.bDead);
+        hasher.add(object.nBounceBeforeDeath);
+        hasher.add(object.px);
+        hasher.add(object.py);
+        hasher.add(object.vx);
+        hasher.add(object.vy);
+        hasher.add(object.fHealth);
+    }
+    nHash = hasher.get();
+}
+
+bool cStateLog::save(const std::string &path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "Unable to open state log " << path << " for writing" << std::endl;
+        return false;
+    }
+    file.write(STATE_LOG_MAGIC, 4);
+    put(file, STATE_LOG_VERSION);
+    put(file, static_cast<uint32_t>(vecTicks.size()));
+    for (auto &tick: vecTicks) {
+        put(file, tick.nTick);
+        put(file, tick.nHash);
+        put(file, tick.nMapHash);
+        for (uint64_t nBandHash: tick.nMapBandHash) put(file, nBandHash);
+        put(file, tick.nGameState);
+        put(file, tick.nAIState);
+        put(file, tick.nCurrentTeam);
+        put(file, tick.fTurnTime);
+        put(file, tick.nRngState);
+        put(file, static_cast<uint32_t>(tick.vecTeamHealth.size()));
+        for (float fHealth: tick.vecTeamHealth) put(file, fHealth);
+        put(file, static_cast<uint32_t>(tick.vecObjects.size()));
+        for (auto &object: tick.vecObjects) {
+            put(file, object.nType);
+            put(file, object.bStable);
+            put(file, object.bDead);
+            put(file, object.nBounceBeforeDeath);
+            put(file, object.px);
+            put(file, object.py);
+            put(file, object.vx);
+            put(file, object.vy);
+            put(file, object.fHealth);
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+bool cStateLog::load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Unable to open state log " << path << std::endl;
+        return false;
+    }
+    char magic[4];
+    uint8_t version = 0;
+    uint32_t nTicks = 0;
+    if (!file.read(magic, 4) || memcmp(magic, STATE_LOG_MAGIC, 4) != 0 || !get(file, version) ||
+        version != STATE_LOG_VERSION || !get(file, nTicks)) {
+        std::cout << path << " is not a supported state log" << std::endl;
+        return false;
+    }
+    vecTicks.clear();
+    vecTicks.reserve(nTicks);
+    for (uint32_t i = 0; i < nTicks; i++) {
+        TickRecord tick;
+        uint32_t nTeams = 0, nObjects = 0;
+        bool bOk = get(file, tick.nTick) && get(file, tick.nHash) && get(file, tick.nMapHash);
+        for (uint64_t &nBandHash: tick.nMapBandHash) bOk = bOk && get(file, nBandHash);
+        bOk = bOk && get(file, tick.nGameState) && get(file, tick.nAIState) && get(file, tick.nCurrentTeam) &&
+              get(file, tick.fTurnTime) && get(file, tick.nRngState) && get(file, nTeams);
+        for (uint32_t t = 0; bOk && t < nTeams; t++) {
+            float fHealth;
+            bOk = get(file, fHealth);
+            tick.vecTeamHealth.push_back(fHealth);
+        }
+        bOk = bOk && get(file, nObjects);
+        for (uint32_t o = 0; bOk && o < nObjects; o++) {
+            ObjectState object;
+            bOk = get(file, object.nType) && get(file, object.bStable) && get(file, object.bDead) &&
+                  get(file, object.nBounceBeforeDeath) && get(file, object.px) && get(file, object.py) &&
+                  get(file, object.vx) && get(file, object.vy) && get(file, object.fHealth);
+            tick.vecObjects.push_back(object);
+        }
+        if (!bOk) {
+            std::cout << "State log " << path << " is truncated" << std::endl;
+            return false;
+        }
+        vecTicks.push_back(std::move(tick));
+    }
+    return true;
+}
+
+bool cStateLog::compare(const cStateLog &a, const cStateLog &b, const std::string &nameA, const std::string &nameB,
+                        std::ostream &out) {
+    size_t nTicks = std::min(a.vecTicks.size(), b.vecTicks.size());
+    size_t nDiverged = 0;
+    while (nDiverged < nTicks && a.vecTicks[nDiverged].nHash == b.vecTicks[nDiverged].nHash) nDiverged++;
+
+    if (nDiverged == nTicks) {
+        out << "No divergence in " << nTicks << " ticks";
+        if (a.vecTicks.size() != b.vecTicks.size()) {
+            out << " (" << nameA << " ran " << a.vecTicks.size() << " ticks, " << nameB << " ran "
+                << b.vecTicks.size() << ")";
+        }
+        out << std::endl;
+        return true;
+    }
+
+    const TickRecord &ta = a.vecTicks[nDiverged];
+    const TickRecord &tb = b.vecTicks[nDiverged];
+    out << "Runs diverge at tick " << ta.nTick << " (" << nameA << " vs " << nameB << ")" << std::endl;
+
+    if (ta.nMapHash != tb.nMapHash) {
+        for (int band = 0; band < TickRecord::MAP_BANDS; band++) {
+            if (ta.nMapBandHash[band] != tb.nMapBandHash[band]) {
+                out << "    terrain differs in band " << band << " of " << TickRecord::MAP_BANDS << std::endl;
+            }
+        }
+    }
+    diffField(out, "game state", ta.nGameState, tb.nGameState);
+    diffField(out, "ai state", ta.nAIState, tb.nAIState);
+    diffField(out, "current team", ta.nCurrentTeam, tb.nCurrentTeam);
+    diffField(out, "turn time", ta.fTurnTime, tb.fTurnTime);
+    diffField(out, "rng state", ta.nRngState, tb.nRngState);
+
+    if (ta.vecTeamHealth.size() != tb.vecTeamHealth.size()) {
+        out << "    team count: " << ta.vecTeamHealth.size() << " vs " << tb.vecTeamHealth.size() << std::endl;
+    }
+    for (size_t t = 0; t < std::min(ta.vecTeamHealth.size(), tb.vecTeamHealth.size()); t++) {
+        diffField(out, "team " + std::to_string(t) + " health", ta.vecTeamHealth[t], tb.vecTeamHealth[t]);
+    }
+
+    if (ta.vecObjects.size() != tb.vecObjects.size()) {
+        out << "    object count: " << ta.vecObjects.size() << " vs " << tb.vecObjects.size() << std::endl;
+    }
+    const int MAX_OBJECTS_REPORTED = 8;
+    int nReported = 0;
+    for (size_t o = 0; o < std::min(ta.vecObjects.size(), tb.vecObjects.size()); o++) {
+        const ObjectState &oa = ta.vecObjects[o];
+        const ObjectState &ob = tb.vecObjects[o];
+        std::string name = std::string("object ") + std::to_string(o) + " (" + objectTypeName(oa.nType) + ") ";
+        bool bDiffers = false;
+        bDiffers |= diffField(out, name + "type", static_cast<int>(oa.nType), static_cast<int>(ob.nType));
+        bDiffers |= diffField(out, name + "stable", static_cast<int>(oa.bStable), static_cast<int>(ob.bStable));
+        bDiffers |= diffField(out, name + "dead", static_cast<int>(oa.bDead), static_cast<int>(ob.bDead));
+        bDiffers |= diffField(out, name + "bounces", oa.nBounceBeforeDeath, ob.nBounceBeforeDeath);
+        bDiffers |= diffField(out, name + "px", oa.px, ob.px);
+        bDiffers |= diffField(out, name + "py", oa.py, ob.py);
+        bDiffers |= diffField(out, name + "vx", oa.vx, ob.vx);
+        bDiffers |= diffField(out, name + "vy", oa.vy, ob.vy);
+        bDiffers |= diffField(out, name + "health", oa.fHealth, ob.fHealth);
+        if (bDiffers && ++nReported == MAX_OBJECTS_REPORTED) {
+            out << "    ..." << std::endl;
+            break;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Order dependent 64 bit hash over raw bytes, 8 bytes at a time.
+// Floats go in by their bit pattern, so two runs only hash equal if they are bit for bit identical.
+class cStateHasher {
+private:
+    uint64_t nHash = 0xcbf29ce484222325ull;
+
+    void mix(uint64_t word) {
+        nHash ^= word;
+        nHash *= 0x9E3779B97F4A7C15ull;
+        nHash ^= nHash >> 32;
+    }
+
+public:
+    void add(const void *data, size_t size) {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, bytes + i, 8);
+            mix(word);
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, bytes + i, size - i);
+        mix(tail ^ (static_cast<uint64_t>(size) << 56));
+    }
+
+    template<typename T>
+    void add(const T &value) {
+        add(&value, sizeof(T));
+    }
+
+    uint64_t get() const { return nHash; }
+};
+
+enum OBJECT_TYPE : uint8_t {
+    OBJ_MAN = 0,
+    OBJ_MISSILE,
+    OBJ_DEBRIS,
+    OBJ_UNKNOWN
+};
+
+struct ObjectState {
+    uint8_t nType = OBJ_UNKNOWN;
+    uint8_t bStable = 0;
+    uint8_t bDead = 0;
+    int32_t nBounceBeforeDeath = 0;
+    float px = 0.0f;
+    float py = 0.0f;
+    float vx = 0.0f;
+    float vy = 0.0f;
+    float fHealth = 0.0f; // men only
+};
+
+// Everything about the simulation at the end of one tick that has to come out identical between runs
+struct TickRecord {
+    static const int MAP_BANDS = 8; // the map hash is also kept per horizontal band, to localise terrain drift
+
+    uint32_t nTick = 0;
+    uint64_t nHash = 0; // over everything below
+    uint64_t nMapHash = 0;
+    uint64_t nMapBandHash[MAP_BANDS] = {};
+    int32_t nGameState = 0;
+    int32_t nAIState = 0;
+    int32_t nCurrentTeam = 0;
+    float fTurnTime = 0.0f;
+    uint64_t nRngState = 0;
+    std::vector<float> vecTeamHealth;
+    std::vector<ObjectState> vecObjects;
+
+    // fills in the map hashes from the terrain bytes
+    void hashMap(const unsigned char *map, int nWidth, int nHeight);
+
+    // computes nHash once every other field is filled in
+    void finish();
+};
+
+// The per-tick records of one run
+class cStateLog {
+public:
+    std::vector<TickRecord> vecTicks;
+
+    bool save(const std::string &path) const;
+
+    bool load(const std::string &path);
+
+    // Compares two runs tick by tick and prints the first divergence with a field level diff.
+    // Returns true if the runs are identical for as long as both lasted.
+    static bool compare(const cStateLog &a, const cStateLog &b, const std::string &nameA, const std::string &nameB,
+                        std::ostream &out);
+};
@@ -0,0 +1,252 @@
+#include "TerrainRle.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    void putVarint(std::vector<uint8_t> &out, uint32_t nValue) {
+        while (nValue >= 0x80) {
+            out.push_back(static_cast<uint8_t>(nValue | 0x80));
+            nValue >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(nValue));
+    }
+
+    // false when it runs past pEnd or is longer than a uint32_t takes
+    bool getVarint(const uint8_t *&p, const uint8_t *pEnd, uint32_t &nValue) {
+        nValue = 0;
+        for (int nShift = 0; nShift < 35; nShift += 7) {
+            if (p == pEnd) return false;
+            uint8_t nByte = *p++;
+            nValue |= static_cast<uint32_t>(nByte & 0x7F) << nShift;
+            if (!(nByte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // what a run without a value of its own holds
+    uint8_t getImpliedValue(uint8_t nPrevious) {
+        return nPrevious == 0 ? 1 : 0;
+    }
+
+    void putRun(std::vector<uint8_t> &out, int nLength, uint8_t nValue, uint8_t nPrevious) {
+        uint32_t nToken = static_cast<uint32_t>(nLength - 1) << 1;
+        if (nValue == getImpliedValue(nPrevious)) {
+            putVarint(out, nToken);
+        } else {
+            putVarint(out, nToken | 1);
+            out.push_back(nValue);
+        }
+    }
+
+    // Calls change(x, y) for every pixel below the top row that differs from the one above it, row by row
+    template<typename Change>
+    void forEachRowChange(const unsigned char *map, int nWidth, int nHeight, Change &&change) {
+        const size_t nStride = static_cast<size_t>(nWidth);
+        for (int y = 1; y < nHeight; y++) {
+            const unsigned char *row = map + y * nStride;
+            const unsigned char *above = row - nStride;
+            // most rows are the row above, and of the others most pixels
+            if (memcmp(row, above, nStride) == 0) continue;
+            int x = 0;
+            for (; x + 8 <= nWidth; x += 8) {
+                uint64_t nRow, nAbove;
+                memcpy(&nRow, row + x, sizeof(nRow));
+                memcpy(&nAbove, above + x, sizeof(nAbove));
+                if (nRow == nAbove) continue;
+                for (int i = x; i < x + 8; i++) {
+                    if (row[i] != above[i]) change(i, y);
+                }
+            }
+            for (; x < nWidth; x++) {
+                if (row[x] != above[x]) change(x, y);
+            }
+        }
+    }
+
+    // The run at p, coming after a run of nValue which it is then replaced with. nLength is anything from 1 to
+    // 2^31 here, load makes sure every run it takes fits into its column.
+    bool getRun(const uint8_t *&p, const uint8_t *pEnd, uint32_t &nLength, uint8_t &nValue) {
+        uint32_t nToken;
+        if (!getVarint(p, pEnd, nToken)) return false;
+        nLength = (nToken >> 1) + 1;
+        if (!(nToken & 1)) {
+            nValue = getImpliedValue(nValue);
+            return true;
+        }
+        if (p == pEnd) return false;
+        nValue = *p++;
+        return true;
+    }
+}
+
+void cTerrainRle::encode(const unsigned char *map, int nWidth, int nHeight) {
+    // a map without pixels is one of 0 x 0
+    bool bEmpty = nWidth <= 0 || nHeight <= 0;
+    this->nWidth = bEmpty ? 0 : nWidth;
+    this->nHeight = bEmpty ? 0 : nHeight;
+    vecData.clear();
+    putVarint(vecData, static_cast<uint32_t>(this->nWidth));
+    putVarint(vecData, static_cast<uint32_t>(this->nHeight));
+    vecColumnOffset.resize(this->nWidth + 1);
+    if (bEmpty) {
+        vecColumnOffset[0] = static_cast<uint32_t>(vecData.size());
+        return;
+    }
+
+    // Going down a column touches a cache line per pixel, so the runs are found going along the rows instead:
+    // a run starts wherever a pixel differs from the one above. They are then sorted into columns, with their
+    // values, looking those up later would be a cache miss each.
+    const size_t nStride = static_cast<size_t>(nWidth);
+    struct RunStart {
+        int x;
+        int y;
+        uint8_t nValue;
+    };
+    std::vector<RunStart> vecChanges;
+    vecChanges.reserve(nWidth * 4);
+    std::vector<uint32_t> vecRunStart(nWidth + 1, 0); // of every column's run starts below the top, in vecStarts
+    forEachRowChange(map, nWidth, nHeight, [&](int x, int y) {
+        vecChanges.push_back({x, y, map[y * nStride + x]});
+        vecRunStart[x + 1]++;
+    });
+    for (int x = 0; x < nWidth; x++) vecRunStart[x + 1] += vecRunStart[x];
+    std::vector<std::pair<int, uint8_t>> vecStarts(vecChanges.size());
+    std::vector<uint32_t> vecNext(vecRunStart.begin(), vecRunStart.end() - 1);
+    for (const RunStart &start: vecChanges) {
+        vecStarts[vecNext[start.x]++] = {start.y, start.nValue};
+    }
+
+    for (int x = 0; x < nWidth; x++) {
+        vecColumnOffset[x] = static_cast<uint32_t>(vecData.size());
+        uint8_t nPrevious = 1;
+        uint8_t nValue = map[x];
+        int y = 0;
+        for (uint32_t i = vecRunStart[x]; i <= vecRunStart[x + 1]; i++) {
+            int nEnd = i < vecRunStart[x + 1] ? vecStarts[i].first : nHeight;
+            putRun(vecData, nEnd - y, nValue, nPrevious);
+            nPrevious = nValue;
+            if (i < vecRunStart[x + 1]) nValue = vecStarts[i].second;
+            y = nEnd;
+        }
+    }
+    vecColumnOffset[nWidth] = static_cast<uint32_t>(vecData.size());
+}
+
+bool cTerrainRle::load(const uint8_t *pData, size_t nSize) {
+    nWidth = 0;
+    nHeight = 0;
+    vecData.clear();
+    vecColumnOffset.clear();
+    const uint8_t *p = pData;
+    const uint8_t *pEnd = pData + nSize;
+    uint32_t nLoadWidth, nLoadHeight;
+    if (!getVarint(p, pEnd, nLoadWidth) || !getVarint(p, pEnd, nLoadHeight) || nLoadWidth > INT32_MAX ||
+        nLoadHeight > INT32_MAX) {
+        return false;
+    }
+    // every column holds a run at least, a byte each
+    if ((nLoadWidth == 0) != (nLoadHeight == 0) || nLoadWidth > static_cast<size_t>(pEnd - p)) return false;
+    std::vector<uint32_t> vecOffsets(nLoadWidth + 1);
+    for (uint32_t x = 0; x < nLoadWidth; x++) {
+        vecOffsets[x] = static_cast<uint32_t>(p - pData);
+        uint8_t nValue = 1;
+        uint32_t nFilled = 0;
+        while (nFilled < nLoadHeight) {
+            uint32_t nLength;
+            if (!getRun(p, pEnd, nLength, nValue)) return false;
+            // a run running past the bottom of its column would have decode write past the map
+            if (nLength < 1 || nLength > nLoadHeight - nFilled) return false;
+            nFilled += nLength;
+        }
+    }
+    if (p != pEnd) return false;
+    vecOffsets[nLoadWidth] = static_cast<uint32_t>(nSize);
+    nWidth = static_cast<int>(nLoadWidth);
+    nHeight = static_cast<int>(nLoadHeight);
+    vecData.assign(pData, pEnd);
+    vecColumnOffset = std::move(vecOffsets);
+    return true;
+}
+
+const std::vector<uint8_t> &cTerrainRle::getData() const {
+    return vecData;
+}
+
+int cTerrainRle::getWidth() const {
+    return nWidth;
+}
+
+int cTerrainRle::getHeight() const {
+    return nHeight;
+}
+
+bool cTerrainRle::decode(unsigned char *map) const {
+    if (nWidth == 0) return true;
+    // Row by row, for the same reason encode goes along the rows: the top row out of the first runs, every row
+    // below a copy of the one above with the runs starting in it written over it
+    const uint8_t *pEnd = vecData.data() + vecData.size();
+    const size_t nStride = static_cast<size_t>(nWidth);
+    std::vector<uint32_t> vecRowStart(nHeight + 1, 0); // of every row's run starts in vecStarts
+    auto forEachRun = [&](auto &&run) {
+        for (int x = 0; x < nWidth; x++) {
+            const uint8_t *p = vecData.data() + vecColumnOffset[x];
+            uint8_t nValue = 1;
+            int y = 0;
+            while (y < nHeight) {
+                uint32_t nLength;
+                if (!getRun(p, pEnd, nLength, nValue) || nLength > static_cast<uint32_t>(nHeight - y)) return false;
+                run(x, y, nValue);
+                y += static_cast<int>(nLength);
+            }
+        }
+        return true;
+    };
+    bool bWhole = forEachRun([&](int x, int y, uint8_t nValue) {
+        if (y == 0) {
+            map[x] = nValue;
+        } else {
+            vecRowStart[y + 1]++;
+        }
+    });
+    if (!bWhole) return false;
+    for (int y = 0; y < nHeight; y++) vecRowStart[y + 1] += vecRowStart[y];
+    std::vector<std::pair<int, uint8_t>> vecStarts(vecRowStart[nHeight]);
+    std::vector<uint32_t> vecNext(vecRowStart.begin(), vecRowStart.end() - 1);
+    forEachRun([&](int x, int y, uint8_t nValue) {
+        if (y > 0) vecStarts[vecNext[y]++] = {x, nValue};
+    });
+    for (int y = 1; y < nHeight; y++) {
+        unsigned char *row = map + y * nStride;
+        memcpy(row, row - nStride, nStride);
+        for (uint32_t i = vecRowStart[y]; i < vecRowStart[y + 1]; i++) row[vecStarts[i].first] = vecStarts[i].second;
+    }
+    return true;
+}
+
+bool cTerrainRle::decodeColumn(int x, unsigned char *pColumn) const {
+    const uint8_t *p = vecData.data() + vecColumnOffset[x];
+    const uint8_t *pEnd = vecData.data() + vecColumnOffset[x + 1];
+    uint8_t nValue = 1;
+    int y = 0;
+    while (y < nHeight) {
+        uint32_t nLength;
+        if (!getRun(p, pEnd, nLength, nValue) || nLength > static_cast<uint32_t>(nHeight - y)) return false;
+        memset(pColumn + y, nValue, nLength);
+        y += static_cast<int>(nLength);
+    }
+    return true;
+}
+
+int cTerrainRle::getColumnTop(int x) const {
+    const uint8_t *p = vecData.data() + vecColumnOffset[x];
+    const uint8_t *pEnd = vecData.data() + vecColumnOffset[x + 1];
+    uint8_t nValue = 1;
+    int y = 0;
+    while (y < nHeight) {
+        uint32_t nLength;
+        if (!getRun(p, pEnd, nLength, nValue)) return -1;
+        if (nValue != 0) return y;
+        y += static_cast<int>(std::min(nLength, static_cast<uint32_t>(nHeight - y)));
+    }
+    return nHeight;
+}
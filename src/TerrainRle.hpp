@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The map run-length coded down every column. After createMap a column is air over a run for each layer of
+// land and every crater through it adds two runs more, so a whole map comes to a few bytes per column. Any
+// column can be decoded on its own.
+//
+// Bytes: varint width | varint height | the columns left to right, each its runs top down as
+//   varint ((length - 1) << 1 | bValue) | u8 value if bValue
+// where a run without a value of its own is soil (1) after air and air (0) after anything else, the first run
+// of a column coming after land.
+class cTerrainRle {
+public:
+    void encode(const unsigned char *map, int nWidth, int nHeight);
+
+    // Takes bytes encode made (read from a file or a packet, say), false unless they hold a whole map
+    bool load(const uint8_t *pData, size_t nSize);
+
+    const std::vector<uint8_t> &getData() const;
+
+    int getWidth() const;
+
+    int getHeight() const;
+
+    // The whole map into one of getWidth() x getHeight(). false if the runs don't make up the map, which only
+    // happens to bytes load didn't check; map is left half written then.
+    bool decode(unsigned char *map) const;
+
+    // column x top down into pColumn, getHeight() values, false like decode
+    bool decodeColumn(int x, unsigned char *pColumn) const;
+
+    // the first y of column x that isn't air, getHeight() if there is none, -1 if its runs are cut short
+    int getColumnTop(int x) const;
+
+private:
+    // breaks the bytes behind load's back, to check the decoders don't trust them
+    friend class FaujiTests;
+
+    int nWidth = 0;
+    int nHeight = 0;
+    std::vector<uint8_t> vecData;
+    std::vector<uint32_t> vecColumnOffset; // of every column's first run in vecData, and of the end
+};
@@ -0,0 +1,244 @@
+#include "TerrainSettler.hpp"
+#include "Materials.hpp"
+#include <cstring>
+
+namespace {
+    // A row of a chunk is worked on in a buffer holding PAD pixels more on either side, so that the pixels
+    // beside the chunk are at hand and 8 pixels at a time can be loaded shifted by one
+    const int PAD = 8;
+    const int ROW_BUFFER = cTerrainSettler::CHUNK_SIZE + 2 * PAD;
+
+    uint64_t loadWord(const unsigned char *p) {
+        uint64_t nWord;
+        memcpy(&nWord, p, sizeof(nWord));
+        return nWord;
+    }
+
+    void storeWord(unsigned char *p, uint64_t nWord) {
+        memcpy(p, &nWord, sizeof(nWord));
+    }
+
+    // 0xFF in every byte of nWord that isn't 0, 0 in the others
+    uint64_t nonZeroBytes(uint64_t nWord) {
+        const uint64_t LOW_BITS = 0x7F7F7F7F7F7F7F7FULL;
+        uint64_t nHighBits = (((nWord & LOW_BITS) + LOW_BITS) | nWord) & ~LOW_BITS;
+        return (nHighBits >> 7) * 0xFF;
+    }
+
+    // the materials of some kind, each value in all 8 bytes of a word
+    struct MaterialSet {
+        int nCount = 0;
+        uint64_t nBroadcast[MATERIAL_COUNT];
+    };
+
+    // 0xFF in every byte of nWord that holds a material of set, 0 in the others
+    uint64_t materialBytes(uint64_t nWord, const MaterialSet &set) {
+        uint64_t nBytes = 0;
+        for (int i = 0; i < set.nCount; i++) nBytes |= ~nonZeroBytes(nWord ^ set.nBroadcast[i]);
+        return nBytes;
+    }
+
+    // the land that stays where it is (bedrock), and the land that falls but doesn't slide (rock)
+    const MaterialSet &getFixedMaterials() {
+        static const MaterialSet set = [] {
+            MaterialSet fixed;
+            for (int m = MATERIAL_SKY + 1; m < MATERIAL_COUNT; m++) {
+                if (!getMaterialInfo(m).bFalls) fixed.nBroadcast[fixed.nCount++] = m * 0x0101010101010101ULL;
+            }
+            return fixed;
+        }();
+        return set;
+    }
+
+    const MaterialSet &getStackingMaterials() {
+        static const MaterialSet set = [] {
+            MaterialSet stacking;
+            for (int m = MATERIAL_SKY + 1; m < MATERIAL_COUNT; m++) {
+                const MaterialInfo &info = getMaterialInfo(m);
+                if (info.bFalls && !info.bSlides) stacking.nBroadcast[stacking.nCount++] = m * 0x0101010101010101ULL;
+            }
+            return stacking;
+        }();
+        return set;
+    }
+
+    // Row y from x0 - PAD on into buffer. Off the map is land, nothing slides out of it.
+    void loadRow(const unsigned char *map, int nWidth, int y, int x0, unsigned char *buffer) {
+        memset(buffer, 1, ROW_BUFFER);
+        int xFrom = std::max(x0 - PAD, 0);
+        int xTo = std::min(x0 - PAD + ROW_BUFFER, nWidth);
+        memcpy(buffer + xFrom - (x0 - PAD), map + static_cast<size_t>(y) * nWidth + xFrom, xTo - xFrom);
+    }
+
+    // pixels xFrom to xTo of row y back from buffer, which loadRow filled from x0 - PAD on
+    void storeRow(unsigned char *map, int nWidth, int y, int x0, int xFrom, int xTo, const unsigned char *buffer) {
+        xFrom = std::max(xFrom, 0);
+        xTo = std::min(xTo, nWidth);
+        memcpy(map + static_cast<size_t>(y) * nWidth + xFrom, buffer + xFrom - (x0 - PAD), xTo - xFrom);
+    }
+}
+
+void cTerrainSettler::reset(int nWidth, int nHeight) {
+    this->nWidth = std::max(nWidth, 0);
+    this->nHeight = std::max(nHeight, 0);
+    nChunksX = (this->nWidth + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    nChunksY = (this->nHeight + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    vecActive.clear();
+    vecIsActive.assign(nChunksX * nChunksY, 0);
+    vecChanged.clear();
+    vecIsChanged.assign(nChunksX * nChunksY, 0);
+}
+
+void cTerrainSettler::activate(int x, int y, int w, int h) {
+    // and a pixel around, the land beside and on top of it may have leant on the rectangle
+    int x0 = std::max(x - 1, 0);
+    int y0 = std::max(y - 1, 0);
+    int x1 = std::min(x + w + 1, nWidth);
+    int y1 = std::min(y + h + 1, nHeight);
+    if (x0 >= x1 || y0 >= y1) return;
+    for (int cy = y0 / CHUNK_SIZE; cy <= (y1 - 1) / CHUNK_SIZE; cy++) {
+        for (int cx = x0 / CHUNK_SIZE; cx <= (x1 - 1) / CHUNK_SIZE; cx++) {
+            queue(cx, cy);
+        }
+    }
+}
+
+bool cTerrainSettler::isIdle() const {
+    return vecActive.empty();
+}
+
+int cTerrainSettler::getActiveChunkCount() const {
+    return static_cast<int>(vecActive.size());
+}
+
+void cTerrainSettler::save(std::vector<uint32_t> &vecChunks) const {
+    vecChunks = vecActive;
+}
+
+void cTerrainSettler::restore(int nWidth, int nHeight, const std::vector<uint32_t> &vecChunks) {
+    reset(nWidth, nHeight);
+    for (uint32_t nChunk: vecChunks) {
+        queue(static_cast<int>(nChunk % nChunksX), static_cast<int>(nChunk / nChunksX));
+    }
+}
+
+void cTerrainSettler::queue(int cx, int cy) {
+    if (cx < 0 || cx >= nChunksX || cy < 0 || cy >= nChunksY) return;
+    uint32_t nChunk = static_cast<uint32_t>(cy * nChunksX + cx);
+    if (vecIsActive[nChunk]) return;
+    vecIsActive[nChunk] = 1;
+    vecActive.push_back(nChunk);
+}
+
+void cTerrainSettler::step(unsigned char *map, bool bSlideLeft) {
+    vecStep.swap(vecActive);
+    vecActive.clear();
+    for (uint32_t nChunk: vecStep) vecIsActive[nChunk] = 0;
+    // the bottom row of chunks first, what falls out of a chunk lands in one that already took its step
+    std::sort(vecStep.begin(), vecStep.end(), [this](uint32_t a, uint32_t b) {
+        uint32_t ya = a / nChunksX;
+        uint32_t yb = b / nChunksX;
+        return ya != yb ? ya > yb : a < b;
+    });
+    size_t nUpdated = std::min(vecStep.size(), static_cast<size_t>(MAX_CHUNKS_PER_STEP));
+    for (size_t i = nUpdated; i < vecStep.size(); i++) {
+        queue(static_cast<int>(vecStep[i] % nChunksX), static_cast<int>(vecStep[i] / nChunksX));
+    }
+    for (size_t i = 0; i < nUpdated; i++) {
+        uint32_t nChunk = vecStep[i];
+        if (!settleChunk(map, nChunk, bSlideLeft)) continue;
+        if (!vecIsChanged[nChunk]) {
+            vecIsChanged[nChunk] = 1;
+            vecChanged.push_back(nChunk);
+        }
+        // what moved may have let go of land in the chunks around, or not come to rest yet
+        int cx = static_cast<int>(nChunk % nChunksX);
+        int cy = static_cast<int>(nChunk / nChunksX);
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) queue(cx + dx, cy + dy);
+        }
+    }
+}
+
+bool cTerrainSettler::settleChunk(unsigned char *map, uint32_t nChunk, bool bSlideLeft) const {
+    const int x0 = static_cast<int>(nChunk % nChunksX) * CHUNK_SIZE;
+    const int y0 = static_cast<int>(nChunk / nChunksX) * CHUNK_SIZE;
+    const int w = std::min(CHUNK_SIZE, nWidth - x0);
+    const int nWords = (w + 7) / 8;
+    // the bottom row of the map has nowhere to go
+    const int yLast = std::min(y0 + CHUNK_SIZE, nHeight - 1) - 1;
+    // Word k of a buffer holds the pixels x0 - PAD + 8 * k on, the chunk's are in words 1 to nWords. What
+    // moves is worked out for all 8 pixels of a word at once, a byte each, with masks of 0xFF or 0 per byte.
+    alignas(8) unsigned char row[ROW_BUFFER];
+    alignas(8) unsigned char below[ROW_BUFFER];
+    alignas(8) unsigned char movable[ROW_BUFFER]; // the chunk's pixels of row that fall, nothing outside it moves
+    alignas(8) unsigned char moved[ROW_BUFFER];   // of the pixels slid into below, where they came to
+    const MaterialSet &fixed = getFixedMaterials();
+    const MaterialSet &stacking = getStackingMaterials();
+    bool bChunkMoved = false;
+    // bottom up, a pixel falls a row a step and the row below has made room for it already
+    for (int y = yLast; y >= y0; y--) {
+        memset(movable, 0, ROW_BUFFER);
+        memcpy(movable + PAD, map + static_cast<size_t>(y) * nWidth + x0, w);
+        uint64_t nAnyLand = 0;
+        for (int k = 1; k <= nWords; k++) {
+            uint64_t nLand = loadWord(movable + 8 * k);
+            if (fixed.nCount != 0 && nLand != 0) {
+                nLand &= ~materialBytes(nLand, fixed);
+                storeWord(movable + 8 * k, nLand);
+            }
+            nAnyLand |= nLand;
+        }
+        if (nAnyLand == 0) continue;
+        loadRow(map, nWidth, y + 1, x0, below);
+        // land all the way under the chunk and a pixel to either side, nothing can move
+        uint64_t nAllLand = ~0ULL;
+        for (int k = 0; k <= nWords + 1; k++) nAllLand &= nonZeroBytes(loadWord(below + 8 * k));
+        if (nAllLand == ~0ULL) continue;
+        loadRow(map, nWidth, y, x0, row);
+
+        // what has sky under it falls
+        uint64_t nRowMoved = 0;
+        for (int k = 1; k <= nWords; k++) {
+            uint64_t nLand = loadWord(movable + 8 * k);
+            uint64_t nBelow = loadWord(below + 8 * k);
+            uint64_t nFall = nonZeroBytes(nLand) & ~nonZeroBytes(nBelow);
+            if (nFall == 0) continue;
+            storeWord(below + 8 * k, nBelow | (nLand & nFall));
+            storeWord(movable + 8 * k, nLand & ~nFall);
+            storeWord(row + 8 * k, loadWord(row + 8 * k) & ~nFall);
+            nRowMoved |= nFall;
+        }
+
+        // What is left slides down to the side, into the pixel below where both it and the one above are sky,
+        // unless it is of a material that stacks up instead. Worked out by the pixel slid into, which has the
+        // pixel that slides next to it in the row above.
+        memset(moved, 0, ROW_BUFFER);
+        int nShift = bSlideLeft ? 1 : -1;           // from the pixel slid into to the one that slides
+        int kFirst = bSlideLeft ? 0 : 1;            // the words pixels of the chunk can slide into
+        int kLast = bSlideLeft ? nWords : nWords + 1;
+        uint64_t nSlid = 0;
+        for (int k = kFirst; k <= kLast; k++) {
+            uint64_t nLand = loadWord(movable + 8 * k + nShift);
+            if (nLand == 0) continue;
+            uint64_t nBelow = loadWord(below + 8 * k);
+            uint64_t nSlide = nonZeroBytes(nLand) & ~nonZeroBytes(nBelow) & ~nonZeroBytes(loadWord(row + 8 * k));
+            if (nSlide != 0 && stacking.nCount != 0) nSlide &= ~materialBytes(nLand, stacking);
+            if (nSlide == 0) continue;
+            storeWord(below + 8 * k, nBelow | (nLand & nSlide));
+            storeWord(moved + 8 * k, nSlide);
+            nSlid |= nSlide;
+        }
+        if (nSlid != 0) {
+            for (int k = 1; k <= nWords; k++) {
+                storeWord(row + 8 * k, loadWord(row + 8 * k) & ~loadWord(moved + 8 * k - nShift));
+            }
+        }
+
+        if ((nRowMoved | nSlid) == 0) continue;
+        storeRow(map, nWidth, y, x0, x0, x0 + w, row);
+        storeRow(map, nWidth, y + 1, x0, x0 - 1, x0 + w + 1, below);
+        bChunkMoved = true;
+    }
+    return bChunkMoved;
+}
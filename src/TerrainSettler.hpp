@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Lets the land a crater undermined fall and settle, as a cellular automaton on the map: a land pixel over sky
+// falls a row, and one that can't slides a row down to the side where both the pixel beside it and the one
+// below that are sky, so loose land comes to rest in heaps no steeper than 45 degrees. Pixels keep their
+// materials when they move, and go by them: bedrock stays where it is, rock falls but doesn't slide, it can
+// stand steeper (see Materials.hpp).
+//
+// Only the chunks of CHUNK_SIZE x CHUNK_SIZE pixels something may move in are updated: those a crater touched,
+// and those around a chunk something moved in the step before. A chunk in which nothing moved drops out, so
+// the settler goes idle once everything has come to rest. A step updates at most MAX_CHUNKS_PER_STEP chunks,
+// the lowest first, the others wait for the next one; a nuke levelling a hillside takes longer then rather
+// than the tick.
+//
+// What a tick moves depends only on the map, the chunks that are active and the tick, so a spectator stream's
+// viewer settles its craters the same way the match did.
+class cTerrainSettler {
+public:
+    static const int CHUNK_SIZE = 32;
+    static const int STEPS_PER_TICK = 4;       // rows loose land falls in a tick
+    static const int MAX_CHUNKS_PER_STEP = 384;
+
+    // a map of nWidth x nHeight with nothing loose on it
+    void reset(int nWidth, int nHeight);
+
+    // Land in and around the rectangle may have lost what held it up (a crater was carved there, say)
+    void activate(int x, int y, int w, int h);
+
+    bool isIdle() const;
+
+    int getActiveChunkCount() const;
+
+    // STEPS_PER_TICK steps of tick nTick on map, of the size reset was given. changed(x, y, w, h) is called
+    // afterwards for the rectangles the pixels that moved are in.
+    template<typename Changed>
+    void tick(unsigned char *map, uint32_t nTick, Changed &&changed) {
+        if (vecActive.empty()) return;
+        for (int s = 0; s < STEPS_PER_TICK; s++) {
+            // which way pixels slide alternates, so heaps come out even
+            step(map, (nTick * STEPS_PER_TICK + s) % 2 == 0);
+        }
+        // the chunks that changed, a rectangle for every run of them along a row of chunks, reaching a pixel
+        // to the sides and below where what slid and fell out of them landed
+        std::sort(vecChanged.begin(), vecChanged.end());
+        for (size_t i = 0; i < vecChanged.size();) {
+            size_t j = i + 1;
+            while (j < vecChanged.size() && vecChanged[j] == vecChanged[j - 1] + 1 &&
+                   vecChanged[j] % nChunksX != 0) {
+                j++;
+            }
+            int x = (vecChanged[i] % nChunksX) * CHUNK_SIZE;
+            int y = (vecChanged[i] / nChunksX) * CHUNK_SIZE;
+            changed(x - 1, y, static_cast<int>(j - i) * CHUNK_SIZE + 2, CHUNK_SIZE + 1);
+            i = j;
+        }
+        for (uint32_t nChunk: vecChanged) vecIsChanged[nChunk] = 0;
+        vecChanged.clear();
+    }
+
+    // the active chunks, for a state the match is restored to later
+    void save(std::vector<uint32_t> &vecChunks) const;
+
+    void restore(int nWidth, int nHeight, const std::vector<uint32_t> &vecChunks);
+
+private:
+    int nWidth = 0;
+    int nHeight = 0;
+    int nChunksX = 0;
+    int nChunksY = 0;
+    std::vector<uint32_t> vecActive;   // chunks for the next step
+    std::vector<uint8_t> vecIsActive;  // of every chunk, whether it is in vecActive
+    std::vector<uint32_t> vecStep;     // the chunks of the step running
+    std::vector<uint32_t> vecChanged;  // chunks something moved in during the tick
+    std::vector<uint8_t> vecIsChanged;
+
+    void queue(int cx, int cy);
+
+    void step(unsigned char *map, bool bSlideLeft);
+
+    // one step of the chunk, whether anything moved
+    bool settleChunk(unsigned char *map, uint32_t nChunk, bool bSlideLeft) const;
+};
@@ -0,0 +1,24 @@
+#include "Weapons.hpp"
+
+namespace {
+    // Tune the weapons here. The missile is the one the AI planner simulates, see ShotParams.
+    const WeaponInfo WEAPONS[WEAPON_COUNT] = {
+            // name          select radius friction bounces speed  fuse  blast  releases        count speed  spread  color
+            {"Missile",      true,  5.0f,  0.5f,    1,      40.0f, 0.0f, 30.0f, WEAPON_MISSILE, 0,    0.0f,  0.0f,   {0xFF, 0x00, 0x00}},
+            {"Cluster bomb", true,  5.0f,  0.5f,    1,      40.0f, 0.0f, 15.0f, WEAPON_BOMBLET, 12,   20.0f, 0.0f,   {0xFF, 0x80, 0x00}},
+            {"Bomblet",      false, 2.0f,  0.5f,    1,      0.0f,  0.0f, 10.0f, WEAPON_MISSILE, 0,    0.0f,  0.0f,   {0xFF, 0xC0, 0x00}},
+            {"Grenade",      true,  4.0f,  0.6f,    -1,     30.0f, 3.0f, 40.0f, WEAPON_MISSILE, 0,    0.0f,  0.0f,   {0x20, 0x40, 0x20}},
+            {"Airstrike",    true,  3.0f,  0.5f,    1,      40.0f, 0.0f, 0.0f,  WEAPON_MISSILE, 6,    0.0f,  150.0f, {0x80, 0x00, 0x80}},
+    };
+}
+
+const WeaponInfo &getWeaponInfo(WEAPON nWeapon) {
+    return WEAPONS[nWeapon];
+}
+
+WEAPON getNextSelectableWeapon(WEAPON nWeapon) {
+    do {
+        nWeapon = static_cast<WEAPON>((nWeapon + 1) % WEAPON_COUNT);
+    } while (!WEAPONS[nWeapon].bSelectable);
+    return nWeapon;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "SimpleGameEngine.hpp"
+
+enum WEAPON {
+    WEAPON_MISSILE = 0,
+    WEAPON_CLUSTER_BOMB,
+    WEAPON_BOMBLET,
+    WEAPON_GRENADE,
+    WEAPON_AIRSTRIKE,
+    WEAPON_COUNT
+};
+
+// How a projectile flies and what happens when it goes off. Every projectile is a cMissile set up from
+// one of these rows, the game has no code of its own for any particular weapon.
+struct WeaponInfo {
+    const char *name;
+    bool bSelectable;        // false for what only ever comes out of another weapon
+    float fRadius;
+    float fFriction;
+    int nBounceBeforeDeath;  // -1 bounces until the fuse runs out
+    float fMagFireVelocity;  // launch speed at full energy
+    float fFuseTime;         // seconds until it goes off by itself, 0 for none
+    float fBlastRadius;      // crater and damage radius, 0 makes no crater
+    WEAPON nReleases;        // what it lets loose when it goes off
+    int nReleaseCount;
+    float fReleaseSpeed;     // bomblets burst upwards this fast
+    float fReleaseSpread;    // an airstrike drops its missiles over this width around the impact
+    Color color;
+};
+
+const WeaponInfo &getWeaponInfo(WEAPON nWeapon);
+
+// the next weapon a player can pick after nWeapon
+WEAPON getNextSelectableWeapon(WEAPON nWeapon);
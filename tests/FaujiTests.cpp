@@ -0,0 +1,672 @@
+#include "Fauji.hpp"
+#include "Profiler.hpp"
+#include "TerrainRle.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless checks of the game's parts that have to hold exactly, run by ctest. Every case is seeded, a failing
+// one prints what it checked and the run exits with 1.
+
+class FaujiTests {
+private:
+    uint64_t nSeed = 1;
+    int nChecks = 0;
+    int nFailures = 0;
+
+    void check(bool bPassed, const std::string &what) {
+        nChecks++;
+        if (bPassed) return;
+        nFailures++;
+        std::cout << "FAILED: " << what << std::endl;
+    }
+
+    // a headless game with a generated map, without units
+    static void initGame(Fauji &game, uint64_t nSeed, int nMapWidth, int nMapHeight) {
+        game.setMapSize(nMapWidth, nMapHeight);
+        game.setSeed(nSeed);
+        game.onInit();
+        game.createMap();
+    }
+
+    // a generated map with nCraters craters blown into it, or noise for nCraters < 0. The terrain noise wants a
+    // width of 128 at least.
+    std::vector<unsigned char> makeMap(int nCraters, int nWidth, int nHeight) {
+        Fauji game(true);
+        initGame(game, nSeed, nWidth, nHeight);
+        Random rng(nSeed);
+        for (int i = 0; i < nCraters; i++) {
+            game.BOOM(rng.nextFloat() * game.nMapWidth, game.nMapHeight * (0.3f + 0.7f * rng.nextFloat()),
+                      10.0f + 50.0f * rng.nextFloat());
+        }
+        game.listObjects.clear();
+        std::vector<unsigned char> vecMap(game.map, game.map + static_cast<size_t>(nWidth) * nHeight);
+        if (nCraters < 0) {
+            for (auto &pixel: vecMap) pixel = static_cast<unsigned char>(rng.nextInt(3));
+        }
+        return vecMap;
+    }
+
+    // Whether terrain holds map exactly, all of it, column by column and through its bytes
+    static bool checkTerrainRle(const cTerrainRle &terrain, const std::vector<unsigned char> &vecMap, int nWidth,
+                                int nHeight) {
+        if (terrain.getWidth() != nWidth || terrain.getHeight() != nHeight) return false;
+        std::vector<unsigned char> vecDecoded(vecMap.size(), 0xFF);
+        terrain.decode(vecDecoded.data());
+        if (vecDecoded != vecMap) return false;
+        std::vector<unsigned char> vecColumn(nHeight);
+        for (int x = 0; x < nWidth; x++) {
+            terrain.decodeColumn(x, vecColumn.data());
+            int nTop = nHeight;
+            for (int y = 0; y < nHeight; y++) {
+                if (vecColumn[y] != vecMap[static_cast<size_t>(y) * nWidth + x]) return false;
+                if (vecColumn[y] != 0 && nTop == nHeight) nTop = y;
+            }
+            if (terrain.getColumnTop(x) != nTop) return false;
+        }
+        cTerrainRle loaded;
+        const std::vector<uint8_t> &vecBytes = terrain.getData();
+        return loaded.load(vecBytes.data(), vecBytes.size()) && loaded.getData() == vecBytes;
+    }
+
+    // load has to turn bytes down, and leave an empty map behind when it does
+    void checkRejected(const std::vector<uint8_t> &vecBytes, const std::string &what) {
+        cTerrainRle terrain;
+        std::vector<unsigned char> vecMap(4, 0);
+        terrain.encode(vecMap.data(), 2, 2);
+        bool bLoaded = terrain.load(vecBytes.data(), vecBytes.size());
+        check(!bLoaded && terrain.getWidth() == 0 && terrain.getHeight() == 0, "terrain rle rejects " + what);
+    }
+
+    static void putVarint(std::vector<uint8_t> &out, uint32_t nValue) {
+        while (nValue >= 0x80) {
+            out.push_back(static_cast<uint8_t>(nValue | 0x80));
+            nValue >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(nValue));
+    }
+
+    void testTerrainRleRoundTrip() {
+        for (int nCraters: {0, 50, 400, -1}) {
+            std::vector<unsigned char> vecMap = makeMap(nCraters, 1024, 512);
+            cTerrainRle terrain;
+            terrain.encode(vecMap.data(), 1024, 512);
+            check(checkTerrainRle(terrain, vecMap, 1024, 512),
+                  "terrain rle round trip, craters=" + std::to_string(nCraters));
+        }
+        // odd sizes, a column of one pixel and every value a byte takes
+        const std::pair<int, int> sizes[] = {{1, 1}, {1, 300}, {300, 1}, {13, 7}};
+        for (auto size: sizes) {
+            Random rng(nSeed);
+            std::vector<unsigned char> vecMap(static_cast<size_t>(size.first) * size.second);
+            for (auto &pixel: vecMap) pixel = static_cast<unsigned char>(rng.nextInt(256));
+            cTerrainRle terrain;
+            terrain.encode(vecMap.data(), size.first, size.second);
+            check(checkTerrainRle(terrain, vecMap, size.first, size.second),
+                  "terrain rle round trip, " + std::to_string(size.first) + "x" + std::to_string(size.second));
+        }
+        cTerrainRle empty;
+        empty.encode(nullptr, 0, 0);
+        cTerrainRle loaded;
+        check(loaded.load(empty.getData().data(), empty.getData().size()) && loaded.getWidth() == 0 &&
+              loaded.getHeight() == 0, "terrain rle round trip, empty map");
+    }
+
+    void testTerrainRleMalformed() {
+        std::vector<unsigned char> vecMap = makeMap(20, 256, 96);
+        cTerrainRle terrain;
+        terrain.encode(vecMap.data(), 256, 96);
+        const std::vector<uint8_t> &vecBytes = terrain.getData();
+        // cut short anywhere it is no map at all
+        bool bAllRejected = true;
+        for (size_t nSize = 0; nSize < vecBytes.size(); nSize++) {
+            cTerrainRle truncated;
+            bAllRejected &= !truncated.load(vecBytes.data(), nSize);
+        }
+        check(bAllRejected, "terrain rle rejects every truncation");
+        std::vector<uint8_t> vecTrailing = vecBytes;
+        vecTrailing.push_back(0);
+        checkRejected(vecTrailing, "bytes after the last column");
+
+        // a column of 16 pixels, 1 x 16
+        auto column = [](std::initializer_list<uint32_t> tokens) {
+            std::vector<uint8_t> vecColumn;
+            putVarint(vecColumn, 1);
+            putVarint(vecColumn, 16);
+            for (uint32_t nToken: tokens) putVarint(vecColumn, nToken);
+            return vecColumn;
+        };
+        std::vector<uint8_t> vecValid = column({7 << 1, 7 << 1});
+        cTerrainRle valid;
+        check(valid.load(vecValid.data(), vecValid.size()) && valid.getColumnTop(0) == 8,
+              "terrain rle loads a column of sky over soil");
+        checkRejected(column({16 << 1}), "a run past the bottom of its column");
+        checkRejected(column({7 << 1, 15 << 1}), "runs adding up to more than the column");
+        checkRejected(column({7 << 1}), "a column that stops short");
+        // a run of 2^31 pixels came out as a negative int length, the runs after it made up the column again
+        checkRejected(column({0xFFFFFFFE}), "a run of 2^31 pixels");
+        checkRejected(column({0xFFFFFFFE, 0xFFFFFFFC, 16 << 1}), "runs adding up to the column through 2^31");
+        checkRejected(column({0xFFFFFFFC, 0xFFFFFFFC, 0xFFFFFFFE, 15 << 1}), "runs adding up past 2^32");
+
+        std::vector<uint8_t> vecHeader;
+        putVarint(vecHeader, 0);
+        putVarint(vecHeader, 16);
+        checkRejected(vecHeader, "a map without columns but with rows");
+        vecHeader.clear();
+        putVarint(vecHeader, 0x80000000u);
+        putVarint(vecHeader, 1);
+        checkRejected(vecHeader, "a width past INT32_MAX");
+        checkRejected({0x81, 0x80, 0x80, 0x80, 0x80, 0x01, 0x01, 0x00}, "a varint longer than 32 bits");
+        checkRejected({}, "no bytes at all");
+
+        // bytes broken after load checked them, the decoders have to notice rather than read past them
+        cTerrainRle broken;
+        broken.load(vecValid.data(), vecValid.size());
+        broken.vecData.pop_back();
+        broken.vecColumnOffset[1]--;
+        std::vector<unsigned char> vecColumn(16);
+        check(!broken.decode(vecColumn.data()), "terrain rle decode fails on a truncated stream");
+        check(!broken.decodeColumn(0, vecColumn.data()), "terrain rle decodeColumn fails on a truncated stream");
+        check(broken.getColumnTop(0) == -1, "terrain rle getColumnTop fails on a truncated stream");
+        broken.load(vecValid.data(), vecValid.size());
+        broken.vecData.back() = 15 << 1;
+        check(!broken.decode(vecColumn.data()) && !broken.decodeColumn(0, vecColumn.data()),
+              "terrain rle decoders fail on a run past the bottom of its column");
+    }
+
+    // Whether the land of vecBefore came to rest in map: as many pixels of every value, none of them over sky
+    static bool checkSettled(const unsigned char *map, const std::vector<unsigned char> &vecBefore, int nWidth,
+                             int nHeight) {
+        std::vector<long long> vecCounts(256, 0);
+        for (unsigned char nPixel: vecBefore) vecCounts[nPixel]++;
+        for (size_t i = 0; i < vecBefore.size(); i++) vecCounts[map[i]]--;
+        if (std::any_of(vecCounts.begin(), vecCounts.end(), [](long long n) { return n != 0; })) return false;
+        for (int y = 0; y + 1 < nHeight; y++) {
+            for (int x = 0; x < nWidth; x++) {
+                if (map[y * nWidth + x] != 0 && map[(y + 1) * nWidth + x] == 0) return false;
+            }
+        }
+        return true;
+    }
+
+    // The terrain after nCraters craters of nRadius blown in at once, the way the nuke's land, or for nCraters 0
+    // after one crater of nRadius undercutting the highest hill, settled until the settler went idle. Settled
+    // twice, it has to come to rest the same way both times.
+    void testTerrainSettle(int nCraters, int nRadius) {
+        Fauji game(true);
+        initGame(game, nSeed, 1024, 512);
+        int nWidth = game.nMapWidth, nHeight = game.nMapHeight;
+        Random rng(nSeed);
+        std::vector<std::pair<int, int>> vecCraters;
+        for (int i = 0; i < nCraters; i++) vecCraters.push_back({rng.nextInt(nWidth), rng.nextInt(nHeight)});
+        if (nCraters == 0) {
+            int x = static_cast<int>(std::min_element(game.vecColumnTop.begin(), game.vecColumnTop.end()) -
+                                     game.vecColumnTop.begin());
+            vecCraters.push_back({x + nRadius, game.vecColumnTop[x] + nRadius});
+        }
+        for (auto &crater: vecCraters) carveCrater(game.map, nWidth, nHeight, crater.first, crater.second, nRadius);
+        std::vector<unsigned char> vecCarved(game.map, game.map + static_cast<size_t>(nWidth) * nHeight);
+        int nReach = getCraterReach(nRadius);
+        std::string what = (nCraters == 0 ? std::string("hillside") : "craters=" + std::to_string(nCraters)) +
+                           ",radius=" + std::to_string(nRadius);
+
+        std::vector<unsigned char> vecFirst;
+        for (int nRun = 0; nRun < 2; nRun++) {
+            std::copy(vecCarved.begin(), vecCarved.end(), game.map);
+            game.terrainSettler.reset(nWidth, nHeight);
+            for (auto &crater: vecCraters) {
+                game.terrainSettler.activate(crater.first - nReach, crater.second - nReach, 2 * nReach + 1,
+                                             2 * nReach + 1);
+            }
+            // a settler that doesn't go idle fails the check instead of hanging the test
+            uint32_t nTick = 0;
+            while (!game.terrainSettler.isIdle() && nTick < 100000) {
+                game.terrainSettler.tick(game.map, ++nTick, [](int, int, int, int) {});
+            }
+            check(game.terrainSettler.isIdle(), "terrain settles in the end, " + what);
+            if (nRun == 0) {
+                check(checkSettled(game.map, vecCarved, nWidth, nHeight), "terrain comes to rest, " + what);
+                vecFirst.assign(game.map, game.map + vecCarved.size());
+            } else {
+                check(std::equal(vecFirst.begin(), vecFirst.end(), game.map),
+                      "terrain settles the same way twice, " + what);
+            }
+        }
+    }
+
+    // everything of a seeded headless all-AI match that goes before onInit
+    static void setupSeededMatch(Fauji &game, uint64_t nSeed, bool bDeterministicAI = true) {
+        game.setFixedTimestep(1.0f / 60.0f);
+        game.setSeed(nSeed);
+        game.setAllTeamsAI(true);
+        game.setDeterministicAI(bDeterministicAI);
+        if (!bDeterministicAI) game.setAIThreadCount(1);
+    }
+
+    // A headless match of nMaxTicks with every team played by the AI, the way a seeded --headless run plays it,
+    // recorded to recordPath when that is set. The AI that isn't deterministic plans on a thread of its own.
+    bool playSeededMatch(int nMaxTicks, cStateLog &log, const std::string &recordPath = "",
+                         bool bDeterministicAI = true) {
+        Fauji game(true);
+        setupSeededMatch(game, nSeed, bDeterministicAI);
+        game.setMaxTicks(nMaxTicks);
+        game.setStateLog(&log);
+        if (!recordPath.empty() && !game.startRecording(recordPath, nSeed)) return false;
+        game.startGameLoop();
+        return true;
+    }
+
+    // replays replayPath with nothing else set, everything the match needs has to come out of the recording
+    static bool replayMatch(const std::string &replayPath, int nMaxTicks, cStateLog &log) {
+        Fauji game(true);
+        game.setFixedTimestep(1.0f / 60.0f);
+        if (!game.startReplay(replayPath)) return false;
+        game.setSeed(game.getReplaySeed());
+        game.setMaxTicks(nMaxTicks);
+        game.setStateLog(&log);
+        game.startGameLoop();
+        return true;
+    }
+
+    // Both runs went through the same states for nTicks ticks, the first difference is printed otherwise
+    void checkSameStates(const cStateLog &a, const cStateLog &b, size_t nTicks, const std::string &what) {
+        std::ostringstream diff;
+        bool bSame = a.vecTicks.size() == nTicks && b.vecTicks.size() == nTicks &&
+                     cStateLog::compare(a, b, "first", "second", diff);
+        check(bSame, what + " (" + std::to_string(a.vecTicks.size()) + " and " + std::to_string(b.vecTicks.size()) +
+                     " ticks)\n" + diff.str());
+    }
+
+    // A seeded all-AI match recorded and replayed without any of its options goes through the same states
+    void testRecordReplay() {
+        const int nTicks = 2400;
+        const std::string path = "fauji-tests-record.frpl";
+        cStateLog recorded, replayed;
+        bool bPlayed = playSeededMatch(nTicks, recorded, path) && replayMatch(path, nTicks, replayed);
+        std::remove(path.c_str());
+        check(bPlayed, "record and replay a seeded all-AI match");
+        if (bPlayed) checkSameStates(recorded, replayed, nTicks, "a replay of a seeded all-AI match");
+    }
+
+    // The planner on its thread plans differently from run to run, its plans go into the recording and a replay
+    // has to act on them in the same ticks, and twice in a row the same way
+    void testReplayDeterminism() {
+        const int nTicks = 3000;
+        const std::string path = "fauji-tests-threaded.frpl";
+        cStateLog recorded, replayed, replayedAgain;
+        bool bPlayed = playSeededMatch(nTicks, recorded, path, false) && replayMatch(path, nTicks, replayed) &&
+                       replayMatch(path, nTicks, replayedAgain);
+        std::remove(path.c_str());
+        check(bPlayed, "record and replay a match of the threaded AI");
+        if (!bPlayed) return;
+        checkSameStates(recorded, replayed, nTicks, "a replay of a match of the threaded AI");
+        checkSameStates(replayed, replayedAgain, nTicks, "a match of the threaded AI replayed twice");
+    }
+
+    // The same seed goes through the same states, another seed doesn't, and the state log keeps them on disk
+    void testStateHashRuns() {
+        const int nTicks = 1200;
+        cStateLog first, second, other;
+        playSeededMatch(nTicks, first);
+        playSeededMatch(nTicks, second);
+        checkSameStates(first, second, nTicks, "a seeded match played twice");
+        nSeed++;
+        playSeededMatch(nTicks, other);
+        nSeed--;
+        std::ostringstream diff;
+        check(other.vecTicks.size() == static_cast<size_t>(nTicks) && !cStateLog::compare(first, other, "first", "other", diff),
+              "matches of different seeds hash different");
+
+        const std::string path = "fauji-tests-states.fstl";
+        cStateLog loaded;
+        bool bLoaded = first.save(path) && loaded.load(path);
+        std::remove(path.c_str());
+        check(bLoaded, "save and load a state log");
+        if (bLoaded) checkSameStates(first, loaded, nTicks, "a state log saved and loaded");
+    }
+
+    // The hash of a tick changes with a single bit of a man's position or a single map pixel and comes back
+    // once they are put back
+    void testStateHashSensitivity() {
+        Fauji game(true);
+        setupSeededMatch(game, nSeed);
+        bool bStarted = game.startSimulation();
+        for (int i = 0; bStarted && i < 300; i++) game.stepSimulation();
+        cMan *pMan = nullptr;
+        for (auto &p: game.listObjects) {
+            if (!pMan) pMan = dynamic_cast<cMan *>(p.get());
+        }
+        check(bStarted && pMan, "a seeded match starts with men");
+        if (!bStarted || !pMan) return;
+
+        TickRecord before, changed, after;
+        game.captureTickState(before);
+        float px = pMan->px;
+        pMan->px = std::nextafter(px, px + 1.0f);
+        game.captureTickState(changed);
+        pMan->px = px;
+        game.captureTickState(after);
+        check(changed.nHash != before.nHash && changed.nMapHash == before.nMapHash,
+              "the state hash changes with one ulp of a man's position");
+        check(after.nHash == before.nHash, "the state hash comes back with the man's position");
+
+        // the lowest row is the last band's
+        size_t nPixel = static_cast<size_t>(game.nMapHeight - 1) * game.nMapWidth + game.nMapWidth / 2;
+        unsigned char nOld = game.map[nPixel];
+        game.map[nPixel] = static_cast<unsigned char>(nOld ^ 1);
+        game.captureTickState(changed);
+        game.map[nPixel] = nOld;
+        game.captureTickState(after);
+        bool bOnlyLastBand = std::equal(before.nMapBandHash, before.nMapBandHash + TickRecord::MAP_BANDS - 1,
+                                        changed.nMapBandHash);
+        check(changed.nHash != before.nHash && changed.nMapHash != before.nMapHash && bOnlyLastBand &&
+              changed.nMapBandHash[TickRecord::MAP_BANDS - 1] != before.nMapBandHash[TickRecord::MAP_BANDS - 1],
+              "the state hash changes with one map pixel, in its band only");
+        check(after.nHash == before.nHash && after.nMapHash == before.nMapHash,
+              "the state hash comes back with the map pixel");
+    }
+
+    // A match that every 50 ticks goes back 50 ticks and runs them again goes through the states of one that
+    // doesn't
+    void testRollbackCheck() {
+        const int nTicks = 2400;
+        cStateLog straight, rolledBack;
+        playSeededMatch(nTicks, straight);
+        Fauji game(true);
+        setupSeededMatch(game, nSeed);
+        game.setRollbackCheck(50);
+        game.setMaxTicks(nTicks);
+        game.setStateLog(&rolledBack);
+        game.startGameLoop();
+        checkSameStates(straight, rolledBack, nTicks, "a match rolled back every 50 ticks");
+    }
+
+    // Saved with projectiles in flight and restored, the ticks after it come out the same the second time
+    void testSaveRestoreState() {
+        const int nTicks = 180;
+        Fauji game(true);
+        setupSeededMatch(game, nSeed);
+        bool bStarted = game.startSimulation();
+        bool bRunning = bStarted;
+        for (int i = 0; bRunning && game.projectiles.size() == 0 && i < 20000; i++) bRunning = game.stepSimulation();
+        check(bRunning && game.projectiles.size() > 0, "a seeded match gets projectiles in flight");
+        if (!bRunning || game.projectiles.size() == 0) return;
+
+        SimulationState state;
+        game.saveState(state);
+        TickRecord saved;
+        game.captureTickState(saved);
+        std::vector<uint64_t> vecFirst, vecSecond;
+        for (int i = 0; i < nTicks && game.stepSimulation(); i++) {
+            TickRecord record;
+            game.captureTickState(record);
+            vecFirst.push_back(record.nHash);
+        }
+        game.restoreState(state);
+        TickRecord restored;
+        game.captureTickState(restored);
+        for (int i = 0; i < nTicks && game.stepSimulation(); i++) {
+            TickRecord record;
+            game.captureTickState(record);
+            vecSecond.push_back(record.nHash);
+        }
+        check(restored.nHash == saved.nHash && restored.nTick == saved.nTick,
+              "restoreState puts back the state saveState saw");
+        check(vecFirst.size() == static_cast<size_t>(nTicks) && vecFirst == vecSecond,
+              "the ticks after restoreState run the way they did after saveState");
+    }
+
+    // Restored, the pool's projectiles are back in their slots, and its free list hands out the slots it would have
+    void testProjectilePoolRestore() {
+        cProjectilePool pool(8);
+        std::vector<cMissile *> vecSpawned;
+        for (int i = 0; i < 5; i++) {
+            vecSpawned.push_back(pool.spawn(WEAPON_GRENADE, 10.0f * i, 20.0f, 1.0f + i, -2.0f));
+        }
+        vecSpawned[1]->bDead = true;
+        vecSpawned[3]->bDead = true;
+        pool.removeDead();
+        cProjectilePool::Saved saved;
+        pool.save(saved);
+        cProjectilePool untouched = pool;
+        std::vector<cMissile *> vecInFlight;
+        for (size_t i = 0; i < pool.size(); i++) vecInFlight.push_back(&pool[i]);
+
+        // everything of it changes before the restore
+        for (size_t i = 0; i < pool.size(); i++) {
+            pool[i].px += 100.0f;
+            pool[i].bDead = true;
+        }
+        pool.removeDead();
+        for (int i = 0; i < 6; i++) pool.spawn(WEAPON_MISSILE, 0.0f, 0.0f, 0.0f, 0.0f);
+        pool.restore(saved);
+
+        bool bSame = pool.size() == untouched.size();
+        for (size_t i = 0; bSame && i < pool.size(); i++) {
+            bSame = &pool[i] == vecInFlight[i] && pool.getSlot(&pool[i]) == untouched.getSlot(&untouched[i]) &&
+                    pool[i].px == untouched[i].px && pool[i].vx == untouched[i].vx && !pool[i].bDead &&
+                    pool[i].nWeapon == WEAPON_GRENADE;
+        }
+        check(bSame, "the projectile pool restores every projectile into its own slot");
+        bool bSameSlots = true;
+        // 3 of the 8 slots are in flight
+        for (int i = 0; i < 5; i++) {
+            cMissile *pRestored = pool.spawn(WEAPON_MISSILE, 0.0f, 0.0f, 0.0f, 0.0f);
+            cMissile *pUntouched = untouched.spawn(WEAPON_MISSILE, 0.0f, 0.0f, 0.0f, 0.0f);
+            bSameSlots &= pRestored && pUntouched && pool.getSlot(pRestored) == untouched.getSlot(pUntouched);
+        }
+        check(bSameSlots && !pool.spawn(WEAPON_MISSILE, 0.0f, 0.0f, 0.0f, 0.0f),
+              "the projectile pool spawns into the slots it would have after a restore");
+    }
+
+    // Whether a snapshot the spectator stream gave back shows what the match did in that tick, as far as the
+    // stream quantises it: positions to 1/8 of a pixel, the turn timer to 1/100 of a second. nMapHash is the
+    // match's map, a stream without one yet shows sky, and nSkyHash is that.
+    static bool sameSpectatorTick(const RenderSnapshot &played, uint64_t nMapHash, uint64_t nSkyHash,
+                                  const RenderSnapshot &seen) {
+        if (seen.vecObjects.size() != played.vecObjects.size()) return false;
+        for (size_t i = 0; i < played.vecObjects.size(); i++) {
+            const ObjectSnapshot &a = played.vecObjects[i], &b = seen.vecObjects[i];
+            if (a.nKind != b.nKind || a.radius != b.radius || std::fabs(a.px - b.px) > 0.07f ||
+                std::fabs(a.py - b.py) > 0.07f) return false;
+            if (a.nKind == OBJECT_MAN && (std::fabs(a.fHealth - b.fHealth) > 0.001f || a.nTeam != b.nTeam ||
+                                          a.bIsPlayable != b.bIsPlayable || a.flipType != b.flipType)) return false;
+            if (a.nKind != OBJECT_MAN && a.nWeapon != b.nWeapon) return false;
+        }
+        cStateHasher map;
+        map.add(seen.vecMap.data(), seen.vecMap.size());
+        if ((seen.vecMap.empty() ? nSkyHash : map.get()) != nMapHash) return false;
+        if (seen.bHasControlledMan != played.bHasControlledMan || seen.gameOverMessage != played.gameOverMessage ||
+            seen.bShowCountDown != played.bShowCountDown || seen.nSelectedWeapon != played.nSelectedWeapon ||
+            std::fabs(seen.fTurnTime - played.fTurnTime) > 0.006f ||
+            std::fabs(seen.fEnergyLevel - played.fEnergyLevel) > 0.001f) return false;
+        return !played.bHasControlledMan || (std::fabs(seen.fManX - played.fManX) <= 0.07f &&
+                                             std::fabs(seen.fShootingAngle - played.fShootingAngle) <= 0.001f);
+    }
+
+    // A match written to a spectator stream shows the same in every tick, seeked to one after the other and in
+    // random order, backwards over keyframes and terrain maps as well
+    void testSpectatorSeek() {
+        const int nTicks = 3600;
+        std::stringstream stream;
+        cSpectatorWriter writer(stream);
+        std::vector<RenderSnapshot> vecPlayed(1);
+        std::vector<uint64_t> vecMapHashes(1);
+        uint64_t nSkyHash = 0;
+        {
+            Fauji game(true);
+            setupSeededMatch(game, nSeed);
+            game.setMaxTicks(nTicks);
+            game.setSpectatorWriter(&writer);
+            bool bRunning = game.startSimulation();
+            check(bRunning, "start a match written to a spectator stream");
+            std::vector<unsigned char> vecSky(static_cast<size_t>(game.nMapWidth) * game.nMapHeight, 0);
+            cStateHasher sky;
+            sky.add(vecSky.data(), vecSky.size());
+            nSkyHash = sky.get();
+            while (bRunning) {
+                bRunning = game.stepSimulation();
+                vecPlayed.emplace_back();
+                game.takeSnapshot(vecPlayed.back());
+                cStateHasher map;
+                map.add(game.map, static_cast<size_t>(game.nMapWidth) * game.nMapHeight);
+                vecMapHashes.push_back(map.get());
+            }
+        }
+        cSpectatorReader reader;
+        bool bLoaded = reader.load(stream, "fauji-tests");
+        check(bLoaded && reader.getFirstTick() == 1 && reader.getLastTick() + 1 == vecPlayed.size() &&
+              reader.getKeyframeCount() > 1, "load a spectator stream of every tick of the match");
+        if (!bLoaded || reader.getLastTick() + 1 != vecPlayed.size()) return;
+
+        std::vector<uint32_t> vecOrder;
+        for (uint32_t nTick = reader.getFirstTick(); nTick <= reader.getLastTick(); nTick++) vecOrder.push_back(nTick);
+        Random rng(nSeed);
+        for (int i = 0; i < 1000; i++) {
+            vecOrder.push_back(reader.getFirstTick() + static_cast<uint32_t>(rng.nextInt(reader.getLastTick())));
+        }
+        int nMismatches = 0;
+        uint32_t nFirstMismatch = 0;
+        for (uint32_t nTick: vecOrder) {
+            RenderSnapshot seen;
+            bool bSeeked = reader.seek(nTick);
+            if (bSeeked) reader.fillSnapshot(seen, 1 << 20, 1 << 20);
+            if (bSeeked && sameSpectatorTick(vecPlayed[nTick], vecMapHashes[nTick], nSkyHash, seen)) continue;
+            if (nMismatches++ == 0) nFirstMismatch = nTick;
+        }
+        check(nMismatches == 0, "every tick of the spectator stream shows what the match did, " +
+                                std::to_string(nMismatches) + " don't, the first at tick " +
+                                std::to_string(nFirstMismatch));
+    }
+
+    // Two lockstep players on localhost exchange their inputs tick by tick, and as soon as one of them hashes a
+    // different state than the other both of them find the desync, in the tick it happened
+    void testLockstepDesync() {
+        const uint32_t nDesyncTick = 10 * cLockstep::HASH_INTERVAL;
+        const uint32_t nMaxTicks = nDesyncTick + 4 * cLockstep::HASH_INTERVAL;
+        LockstepConfig config;
+        config.vecPlayers = {"127.0.0.1:47631", "127.0.0.1:47632"};
+        config.nSessionId = static_cast<uint32_t>(nSeed);
+        cLockstep players[2];
+        bool bStarted = true;
+        for (int i = 0; i < 2; i++) {
+            config.nLocalPlayer = i;
+            bStarted &= players[i].start(config);
+        }
+        check(bStarted, "start two lockstep players on localhost");
+        if (!bStarted) return;
+
+        auto input = [](int nPlayer, uint32_t nTick) { return static_cast<uint8_t>((nTick / 7 + nPlayer) % 128); };
+        int nDelay = players[0].getInputDelay();
+        bool bInputsArrived = true, bHealthyBefore = true;
+        uint32_t nTick = 0;
+        for (; nTick <= nMaxTicks && players[0].isHealthy() && players[1].isHealthy(); nTick++) {
+            for (int i = 0; i < 2; i++) players[i].setLocalInput(nTick + nDelay, input(i, nTick));
+            // nothing waits for a lost datagram longer than a resend
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            bool bReady = false;
+            while (!bReady && std::chrono::steady_clock::now() < deadline) {
+                bool bReady0 = players[0].isTickReady(nTick);
+                bReady = players[1].isTickReady(nTick) && bReady0;
+                if (!players[0].isHealthy() || !players[1].isHealthy()) break;
+                if (!bReady) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (!bReady) break;
+            for (int i = 0; i < 2; i++) {
+                for (int nPlayer = 0; nPlayer < 2; nPlayer++) {
+                    uint8_t nExpected = nTick < static_cast<uint32_t>(nDelay) ? 0 : input(nPlayer, nTick - nDelay);
+                    bInputsArrived &= players[i].getInput(nPlayer, nTick) == nExpected;
+                }
+            }
+            if (!players[0].wantsStateHash(nTick)) continue;
+            bHealthyBefore &= players[0].isHealthy() && players[1].isHealthy();
+            uint64_t nHash = 0x9E3779B97F4A7C15ull * (nTick + 1);
+            players[0].addStateHash(nTick, nHash);
+            players[1].addStateHash(nTick, nTick >= nDesyncTick ? nHash + 1 : nHash);
+        }
+        check(bInputsArrived && bHealthyBefore, "lockstep players get each other's inputs and agree on the state");
+
+        // the one that didn't notice yet still gets the other's hash
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while ((players[0].isHealthy() || players[1].isHealthy()) && std::chrono::steady_clock::now() < deadline) {
+            for (int i = 0; i < 2; i++) players[i].isTickReady(nTick);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const std::string at = " at tick " + std::to_string(nDesyncTick);
+        check(players[0].getError() == "Desync with player 1" + at &&
+              players[1].getError() == "Desync with player 0" + at,
+              "lockstep players find the desync in the tick it happened: '" + players[0].getError() + "', '" +
+              players[1].getError() + "'");
+    }
+
+    // The frame profile of a session a few chunks long comes out whole, every frame a row
+    void testProfilerCsv() {
+        const std::string path = "fauji-tests-profile.csv";
+        const int nFrames = 3 * Profiler::CSV_CHUNK_FRAMES + 17;
+        int nPhase = Profiler::registerPhase("tests");
+        Profiler::setCsvPath(path);
+        for (int i = 0; i < nFrames; i++) {
+            Profiler::addTime(nPhase, std::chrono::microseconds(i));
+            Profiler::endFrame();
+        }
+        bool bWritten = Profiler::writeCsv();
+        Profiler::setCsvPath("");
+        std::ifstream file(path);
+        std::string line, last;
+        int nLines = 0;
+        while (std::getline(file, line)) {
+            nLines++;
+            last = line;
+        }
+        file.close();
+        std::remove(path.c_str());
+        check(bWritten && nLines == nFrames + 1 && last.rfind(std::to_string(nFrames - 1) + ",", 0) == 0,
+              "profiler writes every frame of a long session to the csv");
+    }
+
+public:
+    explicit FaujiTests(uint64_t nSeed) : nSeed(nSeed) {}
+
+    // the number of failed checks
+    int run() {
+        testTerrainRleRoundTrip();
+        testTerrainRleMalformed();
+        testTerrainSettle(1, 20);
+        testTerrainSettle(100, 20);
+        testTerrainSettle(0, 80);
+        testRecordReplay();
+        testReplayDeterminism();
+        testStateHashRuns();
+        testStateHashSensitivity();
+        testRollbackCheck();
+        testSaveRestoreState();
+        testProjectilePoolRestore();
+        testSpectatorSeek();
+        testLockstepDesync();
+        testProfilerCsv();
+        std::cout << nChecks - nFailures << " of " << nChecks << " checks passed" << std::endl;
+        return nFailures;
+    }
+};
+
+int main(int argc, char *argv[]) {
+    uint64_t nSeed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            nSeed = std::stoull(argv[++i]);
+        } else {
+            std::cout << "usage: fauji-tests [--seed n]" << std::endl;
+            return 1;
+        }
+    }
+    FaujiTests tests(nSeed);
+    return tests.run() == 0 ? 0 : 1;
+}
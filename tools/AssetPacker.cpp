@@ -0,0 +1,79 @@
+#include "AssetArchive.hpp"
+#include <SDL.h>
+#include <SDL_image.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// fauji-pack: packs the game's assets into one archive (see AssetArchive.hpp), run by the build.
+// PNGs are decoded and colour keyed here, the same way LTexture::loadTextureFromFile does it at runtime,
+// everything else is copied as it is.
+
+namespace {
+    std::string fileNameOf(const std::string &path) {
+        size_t nSlash = path.find_last_of("/\\");
+        return nSlash == std::string::npos ? path : path.substr(nSlash + 1);
+    }
+
+    bool endsWith(const std::string &text, const std::string &suffix) {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool addImage(AssetArchiveWriter &writer, const std::string &path) {
+        SDL_Surface *loadedSurface = IMG_Load(path.c_str());
+        if (loadedSurface == nullptr) {
+            std::cout << "Unable to load image " << path << " SDL_image Error: " << IMG_GetError() << std::endl;
+            return false;
+        }
+        SDL_Surface *surface = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loadedSurface);
+        if (surface == nullptr) {
+            std::cout << "Unable to convert image " << path << " SDL Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        // colour key: cyan pixels are transparent
+        SDL_LockSurface(surface);
+        auto *pixels = static_cast<unsigned char *>(surface->pixels);
+        for (int y = 0; y < surface->h; y++) {
+            unsigned char *row = pixels + y * surface->pitch;
+            for (int x = 0; x < surface->w; x++) {
+                unsigned char *pixel = row + x * 4;
+                if (pixel[0] == 0 && pixel[1] == 0xFF && pixel[2] == 0xFF) {
+                    pixel[3] = 0;
+                }
+            }
+        }
+        bool bAdded = writer.addImage(fileNameOf(path), static_cast<uint32_t>(surface->w),
+                                      static_cast<uint32_t>(surface->h), pixels, static_cast<uint32_t>(surface->pitch));
+        SDL_UnlockSurface(surface);
+        SDL_FreeSurface(surface);
+        return bAdded;
+    }
+
+    bool addFile(AssetArchiveWriter &writer, const std::string &path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cout << "Unable to open " << path << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return writer.addBlob(fileNameOf(path), std::move(data));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cout << "usage: fauji-pack archive.pak asset..." << std::endl;
+        return 1;
+    }
+    AssetArchiveWriter writer;
+    for (int i = 2; i < argc; i++) {
+        std::string path = argv[i];
+        bool bAdded = endsWith(path, ".png") ? addImage(writer, path) : addFile(writer, path);
+        if (!bAdded) {
+            return 1;
+        }
+    }
+    return writer.write(argv[1]) ? 0 : 1;
+}